@@ -0,0 +1,420 @@
+/*
+ * =============================================================
+ *
+ * 	ntAdmission.cpp
+ *
+ *	Source file that implements the admission control and fair
+ *	scheduling of the requests of client connections.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntAdmission.h>
+#include <pv/ntThreadPlacement.h>
+#include <pv/ntTrace.h>
+
+#include <cstdlib>
+#include <sstream>
+
+#include <epicsTime.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::ntDatabase;
+
+class NTAdmission::Client {
+	public:
+		Client(string const &name, double weight, double tokens, epicsUInt64 now)
+			: name(name), weight(weight), users(0),
+			  tokens(tokens), refill(now), deficit(0.0),
+			  running(false), outstanding(0),
+			  admitted(0), throttled(0), rejected(0),
+			  started(0), totalWait(0), maxWait(0) {}
+
+		struct Waiting {
+			NTAdmissionTaskPtr task;
+			epicsUInt64 arrival;   // epicsMonotonicGet() time
+		};
+
+		string name;
+		double weight;
+		size_t users;
+
+		// Token bucket, last refilled at refill.
+		double tokens;
+		epicsUInt64 refill;
+
+		// Requests the connection may still run in this round.
+		double deficit;
+		deque<Waiting> waiting;
+		bool running;
+		// Requests admitted and not yet ended.
+		size_t outstanding;
+
+		size_t admitted;
+		size_t throttled;
+		size_t rejected;
+		size_t started;
+		epicsUInt64 totalWait;   // nanoseconds
+		epicsUInt64 maxWait;
+};
+
+bool NTAdmissionOptions::parse(string const &text, NTAdmissionOptions &options)
+{
+	NTAdmissionOptions parsed(options);
+	stringstream in(text);
+	string item;
+
+	while (getline(in, item, ':')) {
+		size_t equals = item.find('=');
+		if (equals == string::npos) return false;
+
+		string key = item.substr(0, equals);
+		string value = item.substr(equals + 1);
+		char *end;
+
+		if (key == "workers") {
+			parsed.workers = strtoul(value.c_str(), &end, 10);
+			if (*end != '\0' || parsed.workers == 0) return false;
+		} else if (key == "rate") {
+			parsed.rate = strtod(value.c_str(), &end);
+			if (*end != '\0' || parsed.rate < 0.0) return false;
+		} else if (key == "burst") {
+			parsed.burst = strtod(value.c_str(), &end);
+			if (*end != '\0' || parsed.burst < 1.0) return false;
+		} else if (key == "depth") {
+			parsed.queueDepth = strtoul(value.c_str(), &end, 10);
+			if (*end != '\0' || parsed.queueDepth == 0) return false;
+		} else {
+			return false;
+		}
+	}
+
+	options = parsed;
+	return true;
+}
+
+NTAdmission::Worker::Worker(NTAdmission &admission, string const &name)
+	: admission(admission),
+	  thread(*this, name.c_str(),
+		epicsThreadGetStackSize(epicsThreadStackMedium),
+		epicsThreadPriorityMedium)
+{
+}
+
+void NTAdmission::Worker::run()
+{
+	NTThreadPlacement::applyRole("io");
+	admission.work();
+}
+
+NTAdmissionPtr NTAdmission::create(NTAdmissionOptions const &options)
+{
+	NTAdmissionPtr admission(new NTAdmission(options));
+
+	size_t workers = options.workers ? options.workers : 1;
+
+	for (size_t i = 0; i < workers; ++i) {
+		stringstream name;
+		name << "ntAdmission" << i;
+
+		admission->workers.push_back(new Worker(*admission, name.str()));
+		admission->workers.back()->thread.start();
+	}
+
+	return admission;
+}
+
+NTAdmission::NTAdmission(NTAdmissionOptions const &options)
+	: options(options),
+	  throttled(0),
+	  rejected(0),
+	  stopping(false)
+{
+	if (this->options.burst < 1.0)
+		this->options.burst = this->options.rate < 1.0 ? 1.0 : this->options.rate;
+	if (this->options.queueDepth == 0) this->options.queueDepth = 1;
+
+	closed.reset(new Client("closed", 0.0, 0.0, 0));
+}
+
+NTAdmission::~NTAdmission()
+{
+	stop();
+
+	for (size_t i = 0; i < workers.size(); ++i)
+		delete workers[i];
+}
+
+NTAdmission::ClientPtr NTAdmission::connect(string const &name)
+{
+	Lock lock(mutex);
+
+	ClientPtr &client = clients[name];
+
+	if (!client) {
+		// Weighted by the host, the name without its port, or by the whole name.
+		double weight = 1.0;
+		map<string, double>::const_iterator it = options.weights.find(name);
+		if (it == options.weights.end()) it = options.weights.find(name.substr(0, name.rfind(':')));
+		if (it != options.weights.end() && it->second > 0.0) weight = it->second;
+
+		client.reset(new Client(name, weight, options.burst, epicsMonotonicGet()));
+	}
+
+	++client->users;
+
+	return client;
+}
+
+void NTAdmission::disconnect(ClientPtr const &client)
+{
+	Lock lock(mutex);
+
+	if (client->users == 0 || --client->users > 0) return;
+
+	// Requests still waiting run or are refused as the connection's
+	// channels are gone, but are no longer counted.
+	map<string, ClientPtr>::iterator it = clients.find(client->name);
+	if (it != clients.end() && it->second == client) clients.erase(it);
+
+	closed->admitted += client->admitted;
+	closed->throttled += client->throttled;
+	closed->rejected += client->rejected;
+	closed->started += client->started;
+	closed->totalWait += client->totalWait;
+	if (client->maxWait > closed->maxWait) closed->maxWait = client->maxWait;
+}
+
+bool NTAdmission::submit(ClientPtr const &client, NTAdmissionTaskPtr const &task)
+{
+	string reason;
+	bool wake(false);
+
+	{
+		Lock lock(mutex);
+
+		epicsUInt64 now = epicsMonotonicGet();
+
+		if (stopping) {
+			reason = "server is stopping";
+		} else if (client->outstanding >= options.queueDepth) {
+			reason = "too many requests of " + client->name + " queued";
+			++client->rejected;
+			++rejected;
+		} else {
+			if (options.rate > 0.0) {
+				client->tokens += (now - client->refill) / 1e9 * options.rate;
+				if (client->tokens > options.burst) client->tokens = options.burst;
+				client->refill = now;
+			}
+
+			if (options.rate > 0.0 && client->tokens < 1.0) {
+				reason = "request rate of " + client->name + " over its limit";
+				++client->throttled;
+				++throttled;
+			} else {
+				if (options.rate > 0.0) client->tokens -= 1.0;
+
+				Client::Waiting waiting;
+				waiting.task = task;
+				waiting.arrival = now;
+
+				// A connection joins the round when it has work and none running.
+				wake = client->waiting.empty() && !client->running;
+				if (wake) ready.push_back(client);
+
+				client->waiting.push_back(waiting);
+				++client->outstanding;
+				++client->admitted;
+			}
+		}
+	}
+
+	if (reason.empty()) {
+		if (wake) wakeUp.signal();
+		return true;
+	}
+
+	// Refused at once, in the caller's thread.
+	task->refuse(reason);
+	return false;
+}
+
+void NTAdmission::finish(ClientPtr const &client)
+{
+	Lock lock(mutex);
+	if (client->outstanding > 0) --client->outstanding;
+}
+
+bool NTAdmission::next(ClientPtr &client, NTAdmissionTaskPtr &task)
+{
+	while (!ready.empty()) {
+		ClientPtr candidate = ready.front();
+		ready.pop_front();
+
+		// Deficit round robin: each turn of the round adds the connection's
+		// weight to its deficit, and a request costs one.
+		if (candidate->deficit < 1.0) {
+			candidate->deficit += candidate->weight;
+			ready.push_back(candidate);
+			continue;
+		}
+
+		candidate->deficit -= 1.0;
+
+		Client::Waiting waiting = candidate->waiting.front();
+		candidate->waiting.pop_front();
+		candidate->running = true;
+
+		epicsUInt64 now = epicsMonotonicGet();
+		epicsUInt64 wait = now - waiting.arrival;
+
+		++candidate->started;
+		candidate->totalWait += wait;
+		if (wait > candidate->maxWait) candidate->maxWait = wait;
+
+		if (NTTrace::isEnabled())
+			NTTrace::record("admission.wait", candidate->name, waiting.arrival, now);
+
+		client = candidate;
+		task = waiting.task;
+		return true;
+	}
+
+	return false;
+}
+
+void NTAdmission::work()
+{
+	while (true) {
+
+		ClientPtr client;
+		NTAdmissionTaskPtr task;
+		bool more(false);
+
+		{
+			Lock lock(mutex);
+
+			if (next(client, task)) more = !ready.empty();
+			else if (stopping) break;
+		}
+
+		if (!task) {
+			wakeUp.wait();
+			continue;
+		}
+
+		// One signal wakes one worker, so pass it on while work is left.
+		if (more) wakeUp.signal();
+
+		bool ended = task->run();
+		task.reset();
+
+		bool wake(false);
+
+		{
+			Lock lock(mutex);
+
+			client->running = false;
+			if (ended && client->outstanding > 0) --client->outstanding;
+
+			// The connection keeps its turn while its deficit lasts, and an
+			// idle connection does not save up a deficit.
+			if (client->waiting.empty()) {
+				client->deficit = 0.0;
+			} else {
+				if (client->deficit >= 1.0) ready.push_front(client);
+				else ready.push_back(client);
+				wake = true;
+			}
+		}
+
+		if (wake) wakeUp.signal();
+	}
+
+	// Let the next worker see that the admission is stopping.
+	wakeUp.signal();
+}
+
+static NTAdmission::Counters countersOf(NTAdmission::Client const &client)
+{
+	NTAdmission::Counters counters;
+
+	counters.client = client.name;
+	counters.weight = client.weight;
+	counters.admitted = client.admitted;
+	counters.throttled = client.throttled;
+	counters.rejected = client.rejected;
+	counters.queued = client.outstanding;
+	counters.meanWait = client.started ? client.totalWait / 1e9 / client.started : 0.0;
+	counters.maxWait = client.maxWait / 1e9;
+
+	return counters;
+}
+
+vector<NTAdmission::Counters> NTAdmission::getCounters()
+{
+	Lock lock(mutex);
+
+	vector<Counters> counters;
+	counters.reserve(clients.size() + 1);
+
+	map<string, ClientPtr>::const_iterator it;
+	for (it = clients.begin(); it != clients.end(); ++it)
+		counters.push_back(countersOf(*it->second));
+
+	if (closed->admitted || closed->throttled || closed->rejected)
+		counters.push_back(countersOf(*closed));
+
+	return counters;
+}
+
+size_t NTAdmission::getThrottled()
+{
+	Lock lock(mutex);
+	return throttled;
+}
+
+size_t NTAdmission::getRejected()
+{
+	Lock lock(mutex);
+	return rejected;
+}
+
+void NTAdmission::stop()
+{
+	vector<NTAdmissionTaskPtr> abandoned;
+
+	{
+		Lock lock(mutex);
+		if (stopping) return;
+		stopping = true;
+
+		// The connections gone may still have requests waiting in ready,
+		// and those running are not in it.
+		vector<ClientPtr> waiting(ready.begin(), ready.end());
+		map<string, ClientPtr>::const_iterator it;
+		for (it = clients.begin(); it != clients.end(); ++it)
+			waiting.push_back(it->second);
+
+		for (size_t i = 0; i < waiting.size(); ++i) {
+			Client &client = *waiting[i];
+
+			for (size_t j = 0; j < client.waiting.size(); ++j)
+				abandoned.push_back(client.waiting[j].task);
+
+			client.outstanding -= client.waiting.size();
+			client.waiting.clear();
+		}
+		ready.clear();
+	}
+
+	for (size_t i = 0; i < abandoned.size(); ++i)
+		abandoned[i]->refuse("server is stopping");
+
+	wakeUp.signal();
+
+	for (size_t i = 0; i < workers.size(); ++i)
+		workers[i]->thread.exitWait();
+}
@@ -0,0 +1,1222 @@
+/*
+ * =============================================================
+ *
+ * 	ntAdmissionProvider.cpp
+ *
+ *	Source file that implements the channel provider passing the
+ *	writes, processes and RPCs of client connections through
+ *	admission control.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntAdmissionProvider.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::pvAccess;
+using namespace epics::ntDatabase;
+
+const string NTAdmissionProvider::providerName("ntAdmission");
+
+/*
+ * Channel handed to the server in place of the wrapped one. It counts as
+ * a user of its client's connection until destroyed, and creates the
+ * wrappers of the requests that are admitted.
+ */
+class AdmissionChannel :
+	public Channel,
+	public std::tr1::enable_shared_from_this<AdmissionChannel>
+{
+	public:
+		AdmissionChannel(
+			ChannelProvider::shared_pointer const &provider,
+			Channel::shared_pointer const &inner,
+			ChannelRequester::shared_pointer const &requester,
+			ChannelRequester::shared_pointer const &innerRequester,
+			NTAdmissionPtr const &admission)
+			: provider(provider), inner(inner), requester(requester),
+			  innerRequester(innerRequester), admission(admission),
+			  client(admission->connect(requester->getRequesterName())),
+			  destroyed(false) {}
+
+		virtual ~AdmissionChannel() { destroy(); }
+
+		Channel::shared_pointer getInner() const { return inner; }
+
+		void submit(NTAdmissionTaskPtr const &task) { admission->submit(client, task); }
+		void finish() { admission->finish(client); }
+
+		virtual string getRequesterName()
+		{
+			ChannelRequester::shared_pointer channelRequester = requester.lock();
+			return channelRequester ? channelRequester->getRequesterName() : inner->getChannelName();
+		}
+
+		virtual void message(string const &message, MessageType messageType)
+		{
+			ChannelRequester::shared_pointer channelRequester = requester.lock();
+			if (channelRequester) channelRequester->message(message, messageType);
+		}
+
+		virtual ChannelProvider::shared_pointer getProvider() { return provider; }
+		virtual string getRemoteAddress() { return inner->getRemoteAddress(); }
+		virtual Channel::ConnectionState getConnectionState() { return inner->getConnectionState(); }
+		virtual string getChannelName() { return inner->getChannelName(); }
+		virtual ChannelRequester::shared_pointer getChannelRequester() { return requester.lock(); }
+		virtual bool isConnected() { return inner->isConnected(); }
+
+		virtual void getField(GetFieldRequester::shared_pointer const &fieldRequester, string const &subField)
+		{
+			inner->getField(fieldRequester, subField);
+		}
+
+		virtual AccessRights getAccessRights(PVFieldPtr const &pvField)
+		{
+			return inner->getAccessRights(pvField);
+		}
+
+		virtual ChannelProcess::shared_pointer createChannelProcess(
+			ChannelProcessRequester::shared_pointer const &processRequester,
+			PVStructurePtr const &pvRequest);
+
+		virtual ChannelGet::shared_pointer createChannelGet(
+			ChannelGetRequester::shared_pointer const &getRequester,
+			PVStructurePtr const &pvRequest)
+		{
+			return inner->createChannelGet(getRequester, pvRequest);
+		}
+
+		virtual ChannelPut::shared_pointer createChannelPut(
+			ChannelPutRequester::shared_pointer const &putRequester,
+			PVStructurePtr const &pvRequest);
+
+		virtual ChannelPutGet::shared_pointer createChannelPutGet(
+			ChannelPutGetRequester::shared_pointer const &putGetRequester,
+			PVStructurePtr const &pvRequest);
+
+		virtual ChannelRPC::shared_pointer createChannelRPC(
+			ChannelRPCRequester::shared_pointer const &rpcRequester,
+			PVStructurePtr const &pvRequest);
+
+		virtual Monitor::shared_pointer createMonitor(
+			MonitorRequester::shared_pointer const &monitorRequester,
+			PVStructurePtr const &pvRequest)
+		{
+			return inner->createMonitor(monitorRequester, pvRequest);
+		}
+
+		virtual ChannelArray::shared_pointer createChannelArray(
+			ChannelArrayRequester::shared_pointer const &arrayRequester,
+			PVStructurePtr const &pvRequest);
+
+		virtual void printInfo(ostream &out) { inner->printInfo(out); }
+
+		virtual void destroy()
+		{
+			{
+				Lock lock(mutex);
+				if (destroyed) return;
+				destroyed = true;
+			}
+
+			inner->destroy();
+			admission->disconnect(client);
+		}
+
+	private:
+		ChannelProvider::shared_pointer provider;
+		Channel::shared_pointer inner;
+		ChannelRequester::weak_pointer requester;
+		// Given to the wrapped channel, which may hold it weakly.
+		ChannelRequester::shared_pointer innerRequester;
+		NTAdmissionPtr admission;
+		NTAdmission::ClientPtr client;
+
+		Mutex mutex;
+		bool destroyed;
+};
+
+typedef std::tr1::shared_ptr<AdmissionChannel> AdmissionChannelPtr;
+
+/*
+ * Requester given to the wrapped provider. It wraps the channel once
+ * created and reports the wrapper to the server's requester.
+ */
+class AdmissionChannelRequester :
+	public ChannelRequester,
+	public std::tr1::enable_shared_from_this<AdmissionChannelRequester>
+{
+	public:
+		AdmissionChannelRequester(
+			ChannelProvider::shared_pointer const &provider,
+			ChannelRequester::shared_pointer const &requester,
+			NTAdmissionPtr const &admission)
+			: provider(provider), requester(requester), admission(admission),
+			  creating(true) {}
+
+		// The wrapper made by channelCreated() while the wrapped provider's
+		// createChannel() ran, to return in place of its channel. A wrapper
+		// made later is only held by the server.
+		Channel::shared_pointer takeChannel()
+		{
+			Lock lock(mutex);
+			Channel::shared_pointer channel = created;
+			created.reset();
+			creating = false;
+			return channel;
+		}
+
+		virtual string getRequesterName()
+		{
+			ChannelRequester::shared_pointer channelRequester = requester.lock();
+			return channelRequester ? channelRequester->getRequesterName() : string();
+		}
+
+		virtual void message(string const &message, MessageType messageType)
+		{
+			ChannelRequester::shared_pointer channelRequester = requester.lock();
+			if (channelRequester) channelRequester->message(message, messageType);
+		}
+
+		virtual void channelCreated(Status const &status, Channel::shared_pointer const &channel)
+		{
+			ChannelRequester::shared_pointer channelRequester = requester.lock();
+			if (!channelRequester) return;
+
+			if (!channel) {
+				channelRequester->channelCreated(status, channel);
+				return;
+			}
+
+			AdmissionChannelPtr wrapper(new AdmissionChannel(
+				provider, channel, channelRequester, shared_from_this(), admission));
+
+			{
+				Lock lock(mutex);
+				wrapped = wrapper;
+				if (creating) created = wrapper;
+			}
+
+			channelRequester->channelCreated(status, wrapper);
+		}
+
+		virtual void channelStateChange(Channel::shared_pointer const &channel, Channel::ConnectionState state)
+		{
+			ChannelRequester::shared_pointer channelRequester = requester.lock();
+			if (!channelRequester) return;
+
+			AdmissionChannelPtr wrapper;
+			{
+				Lock lock(mutex);
+				wrapper = wrapped.lock();
+			}
+
+			if (wrapper) channelRequester->channelStateChange(wrapper, state);
+			else channelRequester->channelStateChange(channel, state);
+		}
+
+	private:
+		ChannelProvider::shared_pointer provider;
+		ChannelRequester::weak_pointer requester;
+		NTAdmissionPtr admission;
+
+		Mutex mutex;
+		std::tr1::weak_ptr<AdmissionChannel> wrapped;
+		Channel::shared_pointer created;
+		bool creating;
+};
+
+/*
+ * ChannelPut handed to the server in place of the wrapped one. It is
+ * also the requester of the wrapped one, so that the server only ever
+ * sees the wrapper.
+ */
+class AdmissionPut :
+	public ChannelPut,
+	public ChannelPutRequester,
+	public std::tr1::enable_shared_from_this<AdmissionPut>
+{
+	public:
+		AdmissionPut(
+			AdmissionChannelPtr const &channel,
+			ChannelPutRequester::shared_pointer const &requester)
+			: channel(channel), requester(requester) {}
+
+		void connect(PVStructurePtr const &pvRequest)
+		{
+			ChannelPut::shared_pointer put =
+				channel->getInner()->createChannelPut(shared_from_this(), pvRequest);
+
+			Lock lock(mutex);
+			if (!inner) inner = put;
+		}
+
+		// Puts to the wrapped channel, once admitted.
+		void admitted(PVStructurePtr const &pvPutStructure, BitSetPtr const &putBitSet)
+		{
+			ChannelPut::shared_pointer put = getInner();
+			if (put) put->put(pvPutStructure, putBitSet);
+			else refuse("channel destroyed");
+		}
+
+		void refuse(string const &reason)
+		{
+			ChannelPutRequester::shared_pointer putRequester = requester.lock();
+			if (putRequester)
+				putRequester->putDone(Status(Status::STATUSTYPE_ERROR, reason), shared_from_this());
+		}
+
+		virtual Channel::shared_pointer getChannel() { return channel; }
+
+		virtual void put(PVStructurePtr const &pvPutStructure, BitSetPtr const &putBitSet);
+
+		virtual void get()
+		{
+			ChannelPut::shared_pointer put = getInner();
+			if (put) put->get();
+		}
+
+		virtual void cancel()
+		{
+			ChannelPut::shared_pointer put = getInner();
+			if (put) put->cancel();
+		}
+
+		virtual void lastRequest()
+		{
+			ChannelPut::shared_pointer put = getInner();
+			if (put) put->lastRequest();
+		}
+
+		virtual void lock()
+		{
+			ChannelPut::shared_pointer put = getInner();
+			if (put) put->lock();
+		}
+
+		virtual void unlock()
+		{
+			ChannelPut::shared_pointer put = getInner();
+			if (put) put->unlock();
+		}
+
+		virtual void destroy()
+		{
+			ChannelPut::shared_pointer put;
+			{
+				Lock lock(mutex);
+				put.swap(inner);
+			}
+			if (put) put->destroy();
+		}
+
+		virtual string getRequesterName()
+		{
+			ChannelPutRequester::shared_pointer putRequester = requester.lock();
+			return putRequester ? putRequester->getRequesterName() : string();
+		}
+
+		virtual void message(string const &message, MessageType messageType)
+		{
+			ChannelPutRequester::shared_pointer putRequester = requester.lock();
+			if (putRequester) putRequester->message(message, messageType);
+		}
+
+		virtual void channelPutConnect(
+			Status const &status,
+			ChannelPut::shared_pointer const &channelPut,
+			StructureConstPtr const &structure)
+		{
+			{
+				Lock lock(mutex);
+				if (!inner) inner = channelPut;
+			}
+
+			ChannelPutRequester::shared_pointer putRequester = requester.lock();
+			if (putRequester) putRequester->channelPutConnect(status, shared_from_this(), structure);
+		}
+
+		virtual void putDone(Status const &status, ChannelPut::shared_pointer const &)
+		{
+			ChannelPutRequester::shared_pointer putRequester = requester.lock();
+			if (putRequester) putRequester->putDone(status, shared_from_this());
+		}
+
+		virtual void getDone(
+			Status const &status,
+			ChannelPut::shared_pointer const &,
+			PVStructurePtr const &pvStructure,
+			BitSetPtr const &bitSet)
+		{
+			ChannelPutRequester::shared_pointer putRequester = requester.lock();
+			if (putRequester) putRequester->getDone(status, shared_from_this(), pvStructure, bitSet);
+		}
+
+	private:
+		ChannelPut::shared_pointer getInner()
+		{
+			Lock lock(mutex);
+			return inner;
+		}
+
+		AdmissionChannelPtr channel;
+		ChannelPutRequester::weak_pointer requester;
+
+		Mutex mutex;
+		ChannelPut::shared_pointer inner;
+};
+
+typedef std::tr1::shared_ptr<AdmissionPut> AdmissionPutPtr;
+
+class PutTask : public NTAdmissionTask {
+	public:
+		PutTask(AdmissionPutPtr const &put, PVStructurePtr const &pvPutStructure, BitSetPtr const &putBitSet)
+			: put(put), pvPutStructure(pvPutStructure), putBitSet(putBitSet) {}
+
+		virtual bool run()
+		{
+			// The local provider processes the record and answers in put().
+			put->admitted(pvPutStructure, putBitSet);
+			return true;
+		}
+
+		virtual void refuse(string const &reason) { put->refuse(reason); }
+
+	private:
+		AdmissionPutPtr put;
+		PVStructurePtr pvPutStructure;
+		BitSetPtr putBitSet;
+};
+
+void AdmissionPut::put(PVStructurePtr const &pvPutStructure, BitSetPtr const &putBitSet)
+{
+	channel->submit(NTAdmissionTaskPtr(new PutTask(shared_from_this(), pvPutStructure, putBitSet)));
+}
+
+// ChannelPutGet handed to the server in place of the wrapped one.
+class AdmissionPutGet :
+	public ChannelPutGet,
+	public ChannelPutGetRequester,
+	public std::tr1::enable_shared_from_this<AdmissionPutGet>
+{
+	public:
+		AdmissionPutGet(
+			AdmissionChannelPtr const &channel,
+			ChannelPutGetRequester::shared_pointer const &requester)
+			: channel(channel), requester(requester) {}
+
+		void connect(PVStructurePtr const &pvRequest)
+		{
+			ChannelPutGet::shared_pointer putGet =
+				channel->getInner()->createChannelPutGet(shared_from_this(), pvRequest);
+
+			Lock lock(mutex);
+			if (!inner) inner = putGet;
+		}
+
+		void admitted(PVStructurePtr const &pvPutStructure, BitSetPtr const &putBitSet)
+		{
+			ChannelPutGet::shared_pointer putGet = getInner();
+			if (putGet) putGet->putGet(pvPutStructure, putBitSet);
+			else refuse("channel destroyed");
+		}
+
+		void refuse(string const &reason)
+		{
+			ChannelPutGetRequester::shared_pointer putGetRequester = requester.lock();
+			if (putGetRequester)
+				putGetRequester->putGetDone(
+					Status(Status::STATUSTYPE_ERROR, reason), shared_from_this(),
+					PVStructurePtr(), BitSetPtr());
+		}
+
+		virtual Channel::shared_pointer getChannel() { return channel; }
+
+		virtual void putGet(PVStructurePtr const &pvPutStructure, BitSetPtr const &putBitSet);
+
+		virtual void getPut()
+		{
+			ChannelPutGet::shared_pointer putGet = getInner();
+			if (putGet) putGet->getPut();
+		}
+
+		virtual void getGet()
+		{
+			ChannelPutGet::shared_pointer putGet = getInner();
+			if (putGet) putGet->getGet();
+		}
+
+		virtual void cancel()
+		{
+			ChannelPutGet::shared_pointer putGet = getInner();
+			if (putGet) putGet->cancel();
+		}
+
+		virtual void lastRequest()
+		{
+			ChannelPutGet::shared_pointer putGet = getInner();
+			if (putGet) putGet->lastRequest();
+		}
+
+		virtual void lock()
+		{
+			ChannelPutGet::shared_pointer putGet = getInner();
+			if (putGet) putGet->lock();
+		}
+
+		virtual void unlock()
+		{
+			ChannelPutGet::shared_pointer putGet = getInner();
+			if (putGet) putGet->unlock();
+		}
+
+		virtual void destroy()
+		{
+			ChannelPutGet::shared_pointer putGet;
+			{
+				Lock lock(mutex);
+				putGet.swap(inner);
+			}
+			if (putGet) putGet->destroy();
+		}
+
+		virtual string getRequesterName()
+		{
+			ChannelPutGetRequester::shared_pointer putGetRequester = requester.lock();
+			return putGetRequester ? putGetRequester->getRequesterName() : string();
+		}
+
+		virtual void message(string const &message, MessageType messageType)
+		{
+			ChannelPutGetRequester::shared_pointer putGetRequester = requester.lock();
+			if (putGetRequester) putGetRequester->message(message, messageType);
+		}
+
+		virtual void channelPutGetConnect(
+			Status const &status,
+			ChannelPutGet::shared_pointer const &channelPutGet,
+			StructureConstPtr const &putStructure,
+			StructureConstPtr const &getStructure)
+		{
+			{
+				Lock lock(mutex);
+				if (!inner) inner = channelPutGet;
+			}
+
+			ChannelPutGetRequester::shared_pointer putGetRequester = requester.lock();
+			if (putGetRequester)
+				putGetRequester->channelPutGetConnect(status, shared_from_this(), putStructure, getStructure);
+		}
+
+		virtual void putGetDone(
+			Status const &status,
+			ChannelPutGet::shared_pointer const &,
+			PVStructurePtr const &pvGetStructure,
+			BitSetPtr const &getBitSet)
+		{
+			ChannelPutGetRequester::shared_pointer putGetRequester = requester.lock();
+			if (putGetRequester)
+				putGetRequester->putGetDone(status, shared_from_this(), pvGetStructure, getBitSet);
+		}
+
+		virtual void getPutDone(
+			Status const &status,
+			ChannelPutGet::shared_pointer const &,
+			PVStructurePtr const &pvPutStructure,
+			BitSetPtr const &putBitSet)
+		{
+			ChannelPutGetRequester::shared_pointer putGetRequester = requester.lock();
+			if (putGetRequester)
+				putGetRequester->getPutDone(status, shared_from_this(), pvPutStructure, putBitSet);
+		}
+
+		virtual void getGetDone(
+			Status const &status,
+			ChannelPutGet::shared_pointer const &,
+			PVStructurePtr const &pvGetStructure,
+			BitSetPtr const &getBitSet)
+		{
+			ChannelPutGetRequester::shared_pointer putGetRequester = requester.lock();
+			if (putGetRequester)
+				putGetRequester->getGetDone(status, shared_from_this(), pvGetStructure, getBitSet);
+		}
+
+	private:
+		ChannelPutGet::shared_pointer getInner()
+		{
+			Lock lock(mutex);
+			return inner;
+		}
+
+		AdmissionChannelPtr channel;
+		ChannelPutGetRequester::weak_pointer requester;
+
+		Mutex mutex;
+		ChannelPutGet::shared_pointer inner;
+};
+
+typedef std::tr1::shared_ptr<AdmissionPutGet> AdmissionPutGetPtr;
+
+class PutGetTask : public NTAdmissionTask {
+	public:
+		PutGetTask(AdmissionPutGetPtr const &putGet, PVStructurePtr const &pvPutStructure, BitSetPtr const &putBitSet)
+			: putGet(putGet), pvPutStructure(pvPutStructure), putBitSet(putBitSet) {}
+
+		virtual bool run()
+		{
+			putGet->admitted(pvPutStructure, putBitSet);
+			return true;
+		}
+
+		virtual void refuse(string const &reason) { putGet->refuse(reason); }
+
+	private:
+		AdmissionPutGetPtr putGet;
+		PVStructurePtr pvPutStructure;
+		BitSetPtr putBitSet;
+};
+
+void AdmissionPutGet::putGet(PVStructurePtr const &pvPutStructure, BitSetPtr const &putBitSet)
+{
+	channel->submit(NTAdmissionTaskPtr(new PutGetTask(shared_from_this(), pvPutStructure, putBitSet)));
+}
+
+/*
+ * ChannelRPC handed to the server in place of the wrapped one. A request
+ * stays outstanding, counting against the connection's queue depth,
+ * until the service answers it.
+ */
+class AdmissionRPC :
+	public ChannelRPC,
+	public ChannelRPCRequester,
+	public std::tr1::enable_shared_from_this<AdmissionRPC>
+{
+	public:
+		AdmissionRPC(
+			AdmissionChannelPtr const &channel,
+			ChannelRPCRequester::shared_pointer const &requester)
+			: channel(channel), requester(requester) {}
+
+		void connect(PVStructurePtr const &pvRequest)
+		{
+			ChannelRPC::shared_pointer rpc =
+				channel->getInner()->createChannelRPC(shared_from_this(), pvRequest);
+
+			Lock lock(mutex);
+			if (!inner) inner = rpc;
+		}
+
+		// Returns false if the request was passed on and is still outstanding.
+		bool admitted(PVStructurePtr const &pvArgument)
+		{
+			ChannelRPC::shared_pointer rpc = getInner();
+			if (!rpc) {
+				refuse("channel destroyed");
+				return true;
+			}
+
+			rpc->request(pvArgument);
+			return false;
+		}
+
+		void refuse(string const &reason)
+		{
+			ChannelRPCRequester::shared_pointer rpcRequester = requester.lock();
+			if (rpcRequester)
+				rpcRequester->requestDone(
+					Status(Status::STATUSTYPE_ERROR, reason), shared_from_this(), PVStructurePtr());
+		}
+
+		virtual Channel::shared_pointer getChannel() { return channel; }
+
+		virtual void request(PVStructurePtr const &pvArgument);
+
+		virtual void cancel()
+		{
+			ChannelRPC::shared_pointer rpc = getInner();
+			if (rpc) rpc->cancel();
+		}
+
+		virtual void lastRequest()
+		{
+			ChannelRPC::shared_pointer rpc = getInner();
+			if (rpc) rpc->lastRequest();
+		}
+
+		virtual void destroy()
+		{
+			ChannelRPC::shared_pointer rpc;
+			{
+				Lock lock(mutex);
+				rpc.swap(inner);
+			}
+			if (rpc) rpc->destroy();
+		}
+
+		virtual string getRequesterName()
+		{
+			ChannelRPCRequester::shared_pointer rpcRequester = requester.lock();
+			return rpcRequester ? rpcRequester->getRequesterName() : string();
+		}
+
+		virtual void message(string const &message, MessageType messageType)
+		{
+			ChannelRPCRequester::shared_pointer rpcRequester = requester.lock();
+			if (rpcRequester) rpcRequester->message(message, messageType);
+		}
+
+		virtual void channelRPCConnect(Status const &status, ChannelRPC::shared_pointer const &channelRPC)
+		{
+			{
+				Lock lock(mutex);
+				if (!inner) inner = channelRPC;
+			}
+
+			ChannelRPCRequester::shared_pointer rpcRequester = requester.lock();
+			if (rpcRequester) rpcRequester->channelRPCConnect(status, shared_from_this());
+		}
+
+		virtual void requestDone(
+			Status const &status,
+			ChannelRPC::shared_pointer const &,
+			PVStructurePtr const &pvResponse)
+		{
+			channel->finish();
+
+			ChannelRPCRequester::shared_pointer rpcRequester = requester.lock();
+			if (rpcRequester) rpcRequester->requestDone(status, shared_from_this(), pvResponse);
+		}
+
+	private:
+		ChannelRPC::shared_pointer getInner()
+		{
+			Lock lock(mutex);
+			return inner;
+		}
+
+		AdmissionChannelPtr channel;
+		ChannelRPCRequester::weak_pointer requester;
+
+		Mutex mutex;
+		ChannelRPC::shared_pointer inner;
+};
+
+typedef std::tr1::shared_ptr<AdmissionRPC> AdmissionRPCPtr;
+
+class RPCTask : public NTAdmissionTask {
+	public:
+		RPCTask(AdmissionRPCPtr const &rpc, PVStructurePtr const &pvArgument)
+			: rpc(rpc), pvArgument(pvArgument) {}
+
+		virtual bool run() { return rpc->admitted(pvArgument); }
+
+		virtual void refuse(string const &reason) { rpc->refuse(reason); }
+
+	private:
+		AdmissionRPCPtr rpc;
+		PVStructurePtr pvArgument;
+};
+
+void AdmissionRPC::request(PVStructurePtr const &pvArgument)
+{
+	channel->submit(NTAdmissionTaskPtr(new RPCTask(shared_from_this(), pvArgument)));
+}
+
+// ChannelProcess handed to the server in place of the wrapped one.
+class AdmissionProcess :
+	public ChannelProcess,
+	public ChannelProcessRequester,
+	public std::tr1::enable_shared_from_this<AdmissionProcess>
+{
+	public:
+		AdmissionProcess(
+			AdmissionChannelPtr const &channel,
+			ChannelProcessRequester::shared_pointer const &requester)
+			: channel(channel), requester(requester) {}
+
+		void connect(PVStructurePtr const &pvRequest)
+		{
+			ChannelProcess::shared_pointer process =
+				channel->getInner()->createChannelProcess(shared_from_this(), pvRequest);
+
+			Lock lock(mutex);
+			if (!inner) inner = process;
+		}
+
+		void admitted()
+		{
+			ChannelProcess::shared_pointer process = getInner();
+			if (process) process->process();
+			else refuse("channel destroyed");
+		}
+
+		void refuse(string const &reason)
+		{
+			ChannelProcessRequester::shared_pointer processRequester = requester.lock();
+			if (processRequester)
+				processRequester->processDone(Status(Status::STATUSTYPE_ERROR, reason), shared_from_this());
+		}
+
+		virtual Channel::shared_pointer getChannel() { return channel; }
+
+		virtual void process();
+
+		virtual void cancel()
+		{
+			ChannelProcess::shared_pointer process = getInner();
+			if (process) process->cancel();
+		}
+
+		virtual void lastRequest()
+		{
+			ChannelProcess::shared_pointer process = getInner();
+			if (process) process->lastRequest();
+		}
+
+		virtual void lock()
+		{
+			ChannelProcess::shared_pointer process = getInner();
+			if (process) process->lock();
+		}
+
+		virtual void unlock()
+		{
+			ChannelProcess::shared_pointer process = getInner();
+			if (process) process->unlock();
+		}
+
+		virtual void destroy()
+		{
+			ChannelProcess::shared_pointer process;
+			{
+				Lock lock(mutex);
+				process.swap(inner);
+			}
+			if (process) process->destroy();
+		}
+
+		virtual string getRequesterName()
+		{
+			ChannelProcessRequester::shared_pointer processRequester = requester.lock();
+			return processRequester ? processRequester->getRequesterName() : string();
+		}
+
+		virtual void message(string const &message, MessageType messageType)
+		{
+			ChannelProcessRequester::shared_pointer processRequester = requester.lock();
+			if (processRequester) processRequester->message(message, messageType);
+		}
+
+		virtual void channelProcessConnect(
+			Status const &status,
+			ChannelProcess::shared_pointer const &channelProcess)
+		{
+			{
+				Lock lock(mutex);
+				if (!inner) inner = channelProcess;
+			}
+
+			ChannelProcessRequester::shared_pointer processRequester = requester.lock();
+			if (processRequester) processRequester->channelProcessConnect(status, shared_from_this());
+		}
+
+		virtual void processDone(Status const &status, ChannelProcess::shared_pointer const &)
+		{
+			ChannelProcessRequester::shared_pointer processRequester = requester.lock();
+			if (processRequester) processRequester->processDone(status, shared_from_this());
+		}
+
+	private:
+		ChannelProcess::shared_pointer getInner()
+		{
+			Lock lock(mutex);
+			return inner;
+		}
+
+		AdmissionChannelPtr channel;
+		ChannelProcessRequester::weak_pointer requester;
+
+		Mutex mutex;
+		ChannelProcess::shared_pointer inner;
+};
+
+typedef std::tr1::shared_ptr<AdmissionProcess> AdmissionProcessPtr;
+
+class ProcessTask : public NTAdmissionTask {
+	public:
+		explicit ProcessTask(AdmissionProcessPtr const &process) : process(process) {}
+
+		virtual bool run()
+		{
+			process->admitted();
+			return true;
+		}
+
+		virtual void refuse(string const &reason) { process->refuse(reason); }
+
+	private:
+		AdmissionProcessPtr process;
+};
+
+void AdmissionProcess::process()
+{
+	channel->submit(NTAdmissionTaskPtr(new ProcessTask(shared_from_this())));
+}
+
+/*
+ * ChannelArray handed to the server in place of the wrapped one. Its
+ * putArray and setLength change the record and are admitted, its
+ * getArray and getLength only read it and go straight through.
+ */
+class AdmissionArray :
+	public ChannelArray,
+	public ChannelArrayRequester,
+	public std::tr1::enable_shared_from_this<AdmissionArray>
+{
+	public:
+		AdmissionArray(
+			AdmissionChannelPtr const &channel,
+			ChannelArrayRequester::shared_pointer const &requester)
+			: channel(channel), requester(requester) {}
+
+		void connect(PVStructurePtr const &pvRequest)
+		{
+			ChannelArray::shared_pointer array =
+				channel->getInner()->createChannelArray(shared_from_this(), pvRequest);
+
+			Lock lock(mutex);
+			if (!inner) inner = array;
+		}
+
+		void admittedPut(PVArrayPtr const &putArray, size_t offset, size_t count, size_t stride)
+		{
+			ChannelArray::shared_pointer array = getInner();
+			if (array) array->putArray(putArray, offset, count, stride);
+			else refusePut("channel destroyed");
+		}
+
+		void admittedSetLength(size_t length)
+		{
+			ChannelArray::shared_pointer array = getInner();
+			if (array) array->setLength(length);
+			else refuseSetLength("channel destroyed");
+		}
+
+		void refusePut(string const &reason)
+		{
+			ChannelArrayRequester::shared_pointer arrayRequester = requester.lock();
+			if (arrayRequester)
+				arrayRequester->putArrayDone(Status(Status::STATUSTYPE_ERROR, reason), shared_from_this());
+		}
+
+		void refuseSetLength(string const &reason)
+		{
+			ChannelArrayRequester::shared_pointer arrayRequester = requester.lock();
+			if (arrayRequester)
+				arrayRequester->setLengthDone(Status(Status::STATUSTYPE_ERROR, reason), shared_from_this());
+		}
+
+		virtual Channel::shared_pointer getChannel() { return channel; }
+
+		virtual void putArray(PVArrayPtr const &putArray, size_t offset, size_t count, size_t stride);
+
+		virtual void setLength(size_t length);
+
+		virtual void getArray(size_t offset, size_t count, size_t stride)
+		{
+			ChannelArray::shared_pointer array = getInner();
+			if (array) array->getArray(offset, count, stride);
+		}
+
+		virtual void getLength()
+		{
+			ChannelArray::shared_pointer array = getInner();
+			if (array) array->getLength();
+		}
+
+		virtual void cancel()
+		{
+			ChannelArray::shared_pointer array = getInner();
+			if (array) array->cancel();
+		}
+
+		virtual void lastRequest()
+		{
+			ChannelArray::shared_pointer array = getInner();
+			if (array) array->lastRequest();
+		}
+
+		virtual void lock()
+		{
+			ChannelArray::shared_pointer array = getInner();
+			if (array) array->lock();
+		}
+
+		virtual void unlock()
+		{
+			ChannelArray::shared_pointer array = getInner();
+			if (array) array->unlock();
+		}
+
+		virtual void destroy()
+		{
+			ChannelArray::shared_pointer array;
+			{
+				Lock lock(mutex);
+				array.swap(inner);
+			}
+			if (array) array->destroy();
+		}
+
+		virtual string getRequesterName()
+		{
+			ChannelArrayRequester::shared_pointer arrayRequester = requester.lock();
+			return arrayRequester ? arrayRequester->getRequesterName() : string();
+		}
+
+		virtual void message(string const &message, MessageType messageType)
+		{
+			ChannelArrayRequester::shared_pointer arrayRequester = requester.lock();
+			if (arrayRequester) arrayRequester->message(message, messageType);
+		}
+
+		virtual void channelArrayConnect(
+			Status const &status,
+			ChannelArray::shared_pointer const &channelArray,
+			Array::const_shared_pointer const &array)
+		{
+			{
+				Lock lock(mutex);
+				if (!inner) inner = channelArray;
+			}
+
+			ChannelArrayRequester::shared_pointer arrayRequester = requester.lock();
+			if (arrayRequester) arrayRequester->channelArrayConnect(status, shared_from_this(), array);
+		}
+
+		virtual void putArrayDone(Status const &status, ChannelArray::shared_pointer const &)
+		{
+			ChannelArrayRequester::shared_pointer arrayRequester = requester.lock();
+			if (arrayRequester) arrayRequester->putArrayDone(status, shared_from_this());
+		}
+
+		virtual void getArrayDone(
+			Status const &status,
+			ChannelArray::shared_pointer const &,
+			PVArrayPtr const &pvArray)
+		{
+			ChannelArrayRequester::shared_pointer arrayRequester = requester.lock();
+			if (arrayRequester) arrayRequester->getArrayDone(status, shared_from_this(), pvArray);
+		}
+
+		virtual void getLengthDone(
+			Status const &status,
+			ChannelArray::shared_pointer const &,
+			size_t length)
+		{
+			ChannelArrayRequester::shared_pointer arrayRequester = requester.lock();
+			if (arrayRequester) arrayRequester->getLengthDone(status, shared_from_this(), length);
+		}
+
+		virtual void setLengthDone(Status const &status, ChannelArray::shared_pointer const &)
+		{
+			ChannelArrayRequester::shared_pointer arrayRequester = requester.lock();
+			if (arrayRequester) arrayRequester->setLengthDone(status, shared_from_this());
+		}
+
+	private:
+		ChannelArray::shared_pointer getInner()
+		{
+			Lock lock(mutex);
+			return inner;
+		}
+
+		AdmissionChannelPtr channel;
+		ChannelArrayRequester::weak_pointer requester;
+
+		Mutex mutex;
+		ChannelArray::shared_pointer inner;
+};
+
+typedef std::tr1::shared_ptr<AdmissionArray> AdmissionArrayPtr;
+
+class PutArrayTask : public NTAdmissionTask {
+	public:
+		PutArrayTask(
+			AdmissionArrayPtr const &array,
+			PVArrayPtr const &putArray,
+			size_t offset,
+			size_t count,
+			size_t stride)
+			: array(array), putArray(putArray), offset(offset), count(count), stride(stride) {}
+
+		virtual bool run()
+		{
+			array->admittedPut(putArray, offset, count, stride);
+			return true;
+		}
+
+		virtual void refuse(string const &reason) { array->refusePut(reason); }
+
+	private:
+		AdmissionArrayPtr array;
+		PVArrayPtr putArray;
+		size_t offset;
+		size_t count;
+		size_t stride;
+};
+
+class SetLengthTask : public NTAdmissionTask {
+	public:
+		SetLengthTask(AdmissionArrayPtr const &array, size_t length)
+			: array(array), length(length) {}
+
+		virtual bool run()
+		{
+			array->admittedSetLength(length);
+			return true;
+		}
+
+		virtual void refuse(string const &reason) { array->refuseSetLength(reason); }
+
+	private:
+		AdmissionArrayPtr array;
+		size_t length;
+};
+
+void AdmissionArray::putArray(PVArrayPtr const &putArray, size_t offset, size_t count, size_t stride)
+{
+	channel->submit(NTAdmissionTaskPtr(new PutArrayTask(shared_from_this(), putArray, offset, count, stride)));
+}
+
+void AdmissionArray::setLength(size_t length)
+{
+	channel->submit(NTAdmissionTaskPtr(new SetLengthTask(shared_from_this(), length)));
+}
+
+ChannelProcess::shared_pointer AdmissionChannel::createChannelProcess(
+	ChannelProcessRequester::shared_pointer const &processRequester,
+	PVStructurePtr const &pvRequest)
+{
+	AdmissionProcessPtr process(new AdmissionProcess(shared_from_this(), processRequester));
+	process->connect(pvRequest);
+	return process;
+}
+
+ChannelPut::shared_pointer AdmissionChannel::createChannelPut(
+	ChannelPutRequester::shared_pointer const &putRequester,
+	PVStructurePtr const &pvRequest)
+{
+	AdmissionPutPtr put(new AdmissionPut(shared_from_this(), putRequester));
+	put->connect(pvRequest);
+	return put;
+}
+
+ChannelPutGet::shared_pointer AdmissionChannel::createChannelPutGet(
+	ChannelPutGetRequester::shared_pointer const &putGetRequester,
+	PVStructurePtr const &pvRequest)
+{
+	AdmissionPutGetPtr putGet(new AdmissionPutGet(shared_from_this(), putGetRequester));
+	putGet->connect(pvRequest);
+	return putGet;
+}
+
+ChannelRPC::shared_pointer AdmissionChannel::createChannelRPC(
+	ChannelRPCRequester::shared_pointer const &rpcRequester,
+	PVStructurePtr const &pvRequest)
+{
+	AdmissionRPCPtr rpc(new AdmissionRPC(shared_from_this(), rpcRequester));
+	rpc->connect(pvRequest);
+	return rpc;
+}
+
+ChannelArray::shared_pointer AdmissionChannel::createChannelArray(
+	ChannelArrayRequester::shared_pointer const &arrayRequester,
+	PVStructurePtr const &pvRequest)
+{
+	AdmissionArrayPtr array(new AdmissionArray(shared_from_this(), arrayRequester));
+	array->connect(pvRequest);
+	return array;
+}
+
+// Lets startPVAServer() find the provider by name.
+class AdmissionProviderFactory : public ChannelProviderFactory {
+	public:
+		explicit AdmissionProviderFactory(NTAdmissionProviderPtr const &provider)
+			: provider(provider) {}
+
+		virtual string getFactoryName() { return NTAdmissionProvider::providerName; }
+
+		virtual ChannelProvider::shared_pointer sharedInstance() { return provider.lock(); }
+		virtual ChannelProvider::shared_pointer newInstance() { return provider.lock(); }
+
+	private:
+		std::tr1::weak_ptr<NTAdmissionProvider> provider;
+};
+
+NTAdmissionProviderPtr NTAdmissionProvider::create(
+	ChannelProvider::shared_pointer const &provider,
+	NTAdmissionPtr const &admission)
+{
+	NTAdmissionProviderPtr admissionProvider(new NTAdmissionProvider(provider, admission));
+
+	admissionProvider->factory.reset(new AdmissionProviderFactory(admissionProvider));
+	registerChannelProviderFactory(admissionProvider->factory);
+
+	return admissionProvider;
+}
+
+NTAdmissionProvider::NTAdmissionProvider(
+	ChannelProvider::shared_pointer const &provider,
+	NTAdmissionPtr const &admission)
+	: provider(provider),
+	  admission(admission)
+{
+}
+
+void NTAdmissionProvider::destroy()
+{
+	if (factory) unregisterChannelProviderFactory(factory);
+	factory.reset();
+}
+
+// Searches are answered by the wrapped provider. The server creates the
+// channels found on the providers it serves, which are this one.
+ChannelFind::shared_pointer NTAdmissionProvider::channelFind(
+	string const &channelName,
+	ChannelFindRequester::shared_pointer const &requester)
+{
+	return provider->channelFind(channelName, requester);
+}
+
+ChannelFind::shared_pointer NTAdmissionProvider::channelList(
+	ChannelListRequester::shared_pointer const &requester)
+{
+	return provider->channelList(requester);
+}
+
+Channel::shared_pointer NTAdmissionProvider::createChannel(
+	string const &channelName,
+	ChannelRequester::shared_pointer const &requester,
+	short priority)
+{
+	return createChannel(channelName, requester, priority, string());
+}
+
+Channel::shared_pointer NTAdmissionProvider::createChannel(
+	string const &channelName,
+	ChannelRequester::shared_pointer const &requester,
+	short priority,
+	string const &address)
+{
+	std::tr1::shared_ptr<AdmissionChannelRequester> channelRequester(
+		new AdmissionChannelRequester(shared_from_this(), requester, admission));
+
+	Channel::shared_pointer channel =
+		provider->createChannel(channelName, channelRequester, priority, address);
+
+	// The wrapper, unless the channel could not be created.
+	Channel::shared_pointer wrapper = channelRequester->takeChannel();
+	return wrapper ? wrapper : channel;
+}
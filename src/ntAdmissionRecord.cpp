@@ -0,0 +1,96 @@
+/*
+ * =============================================================
+ *
+ * 	ntAdmissionRecord.cpp
+ *
+ *	Source file that implements the record publishing the
+ *	admission counters of the client connections.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntAdmissionRecord.h>
+
+#include <vector>
+
+#include <pv/nttable.h>
+#include <pv/ntProcessQueue.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::nt;
+using namespace epics::ntDatabase;
+
+NTAdmissionRecordPtr NTAdmissionRecord::create(
+	string const &recordName,
+	NTAdmissionPtr const &admission,
+	double period)
+{
+	PVStructurePtr pvStructure = NTTable::createBuilder()->
+		addColumn("client", pvString)->
+		addColumn("weight", pvDouble)->
+		addColumn("admitted", pvLong)->
+		addColumn("throttled", pvLong)->
+		addColumn("rejected", pvLong)->
+		addColumn("queued", pvLong)->
+		addColumn("meanWait", pvDouble)->
+		addColumn("maxWait", pvDouble)->
+		addTimeStamp()->
+		createPVStructure();
+
+	NTAdmissionRecordPtr pvRecord(new NTAdmissionRecord(recordName, pvStructure, admission));
+
+	if (!pvRecord->init()) {
+		pvRecord.reset();
+		return pvRecord;
+	}
+
+	NTProcessQueue::get()->schedule(pvRecord, period);
+
+	return pvRecord;
+}
+
+NTAdmissionRecord::NTAdmissionRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure,
+	NTAdmissionPtr const &admission)
+	: NTRecord(recordName, pvStructure),
+	  admission(admission)
+{
+}
+
+bool NTAdmissionRecord::init()
+{
+	return NTRecord::init() && admission;
+}
+
+void NTAdmissionRecord::processRecord()
+{
+	vector<NTAdmission::Counters> counters = admission->getCounters();
+
+	shared_vector<string> client;
+	shared_vector<double> weight, meanWait, maxWait;
+	shared_vector<int64> admitted, throttled, rejected, queued;
+
+	for (size_t i = 0; i < counters.size(); ++i) {
+		client.push_back(counters[i].client);
+		weight.push_back(counters[i].weight);
+		admitted.push_back(counters[i].admitted);
+		throttled.push_back(counters[i].throttled);
+		rejected.push_back(counters[i].rejected);
+		queued.push_back(counters[i].queued);
+		meanWait.push_back(counters[i].meanWait);
+		maxWait.push_back(counters[i].maxWait);
+	}
+
+	PVStructurePtr pvValue = getPVStructure()->getSubField<PVStructure>("value");
+
+	pvValue->getSubField<PVStringArray>("client")->replace(freeze(client));
+	pvValue->getSubField<PVDoubleArray>("weight")->replace(freeze(weight));
+	pvValue->getSubField<PVLongArray>("admitted")->replace(freeze(admitted));
+	pvValue->getSubField<PVLongArray>("throttled")->replace(freeze(throttled));
+	pvValue->getSubField<PVLongArray>("rejected")->replace(freeze(rejected));
+	pvValue->getSubField<PVLongArray>("queued")->replace(freeze(queued));
+	pvValue->getSubField<PVDoubleArray>("meanWait")->replace(freeze(meanWait));
+	pvValue->getSubField<PVDoubleArray>("maxWait")->replace(freeze(maxWait));
+}
@@ -0,0 +1,236 @@
+/*
+ * =============================================================
+ *
+ * 	ntAggregateRecord.cpp
+ *
+ *	Source file that implements the aggregate record, which
+ *	holds live statistics of another record.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntAggregateRecord.h>
+
+#include <cmath>
+#include <iostream>
+
+#include <pv/ntaggregate.h>
+#include <pv/ntProcessQueue.h>
+
+using namespace std;
+using std::tr1::dynamic_pointer_cast;
+using namespace epics::pvData;
+using namespace epics::pvDatabase;
+using namespace epics::nt;
+using namespace epics::ntDatabase;
+
+/*
+ * Listener passing each process() of the source record to the aggregate
+ * record. It holds the aggregate record weakly so that an aggregate record
+ * that is gone is not kept alive by its source.
+ */
+class AggregateSourceListener : public NTProcessListener {
+	public:
+		explicit AggregateSourceListener(NTAggregateRecordPtr const &aggregateRecord)
+			: aggregateRecord(aggregateRecord) {}
+
+		virtual void processed(NTRecord &record)
+		{
+			NTAggregateRecordPtr aggregate = aggregateRecord.lock();
+			if (!aggregate) return;
+
+			PVFieldPtr pvField = record.getPVStructure()->getSubField("value");
+
+			PVScalarPtr pvScalar = dynamic_pointer_cast<PVScalar>(pvField);
+			if (pvScalar) {
+				double value = pvScalar->getAs<double>();
+				aggregate->accumulate(&value, 1, record.getTimeStamp());
+				return;
+			}
+
+			PVScalarArrayPtr pvArray = dynamic_pointer_cast<PVScalarArray>(pvField);
+			if (pvArray) {
+				// Shares the array if it holds doubles, converts a copy otherwise.
+				shared_vector<const double> values;
+				pvArray->getAs<double>(values);
+				if (!values.empty())
+					aggregate->accumulate(values.data(), values.size(), record.getTimeStamp());
+			}
+		}
+
+	private:
+		std::tr1::weak_ptr<NTAggregateRecord> aggregateRecord;
+};
+
+PVStructurePtr NTAggregateRecord::createPVStructure()
+{
+	NTAggregateBuilderPtr ntAggregateBuilder = NTAggregate::createBuilder();
+
+	return ntAggregateBuilder->
+		addDispersion()->
+		addFirst()->
+		addFirstTimeStamp()->
+		addLast()->
+		addLastTimeStamp()->
+		addMax()->
+		addMin()->
+		addAlarm()->
+		addTimeStamp()->
+		add("source", getFieldCreate()->createScalar(pvString))->
+		createPVStructure();
+}
+
+NTAggregateRecordPtr NTAggregateRecord::create(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+{
+	NTAggregateRecordPtr pvRecord(new NTAggregateRecord(recordName, pvStructure));
+
+	if (!pvRecord->init()) pvRecord.reset();
+
+	return pvRecord;
+}
+
+NTAggregateRecord::NTAggregateRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+	: NTRecord(recordName, pvStructure)
+{
+}
+
+bool NTAggregateRecord::init()
+{
+	if (!NTRecord::init()) return false;
+
+	PVStructurePtr pvStructure = getPVStructure();
+
+	pvValue = pvStructure->getSubField<PVDouble>("value");
+	pvN = pvStructure->getSubField<PVLong>("N");
+	pvDispersion = pvStructure->getSubField<PVDouble>("dispersion");
+	pvFirst = pvStructure->getSubField<PVDouble>("first");
+	pvLast = pvStructure->getSubField<PVDouble>("last");
+	pvMin = pvStructure->getSubField<PVDouble>("min");
+	pvMax = pvStructure->getSubField<PVDouble>("max");
+
+	return pvValue && pvN && pvDispersion && pvFirst && pvLast && pvMin && pvMax &&
+		pvFirstTimeStamp.attach(pvStructure->getSubField("firstTimeStamp")) &&
+		pvLastTimeStamp.attach(pvStructure->getSubField("lastTimeStamp"));
+}
+
+void NTAggregateRecord::refuse(string const &message)
+{
+	lock();
+	raiseAlarm(message);
+	unlock();
+}
+
+bool NTAggregateRecord::bind(string const &sourceName, double period)
+{
+	NTRecordPtr source = dynamic_pointer_cast<NTRecord>(PVDatabase::getMaster()->findRecord(sourceName));
+	if (!source) {
+		cerr << "Record " << getRecordName() << " can not aggregate " << sourceName
+		     << ", which is not a record of the database\n";
+		refuse("source " + sourceName + " is not in the database");
+		return false;
+	}
+
+	source->lock();
+	PVFieldPtr pvField = source->getPVStructure()->getSubField("value");
+	source->unlock();
+
+	PVScalarPtr pvScalar = dynamic_pointer_cast<PVScalar>(pvField);
+	PVScalarArrayPtr pvArray = dynamic_pointer_cast<PVScalarArray>(pvField);
+
+	bool numeric =
+		(pvScalar && ScalarTypeFunc::isNumeric(pvScalar->getScalar()->getScalarType())) ||
+		(pvArray && ScalarTypeFunc::isNumeric(pvArray->getScalarArray()->getElementType()));
+
+	if (!numeric) {
+		cerr << "Record " << getRecordName() << " can not aggregate " << sourceName
+		     << ", whose value is not numeric\n";
+		refuse("source " + sourceName + " is not numeric");
+		return false;
+	}
+
+	lock();
+	getPVStructure()->getSubField<PVString>("source")->put(sourceName);
+	clearAlarm();
+	unlock();
+
+	NTAggregateRecordPtr self = dynamic_pointer_cast<NTAggregateRecord>(shared_from_this());
+
+	source->addProcessListener(NTProcessListenerPtr(new AggregateSourceListener(self)));
+	NTProcessQueue::get()->schedule(self, period);
+
+	return true;
+}
+
+void NTAggregateRecord::accumulate(
+	double const *values,
+	size_t count,
+	TimeStamp const &timeStamp)
+{
+	if (count == 0) return;
+
+	// Statistics of the new samples, by Welford's method.
+	double mean = 0.0;
+	double m2 = 0.0;
+	double min = values[0];
+	double max = values[0];
+
+	for (size_t i = 0; i < count; ++i) {
+		double delta = values[i] - mean;
+		mean += delta / (i + 1);
+		m2 += delta * (values[i] - mean);
+
+		if (values[i] < min) min = values[i];
+		if (values[i] > max) max = values[i];
+	}
+
+	Lock lock(statisticsMutex);
+	Statistics &total = statistics;
+
+	if (total.count == 0) {
+		total.first = values[0];
+		total.firstTimeStamp = timeStamp;
+		total.min = min;
+		total.max = max;
+	} else {
+		if (min < total.min) total.min = min;
+		if (max > total.max) total.max = max;
+	}
+
+	// Merge the two sets of samples.
+	double n = (double) total.count + count;
+	double delta = mean - total.mean;
+
+	total.mean += delta * count / n;
+	total.m2 += m2 + delta * delta * total.count * count / n;
+	total.count += count;
+
+	total.last = values[count - 1];
+	total.lastTimeStamp = timeStamp;
+}
+
+void NTAggregateRecord::processRecord()
+{
+	Statistics published;
+
+	{
+		Lock lock(statisticsMutex);
+		published = statistics;
+		statistics = Statistics();
+	}
+
+	pvN->put(published.count);
+	if (published.count == 0) return;
+
+	pvValue->put(published.mean);
+	pvDispersion->put(sqrt(published.m2 / published.count));
+	pvFirst->put(published.first);
+	pvLast->put(published.last);
+	pvMin->put(published.min);
+	pvMax->put(published.max);
+	pvFirstTimeStamp.set(published.firstTimeStamp);
+	pvLastTimeStamp.set(published.lastTimeStamp);
+}
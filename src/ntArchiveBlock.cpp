@@ -0,0 +1,377 @@
+/*
+ * =============================================================
+ *
+ * 	ntArchiveBlock.cpp
+ *
+ *	Source file that implements the encoding of the sample
+ *	blocks held in the archive segment files.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntArchiveBlock.h>
+
+#include <cstring>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::ntDatabase;
+
+// "NTA1" read as a little endian word.
+static const uint32 blockMagic = 0x3141544e;
+
+const size_t NTArchiveBlock::blockSamples;
+
+static void putWord(vector<uint8> &out, size_t position, uint32 word)
+{
+	out[position]     = (uint8) word;
+	out[position + 1] = (uint8) (word >> 8);
+	out[position + 2] = (uint8) (word >> 16);
+	out[position + 3] = (uint8) (word >> 24);
+}
+
+static uint32 getWord(uint8 const *data)
+{
+	return (uint32) data[0] | ((uint32) data[1] << 8) |
+		((uint32) data[2] << 16) | ((uint32) data[3] << 24);
+}
+
+static void putVarint(vector<uint8> &out, uint64 value)
+{
+	while (value >= 0x80) {
+		out.push_back((uint8) (value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((uint8) value);
+}
+
+// Returns false if the varint runs past end.
+static bool getVarint(uint8 const *&data, uint8 const *end, uint64 &value)
+{
+	value = 0;
+
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (data == end) return false;
+		uint8 byte = *data++;
+		value |= (uint64) (byte & 0x7f) << shift;
+		if (!(byte & 0x80)) return true;
+	}
+
+	return false;
+}
+
+// Maps signed values to unsigned ones so that small magnitudes stay small.
+static uint64 zigzag(int64 value) { return ((uint64) value << 1) ^ (uint64) (value >> 63); }
+static int64 unzigzag(uint64 value) { return (int64) (value >> 1) ^ -(int64) (value & 1); }
+
+static int leadingZeros(uint64 value)
+{
+#ifdef __GNUC__
+	return __builtin_clzll(value);
+#else
+	int count = 0;
+	for (uint64 bit = (uint64) 1 << 63; !(value & bit); bit >>= 1) ++count;
+	return count;
+#endif
+}
+
+static int trailingZeros(uint64 value)
+{
+#ifdef __GNUC__
+	return __builtin_ctzll(value);
+#else
+	int count = 0;
+	for (uint64 bit = 1; !(value & bit); bit <<= 1) ++count;
+	return count;
+#endif
+}
+
+// Writes bits most significant first.
+class BitWriter {
+	public:
+		explicit BitWriter(vector<uint8> &out) : out(out), free(0) {}
+
+		void write(uint64 value, int bits)
+		{
+			while (bits > 0) {
+				if (free == 0) {
+					out.push_back(0);
+					free = 8;
+				}
+
+				int count = bits < free ? bits : free;
+				uint8 chunk = (uint8) ((value >> (bits - count)) & ((1u << count) - 1));
+
+				out.back() |= (uint8) (chunk << (free - count));
+				free -= count;
+				bits -= count;
+			}
+		}
+
+	private:
+		vector<uint8> &out;
+		int free;
+};
+
+class BitReader {
+	public:
+		BitReader(uint8 const *data, size_t length)
+			: data(data), length(length), position(0), failed(false) {}
+
+		uint64 read(int bits)
+		{
+			uint64 value = 0;
+
+			while (bits > 0) {
+				size_t byte = position >> 3;
+				if (byte >= length) {
+					failed = true;
+					return 0;
+				}
+
+				int available = 8 - (int) (position & 7);
+				int count = bits < available ? bits : available;
+				uint8 chunk = (uint8) ((data[byte] >> (available - count)) & ((1u << count) - 1));
+
+				value = (value << count) | chunk;
+				position += count;
+				bits -= count;
+			}
+
+			return value;
+		}
+
+		bool hasFailed() const { return failed; }
+
+	private:
+		uint8 const *data;
+		size_t length;
+		size_t position;
+		bool failed;
+};
+
+static uint64 doubleBits(double value)
+{
+	uint64 bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static double bitsDouble(uint64 bits)
+{
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+static void encodeTimes(NTArchiveSample const *samples, size_t count, vector<uint8> &out)
+{
+	int64 previous = 0;
+	int64 previousDelta = 0;
+
+	for (size_t i = 0; i < count; ++i) {
+		int64 delta = samples[i].time - previous;
+		putVarint(out, zigzag(i < 2 ? delta : delta - previousDelta));
+		previous = samples[i].time;
+		previousDelta = delta;
+	}
+}
+
+static void encodeValues(NTArchiveSample const *samples, size_t count, vector<uint8> &out)
+{
+	BitWriter writer(out);
+
+	uint64 previous = doubleBits(samples[0].value);
+	writer.write(previous, 64);
+
+	int previousLeading = -1;
+	int previousTrailing = 0;
+
+	for (size_t i = 1; i < count; ++i) {
+		uint64 current = doubleBits(samples[i].value);
+		uint64 xored = current ^ previous;
+		previous = current;
+
+		if (xored == 0) {
+			writer.write(0, 1);
+			continue;
+		}
+
+		int leading = leadingZeros(xored);
+		int trailing = trailingZeros(xored);
+		if (leading > 31) leading = 31;
+
+		writer.write(1, 1);
+
+		// Reuse the previous window if the meaningful bits fit in it.
+		if (previousLeading >= 0 && leading >= previousLeading && trailing >= previousTrailing) {
+			writer.write(0, 1);
+			writer.write(xored >> previousTrailing, 64 - previousLeading - previousTrailing);
+			continue;
+		}
+
+		int meaningful = 64 - leading - trailing;
+
+		writer.write(1, 1);
+		writer.write(leading, 5);
+		writer.write(meaningful - 1, 6);
+		writer.write(xored >> trailing, meaningful);
+
+		previousLeading = leading;
+		previousTrailing = trailing;
+	}
+}
+
+static void encodeAlarms(NTArchiveSample const *samples, size_t count, vector<uint8> &out)
+{
+	size_t run = 0;
+
+	for (size_t i = 0; i < count; ++i) {
+		++run;
+
+		bool last = (i + 1 == count) ||
+			samples[i + 1].severity != samples[i].severity ||
+			samples[i + 1].status != samples[i].status;
+
+		if (last) {
+			putVarint(out, run);
+			putVarint(out, zigzag(samples[i].severity));
+			putVarint(out, zigzag(samples[i].status));
+			run = 0;
+		}
+	}
+}
+
+void NTArchiveBlock::encode(
+	NTArchiveSample const *samples,
+	size_t count,
+	vector<uint8> &out)
+{
+	if (count == 0) return;
+
+	size_t header = out.size();
+	out.resize(header + headerSize);
+
+	size_t start = out.size();
+	encodeTimes(samples, count, out);
+	size_t timeBytes = out.size() - start;
+
+	start = out.size();
+	encodeValues(samples, count, out);
+	size_t valueBytes = out.size() - start;
+
+	start = out.size();
+	encodeAlarms(samples, count, out);
+	size_t alarmBytes = out.size() - start;
+
+	putWord(out, header, blockMagic);
+	putWord(out, header + 4, (uint32) count);
+	putWord(out, header + 8, (uint32) timeBytes);
+	putWord(out, header + 12, (uint32) valueBytes);
+	putWord(out, header + 16, (uint32) alarmBytes);
+}
+
+static bool decodeColumns(
+	uint8 const *data,
+	size_t timeBytes,
+	size_t valueBytes,
+	size_t alarmBytes,
+	NTArchiveSample *samples,
+	size_t count)
+{
+	// Times.
+	uint8 const *cursor = data;
+	uint8 const *end = cursor + timeBytes;
+	int64 previous = 0;
+	int64 previousDelta = 0;
+
+	for (size_t i = 0; i < count; ++i) {
+		uint64 encoded;
+		if (!getVarint(cursor, end, encoded)) return false;
+
+		int64 delta = unzigzag(encoded);
+		if (i >= 2) delta += previousDelta;
+
+		previous += delta;
+		previousDelta = delta;
+		samples[i].time = previous;
+	}
+
+	// Values.
+	BitReader reader(end, valueBytes);
+	uint64 value = reader.read(64);
+	int leading = 0;
+	int trailing = 0;
+
+	samples[0].value = bitsDouble(value);
+
+	for (size_t i = 1; i < count; ++i) {
+		if (reader.read(1)) {
+
+			if (reader.read(1)) {
+				leading = (int) reader.read(5);
+				int meaningful = (int) reader.read(6) + 1;
+				trailing = 64 - leading - meaningful;
+				if (trailing < 0) return false;
+			}
+
+			value ^= reader.read(64 - leading - trailing) << trailing;
+		}
+
+		samples[i].value = bitsDouble(value);
+	}
+
+	if (reader.hasFailed()) return false;
+
+	// Alarms.
+	cursor = end + valueBytes;
+	end = cursor + alarmBytes;
+
+	for (size_t i = 0; i < count;) {
+		uint64 run, severity, status;
+
+		if (!getVarint(cursor, end, run) ||
+		    !getVarint(cursor, end, severity) ||
+		    !getVarint(cursor, end, status) ||
+		    run == 0 || run > count - i)
+			return false;
+
+		for (uint64 j = 0; j < run; ++j, ++i) {
+			samples[i].severity = (int32) unzigzag(severity);
+			samples[i].status = (int32) unzigzag(status);
+		}
+	}
+
+	return true;
+}
+
+bool NTArchiveBlock::decode(
+	uint8 const *data,
+	size_t length,
+	vector<NTArchiveSample> &out)
+{
+	if (length < headerSize || getWord(data) != blockMagic) return false;
+
+	size_t count = getWord(data + 4);
+	size_t timeBytes = getWord(data + 8);
+	size_t valueBytes = getWord(data + 12);
+	size_t alarmBytes = getWord(data + 16);
+
+	if (timeBytes > length || valueBytes > length || alarmBytes > length ||
+	    headerSize + timeBytes + valueBytes + alarmBytes > length)
+		return false;
+
+	// Every sample takes at least a byte of time and a bit of value, so a
+	// larger count is corrupt and must not size out.
+	if (count == 0 || count > blockSamples || count > timeBytes || count > 8 * valueBytes) return false;
+
+	size_t base = out.size();
+	out.resize(base + count);
+
+	if (!decodeColumns(data + headerSize, timeBytes, valueBytes, alarmBytes, &out[base], count)) {
+		out.resize(base);
+		return false;
+	}
+
+	return true;
+}
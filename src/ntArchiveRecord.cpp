@@ -0,0 +1,53 @@
+/*
+ * =============================================================
+ *
+ * 	ntArchiveRecord.cpp
+ *
+ *	Source file that implements the record serving queries of
+ *	the on disk archive.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntArchiveRecord.h>
+
+#include <stdexcept>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::ntDatabase;
+
+NTArchiveRecordPtr NTArchiveRecord::create(
+	string const &recordName,
+	NTArchiverPtr const &archiver)
+{
+	NTArchiveRecordPtr pvRecord(new NTArchiveRecord(recordName, createPVStructure(), archiver));
+
+	if (!pvRecord->init()) pvRecord.reset();
+
+	return pvRecord;
+}
+
+NTArchiveRecord::NTArchiveRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure,
+	NTArchiverPtr const &archiver)
+	: NTHistoryRecord(recordName, pvStructure),
+	  archiver(archiver)
+{
+}
+
+void NTArchiveRecord::query(
+	string const &recordName,
+	double start,
+	double end,
+	size_t maxPoints,
+	PVStructurePtr const &result)
+{
+	if (!archiver->isArchived(recordName))
+		throw runtime_error("record " + recordName + " is not archived");
+
+	// Only the files are read, so neither the archived record nor the
+	// archiver's writer is held up by a query.
+	archiver->query(recordName, start, end, maxPoints, result);
+}
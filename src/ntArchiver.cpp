@@ -0,0 +1,598 @@
+/*
+ * =============================================================
+ *
+ * 	ntArchiver.cpp
+ *
+ *	Source file that implements the on disk archive of the
+ *	normative type database records.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntArchiver.h>
+#include <pv/ntThreadPlacement.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::ntDatabase;
+
+// Queued samples that wake the writer before the flush period is over.
+static const size_t wakeUpSamples = 65536;
+
+static const size_t indexEntrySize = 32;
+
+const size_t NTArchiver::pendingLimit;
+const size_t NTArchiver::queryLimit;
+
+static void putWord(uint8 *data, uint64 word, int bytes)
+{
+	for (int i = 0; i < bytes; ++i) data[i] = (uint8) (word >> (8 * i));
+}
+
+static uint64 getWord(uint8 const *data, int bytes)
+{
+	uint64 word = 0;
+	for (int i = bytes - 1; i >= 0; --i) word = (word << 8) | data[i];
+	return word;
+}
+
+static bool makeDirectory(string const &path)
+{
+	return mkdir(path.c_str(), 0777) == 0 || errno == EEXIST;
+}
+
+// Seconds past the epoch to the nanoseconds held by the archive.
+static int64 toArchiveTime(double seconds)
+{
+	if (seconds <= -9.2e9) return -0x7fffffffffffffffLL;
+	if (seconds >= 9.2e9) return 0x7fffffffffffffffLL;
+	return (int64) (seconds * 1e9);
+}
+
+/*
+ * Read only memory mapping of a whole file. Files written after the
+ * mapping was made are seen up to their length at that time.
+ */
+class MappedFile {
+	public:
+		explicit MappedFile(string const &path)
+			: data(0), length(0)
+		{
+			int fd = open(path.c_str(), O_RDONLY);
+			if (fd < 0) return;
+
+			struct stat status;
+			if (fstat(fd, &status) == 0 && status.st_size > 0) {
+				void *mapping = mmap(0, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+				if (mapping != MAP_FAILED) {
+					data = static_cast<uint8 const *>(mapping);
+					length = status.st_size;
+				}
+			}
+
+			close(fd);
+		}
+
+		~MappedFile()
+		{
+			if (data) munmap(const_cast<uint8 *>(data), length);
+		}
+
+		uint8 const *data;
+		size_t length;
+
+	private:
+		MappedFile(MappedFile const &);
+		MappedFile &operator=(MappedFile const &);
+};
+
+// Columns of a query result being filled.
+struct QueryResult {
+	explicit QueryResult(size_t size)
+		: seconds(size), nsec(size), value(size), severity(size), status(size), filled(0) {}
+
+	void add(NTArchiveSample const &sample)
+	{
+		if (filled == value.size()) return;
+
+		// Floor division, so times before the epoch keep positive nanoseconds.
+		int64 secs = sample.time / 1000000000;
+		int64 ns = sample.time % 1000000000;
+		if (ns < 0) {
+			--secs;
+			ns += 1000000000;
+		}
+
+		seconds[filled] = secs;
+		nsec[filled] = (int32) ns;
+		value[filled] = sample.value;
+		severity[filled] = sample.severity;
+		status[filled] = sample.status;
+		++filled;
+	}
+
+	// Replaces the columns of result, which has the layout of
+	// NTHistoryBuffer::createResultField(), with those filled.
+	void publish(PVStructurePtr const &result)
+	{
+		seconds.resize(filled);
+		nsec.resize(filled);
+		value.resize(filled);
+		severity.resize(filled);
+		status.resize(filled);
+
+		result->getSubField<PVLongArray>("value.secondsPastEpoch")->replace(freeze(seconds));
+		result->getSubField<PVIntArray>("value.nanoseconds")->replace(freeze(nsec));
+		result->getSubField<PVDoubleArray>("value.value")->replace(freeze(value));
+		result->getSubField<PVIntArray>("value.severity")->replace(freeze(severity));
+		result->getSubField<PVIntArray>("value.status")->replace(freeze(status));
+	}
+
+	shared_vector<int64> seconds;
+	shared_vector<int32> nsec;
+	shared_vector<double> value;
+	shared_vector<int32> severity;
+	shared_vector<int32> status;
+	size_t filled;
+};
+
+// Number of the sample a query picks as its picked-th of returned, out of
+// matched samples evenly spaced.
+static size_t pickedSample(size_t picked, size_t matched, size_t returned)
+{
+	return (size_t) ((uint64) picked * matched / returned);
+}
+
+/*
+ * Walks the samples of the segments with first <= time <= last, numbered
+ * in order. Without result it returns how many there are. A block lying
+ * wholly in the range is counted from its index entry, so counting only
+ * decodes the blocks at the ends of the range. With result it copies the
+ * samples evenly spaced among the matched ones into it, decoding only the
+ * blocks holding one of them, and returns matched.
+ */
+static size_t scan(
+	string const &path,
+	vector<string> const &segments,
+	int64 first,
+	int64 last,
+	size_t matched,
+	QueryResult *result)
+{
+	vector<NTArchiveSample> samples;
+	samples.reserve(NTArchiveBlock::blockSamples);
+
+	size_t returned = result ? result->value.size() : 0;
+	size_t position = 0;
+	size_t picked = 0;
+	size_t wanted = 0;
+
+	for (size_t i = 0; i < segments.size(); ++i) {
+
+		// A later segment starts after the range, and so do the others.
+		if (strtoll(segments[i].c_str(), 0, 10) > last) break;
+		if (result && picked == returned) break;
+
+		MappedFile index(path + "/" + segments[i] + ".idx");
+		MappedFile segment(path + "/" + segments[i] + ".seg");
+
+		for (size_t entry = 0; entry + indexEntrySize <= index.length; entry += indexEntrySize) {
+
+			if (result && picked == returned) break;
+
+			uint8 const *fields = index.data + entry;
+			int64 blockFirst = (int64) getWord(fields, 8);
+			int64 blockLast = (int64) getWord(fields + 8, 8);
+			size_t offset = getWord(fields + 16, 8);
+			size_t length = getWord(fields + 24, 4);
+			size_t count = getWord(fields + 28, 4);
+
+			if (blockLast < first || blockFirst > last) continue;
+			if (offset > segment.length || length > segment.length - offset) break;
+
+			bool whole = blockFirst >= first && blockLast <= last;
+
+			if (whole && (count == 0 || count > NTArchiveBlock::blockSamples)) {
+				if (!result) cerr << "Corrupt archive index in " << path << "/" << segments[i] << ".idx\n";
+				continue;
+			}
+
+			// A whole block without a sample to pick is only counted.
+			if (whole && (!result || wanted >= position + count)) {
+				position += count;
+				continue;
+			}
+
+			samples.clear();
+			if (!NTArchiveBlock::decode(segment.data + offset, length, samples)) {
+				if (!result || whole)
+					cerr << "Corrupt archive block in " << path << "/" << segments[i] << ".seg\n";
+
+				// Its samples were counted, and are skipped as a gap.
+				if (whole) position += count;
+				while (picked < returned && wanted < position)
+					wanted = pickedSample(++picked, matched, returned);
+				continue;
+			}
+
+			size_t blockEnd = position + (whole ? count : 0);
+
+			for (size_t j = 0; j < samples.size(); ++j) {
+				if (samples[j].time < first || samples[j].time > last) continue;
+				if (whole && position == blockEnd) break;
+
+				if (result && picked < returned && position == wanted) {
+					result->add(samples[j]);
+					wanted = pickedSample(++picked, matched, returned);
+				}
+				++position;
+			}
+
+			// Keeps the numbering of the counting pass if the block holds
+			// fewer samples than its index entry says.
+			if (whole) position = blockEnd;
+			while (picked < returned && wanted < position)
+				wanted = pickedSample(++picked, matched, returned);
+		}
+	}
+
+	return result ? matched : position;
+}
+
+NTArchiverPtr NTArchiver::create(
+	string const &directory,
+	double flushPeriod,
+	size_t segmentSize)
+{
+	if (!makeDirectory(directory)) {
+		cerr << "Can not create archive directory " << directory << ": " << strerror(errno) << "\n";
+		return NTArchiverPtr();
+	}
+
+	NTArchiverPtr archiver(new NTArchiver(directory, flushPeriod, segmentSize));
+	archiver->thread.start();
+
+	return archiver;
+}
+
+NTArchiver::NTArchiver(
+	string const &directory,
+	double flushPeriod,
+	size_t segmentSize)
+	: directory(directory),
+	  flushPeriod(flushPeriod),
+	  segmentSize(segmentSize),
+	  pendingCount(0),
+	  dropped(0),
+	  droppedSinceFlush(0),
+	  stopping(false),
+	  thread(*this, "ntArchiver",
+		epicsThreadGetStackSize(epicsThreadStackSmall),
+		epicsThreadPriorityLow)
+{
+}
+
+NTArchiver::~NTArchiver()
+{
+	stop();
+
+	for (size_t i = 0; i < streams.size(); ++i) {
+		if (streams[i]) closeSegment(*streams[i]);
+	}
+}
+
+int NTArchiver::addStream(string const &recordName)
+{
+	// The name becomes a directory of the archive.
+	if (recordName.empty() || recordName == "." || recordName == ".." ||
+	    recordName.find('/') != string::npos) {
+		cerr << "Can not archive record " << recordName << ": not a valid directory name\n";
+		return -1;
+	}
+
+	{
+		Lock lock(mutex);
+		map<string, int>::const_iterator it = streamOf.find(recordName);
+		if (it != streamOf.end()) {
+			++streams[it->second]->users;
+			return it->second;
+		}
+	}
+
+	StreamPtr stream(new Stream());
+	stream->name = recordName;
+	stream->path = directory + "/" + recordName;
+	stream->users = 1;
+	stream->segment = 0;
+	stream->index = 0;
+	stream->segmentBytes = 0;
+
+	if (!makeDirectory(stream->path)) {
+		cerr << "Can not create archive directory " << stream->path << ": " << strerror(errno) << "\n";
+		return -1;
+	}
+
+	Lock lock(mutex);
+
+	// Another thread may have added the record meanwhile.
+	map<string, int>::const_iterator it = streamOf.find(recordName);
+	if (it != streamOf.end()) {
+		++streams[it->second]->users;
+		return it->second;
+	}
+
+	streams.push_back(stream);
+	streamOf[recordName] = (int) streams.size() - 1;
+
+	return (int) streams.size() - 1;
+}
+
+void NTArchiver::removeStream(int stream)
+{
+	// Held so that flush() is not writing the stream while it is closed.
+	Lock writeLock(writeMutex);
+
+	StreamPtr removed;
+	vector<NTArchiveSample> samples;
+
+	{
+		Lock lock(mutex);
+
+		if (stream < 0 || (size_t) stream >= streams.size() || !streams[stream]) return;
+		if (--streams[stream]->users > 0) return;
+
+		removed = streams[stream];
+		streams[stream].reset();
+		streamOf.erase(removed->name);
+
+		pendingCount -= removed->pending.size();
+		samples.swap(removed->pending);
+	}
+
+	if (!samples.empty()) write(*removed, samples);
+	closeSegment(*removed);
+}
+
+bool NTArchiver::isArchived(string const &recordName)
+{
+	Lock lock(mutex);
+	return streamOf.find(recordName) != streamOf.end();
+}
+
+void NTArchiver::append(int stream, NTArchiveSample const &sample)
+{
+	bool wake;
+	bool full(false);
+
+	{
+		Lock lock(mutex);
+		if (stopping) return;
+
+		if (pendingCount >= pendingLimit) {
+			++dropped;
+			full = (++droppedSinceFlush == 1);
+			wake = false;
+		} else if (streams[stream]) {
+			streams[stream]->pending.push_back(sample);
+			wake = (++pendingCount == wakeUpSamples);
+		} else {
+			// Removed while its record was still being processed.
+			wake = false;
+		}
+	}
+
+	if (full) cerr << "Archive writer of " << directory << " is behind, dropping samples\n";
+	if (wake) wakeUp.signal();
+}
+
+size_t NTArchiver::getDropped()
+{
+	Lock lock(mutex);
+	return dropped;
+}
+
+void NTArchiver::run()
+{
+	NTThreadPlacement::applyRole("archive");
+
+	while (true) {
+		wakeUp.wait(flushPeriod);
+
+		flush();
+
+		Lock lock(mutex);
+		if (stopping) break;
+	}
+}
+
+void NTArchiver::stop()
+{
+	{
+		Lock lock(mutex);
+		if (stopping) return;
+		stopping = true;
+	}
+
+	wakeUp.signal();
+	thread.exitWait();
+}
+
+void NTArchiver::flush()
+{
+	Lock writeLock(writeMutex);
+
+	vector<StreamPtr> current;
+	vector<vector<NTArchiveSample> > batches;
+	size_t lost;
+
+	// Take the queued samples, leaving empty queues with their capacity.
+	{
+		Lock lock(mutex);
+
+		lost = droppedSinceFlush;
+		droppedSinceFlush = 0;
+
+		current = streams;
+		batches.resize(current.size());
+
+		for (size_t i = 0; i < current.size(); ++i) {
+			if (!current[i]) continue;
+			batches[i].reserve(current[i]->pending.size());
+			batches[i].swap(current[i]->pending);
+		}
+
+		pendingCount = 0;
+	}
+
+	if (lost > 0) cerr << "Archive writer of " << directory << " dropped " << lost << " samples\n";
+
+	for (size_t i = 0; i < current.size(); ++i) {
+		if (!batches[i].empty()) write(*current[i], batches[i]);
+	}
+}
+
+bool NTArchiver::openSegment(Stream &stream, int64 time)
+{
+	char name[32];
+	sprintf(name, "/%020lld", (long long) time);
+
+	string path = stream.path + name;
+
+	stream.segment = fopen((path + ".seg").c_str(), "ab");
+	stream.index = fopen((path + ".idx").c_str(), "ab");
+	stream.segmentBytes = 0;
+
+	if (!stream.segment || !stream.index) {
+		cerr << "Can not open archive segment " << path << ": " << strerror(errno) << "\n";
+		closeSegment(stream);
+		return false;
+	}
+
+	// Continue an existing segment of the same name where it ends.
+	fseek(stream.segment, 0, SEEK_END);
+	stream.segmentBytes = ftell(stream.segment);
+
+	return true;
+}
+
+void NTArchiver::closeSegment(Stream &stream)
+{
+	if (stream.segment) fclose(stream.segment);
+	if (stream.index) fclose(stream.index);
+
+	stream.segment = 0;
+	stream.index = 0;
+}
+
+void NTArchiver::write(Stream &stream, vector<NTArchiveSample> const &samples)
+{
+	vector<uint8> block;
+
+	// Blocks are split at NTArchiveBlock::blockSamples, which bounds what
+	// a query decodes beyond its range.
+	for (size_t first = 0; first < samples.size(); first += NTArchiveBlock::blockSamples) {
+
+		size_t count = min(NTArchiveBlock::blockSamples, samples.size() - first);
+		NTArchiveSample const *begin = &samples[first];
+
+		if (stream.segment && stream.segmentBytes >= segmentSize)
+			closeSegment(stream);
+		if (!stream.segment && !openSegment(stream, begin[0].time))
+			return;
+
+		block.clear();
+		NTArchiveBlock::encode(begin, count, block);
+
+		uint8 entry[indexEntrySize];
+		putWord(entry, begin[0].time, 8);
+		putWord(entry + 8, begin[count - 1].time, 8);
+		putWord(entry + 16, stream.segmentBytes, 8);
+		putWord(entry + 24, block.size(), 4);
+		putWord(entry + 28, count, 4);
+
+		// The block is complete on disk before its index entry is, so a
+		// reader never follows an entry to a partly written block.
+		if (fwrite(&block[0], 1, block.size(), stream.segment) != block.size() ||
+		    fflush(stream.segment) != 0 ||
+		    fwrite(entry, 1, indexEntrySize, stream.index) != indexEntrySize ||
+		    fflush(stream.index) != 0) {
+			cerr << "Can not write archive segment in " << stream.path << ": " << strerror(errno) << "\n";
+			closeSegment(stream);
+			return;
+		}
+
+		stream.segmentBytes += block.size();
+	}
+}
+
+size_t NTArchiver::query(
+	string const &recordName,
+	double start,
+	double end,
+	size_t maxPoints,
+	PVStructurePtr const &result)
+{
+	// Only the directories of archived records are read, whatever name the
+	// client asked for.
+	string path;
+
+	{
+		Lock lock(mutex);
+		map<string, int>::const_iterator it = streamOf.find(recordName);
+		if (it != streamOf.end()) path = streams[it->second]->path;
+	}
+
+	int64 first = toArchiveTime(start);
+	int64 last = toArchiveTime(end);
+
+	// Segment names are zero padded times, so sorting by name sorts by time.
+	vector<string> segments;
+
+	DIR *dir = path.empty() ? 0 : opendir(path.c_str());
+	if (dir) {
+		struct dirent *entry;
+		while ((entry = readdir(dir)) != 0) {
+			string name(entry->d_name);
+			if (name.size() > 4 && name.compare(name.size() - 4, 4, ".seg") == 0)
+				segments.push_back(name.substr(0, name.size() - 4));
+		}
+		closedir(dir);
+	}
+
+	sort(segments.begin(), segments.end());
+
+	// Counting first lets the samples be picked while the blocks are read,
+	// so a query holds no more than its result and one block.
+	size_t matched = scan(path, segments, first, last, 0, 0);
+
+	if (maxPoints == 0 && matched > queryLimit) {
+		stringstream reason;
+		reason << "query matches " << matched << " samples, more than " << queryLimit
+		       << "; give maxPoints to decimate them";
+		throw runtime_error(reason.str());
+	}
+
+	size_t returned = min(matched, min(maxPoints ? maxPoints : matched, queryLimit));
+
+	QueryResult picked(returned);
+	if (returned > 0) scan(path, segments, first, last, matched, &picked);
+
+	picked.publish(result);
+
+	return picked.filled;
+}
@@ -0,0 +1,167 @@
+/*
+ * =============================================================
+ *
+ * 	ntArrayChunk.cpp
+ *
+ *	Source file that implements chunked reads of record arrays.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntArrayChunk.h>
+
+#include <algorithm>
+
+using namespace std;
+using std::tr1::static_pointer_cast;
+using namespace epics::pvData;
+using namespace epics::ntDatabase;
+
+StructureConstPtr NTArrayChunk::createField(FieldConstPtr const &valueField)
+{
+	return getFieldCreate()->createFieldBuilder()->
+		add("offset", pvInt)->
+		add("length", pvInt)->
+		add("size", pvInt)->
+		add("value", valueField)->
+		createStructure();
+}
+
+bool NTArrayChunk::attach(PVStructurePtr const &pvChunk)
+{
+	if (!pvChunk) return false;
+
+	pvOffset = pvChunk->getSubField<PVInt>("offset");
+	pvLength = pvChunk->getSubField<PVInt>("length");
+	pvSize = pvChunk->getSubField<PVInt>("size");
+	pvValue = pvChunk->getSubField<PVScalarArray>("value");
+	pvUnionValue = pvChunk->getSubField<PVUnion>("value");
+
+	return pvOffset && pvLength && pvSize && (pvValue || pvUnionValue);
+}
+
+/*
+ * The chunk is a copy rather than a view sharing the record's buffer, so
+ * that a served chunk never forces a copy of the whole array when the
+ * record later updates it in place. Returns false, leaving the chunk alone,
+ * if it already holds the requested range of the same array.
+ *
+ * The arrays are remembered by weak pointers, which do not count as
+ * readers sharing them: a buffer freed and allocated again at the same
+ * address is not mistaken for the one served.
+ */
+template<typename T>
+static bool copyElements(
+	PVScalarArray const &from,
+	size_t offset,
+	size_t length,
+	PVScalarArray &to,
+	NTArrayChunk::Served &served)
+{
+	typedef PVValueArray<T> PVArray;
+
+	typename PVArray::const_svector all(static_cast<PVArray const &>(from).view());
+	typename PVArray::const_svector current(static_cast<PVArray const &>(to).view());
+
+	if (served.valid && offset == served.offset && length == served.length &&
+	    all.data() == served.sourceData && all.size() == served.sourceSize &&
+	    served.source.lock().get() == all.dataPtr().get() &&
+	    served.chunk.lock().get() == current.dataPtr().get())
+		return false;
+
+	size_t begin = std::min(offset, all.size());
+	size_t count = std::min(length, all.size() - begin);
+
+	typename PVArray::svector data(count);
+	std::copy(all.begin() + begin, all.begin() + begin + count, data.begin());
+
+	typename PVArray::const_svector chunk(freeze(data));
+	static_cast<PVArray &>(to).replace(chunk);
+
+	served.valid = all.dataPtr() && chunk.dataPtr();
+	served.source = all.dataPtr();
+	served.sourceData = all.data();
+	served.sourceSize = all.size();
+	served.offset = offset;
+	served.length = length;
+	served.chunk = chunk.dataPtr();
+
+	return true;
+}
+
+bool NTArrayChunk::copyRange(PVScalarArrayPtr const &pvArray, PVScalarArrayPtr const &pvChunkValue)
+{
+	int32 offset = pvOffset->get();
+	int32 length = pvLength->get();
+
+	if (!pvArray || offset < 0 || length <= 0) {
+		served.valid = false;
+		if (pvChunkValue->getLength() == 0) return false;
+		pvChunkValue->setLength(0);
+		return true;
+	}
+
+	PVScalarArray const &from = *pvArray;
+	PVScalarArray &to = *pvChunkValue;
+
+	switch (pvArray->getScalarArray()->getElementType()) {
+	case pvBoolean: return copyElements<boolean>(from, offset, length, to, served);
+	case pvByte:    return copyElements<int8>(from, offset, length, to, served);
+	case pvShort:   return copyElements<int16>(from, offset, length, to, served);
+	case pvInt:     return copyElements<int32>(from, offset, length, to, served);
+	case pvLong:    return copyElements<int64>(from, offset, length, to, served);
+	case pvUByte:   return copyElements<uint8>(from, offset, length, to, served);
+	case pvUShort:  return copyElements<uint16>(from, offset, length, to, served);
+	case pvUInt:    return copyElements<uint32>(from, offset, length, to, served);
+	case pvULong:   return copyElements<uint64>(from, offset, length, to, served);
+	case pvFloat:   return copyElements<float>(from, offset, length, to, served);
+	case pvDouble:  return copyElements<double>(from, offset, length, to, served);
+	case pvString:  return copyElements<string>(from, offset, length, to, served);
+	}
+
+	return false;
+}
+
+void NTArrayChunk::serve(PVScalarArrayPtr const &pvArray)
+{
+	if (!pvValue) return;
+
+	int32 size = pvArray ? (int32) pvArray->getLength() : 0;
+	if (pvSize->get() != size) pvSize->put(size);
+
+	copyRange(pvArray, pvValue);
+}
+
+void NTArrayChunk::serve(PVUnionPtr const &pvArray)
+{
+	if (!pvUnionValue) return;
+
+	PVScalarArrayPtr pvSelected;
+	if (pvArray) pvSelected = pvArray->get<PVScalarArray>();
+
+	int32 size = pvSelected ? (int32) pvSelected->getLength() : 0;
+	if (pvSize->get() != size) pvSize->put(size);
+
+	if (!pvSelected) {
+		served.valid = false;
+		if (pvUnionValue->getSelectedIndex() != PVUnion::UNDEFINED_INDEX) {
+			pvUnionValue->select(PVUnion::UNDEFINED_INDEX);
+			pvUnionValue->postPut();
+		}
+		return;
+	}
+
+	// Make chunk.value hold the same type of array as the record's value.
+	PVScalarArrayPtr pvChunkValue = pvUnionValue->get<PVScalarArray>();
+	if (pvUnionValue->getSelectedIndex() != pvArray->getSelectedIndex() || !pvChunkValue)
+		pvChunkValue = pvUnionValue->select<PVScalarArray>(pvArray->getSelectedIndex());
+
+	// The array inside the union is not a field of the record, so the
+	// change is posted on the union itself.
+	if (copyRange(pvSelected, pvChunkValue)) pvUnionValue->postPut();
+}
+
+void NTArrayChunk::invalidate()
+{
+	served.valid = false;
+}
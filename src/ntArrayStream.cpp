@@ -0,0 +1,60 @@
+/*
+ * ==========================================================
+ *
+ *	ntArrayStream.cpp
+ *
+ *	Source file for chunked reads of large arrays by clients.
+ *
+ * ==========================================================
+ */
+
+#include "ntArrayStream.h"
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::pvaClient;
+
+size_t readArrayChunked(
+	PvaClientChannelPtr const &channel,
+	size_t chunkLength,
+	ArrayChunkConsumer &consumer)
+{
+	PvaClientPutGetPtr putGet = channel->createPutGet(
+		"record[process=true]putField(chunk.offset,chunk.length)getField(chunk)");
+
+	PVStructurePtr pvPut = putGet->getPutData()->getPVStructure();
+	PVIntPtr pvOffset = pvPut->getSubField<PVInt>("chunk.offset");
+	PVIntPtr pvLength = pvPut->getSubField<PVInt>("chunk.length");
+
+	size_t offset = 0;
+	size_t size = 0;
+
+	do {
+		pvOffset->put((int32) offset);
+		pvLength->put((int32) chunkLength);
+		putGet->putGet();
+
+		PVStructurePtr pvGet = putGet->getGetData()->getPVStructure();
+		size = pvGet->getSubField<PVInt>("chunk.size")->get();
+
+		// chunk.value is an array, or a union holding one for the ndarray record.
+		PVScalarArrayPtr chunk = pvGet->getSubField<PVScalarArray>("chunk.value");
+		if (!chunk) {
+			PVUnionPtr pvUnion = pvGet->getSubField<PVUnion>("chunk.value");
+			if (pvUnion) chunk = pvUnion->get<PVScalarArray>();
+		}
+
+		if (!chunk || chunk->getLength() == 0) break;
+
+		bool more = consumer.consume(offset, size, chunk);
+		offset += chunk->getLength();
+		if (!more) break;
+
+	} while (offset < size);
+
+	// Release the last chunk held by the record.
+	pvLength->put(0);
+	putGet->putGet();
+
+	return offset;
+}
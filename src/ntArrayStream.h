@@ -0,0 +1,44 @@
+#ifndef NTARRAYSTREAM_H
+#define NTARRAYSTREAM_H
+
+/*
+ * ==========================================================
+ *	ntArrayStream.h
+ *
+ *	Header file for chunked reads of large arrays by clients.
+ *
+ *	The array records and the ndarray record have a chunk
+ *	structure (see pv/ntArrayChunk.h). readArrayChunked() asks
+ *	for one chunk after another and hands each to a consumer
+ *	before asking for the next. The client therefore holds a
+ *	single chunk at a time and the record is never asked for
+ *	more than the consumer has taken, which bounds memory use
+ *	on both ends by the chunk size.
+ *
+ * ==========================================================
+ */
+
+#include <pv/pvData.h>
+#include <pv/pvaClient.h>
+
+class ArrayChunkConsumer {
+	public:
+		virtual ~ArrayChunkConsumer() {}
+
+		// Called for each chunk in order. offset is the position of the chunk's
+		// first element and size the length of the whole array.
+		// Returning false ends the transfer.
+		virtual bool consume(
+			size_t offset,
+			size_t size,
+			epics::pvData::PVScalarArrayPtr const &chunk) = 0;
+};
+
+// Reads the value array of an array or ndarray record chunkLength elements
+// at a time. Returns the number of elements handed to the consumer.
+size_t readArrayChunked(
+	epics::pvaClient::PvaClientChannelPtr const &channel,
+	size_t chunkLength,
+	ArrayChunkConsumer &consumer);
+
+#endif /* NTARRAYSTREAM_H */
@@ -0,0 +1,226 @@
+/*
+ * ==========================================================
+ *
+ *	ntBenchmark.cpp
+ *
+ *	Source file for the microbenchmark harness used by
+ *	ntDatabaseBench.
+ *
+ * ==========================================================
+ */
+
+#include "ntBenchmark.h"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <epicsThread.h>
+#include <epicsTime.h>
+
+using namespace std;
+
+// Upper bound on the iterations of a single run.
+static const size_t maxRunIterations = 1000000000;
+
+BenchmarkState::BenchmarkState(size_t maxIterations)
+	: maxIterations(maxIterations),
+	  iterations(0),
+	  started(false),
+	  timing(false),
+	  realStart(0),
+	  realTotal(0),
+	  cpuStart(0),
+	  cpuTotal(0.0)
+{
+}
+
+bool BenchmarkState::keepRunning()
+{
+	if (!started) {
+		started = true;
+		resumeTiming();
+	}
+
+	if (iterations < maxIterations && error.empty()) {
+		++iterations;
+		return true;
+	}
+
+	pauseTiming();
+	return false;
+}
+
+void BenchmarkState::pauseTiming()
+{
+	if (!timing) return;
+
+	realTotal += epicsMonotonicGet() - realStart;
+	cpuTotal += (double) (clock() - cpuStart) * 1e9 / CLOCKS_PER_SEC;
+	timing = false;
+}
+
+void BenchmarkState::resumeTiming()
+{
+	if (timing) return;
+
+	timing = true;
+	cpuStart = clock();
+	realStart = epicsMonotonicGet();
+}
+
+void BenchmarkState::setCounter(string const &name, double value)
+{
+	counters[name] = value;
+}
+
+void BenchmarkState::skipWithError(string const &message)
+{
+	error = message;
+	pauseTiming();
+}
+
+BenchmarkRunner::BenchmarkRunner()
+	: minTime(0.5)
+{
+}
+
+void BenchmarkRunner::add(Benchmark::shared_pointer const &benchmark)
+{
+	benchmarks.push_back(benchmark);
+}
+
+BenchmarkResult BenchmarkRunner::runBenchmark(Benchmark &benchmark)
+{
+	size_t iterations = 1;
+
+	while (true) {
+		BenchmarkState state(iterations);
+		benchmark.run(state);
+
+		double seconds = state.getRealTime() / 1e9;
+
+		// Accept the run once it is long enough to be meaningful, or
+		// failed, as a longer one would fail too.
+		if (seconds >= minTime || iterations >= maxRunIterations || !state.getError().empty()) {
+			BenchmarkResult result;
+			result.name = benchmark.getName();
+			result.iterations = state.getIterations();
+			result.realTime = state.getIterations() ? state.getRealTime() / state.getIterations() : 0.0;
+			result.cpuTime = state.getIterations() ? state.getCpuTime() / state.getIterations() : 0.0;
+			result.counters = state.getCounters();
+			result.error = state.getError();
+			return result;
+		}
+
+		// Predict the iterations needed to reach minTime, growing at most tenfold.
+		double multiplier = (seconds > 0.0) ? (minTime * 1.4 / seconds) : 10.0;
+		if (multiplier > 10.0) multiplier = 10.0;
+		if (multiplier < 2.0) multiplier = 2.0;
+
+		double next = iterations * multiplier;
+		iterations = (next > maxRunIterations) ? maxRunIterations : (size_t) next;
+	}
+}
+
+void BenchmarkRunner::run(ostream &out)
+{
+	results.clear();
+
+	out << left << setw(48) << "Benchmark"
+	    << right << setw(16) << "Time (ns)"
+	    << setw(16) << "CPU (ns)"
+	    << setw(14) << "Iterations" << "\n";
+	out << string(94, '-') << "\n";
+
+	for (size_t i = 0; i < benchmarks.size(); ++i) {
+		Benchmark &benchmark = *benchmarks[i];
+
+		if (!filter.empty() && benchmark.getName().find(filter) == string::npos)
+			continue;
+
+		benchmark.setUp();
+		BenchmarkResult result = runBenchmark(benchmark);
+		benchmark.tearDown();
+
+		if (!result.error.empty()) {
+			out << left << setw(48) << result.name << " ERROR: " << result.error << "\n";
+			out.flush();
+
+			results.push_back(result);
+			continue;
+		}
+
+		out << left << setw(48) << result.name
+		    << right << fixed << setprecision(1)
+		    << setw(16) << result.realTime
+		    << setw(16) << result.cpuTime
+		    << setw(14) << result.iterations;
+
+		map<string, double>::const_iterator it;
+		for (it = result.counters.begin(); it != result.counters.end(); ++it)
+			out << " " << it->first << "=" << it->second;
+		out << "\n";
+		out.flush();
+
+		results.push_back(result);
+	}
+}
+
+// Escapes the characters that may not appear unquoted in a JSON string.
+static string jsonString(string const &str)
+{
+	stringstream out;
+	out << '"';
+	for (size_t i = 0; i < str.size(); ++i) {
+		char c = str[i];
+		if (c == '"' || c == '\\') out << '\\' << c;
+		else if (c == '\n') out << "\\n";
+		else if (c == '\t') out << "\\t";
+		else if ((unsigned char) c < 0x20) out << "\\u" << hex << setw(4) << setfill('0') << (int) c << dec;
+		else out << c;
+	}
+	out << '"';
+	return out.str();
+}
+
+void BenchmarkRunner::writeJSON(ostream &out, string const &executable) const
+{
+	char date[64];
+	epicsTime::getCurrent().strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S");
+
+	out << "{\n"
+	    << "  \"context\": {\n"
+	    << "    \"date\": " << jsonString(date) << ",\n"
+	    << "    \"executable\": " << jsonString(executable) << ",\n"
+	    << "    \"num_cpus\": " << epicsThreadGetCPUs() << ",\n"
+	    << "    \"min_time\": " << minTime << "\n"
+	    << "  },\n"
+	    << "  \"benchmarks\": [";
+
+	out << setprecision(3) << fixed;
+
+	for (size_t i = 0; i < results.size(); ++i) {
+		BenchmarkResult const &result = results[i];
+
+		out << (i ? ",\n" : "\n")
+		    << "    {\n"
+		    << "      \"name\": " << jsonString(result.name) << ",\n"
+		    << "      \"iterations\": " << result.iterations << ",\n"
+		    << "      \"real_time\": " << result.realTime << ",\n"
+		    << "      \"cpu_time\": " << result.cpuTime << ",\n";
+
+		if (!result.error.empty())
+			out << "      \"error_occurred\": true,\n"
+			    << "      \"error_message\": " << jsonString(result.error) << ",\n";
+
+		map<string, double>::const_iterator it;
+		for (it = result.counters.begin(); it != result.counters.end(); ++it)
+			out << "      " << jsonString(it->first) << ": " << it->second << ",\n";
+
+		out << "      \"time_unit\": \"ns\"\n"
+		    << "    }";
+	}
+
+	out << "\n  ]\n}\n";
+}
@@ -0,0 +1,123 @@
+#ifndef NTBENCHMARK_H
+#define NTBENCHMARK_H
+
+/*
+ * ==========================================================
+ *	ntBenchmark.h
+ *
+ *	Header file for a small in-process microbenchmark harness.
+ *
+ *	It is modelled on Google Benchmark: a benchmark's run()
+ *	loops on BenchmarkState::keepRunning() and the runner
+ *	grows the iteration count until a run lasts at least the
+ *	configured minimum time. Results are printed as a table
+ *	and written out in Google Benchmark's JSON layout so that
+ *	existing regression tracking tools can read them.
+ *
+ * ==========================================================
+ */
+
+#include <ctime>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <epicsTypes.h>
+#include <pv/sharedPtr.h>
+
+class BenchmarkState {
+	public:
+		explicit BenchmarkState(size_t maxIterations);
+
+		// Returns true while the benchmark should execute another iteration.
+		bool keepRunning();
+
+		// Exclude set up work inside the loop from the measured time.
+		void pauseTiming();
+		void resumeTiming();
+
+		// Reports a user defined value alongside the timings.
+		void setCounter(std::string const &name, double value);
+
+		// Ends the run as failed: keepRunning() returns false from now on
+		// and the runner reports message instead of the timings.
+		void skipWithError(std::string const &message);
+
+		size_t getIterations() const { return iterations; }
+		// Total measured wall clock and cpu time in nanoseconds.
+		double getRealTime() const { return (double) realTotal; }
+		double getCpuTime() const { return cpuTotal; }
+		std::map<std::string, double> const &getCounters() const { return counters; }
+		std::string const &getError() const { return error; }
+
+	private:
+		size_t maxIterations;
+		size_t iterations;
+		bool started;
+		bool timing;
+		epicsUInt64 realStart;
+		epicsUInt64 realTotal;
+		std::clock_t cpuStart;
+		double cpuTotal;
+		std::map<std::string, double> counters;
+		std::string error;
+};
+
+class Benchmark {
+	public:
+		POINTER_DEFINITIONS(Benchmark);
+
+		explicit Benchmark(std::string const &name) : name(name) {}
+		virtual ~Benchmark() {}
+
+		// Called once before and after all runs of the benchmark.
+		virtual void setUp() {}
+		virtual void tearDown() {}
+
+		virtual void run(BenchmarkState &state) = 0;
+
+		std::string const &getName() const { return name; }
+
+	private:
+		std::string name;
+};
+
+struct BenchmarkResult {
+	std::string name;
+	size_t iterations;
+	double realTime;   // nanoseconds per iteration
+	double cpuTime;    // nanoseconds per iteration
+	std::map<std::string, double> counters;
+	std::string error;  // empty unless the run failed
+};
+
+class BenchmarkRunner {
+	public:
+		BenchmarkRunner();
+
+		void add(Benchmark::shared_pointer const &benchmark);
+
+		// Only benchmarks whose name contains filter are run.
+		void setFilter(std::string const &filter) { this->filter = filter; }
+		// Minimum measured time of a run in seconds.
+		void setMinTime(double minTime) { this->minTime = minTime; }
+
+		// Runs the selected benchmarks and prints a table to out.
+		void run(std::ostream &out);
+
+		// Writes the results of the last run in Google Benchmark's JSON format.
+		void writeJSON(std::ostream &out, std::string const &executable) const;
+
+		std::vector<BenchmarkResult> const &getResults() const { return results; }
+
+	private:
+		BenchmarkResult runBenchmark(Benchmark &benchmark);
+
+		std::vector<Benchmark::shared_pointer> benchmarks;
+		std::vector<BenchmarkResult> results;
+		std::string filter;
+		double minTime;
+};
+
+#endif /* NTBENCHMARK_H */
@@ -0,0 +1,338 @@
+/*
+ * =============================================================
+ *
+ * 	ntCalcExpression.cpp
+ *
+ *	Source file that implements the compilation and evaluation
+ *	of the expressions of the calc records.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntCalcExpression.h>
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+using namespace epics::ntDatabase;
+
+static double absolute(double x) { return fabs(x); }
+static double minimum(double x, double y) { return x < y ? x : y; }
+static double maximum(double x, double y) { return x > y ? x : y; }
+
+static const struct {
+	const char *name;
+	double (*function)(double);
+} functions1[] = {
+	{ "abs",   &absolute },
+	{ "sqrt",  &sqrt     },
+	{ "exp",   &exp      },
+	{ "log",   &log      },
+	{ "log10", &log10    },
+	{ "sin",   &sin      },
+	{ "cos",   &cos      },
+	{ "tan",   &tan      },
+	{ "floor", &floor    },
+	{ "ceil",  &ceil     }
+};
+
+static const struct {
+	const char *name;
+	double (*function)(double, double);
+} functions2[] = {
+	{ "min",   &minimum },
+	{ "max",   &maximum },
+	{ "pow",   &pow     },
+	{ "atan2", &atan2   }
+};
+
+static const struct {
+	const char *name;
+	NTCalcExpression::Reduction reduction;
+} reductions[] = {
+	{ "sum",  NTCalcExpression::sum  },
+	{ "mean", NTCalcExpression::mean },
+	{ "size", NTCalcExpression::size }
+};
+
+#define TABLE_SIZE(table) (sizeof(table) / sizeof(table[0]))
+
+namespace epics { namespace ntDatabase {
+
+/*
+ * Recursive descent compiler emitting the bytecode of an expression.
+ * It tracks the depth of the evaluation stack so that evaluate() can
+ * use a fixed size stack, and the depth of its own recursion, which
+ * parentheses and unary minus deepen without using the stack, so that
+ * a deeply nested expression fails rather than overflowing the C stack.
+ */
+class NTCalcCompiler {
+	public:
+		NTCalcCompiler(NTCalcExpression &result)
+			: result(result), text(result.expression), position(0), depth(0), nesting(0) {}
+
+		void compile()
+		{
+			expression();
+			skipSpace();
+			if (position != text.size()) fail("unexpected character");
+		}
+
+	private:
+		void expression()
+		{
+			term();
+			while (true) {
+				if (accept('+')) { term(); emit(NTCalcExpression::add, 0, -1); }
+				else if (accept('-')) { term(); emit(NTCalcExpression::subtract, 0, -1); }
+				else return;
+			}
+		}
+
+		void term()
+		{
+			unary();
+			while (true) {
+				if (accept('*')) { unary(); emit(NTCalcExpression::multiply, 0, -1); }
+				else if (accept('/')) { unary(); emit(NTCalcExpression::divide, 0, -1); }
+				else if (accept('%')) { unary(); emit(NTCalcExpression::modulo, 0, -1); }
+				else return;
+			}
+		}
+
+		void unary()
+		{
+			enter();
+
+			if (accept('-')) {
+				unary();
+				emit(NTCalcExpression::negate, 0, 0);
+				--nesting;
+				return;
+			}
+
+			primary();
+
+			// Right associative, binding tighter than a unary minus on its left.
+			if (accept('^')) {
+				unary();
+				emit(NTCalcExpression::power, 0, -1);
+			}
+
+			--nesting;
+		}
+
+		void primary()
+		{
+			enter();
+			primaryOperand();
+			--nesting;
+		}
+
+		void primaryOperand()
+		{
+			skipSpace();
+			if (position == text.size()) fail("expression ends early");
+
+			char c = text[position];
+
+			if (accept('(')) {
+				expression();
+				expect(')');
+			} else if (isdigit((unsigned char) c) || c == '.') {
+				number();
+			} else if (isalpha((unsigned char) c) || c == '_') {
+				name();
+			} else {
+				fail("unexpected character");
+			}
+		}
+
+		void number()
+		{
+			const char *start = text.c_str() + position;
+			char *end;
+			double value = strtod(start, &end);
+
+			if (end == start) fail("malformed number");
+			position += end - start;
+
+			result.constants.push_back(value);
+			emit(NTCalcExpression::pushConstant, result.constants.size() - 1, 1);
+		}
+
+		void name()
+		{
+			size_t start = position;
+			string identifier = readName();
+
+			skipSpace();
+			if (position == text.size() || text[position] != '(') {
+				emit(NTCalcExpression::pushInput, input(identifier, NTCalcExpression::value), 1);
+				return;
+			}
+			++position;
+
+			for (size_t i = 0; i < TABLE_SIZE(reductions); ++i) {
+				if (identifier != reductions[i].name) continue;
+
+				skipSpace();
+				string recordName = readName();
+				if (recordName.empty() || isdigit((unsigned char) recordName[0]))
+					fail("expected a record name");
+				expect(')');
+
+				emit(NTCalcExpression::pushInput, input(recordName, reductions[i].reduction), 1);
+				return;
+			}
+
+			for (size_t i = 0; i < TABLE_SIZE(functions1); ++i) {
+				if (identifier != functions1[i].name) continue;
+
+				expression();
+				expect(')');
+				emit(NTCalcExpression::call1, i, 0);
+				return;
+			}
+
+			for (size_t i = 0; i < TABLE_SIZE(functions2); ++i) {
+				if (identifier != functions2[i].name) continue;
+
+				expression();
+				expect(',');
+				expression();
+				expect(')');
+				emit(NTCalcExpression::call2, i, -1);
+				return;
+			}
+
+			position = start;
+			fail("unknown function " + identifier);
+		}
+
+		string readName()
+		{
+			size_t start = position;
+
+			while (position < text.size()) {
+				char c = text[position];
+				if (!isalnum((unsigned char) c) && c != '_' && c != ':') break;
+				++position;
+			}
+
+			return text.substr(start, position - start);
+		}
+
+		// Index of the input for a use of a record, shared by equal uses.
+		size_t input(string const &recordName, NTCalcExpression::Reduction reduction)
+		{
+			vector<NTCalcExpression::Input> &inputs = result.inputs;
+
+			for (size_t i = 0; i < inputs.size(); ++i) {
+				if (inputs[i].recordName == recordName && inputs[i].reduction == reduction)
+					return i;
+			}
+
+			NTCalcExpression::Input input;
+			input.recordName = recordName;
+			input.reduction = reduction;
+			inputs.push_back(input);
+
+			return inputs.size() - 1;
+		}
+
+		void emit(NTCalcExpression::Opcode opcode, size_t operand, int stackChange)
+		{
+			NTCalcExpression::Instruction instruction;
+			instruction.opcode = opcode;
+			instruction.operand = operand;
+			result.code.push_back(instruction);
+
+			depth += stackChange;
+			if (depth > (int) NTCalcExpression::maxStackDepth) fail("expression is nested too deeply");
+		}
+
+		// Counts a level of recursion of unary() or primary(). An
+		// exception ends the compilation, so the count need not be undone.
+		void enter()
+		{
+			if (++nesting > (int) NTCalcExpression::maxStackDepth) fail("expression is nested too deeply");
+		}
+
+		void skipSpace()
+		{
+			while (position < text.size() && isspace((unsigned char) text[position])) ++position;
+		}
+
+		bool accept(char c)
+		{
+			skipSpace();
+			if (position == text.size() || text[position] != c) return false;
+			++position;
+			return true;
+		}
+
+		void expect(char c)
+		{
+			if (!accept(c)) fail(string("expected '") + c + "'");
+		}
+
+		void fail(string const &message)
+		{
+			stringstream str;
+			str << message << " at position " << position << " of \"" << text << "\"";
+			throw runtime_error(str.str());
+		}
+
+		NTCalcExpression &result;
+		string const &text;
+		size_t position;
+		int depth;
+		int nesting;
+};
+
+}}
+
+NTCalcExpressionPtr NTCalcExpression::compile(string const &expression)
+{
+	NTCalcExpressionPtr result(new NTCalcExpression());
+	result->expression = expression;
+
+	NTCalcCompiler compiler(*result);
+	compiler.compile();
+
+	return result;
+}
+
+double NTCalcExpression::evaluate(double const *inputs) const
+{
+	double stack[maxStackDepth];
+	double *top = stack - 1;
+
+	for (size_t i = 0; i < code.size(); ++i) {
+		Instruction const &instruction = code[i];
+
+		switch (instruction.opcode) {
+			case pushConstant: *++top = constants[instruction.operand]; break;
+			case pushInput:    *++top = inputs[instruction.operand]; break;
+			case add:          top[-1] += top[0]; --top; break;
+			case subtract:     top[-1] -= top[0]; --top; break;
+			case multiply:     top[-1] *= top[0]; --top; break;
+			case divide:       top[-1] /= top[0]; --top; break;
+			case modulo:       top[-1] = fmod(top[-1], top[0]); --top; break;
+			case power:        top[-1] = pow(top[-1], top[0]); --top; break;
+			case negate:       top[0] = -top[0]; break;
+			case call1:        top[0] = functions1[instruction.operand].function(top[0]); break;
+			case call2:
+				top[-1] = functions2[instruction.operand].function(top[-1], top[0]);
+				--top;
+				break;
+		}
+	}
+
+	return *top;
+}
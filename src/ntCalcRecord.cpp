@@ -0,0 +1,223 @@
+/*
+ * =============================================================
+ *
+ * 	ntCalcRecord.cpp
+ *
+ *	Source file that implements the calc records, whose value
+ *	is computed from the values of other records.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntCalcRecord.h>
+
+#include <iostream>
+#include <stdexcept>
+
+#include <epicsMath.h>
+
+#include <pv/ntscalar.h>
+#include <pv/ntProcessQueue.h>
+
+using namespace std;
+using std::tr1::dynamic_pointer_cast;
+using namespace epics::pvData;
+using namespace epics::pvDatabase;
+using namespace epics::nt;
+using namespace epics::ntDatabase;
+
+/*
+ * Computes an input of the expression from the value field of a record.
+ * Returns false if the field does not suit the input.
+ */
+static bool computeInput(
+	PVStructurePtr const &pvStructure,
+	NTCalcExpression::Reduction reduction,
+	double &result)
+{
+	PVFieldPtr pvField = pvStructure->getSubField("value");
+
+	if (reduction == NTCalcExpression::value) {
+		PVScalarPtr pvScalar = dynamic_pointer_cast<PVScalar>(pvField);
+		if (!pvScalar || !ScalarTypeFunc::isNumeric(pvScalar->getScalar()->getScalarType()))
+			return false;
+
+		result = pvScalar->getAs<double>();
+		return true;
+	}
+
+	PVScalarArrayPtr pvArray = dynamic_pointer_cast<PVScalarArray>(pvField);
+	if (!pvArray) return false;
+
+	if (reduction == NTCalcExpression::size) {
+		result = (double) pvArray->getLength();
+		return true;
+	}
+
+	if (!ScalarTypeFunc::isNumeric(pvArray->getScalarArray()->getElementType()))
+		return false;
+
+	// Shares the array if it holds doubles, converts a copy otherwise.
+	shared_vector<const double> data;
+	pvArray->getAs<double>(data);
+
+	double sum = 0.0;
+	for (size_t i = 0; i < data.size(); ++i) sum += data[i];
+
+	if (reduction == NTCalcExpression::mean)
+		result = data.empty() ? 0.0 : sum / data.size();
+	else
+		result = sum;
+
+	return true;
+}
+
+/*
+ * Listener passing the changes of one input record to a calc record.
+ * It holds the calc record weakly so that a calc record that is gone is
+ * not kept alive by the records it used.
+ */
+class CalcInputListener : public NTProcessListener {
+	public:
+		CalcInputListener(
+			NTCalcRecordPtr const &calcRecord,
+			size_t input,
+			NTCalcExpression::Reduction reduction)
+			: calcRecord(calcRecord), input(input), reduction(reduction) {}
+
+		virtual void processed(NTRecord &record)
+		{
+			NTCalcRecordPtr calc = calcRecord.lock();
+			if (!calc) return;
+
+			double value;
+			if (computeInput(record.getPVStructure(), reduction, value))
+				calc->setInput(input, value);
+		}
+
+	private:
+		std::tr1::weak_ptr<NTCalcRecord> calcRecord;
+		size_t input;
+		NTCalcExpression::Reduction reduction;
+};
+
+PVStructurePtr NTCalcRecord::createPVStructure()
+{
+	NTScalarBuilderPtr ntScalarBuilder = NTScalar::createBuilder();
+
+	return ntScalarBuilder->
+		value(pvDouble)->
+		addAlarm()->
+		addTimeStamp()->
+		add("expression", getFieldCreate()->createScalar(pvString))->
+		createPVStructure();
+}
+
+NTCalcRecordPtr NTCalcRecord::create(
+	string const &recordName,
+	string const &expression)
+{
+	NTCalcExpressionPtr compiled;
+
+	try {
+		compiled = NTCalcExpression::compile(expression);
+	} catch (std::exception &e) {
+		cerr << "Can not compile the expression of record " << recordName << ": " << e.what() << "\n";
+		return NTCalcRecordPtr();
+	}
+
+	NTCalcRecordPtr pvRecord(new NTCalcRecord(recordName, createPVStructure(), compiled));
+
+	if (!pvRecord->init() || !pvRecord->bindInputs()) pvRecord.reset();
+
+	return pvRecord;
+}
+
+NTCalcRecord::NTCalcRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure,
+	NTCalcExpressionPtr const &expression)
+	: NTRecord(recordName, pvStructure),
+	  expression(expression),
+	  inputValues(expression->getInputs().size(), 0.0)
+{
+}
+
+bool NTCalcRecord::init()
+{
+	if (!NTRecord::init()) return false;
+
+	pvValue = getPVStructure()->getSubField<PVDouble>("value");
+	if (!pvValue) return false;
+
+	getPVStructure()->getSubField<PVString>("expression")->put(expression->getExpression());
+
+	return true;
+}
+
+bool NTCalcRecord::bindInputs()
+{
+	vector<NTCalcExpression::Input> const &inputs = expression->getInputs();
+	PVDatabasePtr master = PVDatabase::getMaster();
+	NTCalcRecordPtr self = dynamic_pointer_cast<NTCalcRecord>(shared_from_this());
+
+	for (size_t i = 0; i < inputs.size(); ++i) {
+
+		NTRecordPtr record = dynamic_pointer_cast<NTRecord>(master->findRecord(inputs[i].recordName));
+		if (!record) {
+			cerr << "Record " << getRecordName() << " uses " << inputs[i].recordName
+			     << ", which is not a record of the database\n";
+			return false;
+		}
+
+		// Start from the record's current value.
+		record->lock();
+		bool suits = computeInput(record->getPVStructure(), inputs[i].reduction, inputValues[i]);
+		record->unlock();
+
+		if (!suits) {
+			cerr << "Record " << getRecordName() << " can not use the value of "
+			     << inputs[i].recordName << " as written in its expression\n";
+			return false;
+		}
+
+		record->addProcessListener(NTProcessListenerPtr(
+			new CalcInputListener(self, i, inputs[i].reduction)));
+	}
+
+	// Compute the initial value.
+	lock();
+	beginGroupPut();
+	process();
+	endGroupPut();
+	unlock();
+
+	return true;
+}
+
+void NTCalcRecord::setInput(size_t input, double value)
+{
+	{
+		Lock lock(inputMutex);
+
+		if (inputValues[input] == value) return;
+		inputValues[input] = value;
+	}
+
+	NTProcessQueue::get()->request(dynamic_pointer_cast<NTRecord>(shared_from_this()));
+}
+
+void NTCalcRecord::processRecord()
+{
+	{
+		Lock lock(inputMutex);
+		evaluatedValues = inputValues;
+	}
+
+	double result = expression->evaluate(evaluatedValues.empty() ? 0 : &evaluatedValues[0]);
+
+	pvValue->put(result);
+
+	if (finite(result)) clearAlarm();
+	else raiseAlarm("result is not finite");
+}
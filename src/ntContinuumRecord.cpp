@@ -0,0 +1,138 @@
+/*
+ * =============================================================
+ *
+ * 	ntContinuumRecord.cpp
+ *
+ *	Source file that implements the continuum record and its
+ *	resampling onto a uniform grid.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntContinuumRecord.h>
+
+#include <pv/ntcontinuum.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::nt;
+using namespace epics::ntDatabase;
+
+const int32 NTContinuumRecord::maxResampleCount;
+
+PVStructurePtr NTContinuumRecord::createPVStructure()
+{
+	StructureConstPtr resample = getFieldCreate()->createFieldBuilder()->
+		add("start", pvDouble)->
+		add("step", pvDouble)->
+		add("count", pvInt)->
+		add("method", pvString)->
+		addArray("value", pvDouble)->
+		createStructure();
+
+	NTContinuumBuilderPtr ntContinuumBuilder = NTContinuum::createBuilder();
+
+	return ntContinuumBuilder->
+		addAlarm()->
+		addTimeStamp()->
+		add("resample", resample)->
+		createPVStructure();
+}
+
+NTContinuumRecordPtr NTContinuumRecord::create(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+{
+	NTContinuumRecordPtr pvRecord(new NTContinuumRecord(recordName, pvStructure));
+
+	if (!pvRecord->init()) pvRecord.reset();
+
+	return pvRecord;
+}
+
+NTContinuumRecord::NTContinuumRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+	: NTRecord(recordName, pvStructure),
+	  stale(true),
+	  cachedStart(0.0),
+	  cachedStep(0.0),
+	  cachedCount(0),
+	  cachedMethod(NTResampler::linear)
+{
+}
+
+bool NTContinuumRecord::init()
+{
+	if (!NTRecord::init()) return false;
+
+	PVStructurePtr pvStructure = getPVStructure();
+
+	pvBase = pvStructure->getSubField<PVDoubleArray>("base");
+	pvValue = pvStructure->getSubField<PVDoubleArray>("value");
+	pvStart = pvStructure->getSubField<PVDouble>("resample.start");
+	pvStep = pvStructure->getSubField<PVDouble>("resample.step");
+	pvCount = pvStructure->getSubField<PVInt>("resample.count");
+	pvMethod = pvStructure->getSubField<PVString>("resample.method");
+	pvResampled = pvStructure->getSubField<PVDoubleArray>("resample.value");
+
+	return pvBase && pvValue && pvStart && pvStep && pvCount && pvMethod && pvResampled;
+}
+
+void NTContinuumRecord::processRecord()
+{
+	shared_vector<const double> base = pvBase->view();
+	shared_vector<const double> value = pvValue->view();
+
+	// A put of base or value replaces its array, so the waveform is
+	// unchanged as long as the resampler holds the same arrays.
+	if (!resampler.holds(base, value)) {
+
+		if (!resampler.setSamples(base, value)) {
+			raiseAlarm("base must be strictly increasing and as long as value");
+			return;
+		}
+
+		stale = true;
+	}
+
+	double start = pvStart->get();
+	double step = pvStep->get();
+	int32 count = pvCount->get();
+	string methodName = pvMethod->get();
+
+	NTResampler::Method method;
+	if (methodName.empty() || methodName == "linear") method = NTResampler::linear;
+	else if (methodName == "cubic") method = NTResampler::cubic;
+	else {
+		raiseAlarm("unknown resample method " + methodName);
+		return;
+	}
+
+	if (count < 0 || (count > 1 && !(step > 0.0))) {
+		raiseAlarm("resample needs a count of 0 or more and a positive step");
+		return;
+	}
+
+	if (count > maxResampleCount) {
+		raiseAlarm("resample count is over its limit");
+		return;
+	}
+
+	clearAlarm();
+
+	bool sameGrid = start == cachedStart && step == cachedStep &&
+		count == cachedCount && method == cachedMethod;
+
+	if (!stale && sameGrid) return;
+
+	shared_vector<double> resampled(count);
+	if (count > 0) resampler.resample(start, step, count, method, resampled.data());
+	pvResampled->replace(freeze(resampled));
+
+	stale = false;
+	cachedStart = start;
+	cachedStep = step;
+	cachedCount = count;
+	cachedMethod = method;
+}
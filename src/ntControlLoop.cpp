@@ -0,0 +1,392 @@
+/*
+ * =============================================================
+ *
+ * 	ntControlLoop.cpp
+ *
+ *	Source file that implements the main loop of the database
+ *	server and its control socket.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntControlLoop.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace epics::ntDatabase;
+
+#ifndef MSG_NOSIGNAL
+#	define MSG_NOSIGNAL 0
+#endif
+
+// Most clients connected to the control socket at once.
+static const size_t maxClients = 16;
+
+// Write end of the wake pipe of the running loop, for the signal handler.
+static volatile int signalFd = -1;
+
+static struct sigaction previousInt;
+static struct sigaction previousTerm;
+
+static void onSignal(int)
+{
+	int saved = errno;
+	char byte = 's';
+	if (signalFd >= 0 && write(signalFd, &byte, 1) < 0) {}
+	errno = saved;
+}
+
+// Connects to the socket at address and hangs up. Returns 0 if a server
+// listens there, else the error of the connection.
+static int probe(struct sockaddr_un const &address)
+{
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) return errno;
+
+	int error = 0;
+	if (connect(fd, (struct sockaddr const *) &address, sizeof(address)) < 0) error = errno;
+
+	close(fd);
+	return error;
+}
+
+// Shutdown command, ending the loop.
+class ShutdownCommand : public NTControlCommand {
+	public:
+		explicit ShutdownCommand(NTControlLoop &loop) : loop(loop) {}
+
+		virtual string execute(string const &)
+		{
+			loop.shutdown();
+			return "shutting down";
+		}
+
+	private:
+		NTControlLoop &loop;
+};
+
+NTControlLoopPtr NTControlLoop::create(string const &socketPath)
+{
+	NTControlLoopPtr loop(new NTControlLoop());
+
+	if (pipe(loop->wake) < 0) {
+		cerr << "Failed to create the control loop: " << strerror(errno) << "\n";
+		return NTControlLoopPtr();
+	}
+
+	fcntl(loop->wake[0], F_SETFL, O_NONBLOCK);
+	fcntl(loop->wake[1], F_SETFL, O_NONBLOCK);
+
+	if (!socketPath.empty() && !loop->listen(socketPath)) return NTControlLoopPtr();
+
+	loop->addCommand("shutdown", NTControlCommandPtr(new ShutdownCommand(*loop)),
+		"stops the server");
+
+	return loop;
+}
+
+NTControlLoop::NTControlLoop()
+	: listenFd(-1),
+	  stopping(false)
+{
+	wake[0] = wake[1] = -1;
+}
+
+NTControlLoop::~NTControlLoop()
+{
+	for (size_t i = 0; i < clients.size(); ++i)
+		close(clients[i].fd);
+
+	if (listenFd >= 0) {
+		close(listenFd);
+		unlink(socketPath.c_str());
+	}
+
+	if (wake[0] >= 0) close(wake[0]);
+	if (wake[1] >= 0) close(wake[1]);
+}
+
+bool NTControlLoop::listen(string const &path)
+{
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+
+	if (path.size() >= sizeof(address.sun_path)) {
+		cerr << "Control socket path " << path << " is too long\n";
+		return false;
+	}
+	strcpy(address.sun_path, path.c_str());
+
+	// A socket left by a server that did not stop cleanly is in the way,
+	// but anything else at the path is left alone.
+	struct stat status;
+	if (lstat(path.c_str(), &status) == 0) {
+		if (!S_ISSOCK(status.st_mode)) {
+			cerr << "Control socket path " << path << " is taken by a file that is not a socket\n";
+			return false;
+		}
+
+		int error = probe(address);
+		if (error == 0) {
+			cerr << "Another server listens on control socket " << path << "\n";
+			return false;
+		}
+		if (error != ECONNREFUSED) {
+			cerr << "Failed to check control socket " << path << ": " << strerror(error) << "\n";
+			return false;
+		}
+
+		unlink(path.c_str());
+	}
+
+	listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenFd < 0) {
+		cerr << "Failed to create control socket: " << strerror(errno) << "\n";
+		return false;
+	}
+
+	// The commands change the database, so only the server's user may
+	// connect. The socket takes its mode from the umask when it is bound.
+	mode_t previousMask = umask(0177);
+	int bound = bind(listenFd, (struct sockaddr *) &address, sizeof(address));
+	int bindError = errno;
+	umask(previousMask);
+
+	if (bound < 0 || ::listen(listenFd, 8) < 0) {
+		cerr << "Failed to listen on control socket " << path << ": "
+			<< strerror(bound < 0 ? bindError : errno) << "\n";
+		if (bound == 0) unlink(path.c_str());
+		close(listenFd);
+		listenFd = -1;
+		return false;
+	}
+
+	fcntl(listenFd, F_SETFL, O_NONBLOCK);
+	socketPath = path;
+
+	return true;
+}
+
+void NTControlLoop::addCommand(
+	string const &name,
+	NTControlCommandPtr const &command,
+	string const &help)
+{
+	commands[name].command = command;
+	commands[name].help = help;
+}
+
+void NTControlLoop::shutdown()
+{
+	char byte = 'x';
+	if (write(wake[1], &byte, 1) < 0) {}
+}
+
+string NTControlLoop::execute(string const &line)
+{
+	size_t start = line.find_first_not_of(" \t\r");
+	if (start == string::npos) return "";
+
+	size_t end = line.find_first_of(" \t\r", start);
+	string name = line.substr(start, end - start);
+
+	size_t argumentStart = (end == string::npos) ? string::npos : line.find_first_not_of(" \t", end);
+	string argument = (argumentStart == string::npos) ? string() : line.substr(argumentStart);
+	if (!argument.empty() && argument[argument.size() - 1] == '\r')
+		argument.erase(argument.size() - 1);
+
+	if (name == "help") {
+		stringstream reply;
+		reply << "help - lists the commands";
+		for (map<string, Command>::const_iterator it = commands.begin(); it != commands.end(); ++it)
+			reply << "\n" << it->first << " - " << it->second.help;
+		return reply.str();
+	}
+
+	map<string, Command>::const_iterator it = commands.find(name);
+	if (it == commands.end()) return "unknown command " + name + " (try help)";
+
+	try {
+		return it->second.command->execute(argument);
+	} catch (std::exception &e) {
+		return name + " failed: " + e.what();
+	}
+}
+
+void NTControlLoop::accept()
+{
+	int fd = ::accept(listenFd, NULL, NULL);
+	if (fd < 0) return;
+
+	// A client that does not read its replies must not stall the loop.
+	fcntl(fd, F_SETFL, O_NONBLOCK);
+
+	if (clients.size() >= maxClients) {
+		static const char refusal[] = "too many clients\n\n";
+		if (::send(fd, refusal, sizeof(refusal) - 1, MSG_NOSIGNAL) < 0) {}
+		close(fd);
+		return;
+	}
+
+	Client client;
+	client.fd = fd;
+	clients.push_back(client);
+}
+
+bool NTControlLoop::serve(Client &client)
+{
+	char buffer[4096];
+	ssize_t count = read(client.fd, buffer, sizeof(buffer));
+
+	if (count < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+	if (count <= 0) return false;
+
+	client.input.append(buffer, count);
+
+	return answer(client);
+}
+
+bool NTControlLoop::answer(Client &client)
+{
+	// The next command waits until the client has taken the last reply, so
+	// a client that does not read can not pile up replies.
+	size_t newLine;
+	while (client.output.empty() && (newLine = client.input.find('\n')) != string::npos) {
+		string line = client.input.substr(0, newLine);
+		client.input.erase(0, newLine + 1);
+
+		string reply = execute(line);
+		client.output = reply + (reply.empty() ? "\n" : "\n\n");
+		if (!send(client)) return false;
+	}
+
+	// A client that never ends its line is not allowed to grow without bound.
+	return client.input.size() < 65536;
+}
+
+bool NTControlLoop::send(Client &client)
+{
+	size_t written = 0;
+
+	while (written < client.output.size()) {
+		ssize_t count = ::send(client.fd, client.output.data() + written,
+			client.output.size() - written, MSG_NOSIGNAL);
+		if (count < 0 && errno == EINTR) continue;
+		if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+		if (count <= 0) return false;
+		written += count;
+	}
+
+	client.output.erase(0, written);
+	return true;
+}
+
+void NTControlLoop::run(bool console)
+{
+	console = console && isatty(STDIN_FILENO);
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = onSignal;
+	sigemptyset(&action.sa_mask);
+
+	signalFd = wake[1];
+	sigaction(SIGINT, &action, &previousInt);
+	sigaction(SIGTERM, &action, &previousTerm);
+
+	string consoleInput;
+	if (console) cout << "Type exit to stop, or help for the commands:" << endl;
+
+	while (!stopping) {
+
+		vector<struct pollfd> fds;
+		struct pollfd entry;
+		entry.events = POLLIN;
+		entry.revents = 0;
+
+		entry.fd = wake[0];
+		fds.push_back(entry);
+		entry.fd = console ? STDIN_FILENO : -1;
+		fds.push_back(entry);
+		entry.fd = listenFd;
+		fds.push_back(entry);
+
+		// A client with a reply pending is only written to.
+		for (size_t i = 0; i < clients.size(); ++i) {
+			entry.fd = clients[i].fd;
+			entry.events = clients[i].output.empty() ? POLLIN : POLLOUT;
+			fds.push_back(entry);
+		}
+
+		if (poll(&fds[0], fds.size(), -1) < 0) {
+			if (errno == EINTR) continue;
+			cerr << "Control loop failed: " << strerror(errno) << "\n";
+			break;
+		}
+
+		if (fds[0].revents) {
+			char bytes[16];
+			while (read(wake[0], bytes, sizeof(bytes)) > 0) {}
+			stopping = true;
+			break;
+		}
+
+		if (fds[1].revents) {
+			char buffer[1024];
+			ssize_t count = read(STDIN_FILENO, buffer, sizeof(buffer));
+
+			// The terminal went away, but the server carries on.
+			if (count <= 0) console = false;
+			else consoleInput.append(buffer, count);
+
+			size_t newLine;
+			while ((newLine = consoleInput.find('\n')) != string::npos) {
+				string line = consoleInput.substr(0, newLine);
+				consoleInput.erase(0, newLine + 1);
+
+				if (line == "exit") {
+					stopping = true;
+					break;
+				}
+
+				string reply = execute(line);
+				if (!reply.empty()) cout << reply << endl;
+			}
+		}
+
+		if (fds[2].revents) accept();
+
+		// Clients accepted in this pass have no entry in fds yet.
+		for (size_t i = fds.size() - 3; i-- > 0; ) {
+			if (!fds[i + 3].revents) continue;
+
+			Client &client = clients[i];
+			bool connected;
+			if (client.output.empty()) connected = serve(client);
+			else connected = send(client) && (!client.output.empty() || answer(client));
+
+			if (!connected) {
+				close(client.fd);
+				clients.erase(clients.begin() + i);
+			}
+		}
+	}
+
+	sigaction(SIGINT, &previousInt, NULL);
+	sigaction(SIGTERM, &previousTerm, NULL);
+	signalFd = -1;
+}
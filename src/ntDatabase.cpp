@@ -13,12 +13,38 @@
 
 // Located in local pv directory.
 #include <pv/ntDatabase.h>
+#include <pv/ntAdmissionRecord.h>
+#include <pv/ntAggregateRecord.h>
+#include <pv/ntArchiveRecord.h>
+#include <pv/ntCalcRecord.h>
+#include <pv/ntContinuumRecord.h>
+#include <pv/ntEnumRecord.h>
+#include <pv/ntGatherRecord.h>
+#include <pv/ntGroupPut.h>
+#include <pv/ntHistoryRecord.h>
+#include <pv/ntMatrixRecord.h>
+#include <pv/ntNameValueRecord.h>
+#include <pv/ntNDArrayRecord.h>
+#include <pv/ntProcessQueue.h>
+#include <pv/ntRecordAdmin.h>
+#include <pv/ntRecordDefinition.h>
+#include <pv/ntRPCRecord.h>
+#include <pv/ntScalarArrayRecord.h>
+#include <pv/ntScalarRecord.h>
+#include <pv/ntShardMap.h>
+#include <pv/ntTableRecord.h>
+#include <pv/ntThreadPlacement.h>
 
+#include <algorithm>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
+#include <epicsThread.h>
+
 #include <pv/standardField.h>
 #include <pv/standardPVField.h>
 #include <pv/channelProviderLocal.h>
@@ -39,6 +65,7 @@
 
 using namespace std;
 using std::tr1::static_pointer_cast;
+using std::tr1::dynamic_pointer_cast;
 using namespace epics::pvData;
 using namespace epics::nt;
 using namespace epics::pvDatabase;
@@ -52,72 +79,74 @@ static StandardFieldPtr     standardField = getStandardField();
 static PVDataCreatePtr       pvDataCreate = getPVDataCreate();
 static StandardPVFieldPtr standardPVField = getStandardPVField();
 
-// Generic record creation function.
-static void createScalarRecords(
-	PVDatabasePtr const &master,
-	ScalarType scalarType,
-	string const &recordNamePrefix)
-{
-	string recordName = recordNamePrefix;
-	
-	NTScalarBuilderPtr ntScalarBuilder = NTScalar::createBuilder();
-	
-	// Create the pvStructure to be inserted into the record.
-	PVStructurePtr pvStructure = ntScalarBuilder->
-		value(scalarType)->
-		addAlarm()->
-		addTimeStamp()->
-		createPVStructure();
+// Archive of the records created by NTDatabase::create(), if archiving is enabled.
+static NTArchiverPtr archiver;
 
-	// Create the record and attempt to add it to the database.	
-	PVRecordPtr pvRecord = PVRecord::create(recordName, pvStructure);
-	
-	bool result = master->addRecord(pvRecord);
-	if (!result) cerr << "Failed to add record " << recordName << " to database\n";
+// Service behind the rpc record and the record itself.
+static NTRPCDispatcherPtr dispatcher;
+static NTRPCRecordPtr rpcRecord;
 
-	recordName += "Array";
-	
-	// Create the pvStructure for the array type to be inserted into the record.
-	NTScalarArrayBuilderPtr ntScalarArrayBuilder = NTScalarArray::createBuilder();
-	pvStructure = ntScalarArrayBuilder->
-		value(scalarType)->
-		addAlarm()->
-		addTimeStamp()->
-		createPVStructure();
-	
-	pvRecord = PVRecord::create(recordName, pvStructure);
+// Adds and removes records while the database is live.
+static NTRecordAdminPtr admin;
 
-	result = master->addRecord(pvRecord);
-	if (!result) cerr << "Failed to add record " << recordName << " to database\n";
+// Admission control of the clients' requests, if enabled.
+static NTAdmissionPtr admission;
 
-	return;
+// Partition of the records among servers, if there is more than one.
+static NTShardMapPtr shards;
+static size_t shardIndex;
+
+// Returns true if the named record belongs to the shard of this server.
+static bool isLocal(string const &recordName)
+{
+	return !shards || shards->shardOf(recordName) == shardIndex;
 }
 
-// Creates and adds records to database.
-void NTDatabase::create()
+// Returns true if source, a record that user follows, belongs to the shard
+// of this server. Otherwise prints which shard hosts it, since user can
+// only follow the records of its own shard.
+static bool isLocalSource(string const &user, string const &source)
 {
-	bool result(false);
+	if (isLocal(source)) return true;
 
-	// Get the database hosted by the local provider.
-	PVDatabasePtr master = PVDatabase::getMaster();
-	
-	// Create string and string array records.	
-	createScalarRecords(master, pvString, "string");
-	// Create numeric type and numeric type array records.
-	createScalarRecords(master, pvShort, "short");
-	createScalarRecords(master, pvInt, "int");
-	createScalarRecords(master, pvLong, "long");
-	createScalarRecords(master, pvDouble, "double");
-	
-	/* ===================================================== */
-	// Create a NTEnum pvrecord.
-	
-	NTEnumBuilderPtr ntEnumBuilder = NTEnum::createBuilder();
+	cerr << "Record " << user << " can not follow " << source << ", which is hosted by shard "
+	     << shards->shardOf(source) << " and not by this one\n";
+	return false;
+}
+
+// RPC method returning its query, to check and time the round trip.
+class EchoHandler : public NTRPCHandler {
+	public:
+		virtual PVStructurePtr handle(PVStructurePtr const &query)
+		{
+			if (!query) return PVStructurePtr();
+			return pvDataCreate->createPVStructure(query);
+		}
+};
+
+// Builds the pvStructure of a NTScalar record.
+static PVStructurePtr createNTScalar(ScalarType scalarType)
+{
+	NTScalarBuilderPtr ntScalarBuilder = NTScalar::createBuilder();
 	
-	PVStructurePtr pvStructure = ntEnumBuilder->
+	return ntScalarBuilder->
+		value(scalarType)->
 		addAlarm()->
 		addTimeStamp()->
 		createPVStructure();
+}
+
+// Builds the pvStructure of a NTScalarArray record.
+static PVStructurePtr createNTScalarArray(ScalarType scalarType)
+{
+	// The array records also carry the slice field used for partial updates.
+	return NTScalarArrayRecord::createPVStructure(scalarType);
+}
+
+// Builds the pvStructure of the NTEnum record.
+static PVStructurePtr createNTEnum(ScalarType)
+{
+	PVStructurePtr pvStructure = NTEnumRecord::createPVStructure();
 	// Create the choices vector for the enum.
 	shared_vector<string> choices(2);
 	choices[0] = "zero";
@@ -125,121 +154,555 @@ void NTDatabase::create()
 	// Get the structure's array and replace it with the newly created vector.
 	PVStringArrayPtr pvChoices = pvStructure->getSubField<PVStringArray>("value.choices");
 	pvChoices->replace(freeze(choices));
-	
-	result = master->addRecord(PVRecord::create("enum", pvStructure));
-	if (!result) cerr << "Failed to add enum record\n";
 
-	/* ===================================================== */
-	// Create a NTMatrix pvrecord.
-	
-	NTMatrixBuilderPtr ntMatrixBuilder = NTMatrix::createBuilder();
-	
-	pvStructure = ntMatrixBuilder->
-		addDim()->          // Adds dimension field to the matrix. This will define the number 
-							// of columns and rows in the matrix.
-		addAlarm()->
-		addTimeStamp()->
-		createPVStructure();
-	result = master->addRecord(PVRecord::create("matrix", pvStructure));
-	if (!result) cerr << "Failed to add matrix record\n";
-	
-	/* ===================================================== */
-	// Create a NTURI pvrecord.
-	
+	return pvStructure;
+}
+
+// Builds the pvStructure of the NTMatrix record.
+static PVStructurePtr createNTMatrix(ScalarType)
+{
+	return NTMatrixRecord::createPVStructure();
+}
+
+// Builds the pvStructure of the NTURI record.
+static PVStructurePtr createNTURI(ScalarType)
+{
 	NTURIBuilderPtr ntURIBuilder = NTURI::createBuilder();
 	
-	pvStructure = ntURIBuilder->
+	return ntURIBuilder->
 		addQueryString("query")->
 		createPVStructure();
-	result = master->addRecord(PVRecord::create("uri", pvStructure));
-	if (!result) cerr << "Failed to add uri record\n";
-	
-	/* ===================================================== */
-	// Create a NTNameValue pvrecord.
-	
-	NTNameValueBuilderPtr ntNameValueBuilder = NTNameValue::createBuilder();
-	
-	pvStructure = ntNameValueBuilder->
-		value(pvDouble)->
-		createPVStructure();
-	result = master->addRecord(PVRecord::create("name_value", pvStructure));
-	if (!result) cerr << "Failed to add name_value record\n";
+}
 
-	/* ===================================================== */
-	// Create a NTTable pvrecord.
-	
+// Builds the pvStructure of the NTNameValue record.
+static PVStructurePtr createNTNameValue(ScalarType)
+{
+	return NTNameValueRecord::createPVStructure();
+}
+
+// Builds the pvStructure of the NTTable record.
+static PVStructurePtr createNTTable(ScalarType scalarType)
+{
 	NTTableBuilderPtr ntTableBuilder = NTTable::createBuilder();
 	
-	pvStructure = ntTableBuilder->
-		addColumn("questions", pvString)->
-		addColumn("answers", pvString)->
-		addColumn("recommendations", pvString)->
-		createPVStructure();
-	result = master->addRecord(PVRecord::create("table", pvStructure));
-	if (!result) cerr << "Failed to add table record\n";
-	
-	/* ===================================================== */
-	// Create a NTAttribute pvrecord.
-	
+	return NTTableRecord::createPVStructure(ntTableBuilder->
+		addColumn("questions", scalarType)->
+		addColumn("answers", scalarType)->
+		addColumn("recommendations", scalarType)->
+		addAlarm()->
+		addTimeStamp()->
+		createStructure());
+}
+
+// Builds the pvStructure of the NTAttribute record.
+static PVStructurePtr createNTAttribute(ScalarType)
+{
 	NTAttributeBuilderPtr ntAttributeBuilder = NTAttribute::createBuilder();
 	
-	pvStructure = ntAttributeBuilder->
+	return ntAttributeBuilder->
 		createPVStructure();
-	result = master->addRecord(PVRecord::create("attribute", pvStructure));
-	if (!result) cerr << "Failed to add attribute record\n";
-	
-	/* ===================================================== */
-	// Create a NTMultiChannel pvrecord.
-	
+}
+
+// Builds the pvStructure of the NTMultiChannel record.
+static PVStructurePtr createNTMultiChannel(ScalarType)
+{
 	NTMultiChannelBuilderPtr ntMultiChannelBuilder = NTMultiChannel::createBuilder();
 	
-	pvStructure = ntMultiChannelBuilder->
+	return ntMultiChannelBuilder->
 		addIsConnected()->
 		createPVStructure();
-	result = master->addRecord(PVRecord::create("multi_channel", pvStructure));
-	if (!result) cerr << "Failed to add multi_channel record\n";
-	
-	/* ===================================================== */
-	// Create a NTNDArray pvrecord.
-	
-	NTNDArrayBuilderPtr ntNDArrayBuilder = NTNDArray::createBuilder();
-	
-	pvStructure = ntNDArrayBuilder->
-		createPVStructure();
-	result = master->addRecord(PVRecord::create("ndarray", pvStructure));
-	if (!result) cerr << "Failed to add ndarray record\n";
-	
-	/* ===================================================== */
-	// Create a NTContinuum pvrecord.
-	
-	NTContinuumBuilderPtr ntContinuumBuilder = NTContinuum::createBuilder();
-	
-	pvStructure = ntContinuumBuilder->
-		createPVStructure();
-	result = master->addRecord(PVRecord::create("continuum", pvStructure));
-	if (!result) cerr << "Failed to add continuum record\n";
-	
-	/* ===================================================== */
-	// Create a NTHistogram pvrecord.
-	
+}
+
+// Builds the pvStructure of the NTNDArray record.
+static PVStructurePtr createNTNDArray(ScalarType)
+{
+	// The record also carries the chunk field used for chunked reads.
+	return NTNDArrayRecord::createPVStructure();
+}
+
+// Builds the pvStructure of the NTContinuum record.
+static PVStructurePtr createNTContinuum(ScalarType)
+{
+	// The continuum record also carries the resample field.
+	return NTContinuumRecord::createPVStructure();
+}
+
+// Builds the pvStructure of the NTHistogram record.
+static PVStructurePtr createNTHistogram(ScalarType scalarType)
+{
 	NTHistogramBuilderPtr ntHistogramBuilder = NTHistogram::createBuilder();
 	
-	pvStructure = ntHistogramBuilder->
-		value(pvLong)->
-		createPVStructure();
-	result = master->addRecord(PVRecord::create("histogram", pvStructure));
-	if (!result) cerr << "Failed to add histogram record\n";
-	
-	/* ===================================================== */
-	// Create a NTAggregate pvrecord.
-	
-	NTAggregateBuilderPtr ntAggregateBuilder = NTAggregate::createBuilder();
-	
-	pvStructure = ntAggregateBuilder->
+	return ntHistogramBuilder->
+		value(scalarType)->
 		createPVStructure();
-	result = master->addRecord(PVRecord::create("aggregate", pvStructure));
-	if (!result) cerr << "Failed to add aggregate record\n";
-	
+}
+
+// Builds the pvStructure of the gather record.
+static PVStructurePtr createNTGather(ScalarType)
+{
+	// The gather record fills in the state of every member.
+	return NTGatherRecord::createPVStructure();
+}
+
+// Builds the pvStructure of the NTAggregate record.
+static PVStructurePtr createNTAggregate(ScalarType)
+{
+	// The aggregate record fills in every optional statistic.
+	return NTAggregateRecord::createPVStructure();
+}
+
+// Creates a record that holds its pvStructure without further processing.
+static PVRecordPtr createPVRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure,
+	NTDatabaseOptions const &)
+{
+	return PVRecord::create(recordName, pvStructure);
+}
+
+// Creates a NTScalar record, keeping a history of its value and archiving it if requested.
+static PVRecordPtr createNTScalarRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure,
+	NTDatabaseOptions const &options)
+{
+	NTScalarRecordPtr pvRecord = NTScalarRecord::create(recordName, pvStructure);
+	if (!pvRecord) return pvRecord;
+
+	if (options.historyLength > 0)
+		pvRecord->enableHistory(options.historyLength);
+
+	vector<string> const &selected = options.archiveRecords;
+	bool archived = selected.empty() ||
+		find(selected.begin(), selected.end(), recordName) != selected.end();
+
+	if (archiver && archived)
+		pvRecord->enableArchive(archiver);
+
+	return pvRecord;
+}
+
+// Creates a NTScalarArray record that accepts slice updates.
+static PVRecordPtr createNTScalarArrayRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure,
+	NTDatabaseOptions const &)
+{
+	return NTScalarArrayRecord::create(recordName, pvStructure);
+}
+
+// Creates a NTNDArray record that serves chunked reads.
+static PVRecordPtr createNTNDArrayRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure,
+	NTDatabaseOptions const &)
+{
+	return NTNDArrayRecord::create(recordName, pvStructure);
+}
+
+// Creates a NTEnum record that versions its choices.
+static PVRecordPtr createNTEnumRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure,
+	NTDatabaseOptions const &)
+{
+	return NTEnumRecord::create(recordName, pvStructure);
+}
+
+// Creates a NTMatrix record that computes slices and products on request.
+static PVRecordPtr createNTMatrixRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure,
+	NTDatabaseOptions const &)
+{
+	return NTMatrixRecord::create(recordName, pvStructure);
+}
+
+// Creates a NTNameValue record that gets and sets values by name.
+static PVRecordPtr createNTNameValueRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure,
+	NTDatabaseOptions const &)
+{
+	return NTNameValueRecord::create(recordName, pvStructure);
+}
+
+// Creates a NTTable record that answers queries, with the indexes asked for.
+static PVRecordPtr createNTTableRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure,
+	NTDatabaseOptions const &options)
+{
+	NTTableRecordPtr pvRecord = NTTableRecord::create(recordName, pvStructure);
+	if (!pvRecord) return pvRecord;
+
+	for (size_t i = 0; i < options.tableIndexes.size(); ++i) {
+
+		string const &column = options.tableIndexes[i].first;
+		size_t dot = column.find('.');
+
+		if (column.substr(0, dot) != recordName) continue;
+
+		if (dot == string::npos || !pvRecord->addIndex(column.substr(dot + 1), options.tableIndexes[i].second))
+			cerr << "Failed to add " << options.tableIndexes[i].second << " index on " << column << "\n";
+	}
+
+	return pvRecord;
+}
+
+// Creates a NTContinuum record that resamples its waveform on request.
+static PVRecordPtr createNTContinuumRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure,
+	NTDatabaseOptions const &)
+{
+	return NTContinuumRecord::create(recordName, pvStructure);
+}
+
+// Creates a NTAggregate record, bound to its source once every record exists.
+static PVRecordPtr createNTAggregateRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure,
+	NTDatabaseOptions const &)
+{
+	return NTAggregateRecord::create(recordName, pvStructure);
+}
+
+// Creates the gather record, bound to its members once every record exists.
+static PVRecordPtr createNTGatherRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure,
+	NTDatabaseOptions const &)
+{
+	return NTGatherRecord::create(recordName, pvStructure);
+}
+
+// Creates the records of a definition file and adds them to master.
+static void loadDefinitions(PVDatabasePtr const &master, string const &fileName)
+{
+	ifstream file(fileName.c_str());
+	vector<NTRecordDefinition> definitions;
+
+	if (!file || !NTRecordLoader::parse(file, fileName, definitions)) {
+		cerr << "Failed to read record definitions from " << fileName << "\n";
+		return;
+	}
+
+	vector<PVRecordPtr> records = NTRecordLoader::instantiate(
+		definitions, epicsThreadGetCPUs(), archiver, shards, shardIndex);
+
+	for (size_t i = 0; i < records.size(); ++i) {
+		if (!master->addRecord(records[i]))
+			cerr << "Failed to add record " << records[i]->getRecordName() << " to database\n";
+	}
+}
+
+/*
+ * Table of every record hosted by the database, in creation order.
+ * The scalar type is the type of the record's value field where the
+ * normative type has one, and is ignored by the other builders.
+ */
+static const struct {
+	const char *name;
+	ScalarType scalarType;
+	PVStructurePtr (*create)(ScalarType);
+	PVRecordPtr (*createRecord)(string const &, PVStructurePtr const &, NTDatabaseOptions const &);
+} recordTable[] = {
+	{ "string",        pvString, &createNTScalar,       &createNTScalarRecord      },
+	{ "stringArray",   pvString, &createNTScalarArray,  &createNTScalarArrayRecord },
+	{ "short",         pvShort,  &createNTScalar,       &createNTScalarRecord      },
+	{ "shortArray",    pvShort,  &createNTScalarArray,  &createNTScalarArrayRecord },
+	{ "int",           pvInt,    &createNTScalar,       &createNTScalarRecord      },
+	{ "intArray",      pvInt,    &createNTScalarArray,  &createNTScalarArrayRecord },
+	{ "long",          pvLong,   &createNTScalar,       &createNTScalarRecord      },
+	{ "longArray",     pvLong,   &createNTScalarArray,  &createNTScalarArrayRecord },
+	{ "double",        pvDouble, &createNTScalar,       &createNTScalarRecord      },
+	{ "doubleArray",   pvDouble, &createNTScalarArray,  &createNTScalarArrayRecord },
+	{ "enum",          pvInt,    &createNTEnum,         &createNTEnumRecord        },
+	{ "matrix",        pvDouble, &createNTMatrix,       &createNTMatrixRecord      },
+	{ "uri",           pvString, &createNTURI,          &createPVRecord            },
+	{ "name_value",    pvDouble, &createNTNameValue,    &createNTNameValueRecord   },
+	{ "table",         pvString, &createNTTable,        &createNTTableRecord       },
+	{ "attribute",     pvString, &createNTAttribute,    &createPVRecord            },
+	{ "multi_channel", pvDouble, &createNTMultiChannel, &createPVRecord            },
+	{ "ndarray",       pvByte,   &createNTNDArray,      &createNTNDArrayRecord     },
+	{ "continuum",     pvDouble, &createNTContinuum,    &createNTContinuumRecord   },
+	{ "histogram",     pvLong,   &createNTHistogram,    &createPVRecord            },
+	{ "aggregate",     pvDouble, &createNTAggregate,    &createNTAggregateRecord   },
+	{ "gather",        pvDouble, &createNTGather,       &createNTGatherRecord      }
+};
+
+static const size_t recordTableSize = sizeof(recordTable) / sizeof(recordTable[0]);
+
+vector<string> NTDatabase::getRecordNames()
+{
+	vector<string> names;
+	names.reserve(recordTableSize);
+
+	for (size_t i = 0; i < recordTableSize; ++i)
+		names.push_back(recordTable[i].name);
+
+	return names;
+}
+
+PVStructurePtr NTDatabase::createPVStructure(string const &recordName)
+{
+	for (size_t i = 0; i < recordTableSize; ++i) {
+		if (recordName == recordTable[i].name)
+			return recordTable[i].create(recordTable[i].scalarType);
+	}
+
+	return PVStructurePtr();
+}
+
+// Creates and adds records to database.
+void NTDatabase::create(NTDatabaseOptions const &options)
+{
+	// Get the database hosted by the local provider.
+	PVDatabasePtr master = PVDatabase::getMaster();
+
+	if (!options.archiveDirectory.empty())
+		archiver = NTArchiver::create(options.archiveDirectory);
+
+	if (options.shardCount > 1) {
+		shards = NTShardMap::create(options.shardCount, options.shardBasePort);
+		shardIndex = options.shardIndex;
+	}
+	
+	for (size_t i = 0; i < recordTableSize; ++i) {
+		
+		string recordName(recordTable[i].name);
+		if (!isLocal(recordName)) continue;
+		
+		// Create the pvStructure to be inserted into the record.
+		PVStructurePtr pvStructure = recordTable[i].create(recordTable[i].scalarType);
+
+		// Create the record and attempt to add it to the database.	
+		PVRecordPtr pvRecord = recordTable[i].createRecord(recordName, pvStructure, options);
+		bool result = pvRecord && master->addRecord(pvRecord);
+		if (!result) cerr << "Failed to add record " << recordName << " to database\n";
+	}
+
+	for (size_t i = 0; i < options.definitionFiles.size(); ++i)
+		loadDefinitions(master, options.definitionFiles[i]);
+
+	// Calc records, in order so that each may use those before it.
+	for (size_t i = 0; i < options.calcRecords.size(); ++i) {
+
+		string recordName(options.calcRecords[i].first);
+		if (!isLocal(recordName)) continue;
+
+		// A calc record with an input on another shard would never update,
+		// so it is refused. A bad expression is reported by create().
+		bool inputsLocal = true;
+		try {
+			NTCalcExpressionPtr expression = NTCalcExpression::compile(options.calcRecords[i].second);
+			vector<NTCalcExpression::Input> const &inputs = expression->getInputs();
+			for (size_t j = 0; j < inputs.size(); ++j) {
+				if (!isLocalSource(recordName, inputs[j].recordName)) inputsLocal = false;
+			}
+		} catch (std::exception &) {}
+
+		if (!inputsLocal) {
+			cerr << "Failed to add record " << recordName << " to database\n";
+			continue;
+		}
+
+		PVRecordPtr pvRecord = NTCalcRecord::create(recordName, options.calcRecords[i].second);
+		bool result = pvRecord && master->addRecord(pvRecord);
+		if (!result) cerr << "Failed to add record " << recordName << " to database\n";
+	}
+
+	// The aggregate record may summarize any record, so it is bound last.
+	// A source on another shard is not found, which raises its alarm.
+	NTAggregateRecordPtr aggregateRecord =
+		dynamic_pointer_cast<NTAggregateRecord>(master->findRecord("aggregate"));
+	if (aggregateRecord && !options.aggregateSource.empty()) {
+		isLocalSource("aggregate", options.aggregateSource);
+		aggregateRecord->bind(options.aggregateSource, options.aggregatePeriod);
+	}
+
+	// Likewise the gather record, whose members may be calc records. A
+	// member on another shard is published as not connected, with the
+	// record's alarm raised.
+	NTGatherRecordPtr gatherRecord =
+		dynamic_pointer_cast<NTGatherRecord>(master->findRecord("gather"));
+	if (gatherRecord && !options.gatherMembers.empty()) {
+		for (size_t i = 0; i < options.gatherMembers.size(); ++i)
+			isLocalSource("gather", options.gatherMembers[i]);
+		gatherRecord->bind(options.gatherMembers, options.gatherPeriod);
+	}
+
+	// Service record answering range queries of the scalar records' history.
+	PVRecordPtr historyRecord = NTHistoryRecord::create("history");
+	if (!historyRecord || !master->addRecord(historyRecord))
+		cerr << "Failed to add record history to database\n";
+
+	// Record serving RPCs on the worker pool.
+	dispatcher = NTRPCDispatcher::create(options.rpcWorkers, options.rpcQueueDepth);
+	dispatcher->registerHandler("echo", NTRPCHandlerPtr(new EchoHandler()));
+	dispatcher->registerHandler("groupPut", NTGroupPut::create(shards, shardIndex));
+
+	admin = NTRecordAdmin::create(archiver, shards, shardIndex);
+	dispatcher->registerHandler("admin", admin);
+
+	// Clients reach the database through these, so admin leaves them alone.
+	admin->addServiceRecord("history");
+	admin->addServiceRecord("rpc");
+	admin->addServiceRecord("archive");
+	admin->addServiceRecord("admission");
+
+	rpcRecord = NTRPCRecord::create("rpc", dispatcher);
+	if (!rpcRecord || !master->addRecord(rpcRecord))
+		cerr << "Failed to add record rpc to database\n";
+
+	// Service record answering range queries of the archive.
+	if (archiver) {
+		PVRecordPtr archiveRecord = NTArchiveRecord::create("archive", archiver);
+		if (!archiveRecord || !master->addRecord(archiveRecord))
+			cerr << "Failed to add record archive to database\n";
+	}
+
+	// Record publishing the admission counters of the client connections.
+	if (options.admission.workers > 0) {
+		admission = NTAdmission::create(options.admission);
+
+		PVRecordPtr admissionRecord =
+			NTAdmissionRecord::create("admission", admission, options.admissionPeriod);
+		if (!admissionRecord || !master->addRecord(admissionRecord))
+			cerr << "Failed to add record admission to database\n";
+	}
+
 	return;
 }
 
+void NTDatabase::shutdown()
+{
+	// Requests still waiting for admission are refused before the
+	// records they would process stop being served.
+	if (admission) admission->stop();
+	admission.reset();
+
+	NTProcessQueue::get()->stop();
+
+	if (archiver) archiver->stop();
+	archiver.reset();
+
+	if (dispatcher) dispatcher->stop();
+	dispatcher.reset();
+	rpcRecord.reset();
+	admin.reset();
+	shards.reset();
+}
+
+void NTDatabase::writeStats(ostream &out)
+{
+	out << "records " << PVDatabase::getMaster()->getRecordNames()->view().size() << "\n";
+
+	if (shards) {
+		out << "shard.index " << shardIndex << "\n"
+		    << "shard.count " << shards->getShards() << "\n"
+		    << "shard.port " << shards->portOf(shardIndex) << "\n";
+	}
+
+	if (admission) {
+		out << "admission.throttled " << admission->getThrottled() << "\n"
+		    << "admission.rejected " << admission->getRejected() << "\n";
+	}
+
+	if (!dispatcher) return;
+
+	out << "rpc.rejected " << dispatcher->getRejected() << "\n";
+
+	PVStructurePtr metrics = dispatcher->getMetrics();
+	shared_vector<const string> method = metrics->getSubField<PVStringArray>("value.method")->view();
+	PVFieldPtrArray const &columns = metrics->getSubField<PVStructure>("value")->getPVFields();
+
+	// One line per method and column after the method name.
+	for (size_t i = 0; i < method.size(); ++i) {
+		for (size_t j = 1; j < columns.size(); ++j) {
+			shared_vector<const double> column;
+			static_pointer_cast<PVScalarArray>(columns[j])->getAs<double>(column);
+
+			out << "rpc." << method[i] << "." << columns[j]->getFieldName() << " "
+			    << (i < column.size() ? column[i] : 0.0) << "\n";
+		}
+	}
+}
+
+void NTDatabase::writeSnapshot(ostream &out)
+{
+	PVDatabasePtr master = PVDatabase::getMaster();
+	shared_vector<const string> names = master->getRecordNames()->view();
+
+	vector<string> sorted(names.begin(), names.end());
+	sort(sorted.begin(), sorted.end());
+
+	for (size_t i = 0; i < sorted.size(); ++i) {
+		PVRecordPtr pvRecord = master->findRecord(sorted[i]);
+		if (!pvRecord) continue;
+
+		PVFieldPtr pvValue = pvRecord->getPVStructure()->getSubField("value");
+		if (!pvValue) continue;
+
+		// Arrays are shared rather than copied, so the lock is held briefly
+		// and the slow formatting is done without it.
+		pvRecord->lock();
+		PVFieldPtr copy = pvDataCreate->createPVField(pvValue);
+		pvRecord->unlock();
+
+		out << sorted[i] << " " << *copy << "\n";
+	}
+}
+
+void NTDatabase::writePlacement(ostream &out)
+{
+	NTThreadPlacement::writeThreads(out);
+
+	PVDatabasePtr master = PVDatabase::getMaster();
+	shared_vector<const string> names = master->getRecordNames()->view();
+
+	vector<string> sorted(names.begin(), names.end());
+	sort(sorted.begin(), sorted.end());
+
+	for (size_t i = 0; i < sorted.size(); ++i) {
+		NTRecordPtr record = dynamic_pointer_cast<NTRecord>(master->findRecord(sorted[i]));
+		if (!record) continue;
+
+		record->lock();
+		int cpu = record->getProcessCpu();
+		long thread = record->getProcessThread();
+		size_t count = record->getProcessCount();
+		record->unlock();
+
+		out << "record " << sorted[i] << " cpu " << cpu << " thread " << thread
+		    << " processes " << count << "\n";
+	}
+}
+
+vector<string> NTDatabase::addRecords(string const &definitions)
+{
+	if (!admin) throw runtime_error("the database was not created");
+	return admin->add(definitions);
+}
+
+vector<string> NTDatabase::removeRecords(string const &names)
+{
+	if (!admin) throw runtime_error("the database was not created");
+	return admin->remove(names);
+}
+
+NTAdmissionPtr NTDatabase::getAdmission()
+{
+	return admission;
+}
+
+bool NTDatabase::registerRPCHandler(string const &method, NTRPCHandlerPtr const &handler)
+{
+	if (!dispatcher) return false;
+
+	dispatcher->registerHandler(method, handler);
+	if (rpcRecord) rpcRecord->updateMethods();
+
+	return true;
+}
@@ -0,0 +1,1872 @@
+/*
+ * =======================================================================
+ *
+ * 	ntDatabaseBench.cpp
+ *
+ * 	Source file for the normative type database microbenchmarks.
+ *
+ *	The benchmarks run in process against the records created by
+ *	NTDatabase::create() and measure the cost per operation of:
+ *		creating the pvStructure of each record,
+ *		copying, serializing and deserializing each pvStructure,
+ *		freezing and replacing shared_vectors of various sizes,
+ *		putting to and getting from records through the local
+ *		channel provider, without the network,
+ *		editing ten elements of a 10M element array through the
+ *		record's slice field or by replacing the whole array,
+ *		reading a 10M element array in fixed size chunks,
+ *		putting one changed field of a large record either as the
+ *		whole structure or narrowed down by a PutTracker,
+ *		appending to and querying the history of a scalar record,
+ *		encoding a block of archive samples,
+ *		evaluating a compiled calc expression,
+ *		updating the running statistics of the aggregate record,
+ *		resampling a continuum waveform onto a uniform grid,
+ *		transposing a matrix and multiplying it by a vector,
+ *		selecting the rows of a table column with and without an index,
+ *		dictionary encoding an array of strings,
+ *		finding a name of a name value record by hash or by scan,
+ *		serving a batch of NTURI requests with a pool of RPC workers,
+ *		writing three records as one unit with a group put,
+ *		creating records in bulk from a record definition,
+ *		delivering a monitor update while batches of records are added
+ *		and removed from the live database,
+ *		putting to and getting from records partitioned among 1 to 8
+ *		server processes, with the network (given -S),
+ *		admitting a put of one client while another floods the
+ *		admission workers with puts of a large array.
+ *
+ *	Results are printed as a table and written as JSON so that they can
+ *	be tracked for regressions.
+ *
+ * =======================================================================
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <epicsEndian.h>
+
+#include <pv/pvData.h>
+#include <pv/serialize.h>
+#include <pv/channelProviderLocal.h>
+#include <pv/pvaClient.h>
+
+#include <pv/ntAdmission.h>
+#include <pv/ntAggregateRecord.h>
+#include <pv/ntArchiveBlock.h>
+#include <pv/ntCalcExpression.h>
+#include <pv/ntDatabase.h>
+#include <pv/ntResampler.h>
+#include <pv/ntHistoryBuffer.h>
+#include <pv/ntGroupPut.h>
+#include <pv/ntMatrixKernels.h>
+#include <pv/ntRecordDefinition.h>
+#include <pv/ntRPCDispatcher.h>
+#include <pv/ntStringDictionary.h>
+#include <pv/ntStringIndex.h>
+#include <pv/nturi.h>
+#include <pv/ntTableColumn.h>
+
+#include "ntArrayStream.h"
+#include "ntBenchmark.h"
+#include "ntPutTracker.h"
+#include "ntShardRouter.h"
+
+using namespace std;
+using std::tr1::static_pointer_cast;
+using namespace epics::pvData;
+using namespace epics::pvAccess;
+using namespace epics::pvDatabase;
+using namespace epics::pvaClient;
+using namespace epics::ntDatabase;
+
+static PVDataCreatePtr pvDataCreate = getPVDataCreate();
+
+// Number of elements placed in every array of the structures being copied or serialized.
+static const size_t populateLength = 1024;
+
+// Fills every array of a structure so that copies and serialization move
+// a representative amount of data rather than empty arrays.
+static void populate(PVStructurePtr const &pvStructure, size_t length)
+{
+	PVFieldPtrArray const &pvFields = pvStructure->getPVFields();
+
+	for (size_t i = 0; i < pvFields.size(); ++i) {
+
+		PVFieldPtr const &pvField = pvFields[i];
+
+		switch (pvField->getField()->getType()) {
+
+		case structure:
+			populate(static_pointer_cast<PVStructure>(pvField), length);
+			break;
+
+		case scalarArray: {
+			PVScalarArrayPtr pvArray = static_pointer_cast<PVScalarArray>(pvField);
+
+			if (pvArray->getScalarArray()->getElementType() == pvString) {
+				shared_vector<string> data(length);
+				for (size_t j = 0; j < length; ++j) data[j] = "element";
+				pvArray->putFrom(freeze(data));
+			} else {
+				shared_vector<double> data(length);
+				for (size_t j = 0; j < length; ++j) data[j] = (double) j;
+				pvArray->putFrom(freeze(data));
+			}
+			break;
+		}
+
+		default:
+			break;
+		}
+	}
+}
+
+/* PVStructure creation from the normative type builders. */
+class CreateBenchmark : public Benchmark {
+	public:
+		CreateBenchmark(string const &recordName)
+			: Benchmark("create/" + recordName), recordName(recordName) {}
+
+		virtual void run(BenchmarkState &state)
+		{
+			while (state.keepRunning()) {
+				PVStructurePtr pvStructure = NTDatabase::createPVStructure(recordName);
+			}
+		}
+
+	private:
+		string recordName;
+};
+
+/* Copy of a populated structure onto another of the same type, as done by a put. */
+class CopyBenchmark : public Benchmark {
+	public:
+		CopyBenchmark(string const &recordName)
+			: Benchmark("copy/" + recordName), recordName(recordName) {}
+
+		virtual void setUp()
+		{
+			source = NTDatabase::createPVStructure(recordName);
+			populate(source, populateLength);
+			destination = NTDatabase::createPVStructure(recordName);
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			while (state.keepRunning())
+				destination->copyUnchecked(*source);
+		}
+
+		virtual void tearDown()
+		{
+			source.reset();
+			destination.reset();
+		}
+
+	private:
+		string recordName;
+		PVStructurePtr source;
+		PVStructurePtr destination;
+};
+
+/* Serialization of a populated structure into a byte buffer. */
+class SerializeBenchmark : public Benchmark {
+	public:
+		SerializeBenchmark(string const &recordName)
+			: Benchmark("serialize/" + recordName), recordName(recordName) {}
+
+		virtual void setUp()
+		{
+			source = NTDatabase::createPVStructure(recordName);
+			populate(source, populateLength);
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			vector<epicsUInt8> buffer;
+
+			while (state.keepRunning()) {
+				buffer.clear();
+				serializeToVector(source.get(), EPICS_BYTE_ORDER, buffer);
+			}
+
+			state.setCounter("bytes", (double) buffer.size());
+		}
+
+		virtual void tearDown() { source.reset(); }
+
+	private:
+		string recordName;
+		PVStructurePtr source;
+};
+
+/* Deserialization of a byte buffer into an existing structure. */
+class DeserializeBenchmark : public Benchmark {
+	public:
+		DeserializeBenchmark(string const &recordName)
+			: Benchmark("deserialize/" + recordName), recordName(recordName) {}
+
+		virtual void setUp()
+		{
+			PVStructurePtr source = NTDatabase::createPVStructure(recordName);
+			populate(source, populateLength);
+			serializeToVector(source.get(), EPICS_BYTE_ORDER, buffer);
+			destination = NTDatabase::createPVStructure(recordName);
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			while (state.keepRunning())
+				deserializeFromVector(destination.get(), EPICS_BYTE_ORDER, buffer);
+
+			state.setCounter("bytes", (double) buffer.size());
+		}
+
+		virtual void tearDown()
+		{
+			buffer.clear();
+			destination.reset();
+		}
+
+	private:
+		string recordName;
+		vector<epicsUInt8> buffer;
+		PVStructurePtr destination;
+};
+
+/* Allocating a new array, freezing it and replacing an array field's contents with it. */
+class FreezeReplaceBenchmark : public Benchmark {
+	public:
+		FreezeReplaceBenchmark(size_t length)
+			: Benchmark(name(length)), length(length) {}
+
+		virtual void setUp()
+		{
+			pvArray = pvDataCreate->createPVScalarArray<PVDoubleArray>();
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			while (state.keepRunning()) {
+				shared_vector<double> data(length);
+				data[0] = (double) state.getIterations();
+				pvArray->replace(freeze(data));
+			}
+
+			state.setCounter("bytes", (double) (length * sizeof(double)));
+		}
+
+		virtual void tearDown() { pvArray.reset(); }
+
+	private:
+		static string name(size_t length)
+		{
+			stringstream str;
+			str << "shared_vector/freeze_replace/" << length;
+			return str.str();
+		}
+
+		size_t length;
+		PVDoubleArrayPtr pvArray;
+};
+
+/* Taking back a uniquely held array, modifying it in place and replacing it. */
+class ReuseReplaceBenchmark : public Benchmark {
+	public:
+		ReuseReplaceBenchmark(size_t length)
+			: Benchmark(name(length)), length(length) {}
+
+		virtual void setUp()
+		{
+			pvArray = pvDataCreate->createPVScalarArray<PVDoubleArray>();
+			shared_vector<double> data(length, 0.0);
+			pvArray->replace(freeze(data));
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			while (state.keepRunning()) {
+				// The field holds the only reference so reuse() does not copy.
+				shared_vector<double> data(pvArray->reuse());
+				data[0] += 1.0;
+				pvArray->replace(freeze(data));
+			}
+
+			state.setCounter("bytes", (double) (length * sizeof(double)));
+		}
+
+		virtual void tearDown() { pvArray.reset(); }
+
+	private:
+		static string name(size_t length)
+		{
+			stringstream str;
+			str << "shared_vector/reuse_replace/" << length;
+			return str.str();
+		}
+
+		size_t length;
+		PVDoubleArrayPtr pvArray;
+};
+
+/* A put to a record made directly on the record, as the local provider does for a client. */
+class RecordPutBenchmark : public Benchmark {
+	public:
+		RecordPutBenchmark(string const &recordName)
+			: Benchmark("record/put/" + recordName), recordName(recordName) {}
+
+		virtual void setUp()
+		{
+			pvRecord = PVDatabase::getMaster()->findRecord(recordName);
+			pvValue = pvRecord->getPVStructure()->getSubField<PVScalar>("value");
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			double value = 0.0;
+
+			while (state.keepRunning()) {
+				pvRecord->lock();
+				pvRecord->beginGroupPut();
+				pvValue->putFrom<double>(value);
+				pvRecord->process();
+				pvRecord->endGroupPut();
+				pvRecord->unlock();
+				value += 1.0;
+			}
+		}
+
+		virtual void tearDown()
+		{
+			pvValue.reset();
+			pvRecord.reset();
+		}
+
+	private:
+		string recordName;
+		PVRecordPtr pvRecord;
+		PVScalarPtr pvValue;
+};
+
+/* A putGet through pvaClient using the local channel provider, so nothing touches a socket. */
+class LocalPutGetBenchmark : public Benchmark {
+	public:
+		LocalPutGetBenchmark(PvaClientPtr const &pva, string const &recordName)
+			: Benchmark("local/putGet/" + recordName), pva(pva), recordName(recordName) {}
+
+		virtual void setUp()
+		{
+			PvaClientChannelPtr channel = pva->channel(recordName, "local");
+			putGet = channel->createPutGet("");
+			putGet->connect();
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			PVScalarPtr pvValue = putGet->getPutData()->getPVStructure()->getSubField<PVScalar>("value");
+			double value = 0.0;
+
+			while (state.keepRunning()) {
+				pvValue->putFrom<double>(value);
+				putGet->putGet();
+				value += 1.0;
+			}
+		}
+
+		virtual void tearDown() { putGet.reset(); }
+
+	private:
+		PvaClientPtr pva;
+		string recordName;
+		PvaClientPutGetPtr putGet;
+};
+
+/* A get through pvaClient using the local channel provider. */
+class LocalGetBenchmark : public Benchmark {
+	public:
+		LocalGetBenchmark(PvaClientPtr const &pva, string const &recordName)
+			: Benchmark("local/get/" + recordName), pva(pva), recordName(recordName) {}
+
+		virtual void setUp()
+		{
+			PvaClientChannelPtr channel = pva->channel(recordName, "local");
+			get = channel->createGet("");
+			get->connect();
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			while (state.keepRunning())
+				get->get();
+		}
+
+		virtual void tearDown() { get.reset(); }
+
+	private:
+		PvaClientPtr pva;
+		string recordName;
+		PvaClientGetPtr get;
+};
+
+/*
+ * An edit of a few elements of a large doubleArray record, made either through the
+ * record's slice field or by replacing the whole value, directly on the record.
+ */
+class SlicePutBenchmark : public Benchmark {
+	public:
+		SlicePutBenchmark(size_t length, size_t sliceLength, bool whole)
+			: Benchmark(name(length, sliceLength, whole)),
+			  length(length), sliceLength(sliceLength), whole(whole), useFirst(false) {}
+
+		virtual void setUp()
+		{
+			pvRecord = PVDatabase::getMaster()->findRecord("doubleArray");
+			PVStructurePtr pvStructure = pvRecord->getPVStructure();
+			pvValue = pvStructure->getSubField<PVDoubleArray>("value");
+			pvSliceOffset = pvStructure->getSubField<PVInt>("slice.offset");
+			pvSliceValue = pvStructure->getSubField<PVDoubleArray>("slice.value");
+
+			// Two versions of the edit alternate so that every put is new.
+			size_t count = whole ? length : sliceLength;
+			shared_vector<double> data(count, 1.0);
+			first = freeze(data);
+			data = shared_vector<double>(count, 2.0);
+			second = freeze(data);
+
+			// Start from an array of the full length held only by the record.
+			data = shared_vector<double>(length, 0.0);
+			put(freeze(data), true);
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			while (state.keepRunning()) {
+				useFirst = !useFirst;
+				put(useFirst ? first : second, whole);
+			}
+
+			state.setCounter("bytes", (double) ((whole ? length : sliceLength) * sizeof(double)));
+		}
+
+		virtual void tearDown()
+		{
+			first.clear();
+			second.clear();
+			pvRecord.reset();
+			pvValue.reset();
+			pvSliceOffset.reset();
+			pvSliceValue.reset();
+		}
+
+	private:
+		static string name(size_t length, size_t sliceLength, bool whole)
+		{
+			stringstream str;
+			str << "slice/doubleArray/" << (whole ? "whole" : "slice") << "/" << length << "/" << sliceLength;
+			return str.str();
+		}
+
+		void put(shared_vector<const double> const &data, bool replaceValue)
+		{
+			pvRecord->lock();
+			pvRecord->beginGroupPut();
+			if (replaceValue) {
+				pvValue->replace(data);
+			} else {
+				pvSliceOffset->put((int32) (length / 2));
+				pvSliceValue->replace(data);
+			}
+			pvRecord->process();
+			pvRecord->endGroupPut();
+			pvRecord->unlock();
+		}
+
+		size_t length;
+		size_t sliceLength;
+		bool whole;
+		bool useFirst;
+		shared_vector<const double> first;
+		shared_vector<const double> second;
+		PVRecordPtr pvRecord;
+		PVDoubleArrayPtr pvValue;
+		PVIntPtr pvSliceOffset;
+		PVDoubleArrayPtr pvSliceValue;
+};
+
+// Reduces a streamed array to its sum, holding one chunk at a time.
+class SumChunks : public ArrayChunkConsumer {
+	public:
+		SumChunks() : sum(0.0) {}
+
+		virtual bool consume(size_t, size_t, PVScalarArrayPtr const &chunk)
+		{
+			shared_vector<const double> data;
+			chunk->getAs<double>(data);
+			for (size_t i = 0; i < data.size(); ++i) sum += data[i];
+			return true;
+		}
+
+		double sum;
+};
+
+/* A chunked read of the whole of a large doubleArray record through the local provider. */
+class StreamBenchmark : public Benchmark {
+	public:
+		StreamBenchmark(PvaClientPtr const &pva, size_t length, size_t chunkLength)
+			: Benchmark(name(length, chunkLength)),
+			  pva(pva), length(length), chunkLength(chunkLength) {}
+
+		virtual void setUp()
+		{
+			PVRecordPtr pvRecord = PVDatabase::getMaster()->findRecord("doubleArray");
+			shared_vector<double> data(length, 1.0);
+
+			pvRecord->lock();
+			pvRecord->beginGroupPut();
+			pvRecord->getPVStructure()->getSubField<PVDoubleArray>("value")->replace(freeze(data));
+			pvRecord->endGroupPut();
+			pvRecord->unlock();
+
+			channel = pva->channel("doubleArray", "local");
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			while (state.keepRunning()) {
+				SumChunks sum;
+				readArrayChunked(channel, chunkLength, sum);
+			}
+
+			state.setCounter("chunk_bytes", (double) (chunkLength * sizeof(double)));
+			state.setCounter("bytes", (double) (length * sizeof(double)));
+		}
+
+		virtual void tearDown() { channel.reset(); }
+
+	private:
+		static string name(size_t length, size_t chunkLength)
+		{
+			stringstream str;
+			str << "stream/doubleArray/" << length << "/" << chunkLength;
+			return str.str();
+		}
+
+		PvaClientPtr pva;
+		size_t length;
+		size_t chunkLength;
+		PvaClientChannelPtr channel;
+};
+
+/*
+ * A putGet through the local provider of a large record in which a single field changes.
+ * Either the whole structure is sent or a PutTracker narrows the put down to the changed
+ * field. The wire_bytes counter is what the put would place on the network and the cpu
+ * time is dominated by the server copying the put into the record.
+ */
+class DeltaPutBenchmark : public Benchmark {
+	public:
+		DeltaPutBenchmark(
+			PvaClientPtr const &pva,
+			string const &recordName,
+			string const &fieldName,
+			size_t length,
+			bool tracked)
+			: Benchmark(name(recordName, length, tracked)),
+			  pva(pva), recordName(recordName), fieldName(fieldName),
+			  length(length), tracked(tracked), useFirst(false), wireBytes(0) {}
+
+		virtual void setUp()
+		{
+			PvaClientChannelPtr channel = pva->channel(recordName, "local");
+			putGet = channel->createPutGet("");
+			putGet->connect();
+			tracker.reset(new PutTracker(putGet));
+
+			// Load the record with large arrays.
+			pvStructure = tracker->getPVStructure();
+			populate(pvStructure, length);
+			putGet->putGet();
+			tracker->sync();
+
+			// Two versions of the field alternate so that every put is a real change.
+			pvField = pvStructure->getSubField<PVScalarArray>(fieldName);
+			first = static_pointer_cast<PVScalarArray>(pvDataCreate->createPVField(pvField));
+			second = static_pointer_cast<PVScalarArray>(pvDataCreate->createPVField(pvField));
+			second->setLength(second->getLength() + 1);
+
+			change(*second);
+			wireBytes = putPayloadSize(pvStructure, tracker->getChangedBitSet());
+			send();
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			while (state.keepRunning()) {
+				useFirst = !useFirst;
+				change(useFirst ? *first : *second);
+				send();
+			}
+
+			state.setCounter("wire_bytes", (double) wireBytes);
+		}
+
+		virtual void tearDown()
+		{
+			first.reset();
+			second.reset();
+			pvField.reset();
+			pvStructure.reset();
+			tracker.reset();
+			putGet.reset();
+		}
+
+	private:
+		static string name(string const &recordName, size_t length, bool tracked)
+		{
+			stringstream str;
+			str << "delta/" << recordName << "/" << (tracked ? "changed_field" : "whole") << "/" << length;
+			return str.str();
+		}
+
+		// Writes one field and selects what the put will send.
+		void change(PVScalarArray const &from)
+		{
+			pvField->copyUnchecked(from);
+
+			BitSetPtr bitSet = tracker->getChangedBitSet();
+			if (tracked) {
+				bitSet->set(pvField->getFieldOffset());
+				tracker->refine();
+			} else {
+				bitSet->set(0);
+			}
+		}
+
+		void send()
+		{
+			if (tracked) tracker->putGet();
+			else putGet->putGet();
+		}
+
+		PvaClientPtr pva;
+		string recordName;
+		string fieldName;
+		size_t length;
+		bool tracked;
+		bool useFirst;
+		size_t wireBytes;
+		PvaClientPutGetPtr putGet;
+		std::tr1::shared_ptr<PutTracker> tracker;
+		PVStructurePtr pvStructure;
+		PVScalarArrayPtr pvField;
+		PVScalarArrayPtr first;
+		PVScalarArrayPtr second;
+};
+
+/* Appending samples to a full history buffer, as every process of a scalar record does. */
+class HistoryAppendBenchmark : public Benchmark {
+	public:
+		explicit HistoryAppendBenchmark(size_t capacity)
+			: Benchmark(name(capacity)), history(new NTHistoryBuffer(capacity)) {}
+
+		virtual void run(BenchmarkState &state)
+		{
+			int64 seconds = 0;
+			while (state.keepRunning()) {
+				history->append((double) seconds, seconds, 0, 0, 0);
+				++seconds;
+			}
+		}
+
+	private:
+		static string name(size_t capacity)
+		{
+			stringstream str;
+			str << "history/append/" << capacity;
+			return str.str();
+		}
+
+		NTHistoryBufferPtr history;
+};
+
+/* A time range query of a full history buffer, decimated to maxPoints samples. */
+class HistoryQueryBenchmark : public Benchmark {
+	public:
+		HistoryQueryBenchmark(size_t capacity, size_t maxPoints)
+			: Benchmark(name(capacity, maxPoints)),
+			  capacity(capacity), maxPoints(maxPoints) {}
+
+		virtual void setUp()
+		{
+			history.reset(new NTHistoryBuffer(capacity));
+			for (size_t i = 0; i < capacity; ++i)
+				history->append((double) i, i, 0, 0, 0);
+
+			result = pvDataCreate->createPVStructure(NTHistoryBuffer::createResultField());
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			// The middle half of the buffer.
+			double start = capacity / 4;
+			double end = 3 * capacity / 4;
+
+			while (state.keepRunning())
+				history->query(start, end, maxPoints, result);
+		}
+
+		virtual void tearDown()
+		{
+			history.reset();
+			result.reset();
+		}
+
+	private:
+		static string name(size_t capacity, size_t maxPoints)
+		{
+			stringstream str;
+			str << "history/query/" << capacity << "/" << maxPoints;
+			return str.str();
+		}
+
+		size_t capacity;
+		size_t maxPoints;
+		NTHistoryBufferPtr history;
+		PVStructurePtr result;
+};
+
+/*
+ * Encoding a block of archive samples of a slowly changing value taken at a steady rate.
+ * The bytes_per_sample counter is the size on disk of a sample.
+ */
+class ArchiveEncodeBenchmark : public Benchmark {
+	public:
+		explicit ArchiveEncodeBenchmark(size_t count)
+			: Benchmark(name(count)), samples(count) {}
+
+		virtual void setUp()
+		{
+			int64 time = 1500000000LL * 1000000000LL;
+			double value = 20.0;
+
+			for (size_t i = 0; i < samples.size(); ++i) {
+				time += 100000000;
+				if (i % 10 == 0) value += 0.125;
+
+				samples[i].time = time;
+				samples[i].value = value;
+				samples[i].severity = 0;
+				samples[i].status = 0;
+			}
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			while (state.keepRunning()) {
+				block.clear();
+				NTArchiveBlock::encode(&samples[0], samples.size(), block);
+			}
+
+			state.setCounter("bytes_per_sample", (double) block.size() / samples.size());
+		}
+
+	private:
+		static string name(size_t count)
+		{
+			stringstream str;
+			str << "archive/encode/" << count;
+			return str.str();
+		}
+
+		vector<NTArchiveSample> samples;
+		vector<uint8> block;
+};
+
+/* Evaluating a compiled calc expression from the values of its inputs. */
+class CalcEvaluateBenchmark : public Benchmark {
+	public:
+		explicit CalcEvaluateBenchmark(string const &expression)
+			: Benchmark("calc/evaluate/" + expression),
+			  expression(NTCalcExpression::compile(expression)),
+			  inputs(this->expression->getInputs().size(), 1.5) {}
+
+		virtual void run(BenchmarkState &state)
+		{
+			double result = 0.0;
+
+			while (state.keepRunning())
+				result += expression->evaluate(inputs.empty() ? 0 : &inputs[0]);
+
+			// Keep the result alive.
+			state.setCounter("result", result / state.getIterations());
+		}
+
+	private:
+		NTCalcExpressionPtr expression;
+		vector<double> inputs;
+};
+
+/* Adding the elements of an array put to the running statistics of an aggregate record. */
+class AggregateAccumulateBenchmark : public Benchmark {
+	public:
+		explicit AggregateAccumulateBenchmark(size_t length)
+			: Benchmark(name(length)), values(length) {}
+
+		virtual void setUp()
+		{
+			record = NTAggregateRecord::create("aggregate", NTAggregateRecord::createPVStructure());
+
+			for (size_t i = 0; i < values.size(); ++i)
+				values[i] = (double) (i % 1000) / 10.0;
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			TimeStamp timeStamp;
+
+			while (state.keepRunning())
+				record->accumulate(&values[0], values.size(), timeStamp);
+		}
+
+		virtual void tearDown()
+		{
+			record.reset();
+		}
+
+	private:
+		static string name(size_t length)
+		{
+			stringstream str;
+			str << "aggregate/accumulate/" << length;
+			return str.str();
+		}
+
+		vector<double> values;
+		NTAggregateRecordPtr record;
+};
+
+/* Resampling a waveform given at non-uniform points onto a uniform grid. */
+class ResampleBenchmark : public Benchmark {
+	public:
+		ResampleBenchmark(size_t samples, size_t points, NTResampler::Method method)
+			: Benchmark(name(samples, points, method)),
+			  samples(samples), points(points), method(method), out(points) {}
+
+		virtual void setUp()
+		{
+			shared_vector<double> base(samples);
+			shared_vector<double> value(samples);
+
+			double x = 0.0;
+			for (size_t i = 0; i < samples; ++i) {
+				x += 0.5 + (double) (i % 7) / 7.0;
+				base[i] = x;
+				value[i] = (double) (i % 100);
+			}
+
+			resampler.setSamples(freeze(base), freeze(value));
+			end = x;
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			double step = end / points;
+
+			while (state.keepRunning())
+				resampler.resample(0.0, step, points, method, &out[0]);
+		}
+
+	private:
+		static string name(size_t samples, size_t points, NTResampler::Method method)
+		{
+			stringstream str;
+			str << "continuum/resample/" << (method == NTResampler::cubic ? "cubic" : "linear")
+			    << "/" << samples << "/" << points;
+			return str.str();
+		}
+
+		size_t samples;
+		size_t points;
+		NTResampler::Method method;
+		NTResampler resampler;
+		vector<double> out;
+		double end;
+};
+
+static string matrixName(string const &operation, size_t rows, size_t columns)
+{
+	stringstream str;
+	str << "matrix/" << operation << "/" << rows << "x" << columns;
+	return str.str();
+}
+
+/* Transposing a rows x columns matrix. */
+class MatrixTransposeBenchmark : public Benchmark {
+	public:
+		MatrixTransposeBenchmark(size_t rows, size_t columns)
+			: Benchmark(matrixName("transpose", rows, columns)),
+			  rows(rows), columns(columns), matrix(rows * columns), out(rows * columns) {}
+
+		virtual void setUp()
+		{
+			for (size_t i = 0; i < matrix.size(); ++i) matrix[i] = (double) (i % 1000);
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			while (state.keepRunning())
+				NTMatrixKernels::transpose(&matrix[0], rows, columns, &out[0]);
+
+			state.setCounter("bytes", (double) (2 * matrix.size() * sizeof(double)));
+		}
+
+	private:
+		size_t rows;
+		size_t columns;
+		vector<double> matrix;
+		vector<double> out;
+};
+
+/* Multiplying a rows x columns matrix by a vector. */
+class MatrixMultiplyBenchmark : public Benchmark {
+	public:
+		MatrixMultiplyBenchmark(size_t rows, size_t columns)
+			: Benchmark(matrixName("multiply", rows, columns)),
+			  rows(rows), columns(columns), matrix(rows * columns), vec(columns), out(rows) {}
+
+		virtual void setUp()
+		{
+			for (size_t i = 0; i < matrix.size(); ++i) matrix[i] = (double) (i % 1000);
+			for (size_t i = 0; i < columns; ++i) vec[i] = 1.0 / (1.0 + i);
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			while (state.keepRunning())
+				NTMatrixKernels::multiply(&matrix[0], rows, columns, &vec[0], &out[0]);
+
+			state.setCounter("bytes", (double) (matrix.size() * sizeof(double)));
+		}
+
+	private:
+		size_t rows;
+		size_t columns;
+		vector<double> matrix;
+		vector<double> vec;
+		vector<double> out;
+};
+
+/* Selecting the rows of a string column that equal or start with a value. */
+class TableSelectBenchmark : public Benchmark {
+	public:
+		TableSelectBenchmark(size_t rows, NTTableColumn::Index index, NTTablePredicate::Op op)
+			: Benchmark(name(rows, index, op)),
+			  rows(rows), index(index), op(op) {}
+
+		virtual void setUp()
+		{
+			// 1000 distinct keys, each in rows / 1000 rows.
+			shared_vector<string> cells(rows);
+			for (size_t i = 0; i < rows; ++i) {
+				stringstream str;
+				str << "key" << (i * 7919) % 1000;
+				cells[i] = str.str();
+			}
+
+			PVStringArrayPtr array = pvDataCreate->createPVScalarArray<PVStringArray>();
+			array->replace(freeze(cells));
+
+			column.setIndex(index);
+			column.set(array);
+
+			predicate.op = op;
+			predicate.value = (op == NTTablePredicate::prefix) ? "key42" : "key421";
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			vector<uint32> selected;
+
+			while (state.keepRunning()) {
+				selected.clear();
+				column.select(predicate, rows, 0, selected);
+			}
+
+			state.setCounter("rows", (double) selected.size());
+		}
+
+	private:
+		static string name(size_t rows, NTTableColumn::Index index, NTTablePredicate::Op op)
+		{
+			static char const *indexNames[] = { "scan", "sorted", "hash" };
+
+			stringstream str;
+			str << "table/" << (op == NTTablePredicate::prefix ? "prefix" : "equal")
+			    << "/" << indexNames[index] << "/" << rows;
+			return str.str();
+		}
+
+		size_t rows;
+		NTTableColumn::Index index;
+		NTTablePredicate::Op op;
+		NTTableColumn column;
+		NTTablePredicate predicate;
+};
+
+/*
+ * Dictionary encoding an array of strings repeating a few distinct values.
+ * Reports the bytes per element held as strings and as encoded.
+ */
+class StringDictionaryBenchmark : public Benchmark {
+	public:
+		StringDictionaryBenchmark(size_t length, size_t distinct)
+			: Benchmark(name(length, distinct)),
+			  length(length), distinct(distinct) {}
+
+		virtual void setUp()
+		{
+			shared_vector<string> data(length);
+			for (size_t i = 0; i < length; ++i) {
+				stringstream str;
+				str << "device:subsystem:signal" << (i * 7919) % distinct;
+				data[i] = str.str();
+			}
+			cells = freeze(data);
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			while (state.keepRunning())
+				dictionary.encode(cells);
+
+			state.setCounter("plainBytesPerCell", (double) NTStringDictionary::memoryUsed(cells) / length);
+			state.setCounter("encodedBytesPerCell", (double) dictionary.memoryUsed() / length);
+		}
+
+		virtual void tearDown()
+		{
+			cells.clear();
+			dictionary = NTStringDictionary();
+		}
+
+	private:
+		static string name(size_t length, size_t distinct)
+		{
+			stringstream str;
+			str << "dictionary/encode/" << length << "/" << distinct;
+			return str.str();
+		}
+
+		size_t length;
+		size_t distinct;
+		shared_vector<const string> cells;
+		NTStringDictionary dictionary;
+};
+
+/* Finding the positions of names among many, through the hash index or by scan. */
+class NameFindBenchmark : public Benchmark {
+	public:
+		NameFindBenchmark(size_t length, bool hashed)
+			: Benchmark(name(length, hashed)),
+			  length(length), hashed(hashed) {}
+
+		virtual void setUp()
+		{
+			shared_vector<string> data(length);
+			for (size_t i = 0; i < length; ++i) {
+				stringstream str;
+				str << "parameter" << i;
+				data[i] = str.str();
+			}
+			names = freeze(data);
+
+			if (hashed) index.build(names);
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			size_t next = 0;
+
+			while (state.keepRunning()) {
+				// Walk the names with a stride, so each lookup is a different one.
+				string const &key = names[next];
+				next = (next + 7919) % length;
+
+				int32 position = -1;
+				if (hashed) {
+					position = index.find(key);
+				} else {
+					for (size_t i = 0; i < length; ++i) {
+						if (names[i] == key) { position = i; break; }
+					}
+				}
+
+				if (position < 0) cerr << "name not found\n";
+			}
+		}
+
+		virtual void tearDown()
+		{
+			names.clear();
+			index.clear();
+		}
+
+	private:
+		static string name(size_t length, bool hashed)
+		{
+			stringstream str;
+			str << "namevalue/find/" << (hashed ? "hash" : "scan") << "/" << length;
+			return str.str();
+		}
+
+		size_t length;
+		bool hashed;
+		shared_vector<const string> names;
+		NTStringIndex index;
+};
+
+// Returns the query of a request as its result.
+class RPCEchoHandler : public NTRPCHandler {
+	public:
+		virtual PVStructurePtr handle(PVStructurePtr const &query)
+		{
+			return query;
+		}
+};
+
+// Counts the responses to a batch of requests and signals when all arrived.
+class RPCBatchCallback : public RPCResponseCallback {
+	public:
+		RPCBatchCallback() : pending(0), failed(0) {}
+
+		void expect(size_t count)
+		{
+			Lock lock(mutex);
+			pending = count;
+		}
+
+		virtual void requestDone(Status const &status, PVStructurePtr const &)
+		{
+			bool done;
+			{
+				Lock lock(mutex);
+				if (!status.isSuccess()) ++failed;
+				done = (--pending == 0);
+			}
+			if (done) event.signal();
+		}
+
+		void wait() { event.wait(); }
+		size_t getFailed() { Lock lock(mutex); return failed; }
+
+	private:
+		Mutex mutex;
+		size_t pending;
+		size_t failed;
+		epicsEvent event;
+};
+
+class RPCDispatchBenchmark : public Benchmark {
+	public:
+		RPCDispatchBenchmark(size_t workers, size_t batch)
+			: Benchmark(name(workers, batch)),
+			  workers(workers), batch(batch) {}
+
+		virtual void setUp()
+		{
+			dispatcher = NTRPCDispatcher::create(workers, batch);
+			dispatcher->registerHandler("echo", NTRPCHandlerPtr(new RPCEchoHandler()));
+
+			callback = std::tr1::shared_ptr<RPCBatchCallback>(new RPCBatchCallback());
+
+			args = NTURI::createBuilder()->
+				addQueryString("query")->
+				createPVStructure();
+			args->getSubField<PVString>("path")->put("echo");
+			args->getSubField<PVString>("query.query")->put("benchmark");
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			while (state.keepRunning()) {
+				callback->expect(batch);
+				for (size_t i = 0; i < batch; ++i)
+					dispatcher->request(args, callback);
+				callback->wait();
+			}
+
+			state.setCounter("requests_per_iteration", batch);
+			state.setCounter("failed", callback->getFailed());
+		}
+
+		virtual void tearDown()
+		{
+			dispatcher->stop();
+			dispatcher.reset();
+			callback.reset();
+			args.reset();
+		}
+
+	private:
+		static string name(size_t workers, size_t batch)
+		{
+			stringstream str;
+			str << "rpc/dispatch/" << workers << "_workers/" << batch;
+			return str.str();
+		}
+
+		size_t workers;
+		size_t batch;
+		NTRPCDispatcherPtr dispatcher;
+		std::tr1::shared_ptr<RPCBatchCallback> callback;
+		PVStructurePtr args;
+};
+
+/* Writes long, double and enum with one lock sweep and one time stamp. */
+class GroupPutBenchmark : public Benchmark {
+	public:
+		GroupPutBenchmark()
+			: Benchmark("group/put/long_double_enum") {}
+
+		virtual void setUp()
+		{
+			groupPut = NTGroupPut::create();
+
+			query = pvDataCreate->createPVStructure(getFieldCreate()->createFieldBuilder()->
+				add("long", pvLong)->
+				add("double", pvDouble)->
+				add("enum", pvInt)->
+				createStructure());
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			PVLongPtr pvLong = query->getSubField<PVLong>("long");
+			PVDoublePtr pvDouble = query->getSubField<PVDouble>("double");
+			PVIntPtr pvEnum = query->getSubField<PVInt>("enum");
+
+			int64 value = 0;
+
+			while (state.keepRunning()) {
+				pvLong->put(value);
+				pvDouble->put(value);
+				pvEnum->put(value & 1);
+				groupPut->handle(query);
+				++value;
+			}
+		}
+
+		virtual void tearDown()
+		{
+			groupPut.reset();
+			query.reset();
+		}
+
+	private:
+		NTGroupPutPtr groupPut;
+		PVStructurePtr query;
+};
+
+/* Creates count scalar records of one shape from a definition, on every cpu. */
+class DefinitionLoadBenchmark : public Benchmark {
+	public:
+		DefinitionLoadBenchmark(size_t count)
+			: Benchmark(name(count)), count(count) {}
+
+		virtual void setUp()
+		{
+			stringstream text;
+			text << "bench[0-" << count - 1 << "] scalar:double alarm timeStamp value=1.5\n";
+
+			definitions.clear();
+			NTRecordLoader::parse(text, "benchmark", definitions);
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			size_t created = 0;
+
+			while (state.keepRunning())
+				created = NTRecordLoader::instantiate(definitions, epicsThreadGetCPUs()).size();
+
+			state.setCounter("records", created);
+		}
+
+		virtual void tearDown()
+		{
+			definitions.clear();
+		}
+
+	private:
+		static string name(size_t count)
+		{
+			stringstream str;
+			str << "definition/instantiate/" << count;
+			return str.str();
+		}
+
+		size_t count;
+		vector<NTRecordDefinition> definitions;
+};
+
+/* Adds and then removes a batch of records, over and over, until stopped. */
+class RecordChurn : public epicsThreadRunable {
+	public:
+		explicit RecordChurn(size_t count)
+			: stopping(false), batches(0),
+			  thread(*this, "recordChurn",
+			         epicsThreadGetStackSize(epicsThreadStackMedium),
+			         epicsThreadPriorityLow)
+		{
+			stringstream definition, names;
+			definition << "churn[0-" << count - 1 << "] scalar:double alarm timeStamp";
+			names << "churn[0-" << count - 1 << "]";
+			this->definition = definition.str();
+			this->names = names.str();
+
+			thread.start();
+		}
+
+		virtual void run()
+		{
+			while (!stopping) {
+				NTDatabase::addRecords(definition);
+				NTDatabase::removeRecords(names);
+				++batches;
+			}
+		}
+
+		// Returns the number of batches added and removed.
+		size_t stop()
+		{
+			stopping = true;
+			thread.exitWait();
+			return batches;
+		}
+
+	private:
+		string definition;
+		string names;
+		volatile bool stopping;
+		size_t batches;
+		epicsThread thread;
+};
+
+/*
+ * Time from a process() of the double record to the arrival of its
+ * monitor update, with or without batches of records being added to and
+ * removed from the database meanwhile.
+ */
+class MonitorLatencyBenchmark : public Benchmark {
+	public:
+		MonitorLatencyBenchmark(PvaClientPtr const &pva, size_t churnCount)
+			: Benchmark(name(churnCount)), pva(pva), churnCount(churnCount), churn(0) {}
+
+		virtual void setUp()
+		{
+			pvRecord = PVDatabase::getMaster()->findRecord("double");
+			pvValue = pvRecord->getPVStructure()->getSubField<PVDouble>("value");
+
+			monitor = pva->channel("double", "local")->monitor("field(value)");
+
+			// Drop the update carrying the initial value.
+			while (monitor->waitEvent(0.1)) monitor->releaseEvent();
+
+			if (churnCount > 0) churn = new RecordChurn(churnCount);
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			double value = 0.0;
+			epicsUInt64 maxLatency = 0;
+
+			while (state.keepRunning()) {
+				epicsUInt64 start = epicsMonotonicGet();
+
+				pvRecord->lock();
+				pvRecord->beginGroupPut();
+				pvValue->put(value);
+				pvRecord->process();
+				pvRecord->endGroupPut();
+				pvRecord->unlock();
+
+				if (monitor->waitEvent(5.0)) monitor->releaseEvent();
+
+				epicsUInt64 latency = epicsMonotonicGet() - start;
+				if (latency > maxLatency) maxLatency = latency;
+
+				value += 1.0;
+			}
+
+			state.setCounter("max_latency_ns", maxLatency);
+		}
+
+		virtual void tearDown()
+		{
+			if (churn) {
+				churn->stop();
+				delete churn;
+				churn = 0;
+			}
+
+			monitor.reset();
+			pvValue.reset();
+			pvRecord.reset();
+		}
+
+	private:
+		static string name(size_t churnCount)
+		{
+			stringstream str;
+			str << "admin/monitorLatency/churn_" << churnCount;
+			return str.str();
+		}
+
+		PvaClientPtr pva;
+		size_t churnCount;
+		RecordChurn *churn;
+		PVRecordPtr pvRecord;
+		PVDoublePtr pvValue;
+		PvaClientMonitorPtr monitor;
+};
+
+/*
+ * Aggregate put and get throughput of records partitioned among shards
+ * server processes on this host. Each iteration writes and reads back
+ * every record once, all of them at once over channels routed to their
+ * shards, so the servers work in parallel; records / time per iteration
+ * is the throughput.
+ */
+class ShardScalingBenchmark : public Benchmark {
+	public:
+		ShardScalingBenchmark(string const &server, size_t shards, size_t records)
+			: Benchmark(name(shards, records)),
+			  server(server), shards(shards), records(records) {}
+
+		virtual void setUp()
+		{
+			stringstream definition;
+			definition << "shard[0-" << records - 1 << "] scalar:double\n";
+
+			ofstream file(definitionFile.c_str());
+			file << definition.str();
+			file.close();
+
+			// Ports of their own, clear of the previous run's servers.
+			NTShardMapPtr shardMap = NTShardMap::create(shards, 5100 + 16 * shards);
+
+			for (size_t i = 0; i < shards; ++i) {
+				stringstream shardText, portText;
+				shardText << i << "/" << shards;
+				portText << shardMap->getBasePort();
+
+				// Built before fork(), as the child may only exec.
+				string shard(shardText.str()), port(portText.str());
+
+				pid_t pid = fork();
+
+				if (pid == 0) {
+					// The server runs unattended without a terminal on stdin.
+					int null = open("/dev/null", O_RDWR);
+					dup2(null, STDIN_FILENO);
+					dup2(null, STDOUT_FILENO);
+
+					execl(server.c_str(), server.c_str(),
+						"-S", shard.c_str(), "-P", port.c_str(),
+						"-D", definitionFile.c_str(), (char *) NULL);
+					_exit(127);
+				}
+
+				if (pid > 0) servers.push_back(pid);
+				else cerr << "Failed to start shard server " << server << "\n";
+			}
+
+			router = std::tr1::shared_ptr<ShardRouter>(new ShardRouter(shardMap));
+
+			for (size_t i = 0; i < records; ++i) {
+				stringstream recordName;
+				recordName << "shard" << i;
+				putGets.push_back(ShardPutGet::create(*router, recordName.str()));
+			}
+
+			for (size_t i = 0; i < putGets.size(); ++i) {
+				if (!putGets[i]->waitConnect(10.0)) {
+					cerr << "Failed to connect to shard" << i << "\n";
+					break;
+				}
+			}
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			ShardBatch::shared_pointer batch(new ShardBatch());
+			double value = 0.0;
+
+			while (state.keepRunning()) {
+				batch->expect(putGets.size());
+				for (size_t i = 0; i < putGets.size(); ++i)
+					putGets[i]->issue(value, batch);
+
+				// putGets still outstanding must not be issued again, as
+				// each ShardPutGet takes one operation at a time.
+				if (!batch->wait(5.0)) {
+					state.skipWithError("putGets not done within 5 seconds");
+					break;
+				}
+
+				value += 1.0;
+			}
+
+			state.setCounter("records_per_iteration", records);
+			state.setCounter("failed", batch->getFailed());
+		}
+
+		virtual void tearDown()
+		{
+			for (size_t i = 0; i < putGets.size(); ++i)
+				putGets[i]->destroy();
+			putGets.clear();
+			router.reset();
+
+			for (size_t i = 0; i < servers.size(); ++i)
+				kill(servers[i], SIGTERM);
+			for (size_t i = 0; i < servers.size(); ++i)
+				waitpid(servers[i], NULL, 0);
+			servers.clear();
+
+			unlink(definitionFile.c_str());
+		}
+
+	private:
+		static string name(size_t shards, size_t records)
+		{
+			stringstream str;
+			str << "shard/putGet/" << shards << "_shards/" << records;
+			return str.str();
+		}
+
+		static const string definitionFile;
+
+		string server;
+		size_t shards;
+		size_t records;
+		vector<pid_t> servers;
+		std::tr1::shared_ptr<ShardRouter> router;
+		vector<ShardPutGet::shared_pointer> putGets;
+};
+
+const string ShardScalingBenchmark::definitionFile("ntShardBench.db");
+
+/* Writes a record under its lock, as a put from a client would. */
+class RecordWriteTask : public NTAdmissionTask {
+	public:
+		RecordWriteTask(PVRecordPtr const &pvRecord, PVFieldPtr const &pvField, PVFieldPtr const &value, epicsEvent *done)
+			: pvRecord(pvRecord), pvField(pvField), value(value), done(done) {}
+
+		virtual bool run()
+		{
+			pvRecord->lock();
+			pvRecord->beginGroupPut();
+			pvField->copyUnchecked(*value);
+			pvRecord->process();
+			pvRecord->endGroupPut();
+			pvRecord->unlock();
+
+			if (done) done->signal();
+			return true;
+		}
+
+		virtual void refuse(string const &)
+		{
+			if (done) done->signal();
+		}
+
+	private:
+		PVRecordPtr pvRecord;
+		PVFieldPtr pvField;
+		PVFieldPtr value;
+		epicsEvent *done;
+};
+
+/* Keeps a client's admission queue full of puts of doubleArray until stopped. */
+class AdmissionFlood : public epicsThreadRunable {
+	public:
+		AdmissionFlood(NTAdmissionPtr const &admission, size_t length)
+			: admission(admission), stopping(false),
+			  thread(*this, "admissionFlood",
+			         epicsThreadGetStackSize(epicsThreadStackMedium),
+			         epicsThreadPriorityLow)
+		{
+			pvRecord = PVDatabase::getMaster()->findRecord("doubleArray");
+			pvValue = pvRecord->getPVStructure()->getSubField("value");
+
+			PVDoubleArrayPtr array = static_pointer_cast<PVDoubleArray>(pvDataCreate->createPVField(pvValue));
+			shared_vector<double> data(length, 1.0);
+			array->replace(freeze(data));
+			value = array;
+
+			client = admission->connect("flood:1");
+			thread.start();
+		}
+
+		virtual void run()
+		{
+			while (!stopping) {
+				NTAdmissionTaskPtr task(new RecordWriteTask(pvRecord, pvValue, value, 0));
+				// Refused once the queue is full, like a client ignoring errors.
+				if (!admission->submit(client, task)) epicsThreadSleep(0.0001);
+			}
+		}
+
+		void stop()
+		{
+			stopping = true;
+			thread.exitWait();
+			admission->disconnect(client);
+		}
+
+	private:
+		NTAdmissionPtr admission;
+		NTAdmission::ClientPtr client;
+		PVRecordPtr pvRecord;
+		PVFieldPtr pvValue;
+		PVFieldPtr value;
+		volatile bool stopping;
+		epicsThread thread;
+};
+
+/*
+ * Time for a put of the double record to be admitted, run and answered by
+ * two admission workers, with or without another client keeping its queue
+ * of puts of a 1M element doubleArray full.
+ */
+class AdmissionFairnessBenchmark : public Benchmark {
+	public:
+		explicit AdmissionFairnessBenchmark(bool flooded)
+			: Benchmark(flooded ? "admission/put/flooded" : "admission/put/idle"),
+			  flooded(flooded), flood(0) {}
+
+		virtual void setUp()
+		{
+			NTAdmissionOptions options;
+			options.workers = 2;
+			options.queueDepth = 64;
+			admission = NTAdmission::create(options);
+			client = admission->connect("client:1");
+
+			pvRecord = PVDatabase::getMaster()->findRecord("double");
+			pvValue = pvRecord->getPVStructure()->getSubField("value");
+			value = pvDataCreate->createPVField(pvValue);
+
+			if (flooded) flood = new AdmissionFlood(admission, 1000000);
+		}
+
+		virtual void run(BenchmarkState &state)
+		{
+			epicsUInt64 maxLatency = 0;
+
+			while (state.keepRunning()) {
+				epicsUInt64 start = epicsMonotonicGet();
+
+				admission->submit(client, NTAdmissionTaskPtr(new RecordWriteTask(pvRecord, pvValue, value, &done)));
+				done.wait();
+
+				epicsUInt64 latency = epicsMonotonicGet() - start;
+				if (latency > maxLatency) maxLatency = latency;
+			}
+
+			state.setCounter("max_latency_ns", maxLatency);
+		}
+
+		virtual void tearDown()
+		{
+			if (flood) {
+				flood->stop();
+				delete flood;
+				flood = 0;
+			}
+
+			admission->disconnect(client);
+			admission->stop();
+			admission.reset();
+			client.reset();
+			pvRecord.reset();
+		}
+
+	private:
+		bool flooded;
+		AdmissionFlood *flood;
+		NTAdmissionPtr admission;
+		NTAdmission::ClientPtr client;
+		PVRecordPtr pvRecord;
+		PVFieldPtr pvValue;
+		PVFieldPtr value;
+		epicsEvent done;
+};
+
+int main (int argc, char **argv)
+{
+	string output("ntDatabaseBench.json");
+	string filter;
+	string shardServer;
+	double minTime(0.5);
+
+	// Handle executable flags.
+	for (int i = 1; i < argc; ++i) {
+		string arg(argv[i]);
+
+		if (arg == "-h") {
+
+			cout << "Help -- executable flags\n"
+			     << "\t-o file (write JSON results to file. default: ntDatabaseBench.json)\n"
+			     << "\t-f filter (only run benchmarks whose name contains filter)\n"
+			     << "\t-t seconds (minimum measured time of each benchmark. default: 0.5)\n"
+			     << "\t-S server (path of ntDatabaseMain. runs the shard scaling benchmarks,\n"
+			     << "\t           starting 1 to 8 servers on ports 5116 and up)\n"
+			     << "\t-h (help. prints help information)\n";
+			return 0;
+
+		} else if (arg == "-o" && i + 1 < argc) {
+			output = argv[++i];
+		} else if (arg == "-f" && i + 1 < argc) {
+			filter = argv[++i];
+		} else if (arg == "-t" && i + 1 < argc) {
+			minTime = atof(argv[++i]);
+		} else if (arg == "-S" && i + 1 < argc) {
+			shardServer = argv[++i];
+		} else {
+			cout << "Unrecognized option: '" << arg
+			     << "'. ('ntDatabaseBench -h' for help.)\n";
+			return 1;
+		}
+	}
+
+	// The local channel provider must exist before the records are added and the client connects.
+	ChannelProviderLocalPtr cpLocal = getChannelProviderLocal();
+	NTDatabase::create();
+
+	PvaClientPtr pva = PvaClient::get("local");
+
+	BenchmarkRunner runner;
+	runner.setFilter(filter);
+	runner.setMinTime(minTime);
+
+	vector<string> recordNames = NTDatabase::getRecordNames();
+
+	for (size_t i = 0; i < recordNames.size(); ++i)
+		runner.add(Benchmark::shared_pointer(new CreateBenchmark(recordNames[i])));
+	for (size_t i = 0; i < recordNames.size(); ++i)
+		runner.add(Benchmark::shared_pointer(new CopyBenchmark(recordNames[i])));
+	for (size_t i = 0; i < recordNames.size(); ++i)
+		runner.add(Benchmark::shared_pointer(new SerializeBenchmark(recordNames[i])));
+	for (size_t i = 0; i < recordNames.size(); ++i)
+		runner.add(Benchmark::shared_pointer(new DeserializeBenchmark(recordNames[i])));
+
+	size_t lengths[] = { 16, 1024, 65536, 1048576 };
+	for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i)
+		runner.add(Benchmark::shared_pointer(new FreezeReplaceBenchmark(lengths[i])));
+	for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i)
+		runner.add(Benchmark::shared_pointer(new ReuseReplaceBenchmark(lengths[i])));
+
+	string scalarRecords[] = { "short", "int", "long", "double" };
+	for (size_t i = 0; i < 4; ++i)
+		runner.add(Benchmark::shared_pointer(new RecordPutBenchmark(scalarRecords[i])));
+	for (size_t i = 0; i < 4; ++i)
+		runner.add(Benchmark::shared_pointer(new LocalPutGetBenchmark(pva, scalarRecords[i])));
+	for (size_t i = 0; i < 4; ++i)
+		runner.add(Benchmark::shared_pointer(new LocalGetBenchmark(pva, scalarRecords[i])));
+
+	runner.add(Benchmark::shared_pointer(new SlicePutBenchmark(10000000, 10, false)));
+	runner.add(Benchmark::shared_pointer(new SlicePutBenchmark(10000000, 10, true)));
+
+	runner.add(Benchmark::shared_pointer(new StreamBenchmark(pva, 10000000, 65536)));
+	runner.add(Benchmark::shared_pointer(new StreamBenchmark(pva, 10000000, 1048576)));
+
+	for (int tracked = 0; tracked < 2; ++tracked) {
+		runner.add(Benchmark::shared_pointer(
+			new DeltaPutBenchmark(pva, "table", "value.answers", 100000, tracked)));
+		runner.add(Benchmark::shared_pointer(
+			new DeltaPutBenchmark(pva, "multi_channel", "isConnected", 10000, tracked)));
+	}
+
+	runner.add(Benchmark::shared_pointer(new HistoryAppendBenchmark(100000)));
+	runner.add(Benchmark::shared_pointer(new HistoryQueryBenchmark(100000, 0)));
+	runner.add(Benchmark::shared_pointer(new HistoryQueryBenchmark(100000, 1000)));
+
+	runner.add(Benchmark::shared_pointer(new ArchiveEncodeBenchmark(4096)));
+
+	runner.add(Benchmark::shared_pointer(new CalcEvaluateBenchmark("(long + double) * 2")));
+	runner.add(Benchmark::shared_pointer(new CalcEvaluateBenchmark("sqrt(short^2 + int^2) / max(long, 1)")));
+
+	runner.add(Benchmark::shared_pointer(new AggregateAccumulateBenchmark(1)));
+	runner.add(Benchmark::shared_pointer(new AggregateAccumulateBenchmark(65536)));
+
+	runner.add(Benchmark::shared_pointer(new ResampleBenchmark(100000, 10000, NTResampler::linear)));
+	runner.add(Benchmark::shared_pointer(new ResampleBenchmark(100000, 10000, NTResampler::cubic)));
+
+	runner.add(Benchmark::shared_pointer(new MatrixTransposeBenchmark(2000, 2000)));
+	runner.add(Benchmark::shared_pointer(new MatrixMultiplyBenchmark(2000, 2000)));
+
+	runner.add(Benchmark::shared_pointer(new TableSelectBenchmark(100000, NTTableColumn::none, NTTablePredicate::equal)));
+	runner.add(Benchmark::shared_pointer(new TableSelectBenchmark(100000, NTTableColumn::sorted, NTTablePredicate::equal)));
+	runner.add(Benchmark::shared_pointer(new TableSelectBenchmark(100000, NTTableColumn::hash, NTTablePredicate::equal)));
+	runner.add(Benchmark::shared_pointer(new TableSelectBenchmark(100000, NTTableColumn::none, NTTablePredicate::prefix)));
+	runner.add(Benchmark::shared_pointer(new TableSelectBenchmark(100000, NTTableColumn::sorted, NTTablePredicate::prefix)));
+
+	runner.add(Benchmark::shared_pointer(new StringDictionaryBenchmark(1000000, 300)));
+
+	runner.add(Benchmark::shared_pointer(new NameFindBenchmark(50000, false)));
+	runner.add(Benchmark::shared_pointer(new NameFindBenchmark(50000, true)));
+
+	runner.add(Benchmark::shared_pointer(new RPCDispatchBenchmark(1, 256)));
+	runner.add(Benchmark::shared_pointer(new RPCDispatchBenchmark(4, 256)));
+
+	runner.add(Benchmark::shared_pointer(new GroupPutBenchmark()));
+
+	runner.add(Benchmark::shared_pointer(new DefinitionLoadBenchmark(100000)));
+
+	runner.add(Benchmark::shared_pointer(new MonitorLatencyBenchmark(pva, 0)));
+	runner.add(Benchmark::shared_pointer(new MonitorLatencyBenchmark(pva, 10000)));
+
+	runner.add(Benchmark::shared_pointer(new AdmissionFairnessBenchmark(false)));
+	runner.add(Benchmark::shared_pointer(new AdmissionFairnessBenchmark(true)));
+
+	// These start servers of their own, so only when asked for.
+	if (!shardServer.empty()) {
+		for (size_t shards = 1; shards <= 8; shards *= 2)
+			runner.add(Benchmark::shared_pointer(new ShardScalingBenchmark(shardServer, shards, 4096)));
+	}
+
+	try {
+
+		runner.run(cout);
+
+	} catch (std::exception &e) {
+		cerr << "exception: " << e.what() << endl;
+		cpLocal->destroy();
+		return -1;
+	}
+
+	ofstream json(output.c_str());
+	if (!json) {
+		cerr << "Failed to open " << output << " for writing\n";
+	} else {
+		runner.writeJSON(json, argv[0]);
+		cout << "Results written to " << output << endl;
+	}
+
+	cpLocal->destroy();
+
+	return 0;
+}
@@ -22,6 +22,7 @@
  * =======================================================================
  */
 
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <memory>
@@ -34,21 +35,29 @@
 #include <pv/pvAccess.h>
 #include <pv/pvaClient.h>
 #include <pv/pvData.h>
+#include <pv/channelProviderLocal.h>
+
+#include <pv/ntDatabase.h>
+#include <pv/ntTrace.h>
 
 using namespace std;
 using namespace epics::pvData;
 using namespace epics::pvAccess;
 using namespace epics::pvaClient;
+using namespace epics::pvDatabase;
+using namespace epics::ntDatabase;
 
 
 int main (int argc, char **argv)
 {
 	bool verbosity(false);
 	bool debug(false);
+	bool loopback(false);
+	string traceFile;
 	
-	// Handle executable flag.
-	if (argc > 1 && argv[1] != NULL) {
-		string arg(argv[1]);
+	// Handle executable flags.
+	for (int i = 1; i < argc; ++i) {
+		string arg(argv[i]);
 		if (arg == "-v") {
 		
 			verbosity = true;		
@@ -56,9 +65,13 @@ int main (int argc, char **argv)
 	/* Help flag */
 		} else if (arg == "-h") {
 			
-			cout << "Help -- executable flags -- only one accepted at a time\n"
+			cout << "Help -- executable flags\n"
 			     << "\t-v (verbose. prints demo ouput. Recommend redirecting to a file.)\n"
 				 << "\t-d (debug. prints debug information)\n"
+				 << "\t-l (loopback. hosts the database in this process and runs the demos\n"
+				 << "\t    through the local channel provider, without the network)\n"
+				 << "\t-t file (trace. writes the time of each stage of the scalar demos'\n"
+				 << "\t         puts to file in the Chrome trace event format)\n"
 				 << "\t-h (help. prints help information)\n";
 			return 0;
 	
@@ -67,6 +80,17 @@ int main (int argc, char **argv)
 		
 			debug = true;
 		
+	/* Loopback flag */
+		} else if (arg == "-l") {
+
+			loopback = true;
+
+	/* Trace flag */
+		} else if (arg == "-t" && i + 1 < argc) {
+
+			traceFile = argv[++i];
+			NTTrace::enable(true);
+
 	/* Error */
 		} else {
 			
@@ -85,15 +109,26 @@ int main (int argc, char **argv)
 					  "longArray", "doubleArray",		  
 					  
 					  "enum", "matrix", "uri", "name_value", "table",  		// More specific nt examples
-					  "attribute", "multi_channel"};                 
+					  "attribute", "multi_channel", "gather", "rpc"};
 	
-	int number_of_record_types = 16;
+	int number_of_record_types = sizeof(record_types) / sizeof(record_types[0]);
 	
+	// In loopback mode the records live in this process and are reached
+	// through the local channel provider: no sockets and no serialization.
+	string provider_name = loopback ? "local" : "pva";
+	ChannelProviderLocalPtr cpLocal;
+
 	try {
 	
-		PvaClientPtr pvaClient = PvaClient::get("pva");
+		if (loopback) {
+			cpLocal = getChannelProviderLocal();
+			NTDatabase::create();
+		}
+
+		PvaClientPtr pvaClient = PvaClient::get(provider_name);
 		
 		cout << "debug : " << (debug ? "true" : "false") << endl;
+		cout << "provider : " << provider_name << endl;
 		
 		if (debug) PvaClient::setDebug(true);
 		
@@ -107,16 +142,31 @@ int main (int argc, char **argv)
 			
 			channel_name = record_types[i];
 			
-			demoRecord(verbosity, pvaClient, channel_name);
+			demoRecord(verbosity, pvaClient, channel_name, provider_name);
 
 			channel_name.clear();
 		}
 	
 	} catch (std::runtime_error e) {	
 		cerr << "exception: " << e.what() << endl;
+		if (cpLocal) {
+			NTDatabase::shutdown();
+			cpLocal->destroy();
+		}
 		return -1;
 	}
 
+	if (!traceFile.empty()) {
+		ofstream trace(traceFile.c_str());
+		NTTrace::writeChrome(trace);
+		if (!trace) cerr << "Failed to write the trace to " << traceFile << "\n";
+	}
+
+	// The database's threads stop before the provider serving it goes.
+	if (cpLocal) {
+		NTDatabase::shutdown();
+		cpLocal->destroy();
+	}
+
 	return 0;
 }
-
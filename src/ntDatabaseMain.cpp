@@ -18,15 +18,26 @@
  *	============================================================
  */
 
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
+#include <envDefs.h>
+
 #include <pv/channelProviderLocal.h>
+#include <pv/logger.h>
 #include <pv/serverContext.h>
 
+#include <pv/ntAdmissionProvider.h>
+#include <pv/ntControlLoop.h>
 #include <pv/ntDatabase.h>
+#include <pv/ntThreadPlacement.h>
+#include <pv/ntTrace.h>
 
 using namespace std;
 
@@ -36,23 +47,355 @@ using namespace epics::pvAccess;
 using namespace epics::pvDatabase;
 using namespace epics::ntDatabase;
 
+/* Console and control socket commands */
+
+// Reports the number of records changed by add, remove or load.
+static string changedRecords(vector<string> const &changed)
+{
+	stringstream reply;
+	reply << changed.size() << " record(s)";
+	return reply.str();
+}
+
+class AddCommand : public NTControlCommand {
+	public:
+		virtual string execute(string const &argument)
+		{
+			return changedRecords(NTDatabase::addRecords(argument));
+		}
+};
+
+class RemoveCommand : public NTControlCommand {
+	public:
+		virtual string execute(string const &argument)
+		{
+			return changedRecords(NTDatabase::removeRecords(argument));
+		}
+};
+
+class LoadCommand : public NTControlCommand {
+	public:
+		virtual string execute(string const &argument)
+		{
+			ifstream file(argument.c_str());
+			stringstream definitions;
+			definitions << file.rdbuf();
+
+			if (!file) throw runtime_error("can not read " + argument);
+			return changedRecords(NTDatabase::addRecords(definitions.str()));
+		}
+};
+
+class StatsCommand : public NTControlCommand {
+	public:
+		virtual string execute(string const &)
+		{
+			stringstream reply;
+			NTDatabase::writeStats(reply);
+			return reply.str();
+		}
+};
+
+class SnapshotCommand : public NTControlCommand {
+	public:
+		virtual string execute(string const &argument)
+		{
+			stringstream reply;
+
+			if (argument.empty()) {
+				NTDatabase::writeSnapshot(reply);
+				return reply.str();
+			}
+
+			ofstream file(argument.c_str());
+			NTDatabase::writeSnapshot(file);
+			if (!file) throw runtime_error("can not write " + argument);
+
+			return "written to " + argument;
+		}
+};
+
+class PlacementCommand : public NTControlCommand {
+	public:
+		virtual string execute(string const &)
+		{
+			stringstream reply;
+			NTDatabase::writePlacement(reply);
+			return reply.str();
+		}
+};
+
+class TraceCommand : public NTControlCommand {
+	public:
+		virtual string execute(string const &argument)
+		{
+			if (argument == "on" || argument == "off") {
+				NTTrace::enable(argument == "on");
+				return "tracing " + argument;
+			}
+
+			if (argument == "clear") {
+				NTTrace::clear();
+				return "trace cleared";
+			}
+
+			if (argument.empty()) throw runtime_error("trace needs on, off, clear or a file");
+
+			ofstream file(argument.c_str());
+			NTTrace::writeChrome(file);
+			if (!file) throw runtime_error("can not write " + argument);
+
+			return "written to " + argument;
+		}
+};
+
+class LogLevelCommand : public NTControlCommand {
+	public:
+		virtual string execute(string const &argument)
+		{
+			static const char *names[] = { "all", "trace", "debug", "info", "warn", "error", "fatal", "off" };
+			static const pvAccessLogLevel levels[] = {
+				logLevelAll, logLevelTrace, logLevelDebug, logLevelInfo,
+				logLevelWarn, logLevelError, logLevelFatal, logLevelOff };
+
+			for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+				if (argument == names[i]) {
+					pvAccessSetLogLevel(levels[i]);
+					return "log level " + argument;
+				}
+			}
+
+			throw runtime_error("unknown log level " + argument);
+		}
+};
+
+static void addCommands(NTControlLoop &loop)
+{
+	loop.addCommand("add", NTControlCommandPtr(new AddCommand()),
+		"<definition> adds records, replacing those of the same name");
+	loop.addCommand("remove", NTControlCommandPtr(new RemoveCommand()),
+		"<names> removes records, e.g. remove pump[0-9]");
+	loop.addCommand("load", NTControlCommandPtr(new LoadCommand()),
+		"<file> adds the records of a definition file");
+	loop.addCommand("stats", NTControlCommandPtr(new StatsCommand()),
+		"prints the number of records and the rpc metrics");
+	loop.addCommand("snapshot", NTControlCommandPtr(new SnapshotCommand()),
+		"[file] prints the value of every record, or writes it to file");
+	loop.addCommand("placement", NTControlCommandPtr(new PlacementCommand()),
+		"prints the cpus of each thread and where each record was last processed");
+	loop.addCommand("trace", NTControlCommandPtr(new TraceCommand()),
+		"<on|off|clear|file> traces the stages of requests, or writes them to file");
+	loop.addCommand("loglevel", NTControlCommandPtr(new LogLevelCommand()),
+		"<all|trace|debug|info|warn|error|fatal|off> sets the pvAccess log level");
+}
+
 int main (int argc, char **argv)
 {
 
 	bool verbosity(false);
+	NTDatabaseOptions options;
+	string socketPath;
+	// The first -m replaces the default members of the gather record.
+	bool defaultMembers(true);
+	bool sharded(false);
 
-	if (argc > 1 && argv[1]) {
+	for (int i = 1; i < argc; ++i) {
 		
-		string arg(argv[1]);	
+		string arg(argv[i]);	
 		
 		if (arg == string("-v")) {
 		/* Verbose flag */
 			verbosity = true;
 		
+		} else if (arg == string("-s") && i + 1 < argc) {
+		/* Control socket flag */
+			socketPath = argv[++i];
+
+		} else if (arg == string("-t")) {
+		/* Trace flag */
+			NTTrace::enable(true);
+
+		} else if (arg == string("-H") && i + 1 < argc) {
+		/* History flag */
+			options.historyLength = strtoul(argv[++i], NULL, 10);
+
+		} else if (arg == string("-A") && i + 1 < argc) {
+		/* Archive flag */
+			options.archiveDirectory = argv[++i];
+
+		} else if (arg == string("-a") && i + 1 < argc) {
+		/* Archived record flag */
+			options.archiveRecords.push_back(argv[++i]);
+
+		} else if (arg == string("-D") && i + 1 < argc) {
+		/* Record definition file flag */
+			options.definitionFiles.push_back(argv[++i]);
+
+		} else if (arg == string("-c") && i + 1 < argc) {
+		/* Calc record flag */
+			string definition(argv[++i]);
+			size_t equals = definition.find('=');
+
+			if (equals == string::npos) {
+				cout << "calc record \"" << definition << "\" is not name=expression." << endl;
+				return 0;
+			}
+
+			options.calcRecords.push_back(make_pair(
+				definition.substr(0, equals), definition.substr(equals + 1)));
+
+		} else if (arg == string("-g") && i + 1 < argc) {
+		/* Aggregate source flag */
+			options.aggregateSource = argv[++i];
+
+		} else if (arg == string("-G") && i + 1 < argc) {
+		/* Aggregate period flag */
+			options.aggregatePeriod = atof(argv[++i]);
+
+		} else if (arg == string("-m") && i + 1 < argc) {
+		/* Gather member flag */
+			if (defaultMembers) options.gatherMembers.clear();
+			defaultMembers = false;
+
+			string member(argv[++i]);
+			if (!member.empty()) options.gatherMembers.push_back(member);
+
+		} else if (arg == string("-M") && i + 1 < argc) {
+		/* Gather period flag */
+			options.gatherPeriod = atof(argv[++i]);
+
+		} else if (arg == string("-i") && i + 1 < argc) {
+		/* Table index flag */
+			string definition(argv[++i]);
+			size_t equals = definition.find('=');
+
+			if (equals == string::npos) {
+				cout << "table index \"" << definition << "\" is not record.column=kind." << endl;
+				return 0;
+			}
+
+			options.tableIndexes.push_back(make_pair(
+				definition.substr(0, equals), definition.substr(equals + 1)));
+
+		} else if (arg == string("-w") && i + 1 < argc) {
+		/* RPC workers flag */
+			options.rpcWorkers = strtoul(argv[++i], NULL, 10);
+
+		} else if (arg == string("-q") && i + 1 < argc) {
+		/* RPC queue depth flag */
+			options.rpcQueueDepth = strtoul(argv[++i], NULL, 10);
+
+		} else if (arg == string("-S") && i + 1 < argc) {
+		/* Shard flag */
+			string shard(argv[++i]);
+			size_t slash = shard.find('/');
+
+			if (slash != string::npos) {
+				options.shardIndex = strtoul(shard.substr(0, slash).c_str(), NULL, 10);
+				options.shardCount = strtoul(shard.substr(slash + 1).c_str(), NULL, 10);
+			}
+
+			if (slash == string::npos || options.shardIndex >= options.shardCount) {
+				cout << "shard \"" << shard << "\" is not index/count with index < count." << endl;
+				return 0;
+			}
+
+			sharded = true;
+
+		} else if (arg == string("-P") && i + 1 < argc) {
+		/* Shard base port flag */
+			options.shardBasePort = (unsigned short) strtoul(argv[++i], NULL, 10);
+
+		} else if (arg == string("-T") && i + 1 < argc) {
+		/* Thread placement flag */
+			string definition(argv[++i]);
+			size_t colon = definition.find(':');
+			string role = definition.substr(0, colon);
+			NTThreadPlacement placement;
+
+			if (colon == string::npos ||
+			    (role != "io" && role != "scan" && role != "rpc" && role != "archive") ||
+			    !NTThreadPlacement::parse(definition.substr(colon + 1), placement)) {
+				cout << "thread placement \"" << definition << "\" is not role:key=value[:key=value]." << endl;
+				return 0;
+			}
+
+			NTThreadPlacement::set(role, placement);
+			if (role == "rpc" && placement.threads > 0) options.rpcWorkers = placement.threads;
+
+		} else if (arg == string("-F") && i + 1 < argc) {
+		/* Admission control flag */
+			string definition(argv[++i]);
+
+			if (!NTAdmissionOptions::parse(definition, options.admission)) {
+				cout << "admission \"" << definition << "\" is not key=value[:key=value]." << endl;
+				return 0;
+			}
+			if (options.admission.workers == 0) options.admission.workers = 4;
+
+		} else if (arg == string("-W") && i + 1 < argc) {
+		/* Admission weight flag */
+			string definition(argv[++i]);
+			size_t equals = definition.find('=');
+			double weight = equals == string::npos ? 0.0 : atof(definition.c_str() + equals + 1);
+
+			if (weight <= 0.0) {
+				cout << "admission weight \"" << definition << "\" is not host=weight." << endl;
+				return 0;
+			}
+
+			options.admission.weights[definition.substr(0, equals)] = weight;
+
 		} else if (arg == string("-h")) {
 		/* Help flag */	
-			cout << "Help -- executable flags -- only one accepted at a time" << endl
+			cout << "Help -- executable flags" << endl
 				 << "\t -v (verbose. prints database record names.)\n"
+				 << "\t -s <path> (control socket. accepts the console commands, one per line, on\n"
+				 << "\t            a UNIX domain socket at <path>. type help for the commands.)\n"
+				 << "\t -t (trace. records the time of each stage of requests from the start.\n"
+				 << "\t     the trace command writes them out.)\n"
+				 << "\t -H <samples> (history. the numeric scalar records keep their last\n"
+				 << "\t               <samples> values, queried through the history record.)\n"
+				 << "\t -A <directory> (archive. writes every change of the numeric scalar records\n"
+				 << "\t                 to segment files in <directory>, queried through the\n"
+				 << "\t                 archive record.)\n"
+				 << "\t -a <record> (archive only <record>. may be repeated.)\n"
+				 << "\t -D <file> (definitions. adds the records described in <file>, one per line,\n"
+				 << "\t            e.g. \"sensor[0-99] scalar:double alarm timeStamp value=0\".\n"
+				 << "\t            may be repeated.)\n"
+				 << "\t -c <name>=<expression> (calc. adds a record whose value is computed from\n"
+				 << "\t                         other records, e.g. -c \"total=(long + double) * 2\".\n"
+				 << "\t                         may be repeated.)\n"
+				 << "\t -g <record> (aggregate. record summarized by the aggregate record.\n"
+				 << "\t              default: double. \"\" leaves the aggregate record unbound.)\n"
+				 << "\t -G <seconds> (aggregate period. seconds between publications of the\n"
+				 << "\t               aggregate record's statistics. default: 1)\n"
+				 << "\t -m <record> (gather member. record published by the gather record. may be\n"
+				 << "\t              repeated. default: long and double. \"\" leaves the gather\n"
+				 << "\t              record unbound.)\n"
+				 << "\t -M <seconds> (gather period. seconds between publications of the gather\n"
+				 << "\t               record's snapshot. default: 1)\n"
+				 << "\t -i <record>.<column>=<kind> (table index. keeps a sorted or hash index over\n"
+				 << "\t                              a column of a table record, used by its queries,\n"
+				 << "\t                              e.g. -i table.questions=hash. may be repeated.)\n"
+				 << "\t -w <threads> (rpc workers. threads running the methods of the rpc record.\n"
+				 << "\t               default: 4)\n"
+				 << "\t -q <requests> (rpc queue depth. requests that may wait for a worker before\n"
+				 << "\t                further ones are refused. default: 256)\n"
+				 << "\t -T <role>:<placement> (thread placement. cpus and real time priority of the\n"
+				 << "\t                        io, scan, rpc or archive threads, and the number of\n"
+				 << "\t                        rpc workers, e.g. -T rpc:cpus=2-3:threads=2:priority=50.\n"
+				 << "\t                        may be repeated.)\n"
+				 << "\t -S <index>/<count> (shard. hosts only the records of shard <index> of the\n"
+				 << "\t                     <count> servers sharing the record set, e.g. -S 0/4.)\n"
+				 << "\t -P <port> (shard base port. shard <index> serves on <port> + <index>.\n"
+				 << "\t            default: 5080)\n"
+				 << "\t -F <limits> (admission control. rate and queue depth limits of each client\n"
+				 << "\t               connection's writes, processes and RPCs, run fairly among the connections\n"
+				 << "\t               by a pool of workers, e.g. -F rate=1000:burst=100:depth=64:workers=4.\n"
+				 << "\t               counters are published by the admission record.)\n"
+				 << "\t -W <host>=<weight> (admission weight. share of the workers given to each\n"
+				 << "\t                     connection from <host>. default: 1. may be repeated.)\n"
 				 << "\t -h (help. prints help information)\n";
 		
 			return 0;
@@ -70,12 +413,29 @@ int main (int argc, char **argv)
 	// Get the local channel provider.
 	ChannelProviderLocalPtr cpLocal = getChannelProviderLocal();
 
+	// The records are allocated, and the server threads started, on the io cpus.
+	NTThreadPlacement::applyRole("io");
+
 	// Create the normative type database that is defined locally in pv/ntDatabase.h
-	NTDatabase::create();
+	NTDatabase::create(options);
+
+	// Each shard serves on its own port, where the clients' routers expect it.
+	if (sharded) {
+		stringstream port;
+		port << options.shardBasePort + options.shardIndex;
+		epicsEnvSet("EPICS_PVAS_SERVER_PORT", port.str().c_str());
+		cout << "Serving shard " << options.shardIndex << " of " << options.shardCount
+		     << " on port " << port.str() << endl;
+	}
+
+	// Clients reach the records through admission control, if enabled.
+	NTAdmissionProviderPtr admissionProvider;
+	if (NTDatabase::getAdmission())
+		admissionProvider = NTAdmissionProvider::create(cpLocal, NTDatabase::getAdmission());
 
 	// After the records are added to the database, start the server. 
-	ServerContext::shared_pointer pvaServer =
-		startPVAServer("local", 0, true, true);
+	ServerContext::shared_pointer pvaServer = startPVAServer(
+		admissionProvider ? NTAdmissionProvider::providerName : string("local"), 0, true, true);
 	
 	// print the record names currently hosted in the database
 	if (verbosity) {
@@ -90,21 +450,19 @@ int main (int argc, char **argv)
 	// Clear the pointer.
 	master.reset();
 
-	// Wait to die.
-	string input;
-	while (true)
-	{
-		cout << "Type exit to stop: \n";
-		getline(cin, input);
-		if (input.compare("exit") == 0) 
-		{
-			break;
-		}
+	// Serve the console and the control socket until asked to stop.
+	NTControlLoopPtr loop = NTControlLoop::create(socketPath);
+	if (loop) {
+		addCommands(*loop);
+		loop->run(true);
+		loop.reset();
 	}
 
 	// Clean up so that we can exit cleanly.
 	pvaServer->shutdown();
 	pvaServer->destroy();
+	if (admissionProvider) admissionProvider->destroy();
+	NTDatabase::shutdown();
 	cpLocal->destroy();
 
 	return 0;
@@ -14,6 +14,8 @@
  *		NTTable
  *		NTAttribute
  *		NTMultiChannel
+ *		gather (NTMultiChannel)
+ *		rpc (NTURI)
  *
  *	The remaining normative types were added to the database to demonstrate their
  *	functionality. The methods required to interact with them are the same as the 
@@ -29,12 +31,15 @@
  */
 
 #include "ntDemo.h"
+#include "ntEnumChoices.h"
+#include "ntPutTracker.h"
 #include "ntScalarDemo.h"
 #include <pv/pvAccess.h>
 #include <pv/pvaClient.h>
 #include <pv/pvData.h>
 #include <pv/channelProviderLocal.h>
 #include <pv/serverContext.h>
+#include <pv/nturi.h>
 
 using namespace std;
 using namespace epics::pvData;
@@ -57,7 +62,8 @@ void printResult(const bool &result, const string &channel_name) {
 int demoRecord(
 	bool verbosity,
 	PvaClientPtr pva,
-	string const & channel_name)
+	string const & channel_name,
+	string const & provider_name)
 {
 	bool result(false);
 	
@@ -90,7 +96,19 @@ int demoRecord(
 	}
 
 	if (channel_name.compare("multi_channel") == 0) {
-		result = demoMultiChannel(verbosity, pva, channel_name);
+		result = demoMultiChannel(verbosity, pva, channel_name, provider_name);
+		printResult(result, channel_name);
+		return 0;
+	}
+
+	if (channel_name.compare("gather") == 0) {
+		result = demoGather(verbosity, pva, channel_name, provider_name);
+		printResult(result, channel_name);
+		return 0;
+	}
+
+	if (channel_name.compare("rpc") == 0) {
+		result = demoGroupPut(verbosity, pva, channel_name, provider_name);
 		printResult(result, channel_name);
 		return 0;
 	}
@@ -104,7 +122,7 @@ int demoRecord(
 	
 	} else {	
 	
-		PvaClientChannelPtr channel = pva->channel(channel_name);
+		PvaClientChannelPtr channel = pva->channel(channel_name, provider_name);
 		
 		if (channel) cout << "\nChannel \"" << channel_name << "\" connected succesfully\n";
 		else
@@ -126,33 +144,39 @@ bool demoEnum(
 {
 	bool result(true);
 
-	// Create putGet to read and write to/from record.
-	PvaClientPutGetPtr putGet = channel->createPutGet("");
+	// Create putGet to read and write the index. The choices are not part of
+	// it, they are read through the cache once per version of the list.
+	PvaClientPutGetPtr putGet = channel->createPutGet(
+		"putField(value.index)getField(value.index,choicesVersion)");
 	PvaClientPutDataPtr putData = putGet->getPutData();
 	PvaClientGetDataPtr getData = putGet->getGetData();
+	EnumChoicesCache choices(channel);
 	
-	PVStructurePtr pvStructure = putData->getPVStructure();
-	// Request copy of the choices array in the enum
-	shared_vector<const string> choices = pvStructure->getSubField<PVStringArray>("value.choices")->view();
-	// Get current index of choices array in the enum
+	putGet->getGet();
+	PVStructurePtr pvStructure = getData->getPVStructure();
+	// Get current index of choices array in the enum and the version of the array
 	int read = pvStructure->getSubField<PVInt>("value.index")->get();
+	int32 version = pvStructure->getSubField<PVInt>("choicesVersion")->get();
 	
 	stringstream out;
 	
-	out << "\n\tBefore write: enum(zero, one) = " << choices[read] << endl;
+	out << "\n\tBefore write: enum(zero, one) = " << choices.getChoice(version, read) << endl;
 	
 	
 	// Write a new index to the record.
 	int write = 1;
-	pvStructure->getSubField<PVInt>("value.index")->put(write);
+	putData->getPVStructure()->getSubField<PVInt>("value.index")->put(write);
 
 	putGet->putGet();
 
 	// Check that it changed.
 	pvStructure = getData->getPVStructure();
 	read = pvStructure->getSubField<PVInt>("value.index")->get();
+	version = pvStructure->getSubField<PVInt>("choicesVersion")->get();
 
-	out << "\t After write: enum(zero, one) = " << choices[read] << endl << endl;
+	// The version is unchanged, so the cached choices are used.
+	out << "\t After write: enum(zero, one) = " << choices.getChoice(version, read) << endl
+	    << "\t Choices read " << choices.getFetches() << " time(s)" << endl << endl;
 
 	if (read != write)
 		result = false;
@@ -241,6 +265,10 @@ bool demoURI(
 	PvaClientPutDataPtr putData = putGet->getPutData();
 	PvaClientGetDataPtr getData = putGet->getGetData();
 	
+	// Only the fields whose values differ from the record's are sent.
+	PutTracker tracker(putGet);
+	tracker.sync();
+
 	string scheme_write = "URI scheme string";
 	string path_write = "URI path string";
 	string query_write = "URI query string";
@@ -249,7 +277,7 @@ bool demoURI(
 	putData->getPVStructure()->getSubField<PVString>("scheme")->put(scheme_write);
 	putData->getPVStructure()->getSubField<PVString>("path")->put(path_write);
 	putData->getPVStructure()->getSubField<PVString>("query.query")->put(query_write);
-	putGet->putGet();
+	size_t fields_sent = tracker.putGet();
 
 	string scheme_read;
 	string path_read;
@@ -272,7 +300,8 @@ bool demoURI(
 	out << "\tread\n";
 	out << "\t\t" << setw(8) << "scheme: " << scheme_read << endl;
 	out << "\t\t" << setw(8) << "path: " << path_read << endl;
-	out << "\t\t" << setw(8) << "query: " << query_read << endl << endl;
+	out << "\t\t" << setw(8) << "query: " << query_read << endl;
+	out << "\tfields sent: " << fields_sent << endl << endl;
 
 	if (scheme_write != scheme_read ||
 		path_write != path_read ||
@@ -334,6 +363,42 @@ bool demoNameValue(
 		if (value[i] != value_read[i])
 			result = false;
 	}
+
+	// Set two and add four by name, without sending the whole arrays.
+	PvaClientPutGetPtr keyedPutGet = channel->createPutGet(
+		"record[process=true]putField(keyed.request,keyed.names,keyed.values)getField(keyed.result)");
+	PVStructurePtr keyedPut = keyedPutGet->getPutData()->getPVStructure();
+	PVIntPtr keyedRequest = keyedPut->getSubField<PVInt>("keyed.request");
+
+	shared_vector<string> key_data;
+	key_data.push_back("two");
+	key_data.push_back("four");
+	shared_vector<double> key_value_data;
+	key_value_data.push_back(20);
+	key_value_data.push_back(4);
+
+	keyedPut->getSubField<PVStringArray>("keyed.names")->replace(freeze(key_data));
+	keyedPut->getSubField<PVDoubleArray>("keyed.values")->replace(freeze(key_value_data));
+	keyedRequest->put(keyedRequest->get() + 1);
+	keyedPutGet->putGet();
+
+	// Get three and four by name.
+	key_data.push_back("three");
+	key_data.push_back("four");
+	keyedPut->getSubField<PVStringArray>("keyed.names")->replace(freeze(key_data));
+	keyedPut->getSubField<PVDoubleArray>("keyed.values")->replace(shared_vector<const double>());
+	keyedRequest->put(keyedRequest->get() + 1);
+	keyedPutGet->putGet();
+
+	shared_vector<const double> keyed_read =
+		keyedPutGet->getGetData()->getPVStructure()->getSubField<PVDoubleArray>("keyed.result")->view();
+
+	out << "\n\t three, four by name:";
+	for (size_t i = 0; i < keyed_read.size(); ++i)
+		out << setw(8) << keyed_read[i];
+	if (keyed_read.size() != 2 || keyed_read[0] != 3 || keyed_read[1] != 4)
+		result = false;
+
 	out << "\n\n";
 	
 	if (verbosity)
@@ -372,11 +437,15 @@ bool demoTable(
 	data.push_back("Drink heavily and read the guide.");
 	shared_vector<const string> recommendations(freeze(data));
 	
+	// Only the columns whose contents differ from the record's are sent.
+	PutTracker tracker(putGet);
+	tracker.sync();
+
 	// Write the vectors to the table record. These consitute the tables columns
 	putData->getPVStructure()->getSubField<PVStringArray>("value.questions")->replace(questions);
 	putData->getPVStructure()->getSubField<PVStringArray>("value.answers")->replace(answers);
 	putData->getPVStructure()->getSubField<PVStringArray>("value.recommendations")->replace(recommendations);
-	putGet->putGet();
+	size_t fields_sent = tracker.putGet();
 
 	putGet->getGetData();
 	shared_vector<const string> labels
@@ -417,6 +486,7 @@ bool demoTable(
 		if (recommendations[i] != recommendations_read[i]) 
 			result = false;
 	}
+	out << "\n\t" << setw(17) << "fields sent:" << " " << fields_sent;
 	out << "\n\n";
 
 	if (verbosity)
@@ -470,11 +540,12 @@ bool demoAttribute(
 bool demoMultiChannel(
 	bool verbosity,
 	PvaClientPtr pva,
-	const string & channel_name)
+	const string & channel_name,
+	const string & provider_name)
 {
 	bool result(true);
 	
-	PvaClientChannelPtr channel = pva->channel(channel_name);
+	PvaClientChannelPtr channel = pva->channel(channel_name, provider_name);
 	
 	if (channel) cout << "\nChannel \"" << channel_name << "\" connected succesfully\n";
 	else
@@ -485,16 +556,21 @@ bool demoMultiChannel(
 	PvaClientPutDataPtr putData = putGet->getPutData();
 	PvaClientGetDataPtr getData = putGet->getGetData();
 
+	// Only the fields whose values differ from the record's are sent,
+	// so repeating the demo with unchanged members sends nothing.
+	PutTracker tracker(putGet);
+	tracker.sync();
+
 	// Open two channels to pvRecords currently hosted on an accessible database. You must know that these exist.
 	// We're going to use two records that are already populated in our database.
-	PvaClientChannelPtr channel_long   = pva->channel("long");
+	PvaClientChannelPtr channel_long   = pva->channel("long", provider_name);
 	
 	bool long_connect = (channel_long) ? true : false;
 
 	PvaClientGetPtr long_get = channel_long->createGet();
 	PvaClientGetDataPtr long_data = long_get->getData();
 	
-	PvaClientChannelPtr channel_double = pva->channel("double");
+	PvaClientChannelPtr channel_double = pva->channel("double", provider_name);
 	
 	bool double_connect = (channel_double) ? true : false;
 	
@@ -530,11 +606,128 @@ bool demoMultiChannel(
 	putData->getPVStructure()->getSubField<PVUnionArray>("value")->replace(value);
 	putData->getPVStructure()->getSubField<PVBooleanArray>("isConnected")->replace(isConnected);
 	
-	putGet->putGet();
+	size_t fields_sent = tracker.putGet();
 	putGet->getGetData();
 
 	if (verbosity)
-		cout << getData->getPVStructure() << endl;
+		cout << getData->getPVStructure() << endl
+		     << "fields sent: " << fields_sent << endl;
+
+	return result;
+}
+
+/*
+ * The gather record does on the server what demoMultiChannel does by hand:
+ * it follows its members itself, so one monitor replaces a subscription
+ * to every member.
+ */
+bool demoGather(
+	bool verbosity,
+	PvaClientPtr pva,
+	const string & channel_name,
+	const string & provider_name)
+{
+	PvaClientChannelPtr channel = pva->channel(channel_name, provider_name);
+
+	if (channel) cout << "\nChannel \"" << channel_name << "\" connected succesfully\n";
+	else
+		return false;
+
+	PvaClientMonitorPtr monitor = channel->monitor("field(value,channelName,isConnected)");
+
+	// Write a member through its own channel.
+	PvaClientChannelPtr channel_long = pva->channel("long", provider_name);
+	PvaClientPutPtr put = channel_long->put("record[process=true]field(value)");
+
+	int64 write = rand();
+	put->getData()->getPVStructure()->getSubField<PVLong>("value")->put(write);
+	put->put();
+
+	// The change arrives with the next snapshot of every member.
+	bool result(false);
+
+	while (!result && monitor->waitEvent(5.0)) {
+
+		PVStructurePtr pvStructure = monitor->getData()->getPVStructure();
+		shared_vector<const string> names = pvStructure->getSubField<PVStringArray>("channelName")->view();
+		shared_vector<const PVUnionPtr> values = pvStructure->getSubField<PVUnionArray>("value")->view();
+		shared_vector<const boolean> connected = pvStructure->getSubField<PVBooleanArray>("isConnected")->view();
+
+		for (size_t i = 0; i < names.size() && i < values.size(); ++i) {
+			PVLongPtr value = values[i] ? values[i]->get<PVLong>() : PVLongPtr();
+
+			if (names[i] == "long" && value && value->get() == write) result = true;
+
+			if (verbosity && values[i] && values[i]->get())
+				cout << "\t" << names[i] << " = " << *values[i]->get()
+				     << (i < connected.size() && connected[i] ? "" : " (not connected)") << endl;
+		}
+
+		monitor->releaseEvent();
+	}
+
+	return result;
+}
+
+/*
+ * Writes long, double and enum with a single request to the groupPut method
+ * of the rpc record, where the demos of those records take a putGet each.
+ */
+bool demoGroupPut(
+	bool verbosity,
+	PvaClientPtr pva,
+	const string & channel_name,
+	const string & provider_name)
+{
+	PvaClientChannelPtr channel = pva->channel(channel_name, provider_name);
+
+	if (channel) cout << "\nChannel \"" << channel_name << "\" connected succesfully\n";
+	else
+		return false;
+
+	PVStructurePtr args = epics::nt::NTURI::createBuilder()->
+		addQueryInt("long")->
+		addQueryDouble("double")->
+		addQueryInt("enum")->
+		createPVStructure();
+
+	int32 write_long = rand();
+	double write_double = rand() / 3.0;
+	int32 write_index = 0;
+
+	args->getSubField<PVString>("scheme")->put("pva");
+	args->getSubField<PVString>("path")->put("groupPut");
+	args->getSubField<PVInt>("query.long")->put(write_long);
+	args->getSubField<PVDouble>("query.double")->put(write_double);
+	args->getSubField<PVInt>("query.enum")->put(write_index);
+
+	PVStructurePtr response = channel->createRPC()->request(args);
+
+	int64 seconds = response->getSubField<PVLong>("timeStamp.secondsPastEpoch")->get();
+	int32 nanoseconds = response->getSubField<PVInt>("timeStamp.nanoseconds")->get();
+
+	// Every record holds its new value, written at the same time.
+	const char *names[] = { "long", "double", "enum" };
+	const char *fields[] = { "value", "value", "value.index" };
+	double written[] = { (double) write_long, write_double, (double) write_index };
+
+	bool result(true);
+
+	for (size_t i = 0; i < 3; ++i) {
+		PvaClientGetPtr get = pva->channel(names[i], provider_name)->get("field(value,timeStamp)");
+		PVStructurePtr pvStructure = get->getData()->getPVStructure();
+
+		double read = pvStructure->getSubField<PVScalar>(fields[i])->getAs<double>();
+		bool together =
+			pvStructure->getSubField<PVLong>("timeStamp.secondsPastEpoch")->get() == seconds &&
+			pvStructure->getSubField<PVInt>("timeStamp.nanoseconds")->get() == nanoseconds;
+
+		if (verbosity)
+			cout << "\t" << names[i] << ": wrote " << written[i] << ", read " << read
+			     << (together ? "" : " (different time stamp)") << endl;
+
+		if (read != written[i] || !together) result = false;
+	}
 
 	return result;
 }
@@ -16,6 +16,8 @@
  *      NTAttribute (Name and associate value)
  *      NTMultiChannel (Aggregate structure of multiple channel
  *      			    names and values)
+ *      gather (NTMultiChannel kept up to date by the server)
+ *      rpc (group put of several records through NTURI)
  *
  * 		These functions aim to demonstrate the methods of interacting 
  * 		with the records and to demonstrate the functionality of the 
@@ -44,10 +46,13 @@ using namespace epics::pvaClient;
 
 void printResult(const bool &result, const string &channel_name);
 
+// provider_name selects the channel provider used to connect to the record:
+// "pva" goes over the network, "local" reaches an in-process database directly.
 int demoRecord(
 	bool verbosity,
 	PvaClientPtr pva,
-	string const & channel_name);
+	string const & channel_name,
+	string const & provider_name = "pva");
 
 bool demoEnum(
 	bool verbosity,
@@ -76,6 +81,19 @@ bool demoAttribute(
 bool demoMultiChannel(
 	bool verbosity,
 	PvaClientPtr pva,
-	const string & channel_name);
+	const string & channel_name,
+	const string & provider_name = "pva");
+
+bool demoGather(
+	bool verbosity,
+	PvaClientPtr pva,
+	const string & channel_name,
+	const string & provider_name = "pva");
+
+bool demoGroupPut(
+	bool verbosity,
+	PvaClientPtr pva,
+	const string & channel_name,
+	const string & provider_name = "pva");
 
 #endif /* NTDEMO_H */
@@ -0,0 +1,49 @@
+/*
+ * ==========================================================
+ *
+ *	ntEnumChoices.cpp
+ *
+ *	Source file for the client cache of enum choices.
+ *
+ * ==========================================================
+ */
+
+#include "ntEnumChoices.h"
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::pvaClient;
+
+EnumChoicesCache::EnumChoicesCache(PvaClientChannelPtr const &channel)
+	: channel(channel),
+	  fetches(0)
+{
+}
+
+shared_vector<const string> EnumChoicesCache::get(int32 &version)
+{
+	map<int32, shared_vector<const string> >::const_iterator it = choices.find(version);
+	if (it != choices.end()) return it->second;
+
+	if (!choicesGet) choicesGet = channel->createGet("field(value.choices,choicesVersion)");
+
+	choicesGet->get();
+	++fetches;
+
+	PVStructurePtr pvStructure = choicesGet->getData()->getPVStructure();
+
+	version = pvStructure->getSubField<PVInt>("choicesVersion")->get();
+	shared_vector<const string> current = pvStructure->getSubField<PVStringArray>("value.choices")->view();
+
+	choices[version] = current;
+
+	return current;
+}
+
+string EnumChoicesCache::getChoice(int32 &version, int32 index)
+{
+	shared_vector<const string> current = get(version);
+
+	if (index < 0 || (size_t) index >= current.size()) return string();
+	return current[index];
+}
@@ -0,0 +1,48 @@
+#ifndef NTENUMCHOICES_H
+#define NTENUMCHOICES_H
+
+/*
+ * ==========================================================
+ *	ntEnumChoices.h
+ *
+ *	Header file for the client cache of enum choices.
+ *
+ *	The enum record numbers each list of choices it holds
+ *	(see pv/ntEnumRecord.h). A client reads value.index and
+ *	choicesVersion, and asks the cache for the choices of
+ *	that version. The cache gets them from the record only
+ *	for a version it has not seen, so following an enum
+ *	costs two ints per update instead of the whole list.
+ *
+ * ==========================================================
+ */
+
+#include <map>
+#include <string>
+
+#include <pv/pvData.h>
+#include <pv/pvaClient.h>
+
+class EnumChoicesCache {
+	public:
+		explicit EnumChoicesCache(epics::pvaClient::PvaClientChannelPtr const &channel);
+
+		// Choices of the given version, read from the record if not cached.
+		// If the record has moved on to a later version meanwhile, the choices
+		// of that version are returned and version is updated to it.
+		epics::pvData::shared_vector<const std::string> get(epics::pvData::int32 &version);
+
+		// Name of the choice at index of the given version, empty if out of range.
+		std::string getChoice(epics::pvData::int32 &version, epics::pvData::int32 index);
+
+		// Number of times the choices were read from the record.
+		size_t getFetches() const { return fetches; }
+
+	private:
+		epics::pvaClient::PvaClientChannelPtr channel;
+		epics::pvaClient::PvaClientGetPtr choicesGet;
+		std::map<epics::pvData::int32, epics::pvData::shared_vector<const std::string> > choices;
+		size_t fetches;
+};
+
+#endif /* NTENUMCHOICES_H */
@@ -0,0 +1,77 @@
+/*
+ * =============================================================
+ *
+ * 	ntEnumRecord.cpp
+ *
+ *	Source file that implements the enum record and the
+ *	versioning of its choices.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntEnumRecord.h>
+
+#include <pv/ntenum.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::nt;
+using namespace epics::ntDatabase;
+
+PVStructurePtr NTEnumRecord::createPVStructure()
+{
+	NTEnumBuilderPtr ntEnumBuilder = NTEnum::createBuilder();
+
+	return ntEnumBuilder->
+		addAlarm()->
+		addTimeStamp()->
+		add("choicesVersion", getFieldCreate()->createScalar(pvInt))->
+		createPVStructure();
+}
+
+NTEnumRecordPtr NTEnumRecord::create(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+{
+	NTEnumRecordPtr pvRecord(new NTEnumRecord(recordName, pvStructure));
+
+	if (!pvRecord->init()) pvRecord.reset();
+
+	return pvRecord;
+}
+
+NTEnumRecord::NTEnumRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+	: NTRecord(recordName, pvStructure)
+{
+}
+
+bool NTEnumRecord::init()
+{
+	if (!NTRecord::init()) return false;
+
+	PVStructurePtr pvStructure = getPVStructure();
+
+	pvChoices = pvStructure->getSubField<PVStringArray>("value.choices");
+	pvChoicesVersion = pvStructure->getSubField<PVInt>("choicesVersion");
+
+	if (!pvChoices || !pvChoicesVersion) return false;
+
+	// The choices the record was created with are the first version.
+	versionedChoices = pvChoices->view();
+	pvChoicesVersion->put(1);
+
+	return true;
+}
+
+void NTEnumRecord::processRecord()
+{
+	shared_vector<const string> choices = pvChoices->view();
+
+	if (choices.data() == versionedChoices.data() && choices.size() == versionedChoices.size())
+		return;
+
+	versionedChoices = choices;
+	pvChoicesVersion->put(pvChoicesVersion->get() + 1);
+}
@@ -0,0 +1,227 @@
+/*
+ * =============================================================
+ *
+ * 	ntGatherRecord.cpp
+ *
+ *	Source file that implements the gather record, which
+ *	publishes the values of other records together.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntGatherRecord.h>
+
+#include <iostream>
+
+#include <pv/ntmultiChannel.h>
+#include <pv/ntProcessQueue.h>
+
+using namespace std;
+using std::tr1::dynamic_pointer_cast;
+using namespace epics::pvData;
+using namespace epics::pvDatabase;
+using namespace epics::nt;
+using namespace epics::ntDatabase;
+
+static PVDataCreatePtr pvDataCreate = getPVDataCreate();
+
+/*
+ * Listener passing each process() of a member record to the gather record.
+ * It holds the gather record weakly so that a gather record that is gone is
+ * not kept alive by its members.
+ */
+class GatherMemberListener : public NTProcessListener {
+	public:
+		GatherMemberListener(NTGatherRecordPtr const &gatherRecord, size_t member)
+			: gatherRecord(gatherRecord), member(member) {}
+
+		virtual void processed(NTRecord &record)
+		{
+			NTGatherRecordPtr gather = gatherRecord.lock();
+			if (gather) gather->update(member, record);
+		}
+
+	private:
+		std::tr1::weak_ptr<NTGatherRecord> gatherRecord;
+		size_t member;
+};
+
+PVStructurePtr NTGatherRecord::createPVStructure()
+{
+	NTMultiChannelBuilderPtr ntMultiChannelBuilder = NTMultiChannel::createBuilder();
+
+	return ntMultiChannelBuilder->
+		addSeverity()->
+		addSecondsPastEpoch()->
+		addNanoseconds()->
+		addIsConnected()->
+		addAlarm()->
+		addTimeStamp()->
+		createPVStructure();
+}
+
+NTGatherRecordPtr NTGatherRecord::create(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+{
+	NTGatherRecordPtr pvRecord(new NTGatherRecord(recordName, pvStructure));
+
+	if (!pvRecord->init()) pvRecord.reset();
+
+	return pvRecord;
+}
+
+NTGatherRecord::NTGatherRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+	: NTRecord(recordName, pvStructure),
+	  changed(false),
+	  bound(false)
+{
+}
+
+bool NTGatherRecord::init()
+{
+	if (!NTRecord::init()) return false;
+
+	PVStructurePtr pvStructure = getPVStructure();
+
+	pvChannelName = pvStructure->getSubField<PVStringArray>("channelName");
+	pvValue = pvStructure->getSubField<PVUnionArray>("value");
+	pvSeverity = pvStructure->getSubField<PVIntArray>("severity");
+	pvSecondsPastEpoch = pvStructure->getSubField<PVLongArray>("secondsPastEpoch");
+	pvNanoseconds = pvStructure->getSubField<PVIntArray>("nanoseconds");
+	pvIsConnected = pvStructure->getSubField<PVBooleanArray>("isConnected");
+
+	return pvChannelName && pvValue && pvSeverity && pvSecondsPastEpoch &&
+		pvNanoseconds && pvIsConnected;
+}
+
+bool NTGatherRecord::bind(vector<string> const &memberNames, double period)
+{
+	vector<NTRecordPtr> records(memberNames.size());
+
+	{
+		Lock lock(membersMutex);
+
+		if (bound) {
+			cerr << "Record " << getRecordName() << " already gathers its members\n";
+			return false;
+		}
+		bound = true;
+
+		members.resize(memberNames.size());
+
+		for (size_t i = 0; i < memberNames.size(); ++i) {
+			records[i] = dynamic_pointer_cast<NTRecord>(
+				PVDatabase::getMaster()->findRecord(memberNames[i]));
+
+			if (!records[i] || !records[i]->getPVStructure()->getSubField("value")) {
+				cerr << "Record " << getRecordName() << " can not gather " << memberNames[i]
+				     << ", which is not a record of the database with a value\n";
+				records[i].reset();
+			}
+
+			members[i].name = memberNames[i];
+			members[i].record = records[i];
+		}
+
+		changed = true;
+	}
+
+	NTGatherRecordPtr self = dynamic_pointer_cast<NTGatherRecord>(shared_from_this());
+
+	for (size_t i = 0; i < records.size(); ++i) {
+		if (!records[i]) continue;
+
+		records[i]->addProcessListener(NTProcessListenerPtr(new GatherMemberListener(self, i)));
+
+		// The member's state before its next process().
+		records[i]->lock();
+		update(i, *records[i]);
+		records[i]->unlock();
+	}
+
+	NTProcessQueue::get()->request(self);
+	NTProcessQueue::get()->schedule(self, period);
+
+	return true;
+}
+
+void NTGatherRecord::update(size_t member, NTRecord &record)
+{
+	PVStructurePtr pvStructure = record.getPVStructure();
+	PVFieldPtr pvField = pvStructure->getSubField("value");
+	PVIntPtr pvAlarmSeverity = pvStructure->getSubField<PVInt>("alarm.severity");
+	TimeStamp const &timeStamp = record.getTimeStamp();
+
+	Lock lock(membersMutex);
+
+	if (member >= members.size() || !pvField) return;
+
+	Member &state = members[member];
+
+	// The copy is kept between updates, so only the values are copied.
+	if (!state.value || state.value->getField() != pvField->getField())
+		state.value = pvDataCreate->createPVField(pvField->getField());
+	state.value->copyUnchecked(*pvField);
+
+	state.severity = pvAlarmSeverity ? pvAlarmSeverity->get() : 0;
+	state.secondsPastEpoch = timeStamp.getSecondsPastEpoch();
+	state.nanoseconds = timeStamp.getNanoseconds();
+
+	changed = true;
+}
+
+void NTGatherRecord::processRecord()
+{
+	Lock lock(membersMutex);
+
+	size_t count = members.size();
+
+	// A member removed from the database counts as a change.
+	shared_vector<const boolean> published = pvIsConnected->view();
+	shared_vector<boolean> isConnected(count);
+	string disconnected;
+
+	for (size_t i = 0; i < count; ++i) {
+		isConnected[i] = !members[i].record.expired();
+
+		if (!isConnected[i] && disconnected.empty()) disconnected = members[i].name;
+		if (i >= published.size() || published[i] != isConnected[i]) changed = true;
+	}
+
+	if (disconnected.empty()) clearAlarm();
+	else raiseAlarm("member " + disconnected + " is not connected");
+
+	if (!changed) return;
+	changed = false;
+
+	shared_vector<string> channelName(count);
+	shared_vector<PVUnionPtr> value(count);
+	shared_vector<int32> severity(count);
+	shared_vector<int64> secondsPastEpoch(count);
+	shared_vector<int32> nanoseconds(count);
+
+	for (size_t i = 0; i < count; ++i) {
+		Member const &state = members[i];
+
+		channelName[i] = state.name;
+
+		// Published values are shared with clients, so they are copies
+		// that later updates of the member do not touch.
+		value[i] = pvDataCreate->createPVVariantUnion();
+		if (state.value) value[i]->set(pvDataCreate->createPVField(state.value));
+
+		severity[i] = state.severity;
+		secondsPastEpoch[i] = state.secondsPastEpoch;
+		nanoseconds[i] = state.nanoseconds;
+	}
+
+	pvChannelName->replace(freeze(channelName));
+	pvValue->replace(freeze(value));
+	pvSeverity->replace(freeze(severity));
+	pvSecondsPastEpoch->replace(freeze(secondsPastEpoch));
+	pvNanoseconds->replace(freeze(nanoseconds));
+	pvIsConnected->replace(freeze(isConnected));
+}
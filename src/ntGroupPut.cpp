@@ -0,0 +1,190 @@
+/*
+ * =============================================================
+ *
+ * 	ntGroupPut.cpp
+ *
+ *	Source file that implements the RPC method writing several
+ *	records as one unit.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntGroupPut.h>
+#include <pv/ntTrace.h>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <epicsTime.h>
+#include <pv/standardField.h>
+#include <pv/pvTimeStamp.h>
+
+using namespace std;
+using std::tr1::dynamic_pointer_cast;
+using std::tr1::static_pointer_cast;
+using namespace epics::pvData;
+using namespace epics::pvDatabase;
+using namespace epics::ntDatabase;
+
+static PVDataCreatePtr pvDataCreate = getPVDataCreate();
+
+NTGroupPutPtr NTGroupPut::create(NTShardMapPtr const &shards, size_t shard)
+{
+	return NTGroupPutPtr(new NTGroupPut(shards, shard));
+}
+
+NTGroupPut::NTGroupPut(NTShardMapPtr const &shards, size_t shard)
+	: shards(shards),
+	  shard(shard)
+{
+	resultType = getFieldCreate()->createFieldBuilder()->
+		addArray("records", pvString)->
+		add("timeStamp", getStandardField()->timeStamp())->
+		createStructure();
+}
+
+NTGroupPut::Target NTGroupPut::resolve(PVFieldPtr const &pvValue)
+{
+	Target target;
+	target.name = pvValue->getFieldName();
+
+	// Another shard's record is not here to be locked with the others.
+	if (shards && shards->shardOf(target.name) != shard) {
+		stringstream reason;
+		reason << "record " << target.name << " is hosted by shard " << shards->shardOf(target.name);
+		throw runtime_error(reason.str());
+	}
+
+	target.record = dynamic_pointer_cast<NTRecord>(PVDatabase::getMaster()->findRecord(target.name));
+
+	if (!target.record)
+		throw runtime_error("no record " + target.name);
+
+	// The pvStructure of a record is fixed, so its fields are found unlocked.
+	PVStructurePtr pvStructure = target.record->getPVStructure();
+	target.pvField = pvStructure->getSubField("value");
+
+	if (target.pvField && target.pvField->getField()->getType() == structure)
+		target.pvField = pvStructure->getSubField<PVScalar>("value.index");
+
+	Type type = pvValue->getField()->getType();
+
+	if (!target.pvField || target.pvField->getField()->getType() != type || (type != scalar && type != scalarArray))
+		throw runtime_error("can not put " + target.name + " with the value given");
+
+	// Convert outside the locks, where a bad value can not leave the group half written.
+	target.pvValue = pvDataCreate->createPVField(target.pvField->getField());
+
+	if (type == scalar)
+		static_pointer_cast<PVScalar>(target.pvValue)->assign(*static_pointer_cast<PVScalar>(pvValue));
+	else
+		static_pointer_cast<PVScalarArray>(target.pvValue)->assign(*static_pointer_cast<PVScalarArray>(pvValue));
+
+	return target;
+}
+
+/*
+ * Records of a group put, locked with a group put open. However handle()
+ * is left, even by an exception from a record's processing, the records
+ * acquired are released, so none stays locked.
+ */
+class GroupLock {
+	public:
+		explicit GroupLock(size_t size) { records.reserve(size); }
+
+		~GroupLock() { release(); }
+
+		void acquire(NTRecordPtr const &record)
+		{
+			record->lock();
+
+			try {
+				record->beginGroupPut();
+			} catch (...) {
+				record->unlock();
+				throw;
+			}
+
+			records.push_back(record);
+		}
+
+		// Ends the group puts, which posts the monitors, and unlocks the
+		// records in the reverse order of acquire().
+		void release()
+		{
+			while (!records.empty()) {
+				NTRecordPtr record = records.back();
+				records.pop_back();
+
+				// Unlocking must go on, so a failure is only reported.
+				try {
+					record->endGroupPut();
+				} catch (std::exception &e) {
+					cerr << "Failed to end the group put of " << record->getRecordName() << ": " << e.what() << "\n";
+				} catch (...) {
+					cerr << "Failed to end the group put of " << record->getRecordName() << "\n";
+				}
+
+				record->unlock();
+			}
+		}
+
+	private:
+		vector<NTRecordPtr> records;
+};
+
+PVStructurePtr NTGroupPut::handle(PVStructurePtr const &query)
+{
+	if (!query || query->getPVFields().empty())
+		throw runtime_error("group put names no records");
+
+	PVFieldPtrArray const &pvValues = query->getPVFields();
+
+	vector<Target> targets;
+	targets.reserve(pvValues.size());
+
+	for (size_t i = 0; i < pvValues.size(); ++i)
+		targets.push_back(resolve(pvValues[i]));
+
+	// Field names are unique, so the order is total.
+	sort(targets.begin(), targets.end());
+
+	TimeStamp timeStamp;
+	timeStamp.getCurrent();
+
+	bool tracing = NTTrace::isEnabled();
+	epicsUInt64 start = tracing ? epicsMonotonicGet() : 0;
+
+	GroupLock group(targets.size());
+
+	for (size_t i = 0; i < targets.size(); ++i)
+		group.acquire(targets[i].record);
+
+	if (tracing) NTTrace::record("record.lock", "groupPut", start, epicsMonotonicGet());
+
+	for (size_t i = 0; i < targets.size(); ++i) {
+		targets[i].pvField->copyUnchecked(*targets[i].pvValue);
+		targets[i].record->processAt(timeStamp);
+	}
+
+	start = tracing ? epicsMonotonicGet() : 0;
+
+	group.release();
+
+	if (tracing) NTTrace::record("record.post", "groupPut", start, epicsMonotonicGet());
+
+	shared_vector<string> records(targets.size());
+	for (size_t i = 0; i < targets.size(); ++i)
+		records[i] = targets[i].name;
+
+	PVStructurePtr result = pvDataCreate->createPVStructure(resultType);
+	result->getSubField<PVStringArray>("records")->replace(freeze(records));
+
+	PVTimeStamp pvTimeStamp;
+	pvTimeStamp.attach(result->getSubField("timeStamp"));
+	pvTimeStamp.set(timeStamp);
+
+	return result;
+}
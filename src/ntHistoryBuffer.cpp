@@ -0,0 +1,152 @@
+/*
+ * =============================================================
+ *
+ * 	ntHistoryBuffer.cpp
+ *
+ *	Source file that implements the in memory history of the
+ *	normative type database records.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntHistoryBuffer.h>
+
+#include <pv/nttable.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::nt;
+using namespace epics::ntDatabase;
+
+NTHistoryBuffer::NTHistoryBuffer(size_t capacity)
+	: capacity(capacity ? capacity : 1),
+	  first(0),
+	  count(0),
+	  secondsPastEpoch(this->capacity),
+	  nanoseconds(this->capacity),
+	  values(this->capacity),
+	  severities(this->capacity),
+	  statuses(this->capacity)
+{
+}
+
+void NTHistoryBuffer::append(
+	double value,
+	int64 seconds,
+	int32 nsec,
+	int32 severity,
+	int32 status)
+{
+	Lock lock(mutex);
+
+	size_t position;
+
+	if (count < capacity) {
+		position = slot(count);
+		++count;
+	} else {
+		// Overwrite the oldest sample.
+		position = first;
+		first = (first + 1) % capacity;
+	}
+
+	secondsPastEpoch[position] = seconds;
+	nanoseconds[position] = nsec;
+	values[position] = value;
+	severities[position] = severity;
+	statuses[position] = status;
+}
+
+size_t NTHistoryBuffer::getSize() const
+{
+	Lock lock(mutex);
+	return count;
+}
+
+StructureConstPtr NTHistoryBuffer::createResultField()
+{
+	return NTTable::createBuilder()->
+		addColumn("secondsPastEpoch", pvLong)->
+		addColumn("nanoseconds", pvInt)->
+		addColumn("value", pvDouble)->
+		addColumn("severity", pvInt)->
+		addColumn("status", pvInt)->
+		createStructure();
+}
+
+double NTHistoryBuffer::timeAt(size_t index) const
+{
+	size_t position = slot(index);
+	return secondsPastEpoch[position] + nanoseconds[position] * 1e-9;
+}
+
+size_t NTHistoryBuffer::lowerBound(double time) const
+{
+	size_t low = 0;
+	size_t high = count;
+
+	while (low < high) {
+		size_t middle = low + (high - low) / 2;
+		if (timeAt(middle) < time) low = middle + 1;
+		else high = middle;
+	}
+
+	return low;
+}
+
+size_t NTHistoryBuffer::upperBound(double time) const
+{
+	size_t low = 0;
+	size_t high = count;
+
+	while (low < high) {
+		size_t middle = low + (high - low) / 2;
+		if (timeAt(middle) <= time) low = middle + 1;
+		else high = middle;
+	}
+
+	return low;
+}
+
+size_t NTHistoryBuffer::query(
+	double start,
+	double end,
+	size_t maxPoints,
+	PVStructurePtr const &result) const
+{
+	Lock lock(mutex);
+
+	// Binary search the time column for the range.
+	size_t begin = lowerBound(start);
+	size_t stop = upperBound(end);
+	if (stop < begin) stop = begin;
+
+	size_t matched = stop - begin;
+	size_t returned = (maxPoints && matched > maxPoints) ? maxPoints : matched;
+
+	shared_vector<int64> seconds(returned);
+	shared_vector<int32> nsec(returned);
+	shared_vector<double> value(returned);
+	shared_vector<int32> severity(returned);
+	shared_vector<int32> status(returned);
+
+	for (size_t i = 0; i < returned; ++i) {
+		// Evenly spaced samples when decimating, every sample otherwise.
+		size_t index = begin + (returned == matched ? i : (i * matched) / returned);
+		size_t position = slot(index);
+
+		seconds[i] = secondsPastEpoch[position];
+		nsec[i] = nanoseconds[position];
+		value[i] = values[position];
+		severity[i] = severities[position];
+		status[i] = statuses[position];
+	}
+
+	result->getSubField<PVLongArray>("value.secondsPastEpoch")->replace(freeze(seconds));
+	result->getSubField<PVIntArray>("value.nanoseconds")->replace(freeze(nsec));
+	result->getSubField<PVDoubleArray>("value.value")->replace(freeze(value));
+	result->getSubField<PVIntArray>("value.severity")->replace(freeze(severity));
+	result->getSubField<PVIntArray>("value.status")->replace(freeze(status));
+
+	return returned;
+}
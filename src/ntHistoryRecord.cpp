@@ -0,0 +1,120 @@
+/*
+ * =============================================================
+ *
+ * 	ntHistoryRecord.cpp
+ *
+ *	Source file that implements the record serving queries of
+ *	the history kept by the scalar records.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntHistoryRecord.h>
+
+#include <limits>
+#include <stdexcept>
+
+#include <pv/ntScalarRecord.h>
+
+using namespace std;
+using std::tr1::dynamic_pointer_cast;
+using namespace epics::pvData;
+using namespace epics::pvDatabase;
+using namespace epics::ntDatabase;
+
+PVStructurePtr NTHistoryRecord::createPVStructure()
+{
+	StructureConstPtr argument = getFieldCreate()->createFieldBuilder()->
+		add("record", pvString)->
+		add("start", pvDouble)->
+		add("end", pvDouble)->
+		add("maxPoints", pvInt)->
+		createStructure();
+
+	return NTServiceRecord::createPVStructure(argument, NTHistoryBuffer::createResultField());
+}
+
+NTHistoryRecordPtr NTHistoryRecord::create(string const &recordName)
+{
+	NTHistoryRecordPtr pvRecord(new NTHistoryRecord(recordName, createPVStructure()));
+
+	if (!pvRecord->init()) pvRecord.reset();
+
+	return pvRecord;
+}
+
+NTHistoryRecord::NTHistoryRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+	: NTServiceRecord(recordName, pvStructure)
+{
+}
+
+bool NTHistoryRecord::init()
+{
+	if (!NTServiceRecord::init()) return false;
+
+	// Label the result columns once.
+	shared_vector<string> labels(5);
+	labels[0] = "secondsPastEpoch";
+	labels[1] = "nanoseconds";
+	labels[2] = "value";
+	labels[3] = "severity";
+	labels[4] = "status";
+
+	PVStringArrayPtr pvLabels = pvResult->getSubField<PVStringArray>("labels");
+	if (!pvLabels) return false;
+	pvLabels->replace(freeze(labels));
+
+	return true;
+}
+
+void NTHistoryRecord::execute(
+	PVStructurePtr const &argument,
+	PVStructurePtr const &result)
+{
+	string recordName = argument->getSubField<PVString>("record")->get();
+	double start = argument->getSubField<PVDouble>("start")->get();
+	double end = argument->getSubField<PVDouble>("end")->get();
+	int32 maxPoints = argument->getSubField<PVInt>("maxPoints")->get();
+
+	if (maxPoints < 0)
+		throw runtime_error("maxPoints is negative");
+
+	if (end <= 0.0) end = numeric_limits<double>::max();
+
+	query(recordName, start, end, maxPoints, result);
+}
+
+void NTHistoryRecord::clearResult(PVStructurePtr const &result)
+{
+	PVStructurePtr pvColumns = result->getSubField<PVStructure>("value");
+	if (!pvColumns) return;
+
+	PVFieldPtrArray const &columns = pvColumns->getPVFields();
+
+	for (size_t i = 0; i < columns.size(); ++i) {
+		PVScalarArrayPtr pvColumn = dynamic_pointer_cast<PVScalarArray>(columns[i]);
+		if (pvColumn && pvColumn->getLength() > 0) pvColumn->setLength(0);
+	}
+}
+
+void NTHistoryRecord::query(
+	string const &recordName,
+	double start,
+	double end,
+	size_t maxPoints,
+	PVStructurePtr const &result)
+{
+	NTScalarRecordPtr pvRecord =
+		dynamic_pointer_cast<NTScalarRecord>(PVDatabase::getMaster()->findRecord(recordName));
+
+	NTHistoryBufferPtr history;
+	if (pvRecord) history = pvRecord->getHistory();
+
+	if (!history)
+		throw runtime_error("record " + recordName + " keeps no history");
+
+	// The history has its own lock, so the queried record is not locked.
+	history->query(start, end, maxPoints, result);
+}
@@ -0,0 +1,73 @@
+/*
+ * =============================================================
+ *
+ * 	ntMatrixKernels.cpp
+ *
+ *	Source file that implements the linear algebra kernels of
+ *	the matrix record.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntMatrixKernels.h>
+
+#include <algorithm>
+
+using namespace std;
+using namespace epics::ntDatabase;
+
+void NTMatrixKernels::copyBlock(
+	double const *matrix, size_t matrixColumns,
+	size_t row, size_t column,
+	size_t rows, size_t columns,
+	double *out)
+{
+	for (size_t i = 0; i < rows; ++i) {
+		double const *from = matrix + (row + i) * matrixColumns + column;
+		copy(from, from + columns, out + i * columns);
+	}
+}
+
+void NTMatrixKernels::transpose(
+	double const *matrix, size_t rows, size_t columns,
+	double *out)
+{
+	for (size_t i0 = 0; i0 < rows; i0 += tileSize) {
+		size_t i1 = min(i0 + tileSize, rows);
+
+		for (size_t j0 = 0; j0 < columns; j0 += tileSize) {
+			size_t j1 = min(j0 + tileSize, columns);
+
+			for (size_t i = i0; i < i1; ++i) {
+				for (size_t j = j0; j < j1; ++j)
+					out[j * rows + i] = matrix[i * columns + j];
+			}
+		}
+	}
+}
+
+void NTMatrixKernels::multiply(
+	double const *matrix, size_t rows, size_t columns,
+	double const *vector,
+	double *out)
+{
+	size_t unrolled = columns - columns % 4;
+
+	for (size_t i = 0; i < rows; ++i) {
+		double const *row = matrix + i * columns;
+
+		double sum0 = 0.0, sum1 = 0.0, sum2 = 0.0, sum3 = 0.0;
+
+		for (size_t j = 0; j < unrolled; j += 4) {
+			sum0 += row[j] * vector[j];
+			sum1 += row[j + 1] * vector[j + 1];
+			sum2 += row[j + 2] * vector[j + 2];
+			sum3 += row[j + 3] * vector[j + 3];
+		}
+
+		for (size_t j = unrolled; j < columns; ++j)
+			sum0 += row[j] * vector[j];
+
+		out[i] = (sum0 + sum1) + (sum2 + sum3);
+	}
+}
@@ -0,0 +1,212 @@
+/*
+ * =============================================================
+ *
+ * 	ntMatrixRecord.cpp
+ *
+ *	Source file that implements the matrix record and the
+ *	operations it computes on request.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntMatrixRecord.h>
+
+#include <stdexcept>
+
+#include <pv/ntmatrix.h>
+#include <pv/ntMatrixKernels.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::nt;
+using namespace epics::ntDatabase;
+
+// Whether two arrays are the same array, rather than equal ones.
+template<typename T>
+static bool sameArray(shared_vector<const T> const &a, shared_vector<const T> const &b)
+{
+	return a.data() == b.data() && a.size() == b.size();
+}
+
+bool NTMatrixRecord::Operation::operator==(Operation const &other) const
+{
+	return name == other.name && row == other.row && column == other.column &&
+		rows == other.rows && columns == other.columns &&
+		sameArray(matrix, other.matrix) && sameArray(dim, other.dim) &&
+		sameArray(vector, other.vector);
+}
+
+PVStructurePtr NTMatrixRecord::createPVStructure()
+{
+	StructureConstPtr operation = getFieldCreate()->createFieldBuilder()->
+		add("name", pvString)->
+		add("row", pvInt)->
+		add("column", pvInt)->
+		add("rows", pvInt)->
+		add("columns", pvInt)->
+		addArray("vector", pvDouble)->
+		addArray("value", pvDouble)->
+		addArray("dim", pvInt)->
+		createStructure();
+
+	NTMatrixBuilderPtr ntMatrixBuilder = NTMatrix::createBuilder();
+
+	return ntMatrixBuilder->
+		addDim()->          // Adds dimension field to the matrix. This will define the number 
+							// of columns and rows in the matrix.
+		addAlarm()->
+		addTimeStamp()->
+		add("operation", operation)->
+		createPVStructure();
+}
+
+NTMatrixRecordPtr NTMatrixRecord::create(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+{
+	NTMatrixRecordPtr pvRecord(new NTMatrixRecord(recordName, pvStructure));
+
+	if (!pvRecord->init()) pvRecord.reset();
+
+	return pvRecord;
+}
+
+NTMatrixRecord::NTMatrixRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+	: NTRecord(recordName, pvStructure)
+{
+}
+
+bool NTMatrixRecord::init()
+{
+	if (!NTRecord::init()) return false;
+
+	PVStructurePtr pvStructure = getPVStructure();
+
+	pvValue = pvStructure->getSubField<PVDoubleArray>("value");
+	pvDim = pvStructure->getSubField<PVIntArray>("dim");
+	pvOperation = pvStructure->getSubField<PVStructure>("operation");
+	pvResult = pvStructure->getSubField<PVDoubleArray>("operation.value");
+	pvResultDim = pvStructure->getSubField<PVIntArray>("operation.dim");
+
+	return pvValue && pvDim && pvOperation && pvResult && pvResultDim;
+}
+
+void NTMatrixRecord::processRecord()
+{
+	Operation operation;
+	operation.name = pvOperation->getSubField<PVString>("name")->get();
+	operation.row = pvOperation->getSubField<PVInt>("row")->get();
+	operation.column = pvOperation->getSubField<PVInt>("column")->get();
+	operation.rows = pvOperation->getSubField<PVInt>("rows")->get();
+	operation.columns = pvOperation->getSubField<PVInt>("columns")->get();
+	operation.vector = pvOperation->getSubField<PVDoubleArray>("vector")->view();
+	operation.matrix = pvValue->view();
+	operation.dim = pvDim->view();
+
+	// Puts replace arrays, so unchanged arrays mean an unchanged result.
+	if (operation == computed) return;
+
+	shared_vector<double> value;
+	shared_vector<int32> resultDim;
+
+	try {
+		execute(operation, value, resultDim);
+		clearAlarm();
+	} catch (std::exception &e) {
+		value.clear();
+		resultDim.clear();
+		raiseAlarm(e.what());
+	}
+
+	pvResult->replace(freeze(value));
+	pvResultDim->replace(freeze(resultDim));
+
+	computed = operation;
+}
+
+void NTMatrixRecord::execute(
+	Operation const &operation,
+	shared_vector<double> &value,
+	shared_vector<int32> &resultDim)
+{
+	if (operation.name.empty()) return;
+
+	if (operation.dim.size() > 2)
+		throw runtime_error("dim does not match value");
+
+	// Checked before the conversion to size_t, which would wrap them.
+	for (size_t i = 0; i < operation.dim.size(); ++i) {
+		if (operation.dim[i] <= 0)
+			throw runtime_error("dim must be positive");
+	}
+
+	// A matrix without dim, or with one dimension, is a column.
+	size_t rows = operation.dim.empty() ? operation.matrix.size() : operation.dim[0];
+	size_t columns = operation.dim.size() < 2 ? 1 : operation.dim[1];
+
+	// In 64 bits, where the product of two int32 can not wrap.
+	if ((uint64) rows * columns != operation.matrix.size())
+		throw runtime_error("dim does not match value");
+
+	double const *matrix = operation.matrix.data();
+
+	// Signed, so that negative operands are caught by the range check.
+	long row = operation.row;
+	long column = operation.column;
+	long blockRows = operation.rows;
+	long blockColumns = operation.columns;
+
+	if (operation.name == "row") {
+		column = 0;
+		blockRows = 1;
+		blockColumns = columns;
+	} else if (operation.name == "column") {
+		row = 0;
+		blockRows = rows;
+		blockColumns = 1;
+	}
+
+	if (operation.name == "row" || operation.name == "column" || operation.name == "block") {
+
+		if (row < 0 || column < 0 || blockRows < 0 || blockColumns < 0)
+			throw runtime_error("operation is outside of the matrix");
+
+		// Compared without adding, which could overflow a 32 bit long.
+		if ((size_t) row > rows || (size_t) blockRows > rows - (size_t) row ||
+		    (size_t) column > columns || (size_t) blockColumns > columns - (size_t) column)
+			throw runtime_error("operation is outside of the matrix");
+
+		value.resize(blockRows * blockColumns);
+		NTMatrixKernels::copyBlock(matrix, columns, row, column, blockRows, blockColumns, value.data());
+
+		resultDim.resize(2);
+		resultDim[0] = blockRows;
+		resultDim[1] = blockColumns;
+
+	} else if (operation.name == "transpose") {
+
+		value.resize(rows * columns);
+		NTMatrixKernels::transpose(matrix, rows, columns, value.data());
+
+		resultDim.resize(2);
+		resultDim[0] = columns;
+		resultDim[1] = rows;
+
+	} else if (operation.name == "multiply") {
+
+		if (operation.vector.size() != columns)
+			throw runtime_error("vector does not have one element per column");
+
+		value.resize(rows);
+		NTMatrixKernels::multiply(matrix, rows, columns, operation.vector.data(), value.data());
+
+		resultDim.resize(2);
+		resultDim[0] = rows;
+		resultDim[1] = 1;
+
+	} else {
+		throw runtime_error("unknown operation " + operation.name);
+	}
+}
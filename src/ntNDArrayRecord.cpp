@@ -0,0 +1,66 @@
+/*
+ * =============================================================
+ *
+ * 	ntNDArrayRecord.cpp
+ *
+ *	Source file that implements the NTNDArray record of the
+ *	normative type database and its chunked reads.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntNDArrayRecord.h>
+
+#include <pv/ntndarray.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::nt;
+using namespace epics::ntDatabase;
+
+PVStructurePtr NTNDArrayRecord::createPVStructure()
+{
+	// The chunk carries the same union of arrays as the value field.
+	StructureConstPtr ntNDArray = NTNDArray::createBuilder()->createStructure();
+
+	NTNDArrayBuilderPtr ntNDArrayBuilder = NTNDArray::createBuilder();
+
+	return ntNDArrayBuilder->
+		add("chunk", NTArrayChunk::createField(ntNDArray->getField("value")))->
+		createPVStructure();
+}
+
+NTNDArrayRecordPtr NTNDArrayRecord::create(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+{
+	NTNDArrayRecordPtr pvRecord(new NTNDArrayRecord(recordName, pvStructure));
+
+	if (!pvRecord->init()) pvRecord.reset();
+
+	return pvRecord;
+}
+
+NTNDArrayRecord::NTNDArrayRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+	: NTRecord(recordName, pvStructure)
+{
+}
+
+bool NTNDArrayRecord::init()
+{
+	if (!NTRecord::init()) return false;
+
+	PVStructurePtr pvStructure = getPVStructure();
+
+	pvValue = pvStructure->getSubField<PVUnion>("value");
+	if (!pvValue) return false;
+
+	return chunk.attach(pvStructure->getSubField<PVStructure>("chunk"));
+}
+
+void NTNDArrayRecord::processRecord()
+{
+	chunk.serve(pvValue);
+}
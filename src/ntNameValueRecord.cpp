@@ -0,0 +1,180 @@
+/*
+ * =============================================================
+ *
+ * 	ntNameValueRecord.cpp
+ *
+ *	Source file that implements the name value record and its
+ *	gets and sets by name.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntNameValueRecord.h>
+
+#include <algorithm>
+#include <limits>
+
+#include <pv/ntnameValue.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::nt;
+using namespace epics::ntDatabase;
+
+PVStructurePtr NTNameValueRecord::createPVStructure()
+{
+	StructureConstPtr keyed = getFieldCreate()->createFieldBuilder()->
+		add("request", pvInt)->
+		addArray("names", pvString)->
+		addArray("values", pvDouble)->
+		addArray("result", pvDouble)->
+		createStructure();
+
+	NTNameValueBuilderPtr ntNameValueBuilder = NTNameValue::createBuilder();
+
+	return ntNameValueBuilder->
+		value(pvDouble)->
+		addAlarm()->
+		addTimeStamp()->
+		add("keyed", keyed)->
+		createPVStructure();
+}
+
+NTNameValueRecordPtr NTNameValueRecord::create(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+{
+	NTNameValueRecordPtr pvRecord(new NTNameValueRecord(recordName, pvStructure));
+
+	if (!pvRecord->init()) pvRecord.reset();
+
+	return pvRecord;
+}
+
+NTNameValueRecord::NTNameValueRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+	: NTRecord(recordName, pvStructure),
+	  appliedRequest(0)
+{
+}
+
+bool NTNameValueRecord::init()
+{
+	if (!NTRecord::init()) return false;
+
+	PVStructurePtr pvStructure = getPVStructure();
+
+	pvName = pvStructure->getSubField<PVStringArray>("name");
+	pvValue = pvStructure->getSubField<PVDoubleArray>("value");
+	pvKeyedRequest = pvStructure->getSubField<PVInt>("keyed.request");
+	pvKeyedNames = pvStructure->getSubField<PVStringArray>("keyed.names");
+	pvKeyedValues = pvStructure->getSubField<PVDoubleArray>("keyed.values");
+	pvKeyedResult = pvStructure->getSubField<PVDoubleArray>("keyed.result");
+
+	return pvName && pvValue && pvKeyedRequest && pvKeyedNames && pvKeyedValues && pvKeyedResult;
+}
+
+void NTNameValueRecord::processRecord()
+{
+	// A put of name replaces the array, so the index is rebuilt only then.
+	shared_vector<const string> names = pvName->view();
+	if (names.data() != indexedNames.data() || names.size() != indexedNames.size()) {
+		index.build(names);
+		indexedNames = names;
+	}
+	names.clear();
+
+	shared_vector<const string> keys = pvKeyedNames->view();
+	if (keys.empty()) return;
+
+	shared_vector<const double> values = pvKeyedValues->view();
+
+	if (!values.empty() && values.size() != keys.size()) {
+		raiseAlarm("keyed.values must be empty or hold one value per name");
+		return;
+	}
+
+	// A set is applied once, and again only for new arrays or a new request
+	// number, so that processing the record for another reason does not
+	// write the values of an old set over newer ones. Puts replace arrays,
+	// so a new one is told apart by its address.
+	int32 request = pvKeyedRequest->get();
+	bool newRequest = keys.data() != appliedNames.data() ||
+		values.data() != appliedValues.data() || request != appliedRequest;
+
+	if (!values.empty() && newRequest) set(keys, values);
+
+	appliedNames = keys;
+	appliedValues = values;
+	appliedRequest = request;
+
+	// The result is refreshed on every process, so a repeated get returns
+	// the current values.
+	shared_vector<const double> value = pvValue->view();
+	shared_vector<double> result(keys.size());
+	string unknown;
+
+	for (size_t i = 0; i < keys.size(); ++i) {
+
+		int32 position = index.find(keys[i]);
+
+		if (position >= 0 && (size_t) position < value.size()) {
+			result[i] = value[position];
+		} else {
+			result[i] = numeric_limits<double>::quiet_NaN();
+			if (unknown.empty()) unknown = keys[i];
+		}
+	}
+
+	pvKeyedResult->replace(freeze(result));
+
+	if (unknown.empty()) clearAlarm();
+	else raiseAlarm("unknown name " + unknown);
+}
+
+/*
+ * reuse() takes the arrays back from their fields without a copy when the
+ * field holds the only reference, so the values are written in place. The
+ * name array is held by the index's record of it, so it is copied, but only
+ * when names are added.
+ */
+void NTNameValueRecord::set(
+	shared_vector<const string> const &names,
+	shared_vector<const double> const &values)
+{
+	shared_vector<double> value(pvValue->reuse());
+	shared_vector<string> name;
+	bool added(false);
+
+	size_t nameCount = indexedNames.size();
+	if (value.size() < nameCount) value.resize(nameCount);
+
+	for (size_t i = 0; i < names.size(); ++i) {
+
+		int32 position = index.find(names[i]);
+
+		if (position < 0) {
+			if (!added) {
+				indexedNames.clear();
+				name = pvName->reuse();
+				added = true;
+			}
+
+			position = name.size();
+			name.push_back(names[i]);
+			index.insert(names[i], position);
+
+			if (value.size() <= (size_t) position) value.resize(position + 1);
+		}
+
+		value[position] = values[i];
+	}
+
+	pvValue->replace(freeze(value));
+
+	if (added) {
+		pvName->replace(freeze(name));
+		indexedNames = pvName->view();
+	}
+}
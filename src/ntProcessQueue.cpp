@@ -0,0 +1,182 @@
+/*
+ * =============================================================
+ *
+ * 	ntProcessQueue.cpp
+ *
+ *	Source file that implements the thread processing records
+ *	on behalf of the records they depend on.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntProcessQueue.h>
+#include <pv/ntThreadPlacement.h>
+#include <pv/ntTrace.h>
+
+#include <iostream>
+#include <stdexcept>
+
+#include <epicsTime.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::ntDatabase;
+
+NTProcessQueuePtr NTProcessQueue::get()
+{
+	static Mutex mutex;
+	static NTProcessQueuePtr processQueue;
+
+	Lock lock(mutex);
+
+	if (!processQueue) {
+		processQueue.reset(new NTProcessQueue());
+		processQueue->thread.start();
+	}
+
+	return processQueue;
+}
+
+NTProcessQueue::NTProcessQueue()
+	: stopping(false),
+	  thread(*this, "ntProcessQueue",
+		epicsThreadGetStackSize(epicsThreadStackMedium),
+		epicsThreadPriorityMedium)
+{
+}
+
+NTProcessQueue::~NTProcessQueue()
+{
+	stop();
+}
+
+void NTProcessQueue::enqueue(NTRecordPtr const &record)
+{
+	if (queued.insert(record.get()).second) queue.push_back(record);
+}
+
+void NTProcessQueue::request(NTRecordPtr const &record)
+{
+	{
+		Lock lock(mutex);
+
+		if (stopping || queued.count(record.get())) return;
+		enqueue(record);
+	}
+
+	wakeUp.signal();
+}
+
+void NTProcessQueue::schedule(NTRecordPtr const &record, double period)
+{
+	if (period <= 0.0) return;
+
+	Scheduled entry;
+	entry.record = record;
+	entry.period = (epicsUInt64) (period * 1e9);
+	entry.due = epicsMonotonicGet() + entry.period;
+
+	{
+		Lock lock(mutex);
+		if (stopping) return;
+		scheduled.push_back(entry);
+	}
+
+	// Let the thread shorten its wait if this record is due first.
+	wakeUp.signal();
+}
+
+double NTProcessQueue::queueScheduled()
+{
+	if (scheduled.empty()) return -1.0;
+
+	epicsUInt64 now = epicsMonotonicGet();
+	epicsUInt64 next = 0;
+	bool any = false;
+
+	for (size_t i = 0; i < scheduled.size();) {
+
+		Scheduled &entry = scheduled[i];
+		NTRecordPtr record = entry.record.lock();
+
+		if (!record) {
+			scheduled.erase(scheduled.begin() + i);
+			continue;
+		}
+
+		if (now >= entry.due) {
+			enqueue(record);
+			entry.due += entry.period;
+			// After a stall, skip the periods missed rather than catch up.
+			if (entry.due <= now) entry.due = now + entry.period;
+		}
+
+		if (!any || entry.due < next) next = entry.due;
+		any = true;
+		++i;
+	}
+
+	return any ? (next - now) / 1e9 : -1.0;
+}
+
+void NTProcessQueue::stop()
+{
+	{
+		Lock lock(mutex);
+		if (stopping) return;
+		stopping = true;
+	}
+
+	wakeUp.signal();
+	thread.exitWait();
+}
+
+void NTProcessQueue::run()
+{
+	NTThreadPlacement::applyRole("scan");
+
+	while (true) {
+
+		NTRecordPtr record;
+		double timeout;
+
+		{
+			Lock lock(mutex);
+
+			timeout = queueScheduled();
+
+			if (queue.empty()) {
+				if (stopping) break;
+			} else {
+				record = queue.front();
+				queue.pop_front();
+				// Changes made from here on queue the record again.
+				queued.erase(record.get());
+			}
+		}
+
+		if (!record) {
+			if (timeout < 0.0) wakeUp.wait();
+			else wakeUp.wait(timeout);
+			continue;
+		}
+
+		bool tracing = NTTrace::isEnabled();
+		epicsUInt64 start = tracing ? epicsMonotonicGet() : 0;
+
+		record->lock();
+		if (tracing) NTTrace::record("record.lock", record->getRecordName(), start, epicsMonotonicGet());
+		record->beginGroupPut();
+
+		try {
+			record->process();
+		} catch (std::exception &e) {
+			cerr << "Failed to process record " << record->getRecordName() << ": " << e.what() << "\n";
+		}
+
+		start = tracing ? epicsMonotonicGet() : 0;
+		record->endGroupPut();
+		if (tracing) NTTrace::record("record.post", record->getRecordName(), start, epicsMonotonicGet());
+		record->unlock();
+	}
+}
@@ -0,0 +1,125 @@
+/*
+ * ==========================================================
+ *
+ *	ntPutTracker.cpp
+ *
+ *	Source file for incremental puts from clients.
+ *
+ * ==========================================================
+ */
+
+#include "ntPutTracker.h"
+
+#include <vector>
+
+#include <epicsEndian.h>
+#include <pv/serialize.h>
+
+using namespace std;
+using std::tr1::static_pointer_cast;
+using namespace epics::pvData;
+using namespace epics::pvaClient;
+
+PutTracker::PutTracker(PvaClientPutGetPtr const &putGet)
+	: putGetPtr(putGet)
+{
+	PvaClientPutDataPtr putData = putGetPtr->getPutData();
+
+	pvStructure = putData->getPVStructure();
+	bitSet = putData->getChangedBitSet();
+	shadow = getPVDataCreate()->createPVStructure(pvStructure);
+}
+
+PVFieldPtr PutTracker::getSubField(PVStructurePtr const &pvStructure, size_t offset) const
+{
+	if (offset == 0) return pvStructure;
+	return pvStructure->getSubField(offset);
+}
+
+void PutTracker::sync()
+{
+	putGetPtr->getPut();
+
+	shadow->copyUnchecked(*pvStructure);
+	bitSet->clear();
+}
+
+void PutTracker::refineField(PVFieldPtr const &pvField, PVFieldPtr const &shadowField)
+{
+	if (*pvField == *shadowField) return;
+
+	// A changed structure is narrowed down to the subfields that differ.
+	if (pvField->getField()->getType() == structure) {
+
+		PVFieldPtrArray const &pvFields = static_pointer_cast<PVStructure>(pvField)->getPVFields();
+		PVFieldPtrArray const &shadowFields = static_pointer_cast<PVStructure>(shadowField)->getPVFields();
+
+		for (size_t i = 0; i < pvFields.size(); ++i)
+			refineField(pvFields[i], shadowFields[i]);
+
+		return;
+	}
+
+	bitSet->set(pvField->getFieldOffset());
+}
+
+size_t PutTracker::refine()
+{
+	BitSet pending(*bitSet);
+	bitSet->clear();
+
+	int32 offset = pending.nextSetBit(0);
+
+	while (offset >= 0) {
+
+		PVFieldPtr pvField = getSubField(pvStructure, offset);
+		PVFieldPtr shadowField = getSubField(shadow, offset);
+
+		refineField(pvField, shadowField);
+
+		// Subfields of a structure were handled along with it.
+		offset = pending.nextSetBit(pvField->getNextFieldOffset());
+	}
+
+	return bitSet->cardinality();
+}
+
+size_t PutTracker::putGet()
+{
+	size_t count = refine();
+
+	// Nothing to send, but callers still expect fresh get data.
+	if (count == 0) {
+		putGetPtr->getGet();
+		return 0;
+	}
+
+	// Remember what is being sent before pvaClient resets the bitset.
+	BitSet sent(*bitSet);
+
+	putGetPtr->putGet();
+
+	for (int32 offset = sent.nextSetBit(0); offset >= 0; offset = sent.nextSetBit(offset + 1))
+		getSubField(shadow, offset)->copyUnchecked(*getSubField(pvStructure, offset));
+
+	return count;
+}
+
+size_t putPayloadSize(PVStructurePtr const &pvStructure, BitSetPtr const &bitSet)
+{
+	vector<epicsUInt8> buffer;
+
+	serializeToVector(bitSet.get(), EPICS_BYTE_ORDER, buffer);
+	size_t size = buffer.size();
+
+	for (int32 offset = bitSet->nextSetBit(0); offset >= 0; offset = bitSet->nextSetBit(offset + 1)) {
+
+		PVFieldPtr pvField = (offset == 0) ? PVFieldPtr(pvStructure) : pvStructure->getSubField(offset);
+
+		buffer.clear();
+		serializeToVector(pvField.get(), EPICS_BYTE_ORDER, buffer);
+		size += buffer.size();
+	}
+
+	return size;
+}
@@ -0,0 +1,71 @@
+#ifndef NTPUTTRACKER_H
+#define NTPUTTRACKER_H
+
+/*
+ * ==========================================================
+ *	ntPutTracker.h
+ *
+ *	Header file for incremental puts from clients.
+ *
+ *	pvaClient marks a field of the put structure as changed
+ *	whenever it is written, even if the new value equals the
+ *	old one, so a demo that rewrites a whole structure sends
+ *	the whole structure. A PutTracker remembers the values last
+ *	exchanged with the server. Before each put it clears the
+ *	changed bits of fields whose value did not change and
+ *	narrows changed structures down to the subfields that differ.
+ *
+ *	The server copies only the fields named by the bitset into
+ *	the record and only those are posted to monitors, so the
+ *	cost of a put follows what was modified rather than the
+ *	size of the record.
+ *
+ * ==========================================================
+ */
+
+#include <pv/pvData.h>
+#include <pv/bitSet.h>
+#include <pv/pvaClient.h>
+
+class PutTracker {
+	public:
+		explicit PutTracker(epics::pvaClient::PvaClientPutGetPtr const &putGet);
+
+		// Structure to write the new values into.
+		epics::pvData::PVStructurePtr getPVStructure() const { return pvStructure; }
+		epics::pvData::BitSetPtr getChangedBitSet() const { return bitSet; }
+
+		// Reads the current values from the server and drops pending changes.
+		void sync();
+
+		// Removes unmodified fields from the changed bitset.
+		// Returns the number of fields left to send.
+		size_t refine();
+
+		// refine() followed by a putGet of what is left, or by a get
+		// alone if nothing changed. Returns the number of fields sent.
+		size_t putGet();
+
+	private:
+		void refineField(
+			epics::pvData::PVFieldPtr const &pvField,
+			epics::pvData::PVFieldPtr const &shadowField);
+
+		epics::pvData::PVFieldPtr getSubField(
+			epics::pvData::PVStructurePtr const &pvStructure,
+			size_t offset) const;
+
+		epics::pvaClient::PvaClientPutGetPtr putGetPtr;
+		epics::pvData::PVStructurePtr pvStructure;
+		// Values last known to be held by the server.
+		epics::pvData::PVStructurePtr shadow;
+		epics::pvData::BitSetPtr bitSet;
+};
+
+// Number of bytes a put of the fields selected by bitSet places on the wire:
+// the serialized bitset followed by each selected field.
+size_t putPayloadSize(
+	epics::pvData::PVStructurePtr const &pvStructure,
+	epics::pvData::BitSetPtr const &bitSet);
+
+#endif /* NTPUTTRACKER_H */
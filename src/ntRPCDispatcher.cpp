@@ -0,0 +1,300 @@
+/*
+ * =============================================================
+ *
+ * 	ntRPCDispatcher.cpp
+ *
+ *	Source file that implements the dispatch of NTURI requests
+ *	to handlers on a pool of worker threads.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntRPCDispatcher.h>
+#include <pv/ntThreadPlacement.h>
+#include <pv/ntTrace.h>
+
+#include <sstream>
+#include <stdexcept>
+
+#include <epicsTime.h>
+#include <pv/nttable.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::pvAccess;
+using namespace epics::nt;
+using namespace epics::ntDatabase;
+
+// Serves the built in method returning the dispatcher's metrics.
+class MetricsHandler : public NTRPCHandler {
+	public:
+		explicit MetricsHandler(NTRPCDispatcher &dispatcher) : dispatcher(dispatcher) {}
+
+		virtual PVStructurePtr handle(PVStructurePtr const &)
+		{
+			return dispatcher.getMetrics();
+		}
+
+	private:
+		NTRPCDispatcher &dispatcher;
+};
+
+NTRPCDispatcher::Worker::Worker(NTRPCDispatcher &dispatcher, string const &name)
+	: dispatcher(dispatcher),
+	  thread(*this, name.c_str(),
+		epicsThreadGetStackSize(epicsThreadStackMedium),
+		epicsThreadPriorityMedium)
+{
+}
+
+void NTRPCDispatcher::Worker::run()
+{
+	NTThreadPlacement::applyRole("rpc");
+	dispatcher.work();
+}
+
+NTRPCDispatcherPtr NTRPCDispatcher::create(size_t workers, size_t queueDepth)
+{
+	NTRPCDispatcherPtr dispatcher(new NTRPCDispatcher(queueDepth));
+
+	dispatcher->registerHandler("metrics", NTRPCHandlerPtr(new MetricsHandler(*dispatcher)));
+
+	if (workers == 0) workers = 1;
+
+	for (size_t i = 0; i < workers; ++i) {
+		stringstream name;
+		name << "ntRPCWorker" << i;
+
+		dispatcher->workers.push_back(new Worker(*dispatcher, name.str()));
+		dispatcher->workers.back()->thread.start();
+	}
+
+	return dispatcher;
+}
+
+NTRPCDispatcher::NTRPCDispatcher(size_t queueDepth)
+	: queueDepth(queueDepth),
+	  rejected(0),
+	  stopping(false)
+{
+}
+
+NTRPCDispatcher::~NTRPCDispatcher()
+{
+	stop();
+
+	for (size_t i = 0; i < workers.size(); ++i)
+		delete workers[i];
+}
+
+void NTRPCDispatcher::registerHandler(string const &method, NTRPCHandlerPtr const &handler)
+{
+	Lock lock(mutex);
+	handlers[method] = handler;
+}
+
+vector<string> NTRPCDispatcher::getMethods()
+{
+	Lock lock(mutex);
+
+	vector<string> methods;
+	map<string, NTRPCHandlerPtr>::const_iterator it;
+	for (it = handlers.begin(); it != handlers.end(); ++it)
+		methods.push_back(it->first);
+
+	return methods;
+}
+
+void NTRPCDispatcher::request(
+	PVStructurePtr const &args,
+	RPCResponseCallback::shared_pointer const &callback)
+{
+	PVStringPtr pvScheme, pvPath;
+	if (args) {
+		pvScheme = args->getSubField<PVString>("scheme");
+		pvPath = args->getSubField<PVString>("path");
+	}
+
+	string error;
+
+	if (!pvPath) {
+		error = "request is not a NTURI";
+	} else if (pvScheme && !pvScheme->get().empty() && pvScheme->get() != "pva") {
+		error = "unsupported scheme " + pvScheme->get();
+	} else {
+
+		Request request;
+		request.method = pvPath->get();
+		request.query = args->getSubField<PVStructure>("query");
+		request.callback = callback;
+		request.arrival = epicsMonotonicGet();
+
+		{
+			Lock lock(mutex);
+
+			map<string, NTRPCHandlerPtr>::const_iterator it = handlers.find(request.method);
+
+			if (stopping) error = "service is stopping";
+			else if (it == handlers.end()) error = "unknown method " + request.method;
+			else if (queue.size() >= queueDepth) {
+				error = "too many requests queued";
+				++rejected;
+			} else {
+				request.handler = it->second;
+				queue.push_back(request);
+			}
+		}
+
+		if (error.empty()) {
+			wakeUp.signal();
+			return;
+		}
+	}
+
+	// Refused at once, in the caller's thread.
+	callback->requestDone(Status(Status::STATUSTYPE_ERROR, error), PVStructurePtr());
+}
+
+void NTRPCDispatcher::work()
+{
+	while (true) {
+
+		Request request;
+		bool found(false);
+		bool more(false);
+
+		{
+			Lock lock(mutex);
+
+			if (!queue.empty()) {
+				request = queue.front();
+				queue.pop_front();
+				found = true;
+				more = !queue.empty();
+			} else if (stopping) {
+				break;
+			}
+		}
+
+		if (!found) {
+			wakeUp.wait();
+			continue;
+		}
+
+		// One signal wakes one worker, so pass it on while work is left.
+		if (more) wakeUp.signal();
+
+		epicsUInt64 start = epicsMonotonicGet();
+		PVStructurePtr result;
+		Status status;
+
+		try {
+			result = request.handler->handle(request.query);
+			if (!result) result = getPVDataCreate()->createPVStructure(
+				getFieldCreate()->createFieldBuilder()->createStructure());
+		} catch (RPCRequestException &e) {
+			status = e.asStatus();
+		} catch (std::exception &e) {
+			status = Status(Status::STATUSTYPE_ERROR, e.what());
+		} catch (...) {
+			// Anything else thrown would end the worker and leave the
+			// client waiting.
+			status = Status(Status::STATUSTYPE_ERROR, "request failed");
+		}
+
+		record(request, start, !status.isSuccess());
+
+		request.callback->requestDone(status, status.isSuccess() ? result : PVStructurePtr());
+	}
+
+	// Let the next worker see that the dispatcher is stopping.
+	wakeUp.signal();
+}
+
+void NTRPCDispatcher::record(Request const &request, epicsUInt64 start, bool failed)
+{
+	epicsUInt64 end = epicsMonotonicGet();
+	epicsUInt64 latency = end - request.arrival;
+
+	if (NTTrace::isEnabled()) {
+		NTTrace::record("rpc.wait", request.method, request.arrival, start);
+		NTTrace::record("rpc.run", request.method, start, end);
+	}
+
+	Lock lock(metricsMutex);
+
+	Metrics &entry = metrics[request.method];
+	++entry.count;
+	if (failed) ++entry.errors;
+	entry.totalLatency += latency;
+	if (latency > entry.maxLatency) entry.maxLatency = latency;
+	entry.totalWait += start - request.arrival;
+}
+
+PVStructurePtr NTRPCDispatcher::getMetrics()
+{
+	shared_vector<string> method;
+	shared_vector<int64> count, errors;
+	shared_vector<double> meanLatency, maxLatency, meanWait;
+
+	{
+		Lock lock(metricsMutex);
+
+		map<string, Metrics>::const_iterator it;
+		for (it = metrics.begin(); it != metrics.end(); ++it) {
+			Metrics const &entry = it->second;
+
+			method.push_back(it->first);
+			count.push_back(entry.count);
+			errors.push_back(entry.errors);
+			meanLatency.push_back(entry.totalLatency / 1e9 / entry.count);
+			maxLatency.push_back(entry.maxLatency / 1e9);
+			meanWait.push_back(entry.totalWait / 1e9 / entry.count);
+		}
+	}
+
+	PVStructurePtr pvTable = NTTable::createBuilder()->
+		addColumn("method", pvString)->
+		addColumn("count", pvLong)->
+		addColumn("errors", pvLong)->
+		addColumn("meanLatency", pvDouble)->
+		addColumn("maxLatency", pvDouble)->
+		addColumn("meanWait", pvDouble)->
+		createPVStructure();
+
+	pvTable->getSubField<PVStringArray>("value.method")->replace(freeze(method));
+	pvTable->getSubField<PVLongArray>("value.count")->replace(freeze(count));
+	pvTable->getSubField<PVLongArray>("value.errors")->replace(freeze(errors));
+	pvTable->getSubField<PVDoubleArray>("value.meanLatency")->replace(freeze(meanLatency));
+	pvTable->getSubField<PVDoubleArray>("value.maxLatency")->replace(freeze(maxLatency));
+	pvTable->getSubField<PVDoubleArray>("value.meanWait")->replace(freeze(meanWait));
+
+	return pvTable;
+}
+
+size_t NTRPCDispatcher::getRejected()
+{
+	Lock lock(mutex);
+	return rejected;
+}
+
+void NTRPCDispatcher::stop()
+{
+	deque<Request> abandoned;
+
+	{
+		Lock lock(mutex);
+		if (stopping) return;
+		stopping = true;
+		abandoned.swap(queue);
+	}
+
+	for (size_t i = 0; i < abandoned.size(); ++i)
+		abandoned[i].callback->requestDone(
+			Status(Status::STATUSTYPE_ERROR, "service is stopping"), PVStructurePtr());
+
+	wakeUp.signal();
+
+	for (size_t i = 0; i < workers.size(); ++i)
+		workers[i]->thread.exitWait();
+}
@@ -0,0 +1,81 @@
+/*
+ * =============================================================
+ *
+ * 	ntRPCRecord.cpp
+ *
+ *	Source file that implements the record serving RPCs through
+ *	the dispatcher.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntRPCRecord.h>
+
+#include <epicsVersion.h>
+
+#include <pv/ntscalarArray.h>
+
+// Older pvDatabase releases have no PVRecord::getService(), so the method
+// below would compile as a virtual nothing calls and the rpc record would
+// refuse every channelRPC.
+#if !defined(VERSION_INT) || EPICS_VERSION_INT < VERSION_INT(7, 0, 2, 0)
+#	error "ntDatabase needs EPICS 7.0.2 or later (pvDatabase 4.4.0 or later)"
+#endif
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::pvAccess;
+using namespace epics::nt;
+using namespace epics::ntDatabase;
+
+NTRPCRecordPtr NTRPCRecord::create(
+	string const &recordName,
+	NTRPCDispatcherPtr const &dispatcher)
+{
+	PVStructurePtr pvStructure = NTScalarArray::createBuilder()->
+		value(pvString)->
+		addTimeStamp()->
+		createPVStructure();
+
+	NTRPCRecordPtr pvRecord(new NTRPCRecord(recordName, pvStructure, dispatcher));
+
+	if (!pvRecord->init()) pvRecord.reset();
+
+	return pvRecord;
+}
+
+NTRPCRecord::NTRPCRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure,
+	NTRPCDispatcherPtr const &dispatcher)
+	: NTRecord(recordName, pvStructure),
+	  dispatcher(dispatcher)
+{
+}
+
+bool NTRPCRecord::init()
+{
+	if (!NTRecord::init() || !dispatcher) return false;
+
+	updateMethods();
+
+	return true;
+}
+
+Service::shared_pointer NTRPCRecord::getService(PVStructurePtr const &)
+{
+	return dispatcher;
+}
+
+void NTRPCRecord::updateMethods()
+{
+	vector<string> methods = dispatcher->getMethods();
+	shared_vector<string> value(methods.begin(), methods.end());
+
+	lock();
+	beginGroupPut();
+	getPVStructure()->getSubField<PVStringArray>("value")->replace(freeze(value));
+	process();
+	endGroupPut();
+	unlock();
+}
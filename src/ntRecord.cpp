@@ -0,0 +1,127 @@
+/*
+ * =============================================================
+ *
+ * 	ntRecord.cpp
+ *
+ *	Source file that implements the base class of the normative
+ *	type database records.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntRecord.h>
+#include <pv/ntThreadPlacement.h>
+#include <pv/ntTrace.h>
+
+#include <algorithm>
+
+#include <epicsTime.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::pvDatabase;
+using namespace epics::ntDatabase;
+
+NTRecordPtr NTRecord::create(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+{
+	NTRecordPtr pvRecord(new NTRecord(recordName, pvStructure));
+
+	if (!pvRecord->init()) pvRecord.reset();
+
+	return pvRecord;
+}
+
+NTRecord::NTRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+	: PVRecord(recordName, pvStructure),
+	  hasTimeStamp(false),
+	  hasAlarm(false),
+	  processCpu(-1),
+	  processThread(-1),
+	  processCount(0)
+{
+}
+
+bool NTRecord::init()
+{
+	initPVRecord();
+
+	PVFieldPtr pvField = getPVStructure()->getSubField("timeStamp");
+	if (pvField) hasTimeStamp = pvTimeStamp.attach(pvField);
+
+	pvField = getPVStructure()->getSubField("alarm");
+	if (pvField) hasAlarm = pvAlarm.attach(pvField);
+
+	return true;
+}
+
+void NTRecord::process()
+{
+	TimeStamp now;
+	now.getCurrent();
+
+	processAt(now);
+}
+
+void NTRecord::processAt(TimeStamp const &processTime)
+{
+	epicsUInt64 start = NTTrace::isEnabled() ? epicsMonotonicGet() : 0;
+
+	processCpu = NTThreadPlacement::currentCpu();
+	processThread = NTThreadPlacement::currentThread();
+	++processCount;
+
+	processRecord();
+
+	if (hasTimeStamp) {
+		timeStamp = processTime;
+		pvTimeStamp.set(timeStamp);
+	}
+
+	for (size_t i = 0; i < processListeners.size(); ++i)
+		processListeners[i]->processed(*this);
+
+	if (start) NTTrace::record("record.process", getRecordName(), start, epicsMonotonicGet());
+}
+
+void NTRecord::addProcessListener(NTProcessListenerPtr const &listener)
+{
+	lock();
+	processListeners.push_back(listener);
+	unlock();
+}
+
+void NTRecord::removeProcessListener(NTProcessListenerPtr const &listener)
+{
+	lock();
+	processListeners.erase(
+		remove(processListeners.begin(), processListeners.end(), listener),
+		processListeners.end());
+	unlock();
+}
+
+void NTRecord::raiseAlarm(string const &message)
+{
+	if (!hasAlarm) return;
+
+	alarm.setMessage(message);
+	alarm.setSeverity(majorAlarm);
+	alarm.setStatus(recordStatus);
+	pvAlarm.set(alarm);
+}
+
+void NTRecord::clearAlarm()
+{
+	if (!hasAlarm) return;
+
+	pvAlarm.get(alarm);
+	if (alarm.getSeverity() == noAlarm) return;
+
+	alarm.setMessage("");
+	alarm.setSeverity(noAlarm);
+	alarm.setStatus(noStatus);
+	pvAlarm.set(alarm);
+}
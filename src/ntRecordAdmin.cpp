@@ -0,0 +1,201 @@
+/*
+ * =============================================================
+ *
+ * 	ntRecordAdmin.cpp
+ *
+ *	Source file that implements the RPC method adding and
+ *	removing records of the live database.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntRecordAdmin.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+#include <epicsThread.h>
+#include <pv/pvDatabase.h>
+
+#include <pv/ntRecordDefinition.h>
+#include <pv/ntScalarRecord.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::pvDatabase;
+using namespace epics::ntDatabase;
+
+const size_t NTRecordAdmin::maxBatch;
+
+// Returns true if recordName is one of the records definition stands for,
+// without making the names of a range.
+static bool standsFor(NTRecordDefinition const &definition, string const &recordName)
+{
+	if (definition.last < definition.first) return recordName == definition.name;
+
+	size_t length = definition.name.size();
+	if (recordName.size() <= length || recordName.compare(0, length, definition.name) != 0)
+		return false;
+
+	string number = recordName.substr(length);
+	char *end;
+	long index = strtol(number.c_str(), &end, 10);
+
+	return *end == '\0' && index >= definition.first && index <= definition.last &&
+		definition.recordName(index - definition.first) == recordName;
+}
+
+// Called with the removed record's lock free, once no new put can reach it.
+static void retire(PVRecordPtr const &pvRecord)
+{
+	NTScalarRecordPtr scalarRecord = std::tr1::dynamic_pointer_cast<NTScalarRecord>(pvRecord);
+	if (!scalarRecord) return;
+
+	scalarRecord->lock();
+	scalarRecord->disableArchive();
+	scalarRecord->unlock();
+}
+
+NTRecordAdminPtr NTRecordAdmin::create(
+	NTArchiverPtr const &archiver,
+	NTShardMapPtr const &shards,
+	size_t shard)
+{
+	return NTRecordAdminPtr(new NTRecordAdmin(archiver, shards, shard));
+}
+
+NTRecordAdmin::NTRecordAdmin(
+	NTArchiverPtr const &archiver,
+	NTShardMapPtr const &shards,
+	size_t shard)
+	: archiver(archiver),
+	  shards(shards),
+	  shard(shard)
+{
+	resultType = getFieldCreate()->createFieldBuilder()->
+		addArray("removed", pvString)->
+		addArray("added", pvString)->
+		createStructure();
+}
+
+void NTRecordAdmin::addServiceRecord(string const &recordName)
+{
+	Lock lock(mutex);
+	serviceRecords.insert(recordName);
+}
+
+vector<string> NTRecordAdmin::add(string const &definitions, string const &source, size_t limit)
+{
+	string text(definitions);
+	replace(text.begin(), text.end(), ';', '\n');
+
+	istringstream in(text);
+	vector<NTRecordDefinition> parsed;
+
+	if (!NTRecordLoader::parse(in, source, parsed))
+		throw runtime_error("record definitions have errors, nothing was added");
+
+	size_t count = 0;
+	for (size_t i = 0; i < parsed.size(); ++i) count += parsed[i].count();
+
+	if (limit && count > limit) {
+		stringstream message;
+		message << "record definitions stand for more than " << limit << " records, nothing was added";
+		throw runtime_error(message.str());
+	}
+
+	{
+		Lock lock(mutex);
+
+		set<string>::const_iterator it;
+		for (it = serviceRecords.begin(); it != serviceRecords.end(); ++it) {
+			for (size_t i = 0; i < parsed.size(); ++i) {
+				if (standsFor(parsed[i], *it))
+					throw runtime_error("record " + *it + " is a service record, nothing was added");
+			}
+		}
+	}
+
+	// Built before the database is touched, on every cpu.
+	vector<PVRecordPtr> records = NTRecordLoader::instantiate(
+		parsed, epicsThreadGetCPUs(), archiver, shards, shard);
+
+	PVDatabasePtr master = PVDatabase::getMaster();
+	vector<string> added;
+	added.reserve(records.size());
+
+	Lock lock(mutex);
+
+	for (size_t i = 0; i < records.size(); ++i) {
+		string const &recordName = records[i]->getRecordName();
+
+		// A record of the same name is replaced, disconnecting its channels.
+		PVRecordPtr previous = master->findRecord(recordName);
+		if (previous && master->removeRecord(previous)) retire(previous);
+
+		if (master->addRecord(records[i])) added.push_back(recordName);
+	}
+
+	return added;
+}
+
+vector<string> NTRecordAdmin::remove(string const &names, size_t limit)
+{
+	vector<string> recordNames;
+
+	if (!NTRecordLoader::expandNames(names, recordNames, limit)) {
+		stringstream message;
+		message << "malformed record names " << names;
+		if (limit) message << ", or more than " << limit << " of them";
+		throw runtime_error(message.str());
+	}
+
+	PVDatabasePtr master = PVDatabase::getMaster();
+	vector<string> removed;
+
+	Lock lock(mutex);
+
+	for (size_t i = 0; i < recordNames.size(); ++i) {
+		if (serviceRecords.count(recordNames[i]))
+			throw runtime_error("record " + recordNames[i] + " is a service record, nothing was removed");
+	}
+
+	for (size_t i = 0; i < recordNames.size(); ++i) {
+		PVRecordPtr pvRecord = master->findRecord(recordNames[i]);
+		if (pvRecord && master->removeRecord(pvRecord)) {
+			retire(pvRecord);
+			removed.push_back(recordNames[i]);
+		}
+	}
+
+	return removed;
+}
+
+PVStructurePtr NTRecordAdmin::handle(PVStructurePtr const &query)
+{
+	PVStringPtr pvRemove, pvAdd;
+	if (query) {
+		pvRemove = query->getSubField<PVString>("remove");
+		pvAdd = query->getSubField<PVString>("add");
+	}
+
+	if (!pvRemove && !pvAdd)
+		throw runtime_error("admin request has neither add nor remove");
+
+	vector<string> removed, added;
+
+	// Clients are limited to batches of maxBatch records.
+	if (pvRemove) removed = remove(pvRemove->get(), maxBatch);
+	if (pvAdd) added = add(pvAdd->get(), "admin", maxBatch);
+
+	PVStructurePtr result = getPVDataCreate()->createPVStructure(resultType);
+
+	shared_vector<string> removedNames(removed.begin(), removed.end());
+	shared_vector<string> addedNames(added.begin(), added.end());
+	result->getSubField<PVStringArray>("removed")->replace(freeze(removedNames));
+	result->getSubField<PVStringArray>("added")->replace(freeze(addedNames));
+
+	return result;
+}
@@ -0,0 +1,469 @@
+/*
+ * =============================================================
+ *
+ * 	ntRecordDefinition.cpp
+ *
+ *	Source file that implements reading record definition
+ *	files and creating their records.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntRecordDefinition.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include <epicsThread.h>
+
+#include <pv/ntscalar.h>
+#include <pv/nttable.h>
+
+#include <pv/ntEnumRecord.h>
+#include <pv/ntMatrixRecord.h>
+#include <pv/ntNameValueRecord.h>
+#include <pv/ntScalarArrayRecord.h>
+#include <pv/ntScalarRecord.h>
+#include <pv/ntTableRecord.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::pvDatabase;
+using namespace epics::nt;
+using namespace epics::ntDatabase;
+
+const size_t NTRecordDefinition::maxRange;
+
+static PVDataCreatePtr pvDataCreate = getPVDataCreate();
+
+/* ==================== definitions ==================== */
+
+string NTRecordDefinition::recordName(size_t index) const
+{
+	if (last < first) return name;
+
+	stringstream str;
+	str << name << first + (long) index;
+	return str.str();
+}
+
+string NTRecordDefinition::shape() const
+{
+	stringstream str;
+	str << type << ':' << ScalarTypeFunc::name(scalarType);
+
+	for (size_t i = 0; i < fields.size(); ++i)
+		str << ' ' << fields[i];
+
+	for (size_t i = 0; i < columns.size(); ++i)
+		str << ' ' << columns[i].first << ':' << ScalarTypeFunc::name(columns[i].second);
+
+	return str.str();
+}
+
+/* ==================== parsing ==================== */
+
+// Prints a parse error and returns false.
+static bool fail(string const &source, size_t line, string const &message)
+{
+	cerr << source << ":" << line << ": " << message << "\n";
+	return false;
+}
+
+static vector<string> split(string const &text, char separator)
+{
+	vector<string> parts;
+	size_t start = 0;
+
+	while (true) {
+		size_t end = text.find(separator, start);
+		parts.push_back(text.substr(start, end - start));
+		if (end == string::npos) break;
+		start = end + 1;
+	}
+
+	return parts;
+}
+
+// Parses a scalar type name. Returns false if there is no such type.
+static bool parseScalarType(string const &text, ScalarType &scalarType)
+{
+	try {
+		scalarType = ScalarTypeFunc::getScalarType(text);
+	} catch (std::exception &) {
+		return false;
+	}
+	return true;
+}
+
+// Parses "name" or "name[first-last]" into definition.
+static bool parseName(string const &text, NTRecordDefinition &definition)
+{
+	size_t open = text.find('[');
+
+	if (open == string::npos) {
+		definition.name = text;
+		return !text.empty();
+	}
+
+	size_t dash = text.find('-', open);
+	if (open == 0 || dash == string::npos || text[text.size() - 1] != ']') return false;
+
+	char *end;
+	string first = text.substr(open + 1, dash - open - 1);
+	string last = text.substr(dash + 1, text.size() - dash - 2);
+
+	definition.name = text.substr(0, open);
+	definition.first = strtol(first.c_str(), &end, 10);
+	if (first.empty() || *end) return false;
+	definition.last = strtol(last.c_str(), &end, 10);
+	if (last.empty() || *end) return false;
+
+	return definition.first <= definition.last &&
+		(size_t) (definition.last - definition.first) < NTRecordDefinition::maxRange;
+}
+
+bool NTRecordLoader::parse(
+	istream &in,
+	string const &source,
+	vector<NTRecordDefinition> &definitions)
+{
+	static const char *types[] = { "scalar", "scalarArray", "enum", "table", "name_value", "matrix" };
+	static const char *flags[] = { "alarm", "timeStamp", "display", "control", "descriptor" };
+
+	bool result = true;
+	string text;
+
+	for (size_t line = 1; getline(in, text); ++line) {
+
+		text = text.substr(0, text.find('#'));
+
+		istringstream tokens(text);
+		vector<string> words;
+		string word;
+		while (tokens >> word) words.push_back(word);
+
+		if (words.empty()) continue;
+
+		NTRecordDefinition definition;
+		definition.line = line;
+
+		if (words.size() < 2 || !parseName(words[0], definition)) {
+			result = fail(source, line, "expected name or name[first-last], of at most a million records, followed by a type");
+			continue;
+		}
+
+		size_t colon = words[1].find(':');
+		definition.type = words[1].substr(0, colon);
+
+		if (find(types, types + 6, definition.type) == types + 6) {
+			result = fail(source, line, "unknown type " + definition.type);
+			continue;
+		}
+		if (colon != string::npos && !parseScalarType(words[1].substr(colon + 1), definition.scalarType)) {
+			result = fail(source, line, "unknown scalar type " + words[1].substr(colon + 1));
+			continue;
+		}
+
+		string const &type = definition.type;
+		bool valid = true;
+
+		for (size_t i = 2; i < words.size() && valid; ++i) {
+
+			size_t equals = words[i].find('=');
+			string key = words[i].substr(0, equals);
+			string value = (equals == string::npos) ? string() : words[i].substr(equals + 1);
+
+			if (find(flags, flags + 5, key) != flags + 5 && equals == string::npos) {
+
+				bool scalarOnly = (key == "display" || key == "control");
+				if (type != "scalar" && (scalarOnly || type != "table"))
+					valid = fail(source, line, "a " + type + " record has no optional field " + key);
+				else
+					definition.fields.push_back(key);
+
+			} else if (key == "columns" && type == "table") {
+
+				vector<string> columns = split(value, ',');
+				for (size_t j = 0; j < columns.size() && valid; ++j) {
+					size_t separator = columns[j].find(':');
+					ScalarType scalarType = definition.scalarType;
+
+					if (columns[j].empty() || separator == 0 ||
+					    (separator != string::npos && !parseScalarType(columns[j].substr(separator + 1), scalarType)))
+						valid = fail(source, line, "bad column " + columns[j]);
+					else
+						definition.columns.push_back(make_pair(columns[j].substr(0, separator), scalarType));
+				}
+
+			} else if (key == "choices" && type == "enum") {
+				definition.choices = split(value, ',');
+
+			} else if (key == "value" && (type == "scalar" || type == "scalarArray" || type == "enum")) {
+				definition.value = split(value, ',');
+				if (type != "scalarArray" && definition.value.size() != 1)
+					valid = fail(source, line, "a " + type + " record has a single value");
+
+			} else if (key == "history" && type == "scalar") {
+				char *end;
+				definition.history = strtoul(value.c_str(), &end, 10);
+				if (value.empty() || *end) valid = fail(source, line, "bad history " + value);
+
+			} else if (key == "archive" && type == "scalar" && equals == string::npos) {
+				definition.archive = true;
+
+			} else {
+				valid = fail(source, line, "option " + words[i] + " does not apply to a " + type + " record");
+			}
+		}
+
+		if (valid && type == "table" && definition.columns.empty())
+			valid = fail(source, line, "a table record needs columns");
+
+		if (!valid) {
+			result = false;
+			continue;
+		}
+
+		sort(definition.fields.begin(), definition.fields.end());
+		definition.fields.erase(unique(definition.fields.begin(), definition.fields.end()), definition.fields.end());
+
+		definitions.push_back(definition);
+	}
+
+	return result;
+}
+
+bool NTRecordLoader::expandNames(string const &text, vector<string> &names, size_t limit)
+{
+	string words(text);
+	replace(words.begin(), words.end(), ',', ' ');
+
+	istringstream tokens(words);
+	vector<string> expanded;
+	string word;
+
+	while (tokens >> word) {
+		NTRecordDefinition definition;
+		if (!parseName(word, definition)) return false;
+
+		// Counted before the names are made.
+		if (limit && expanded.size() + definition.count() > limit) return false;
+
+		for (size_t i = 0; i < definition.count(); ++i)
+			expanded.push_back(definition.recordName(i));
+	}
+
+	names.insert(names.end(), expanded.begin(), expanded.end());
+	return true;
+}
+
+/* ==================== instantiation ==================== */
+
+static bool hasField(NTRecordDefinition const &definition, string const &field)
+{
+	return binary_search(definition.fields.begin(), definition.fields.end(), field);
+}
+
+// Builds the structure shared by the records of definition's shape.
+static StructureConstPtr buildStructure(NTRecordDefinition const &definition)
+{
+	string const &type = definition.type;
+
+	if (type == "scalar") {
+		NTScalarBuilderPtr builder = NTScalar::createBuilder();
+		builder->value(definition.scalarType);
+
+		if (hasField(definition, "alarm")) builder->addAlarm();
+		if (hasField(definition, "control")) builder->addControl();
+		if (hasField(definition, "descriptor")) builder->addDescriptor();
+		if (hasField(definition, "display")) builder->addDisplay();
+		if (hasField(definition, "timeStamp")) builder->addTimeStamp();
+
+		return builder->createStructure();
+	}
+
+	if (type == "table") {
+		NTTableBuilderPtr builder = NTTable::createBuilder();
+
+		for (size_t i = 0; i < definition.columns.size(); ++i)
+			builder->addColumn(definition.columns[i].first, definition.columns[i].second);
+
+		if (hasField(definition, "alarm")) builder->addAlarm();
+		if (hasField(definition, "descriptor")) builder->addDescriptor();
+		if (hasField(definition, "timeStamp")) builder->addTimeStamp();
+
+		return NTTableRecord::createPVStructure(builder->createStructure())->getStructure();
+	}
+
+	// The other records have a fixed structure.
+	if (type == "scalarArray") return NTScalarArrayRecord::createPVStructure(definition.scalarType)->getStructure();
+	if (type == "enum") return NTEnumRecord::createPVStructure()->getStructure();
+	if (type == "name_value") return NTNameValueRecord::createPVStructure()->getStructure();
+	return NTMatrixRecord::createPVStructure()->getStructure();
+}
+
+// Creates one record of definition. Prints why and returns null on failure.
+static PVRecordPtr createRecord(
+	NTRecordDefinition const &definition,
+	string const &recordName,
+	StructureConstPtr const &structure,
+	NTArchiverPtr const &archiver)
+{
+	string const &type = definition.type;
+	PVStructurePtr pvStructure = pvDataCreate->createPVStructure(structure);
+	PVRecordPtr pvRecord;
+
+	try {
+
+		if (type == "scalar") {
+			if (!definition.value.empty())
+				pvStructure->getSubField<PVScalar>("value")->putFrom<string>(definition.value[0]);
+
+			NTScalarRecordPtr scalarRecord = NTScalarRecord::create(recordName, pvStructure);
+			if (scalarRecord && definition.history > 0) scalarRecord->enableHistory(definition.history);
+			if (scalarRecord && definition.archive && archiver) scalarRecord->enableArchive(archiver);
+			pvRecord = scalarRecord;
+
+		} else if (type == "scalarArray") {
+			if (!definition.value.empty()) {
+				shared_vector<string> value(definition.value.begin(), definition.value.end());
+				pvStructure->getSubField<PVScalarArray>("value")->putFrom(freeze(value));
+			}
+			pvRecord = NTScalarArrayRecord::create(recordName, pvStructure);
+
+		} else if (type == "enum") {
+			shared_vector<string> choices(definition.choices.begin(), definition.choices.end());
+			pvStructure->getSubField<PVStringArray>("value.choices")->replace(freeze(choices));
+			if (!definition.value.empty())
+				pvStructure->getSubField<PVInt>("value.index")->putFrom<string>(definition.value[0]);
+			pvRecord = NTEnumRecord::create(recordName, pvStructure);
+
+		} else if (type == "table") {
+			pvRecord = NTTableRecord::create(recordName, pvStructure);
+		} else if (type == "name_value") {
+			pvRecord = NTNameValueRecord::create(recordName, pvStructure);
+		} else {
+			pvRecord = NTMatrixRecord::create(recordName, pvStructure);
+		}
+
+	} catch (std::exception &e) {
+		cerr << "Failed to create record " << recordName << ": " << e.what() << "\n";
+		return PVRecordPtr();
+	}
+
+	if (!pvRecord) cerr << "Failed to create record " << recordName << "\n";
+
+	return pvRecord;
+}
+
+/*
+ * Thread creating the records numbered [begin, end) of a bulk load, where
+ * the records of definition i are numbered from offsets[i].
+ */
+class RecordBuilder : public epicsThreadRunable {
+	public:
+		RecordBuilder(
+			vector<NTRecordDefinition> const &definitions,
+			vector<StructureConstPtr> const &structures,
+			vector<size_t> const &offsets,
+			NTArchiverPtr const &archiver,
+			NTShardMapPtr const &shards,
+			size_t shard,
+			vector<PVRecordPtr> &records,
+			size_t begin,
+			size_t end)
+			: definitions(definitions), structures(structures), offsets(offsets),
+			  archiver(archiver), shards(shards), shard(shard),
+			  records(records), begin(begin), end(end),
+			  thread(*this, "ntRecordBuilder",
+			         epicsThreadGetStackSize(epicsThreadStackMedium),
+			         epicsThreadPriorityMedium)
+		{
+			thread.start();
+		}
+
+		virtual void run()
+		{
+			// Definition of the first record of the slice.
+			size_t definition = upper_bound(offsets.begin(), offsets.end(), begin) - offsets.begin() - 1;
+
+			for (size_t i = begin; i < end; ++i) {
+				while (i >= offsets[definition + 1]) ++definition;
+
+				NTRecordDefinition const &current = definitions[definition];
+				string recordName = current.recordName(i - offsets[definition]);
+
+				// Records of other shards are left null.
+				if (shards && shards->shardOf(recordName) != shard) continue;
+
+				records[i] = createRecord(current, recordName, structures[definition], archiver);
+			}
+		}
+
+		void wait() { thread.exitWait(); }
+
+	private:
+		vector<NTRecordDefinition> const &definitions;
+		vector<StructureConstPtr> const &structures;
+		vector<size_t> const &offsets;
+		NTArchiverPtr archiver;
+		NTShardMapPtr shards;
+		size_t shard;
+		// Each thread writes only its own slice.
+		vector<PVRecordPtr> &records;
+		size_t begin;
+		size_t end;
+		epicsThread thread;
+};
+
+vector<PVRecordPtr> NTRecordLoader::instantiate(
+	vector<NTRecordDefinition> const &definitions,
+	size_t threads,
+	NTArchiverPtr const &archiver,
+	NTShardMapPtr const &shards,
+	size_t shard)
+{
+	// One structure per distinct shape, shared by its records.
+	map<string, StructureConstPtr> shapes;
+	vector<StructureConstPtr> structures(definitions.size());
+	vector<size_t> offsets(definitions.size() + 1, 0);
+
+	for (size_t i = 0; i < definitions.size(); ++i) {
+		string shape = definitions[i].shape();
+
+		map<string, StructureConstPtr>::iterator it = shapes.find(shape);
+		if (it == shapes.end())
+			it = shapes.insert(make_pair(shape, buildStructure(definitions[i]))).first;
+
+		structures[i] = it->second;
+		offsets[i + 1] = offsets[i] + definitions[i].count();
+	}
+
+	size_t total = offsets.back();
+	vector<PVRecordPtr> records(total);
+
+	if (threads == 0) threads = 1;
+	if (threads > total) threads = total;
+
+	vector<RecordBuilder *> builders;
+
+	for (size_t i = 0; i < threads; ++i) {
+		size_t begin = total * i / threads;
+		size_t end = total * (i + 1) / threads;
+		builders.push_back(new RecordBuilder(definitions, structures, offsets,
+			archiver, shards, shard, records, begin, end));
+	}
+
+	for (size_t i = 0; i < builders.size(); ++i) {
+		builders[i]->wait();
+		delete builders[i];
+	}
+
+	records.erase(remove(records.begin(), records.end(), PVRecordPtr()), records.end());
+
+	return records;
+}
@@ -0,0 +1,136 @@
+/*
+ * =============================================================
+ *
+ * 	ntResampler.cpp
+ *
+ *	Source file that implements the resampling of waveforms
+ *	onto a uniform grid.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntResampler.h>
+
+#include <algorithm>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::ntDatabase;
+
+bool NTResampler::setSamples(
+	shared_vector<const double> const &base,
+	shared_vector<const double> const &value)
+{
+	if (base.size() != value.size()) return false;
+
+	for (size_t i = 1; i < base.size(); ++i) {
+		if (!(base[i] > base[i - 1])) return false;
+	}
+
+	this->base = base;
+	this->value = value;
+	splineReady = false;
+
+	return true;
+}
+
+void NTResampler::locate(double start, double step, size_t count)
+{
+	intervals.resize(count);
+	fractions.resize(count);
+
+	size_t n = base.size();
+	double const *x = base.data();
+
+	// The interval of the first point, then walk along with the grid.
+	size_t i = upper_bound(x, x + n, start) - x;
+	i = (i == 0) ? 0 : min(i - 1, n - 2);
+
+	for (size_t j = 0; j < count; ++j) {
+		double point = start + j * step;
+
+		while (i + 2 < n && x[i + 1] <= point) ++i;
+
+		double fraction = (point - x[i]) / (x[i + 1] - x[i]);
+		if (fraction < 0.0) fraction = 0.0;
+		if (fraction > 1.0) fraction = 1.0;
+
+		intervals[j] = i;
+		fractions[j] = fraction;
+	}
+}
+
+void NTResampler::computeSpline()
+{
+	size_t n = base.size();
+	double const *x = base.data();
+	double const *y = value.data();
+
+	// Solve the tridiagonal system of the natural spline, whose second
+	// derivative is 0 at both ends, by the Thomas algorithm.
+	secondDerivatives.assign(n, 0.0);
+	vector<double> upper(n, 0.0);
+
+	for (size_t i = 1; i + 1 < n; ++i) {
+		double h0 = x[i] - x[i - 1];
+		double h1 = x[i + 1] - x[i];
+		double rhs = 6.0 * ((y[i + 1] - y[i]) / h1 - (y[i] - y[i - 1]) / h0);
+
+		double diagonal = 2.0 * (h0 + h1) - h0 * upper[i - 1];
+		upper[i] = h1 / diagonal;
+		secondDerivatives[i] = (rhs - h0 * secondDerivatives[i - 1]) / diagonal;
+	}
+
+	for (size_t i = n - 2; i > 0; --i)
+		secondDerivatives[i] -= upper[i] * secondDerivatives[i + 1];
+
+	splineReady = true;
+}
+
+void NTResampler::resample(
+	double start,
+	double step,
+	size_t count,
+	Method method,
+	double *out)
+{
+	size_t n = base.size();
+
+	if (n == 0) {
+		fill(out, out + count, 0.0);
+		return;
+	}
+	if (n == 1) {
+		fill(out, out + count, value[0]);
+		return;
+	}
+
+	locate(start, step, count);
+
+	double const *x = base.data();
+	double const *y = value.data();
+	size_t const *interval = &intervals[0];
+	double const *fraction = &fractions[0];
+
+	if (method == linear || n < 3) {
+		for (size_t j = 0; j < count; ++j) {
+			size_t i = interval[j];
+			out[j] = y[i] + fraction[j] * (y[i + 1] - y[i]);
+		}
+		return;
+	}
+
+	if (!splineReady) computeSpline();
+
+	double const *m = &secondDerivatives[0];
+
+	for (size_t j = 0; j < count; ++j) {
+		size_t i = interval[j];
+		double h = x[i + 1] - x[i];
+		double b = fraction[j];
+		double a = 1.0 - b;
+
+		out[j] = a * y[i] + b * y[i + 1] +
+			((a * a * a - a) * m[i] + (b * b * b - b) * m[i + 1]) * h * h / 6.0;
+	}
+}
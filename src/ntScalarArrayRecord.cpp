@@ -0,0 +1,247 @@
+/*
+ * =============================================================
+ *
+ * 	ntScalarArrayRecord.cpp
+ *
+ *	Source file that implements the NTScalarArray records of the
+ *	normative type database, their partial (slice) updates and
+ *	chunked reads.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntScalarArrayRecord.h>
+
+#include <algorithm>
+
+#include <pv/ntscalarArray.h>
+
+using namespace std;
+using std::tr1::static_pointer_cast;
+using namespace epics::pvData;
+using namespace epics::nt;
+using namespace epics::ntDatabase;
+
+PVStructurePtr NTScalarArrayRecord::createPVStructure(ScalarType scalarType)
+{
+	StructureConstPtr slice = getFieldCreate()->createFieldBuilder()->
+		add("offset", pvInt)->
+		addArray("value", scalarType)->
+		createStructure();
+
+	NTScalarArrayBuilderPtr ntScalarArrayBuilder = NTScalarArray::createBuilder();
+
+	ntScalarArrayBuilder->
+		value(scalarType)->
+		addAlarm()->
+		addTimeStamp()->
+		add("slice", slice)->
+		add("chunk", NTArrayChunk::createField(getFieldCreate()->createScalarArray(scalarType)));
+
+	if (scalarType == pvString) {
+		StructureConstPtr dictionary = getFieldCreate()->createFieldBuilder()->
+			addArray("values", pvString)->
+			addArray("codes", pvInt)->
+			createStructure();
+
+		ntScalarArrayBuilder->add("dictionary", dictionary);
+	}
+
+	return ntScalarArrayBuilder->createPVStructure();
+}
+
+NTScalarArrayRecordPtr NTScalarArrayRecord::create(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+{
+	NTScalarArrayRecordPtr pvRecord(new NTScalarArrayRecord(recordName, pvStructure));
+
+	if (!pvRecord->init()) pvRecord.reset();
+
+	return pvRecord;
+}
+
+NTScalarArrayRecord::NTScalarArrayRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+	: NTRecord(recordName, pvStructure),
+	  scalarType(pvDouble)
+{
+}
+
+bool NTScalarArrayRecord::init()
+{
+	if (!NTRecord::init()) return false;
+
+	PVStructurePtr pvStructure = getPVStructure();
+
+	pvValue = pvStructure->getSubField<PVScalarArray>("value");
+	pvSliceOffset = pvStructure->getSubField<PVInt>("slice.offset");
+	pvSliceValue = pvStructure->getSubField<PVScalarArray>("slice.value");
+
+	if (!pvValue || !pvSliceOffset || !pvSliceValue) return false;
+
+	scalarType = pvValue->getScalarArray()->getElementType();
+	if (pvSliceValue->getScalarArray()->getElementType() != scalarType) return false;
+
+	if (scalarType == pvString) {
+		pvDictionaryValues = pvStructure->getSubField<PVStringArray>("dictionary.values");
+		pvDictionaryCodes = pvStructure->getSubField<PVIntArray>("dictionary.codes");
+		if (!pvDictionaryValues || !pvDictionaryCodes) return false;
+	}
+
+	return chunk.attach(pvStructure->getSubField<PVStructure>("chunk"));
+}
+
+void NTScalarArrayRecord::processRecord()
+{
+	applySlice();
+	if (scalarType == pvString) applyDictionary();
+	chunk.serve(pvValue);
+}
+
+/*
+ * Writes the slice into value at offset. Leaves value alone if the slice is
+ * empty or is the one applied last time, the same array at the same offset,
+ * and refuses an offset past the end of value, so that value grows only by
+ * appending to it.
+ *
+ * reuse() takes the array back from the value field without a copy when the
+ * field holds the only reference, so the cost follows the size of the slice.
+ * If a reader such as a queued monitor update still shares the array it is
+ * copied once, which leaves what that reader sees unchanged.
+ */
+template<typename T>
+static NTScalarArrayRecord::SliceWrite writeSlice(
+	PVScalarArray &pvValue,
+	PVScalarArray const &pvSlice,
+	size_t offset,
+	NTScalarArrayRecord::AppliedSlice &applied)
+{
+	typedef PVValueArray<T> PVArray;
+
+	typename PVArray::const_svector slice(static_cast<PVArray const &>(pvSlice).view());
+
+	if (slice.empty()) return NTScalarArrayRecord::sliceUnchanged;
+	if (slice.data() == applied.data && slice.size() == applied.size && offset == applied.offset)
+		return NTScalarArrayRecord::sliceUnchanged;
+
+	// A refused slice is remembered too, so it raises the alarm once.
+	applied.buffer = slice.dataPtr();
+	applied.data = slice.data();
+	applied.size = slice.size();
+	applied.offset = offset;
+
+	if (offset > pvValue.getLength()) return NTScalarArrayRecord::sliceOutOfRange;
+
+	PVArray &value = static_cast<PVArray &>(pvValue);
+	typename PVArray::svector data(value.reuse());
+
+	if (data.size() < offset + slice.size())
+		data.resize(offset + slice.size());
+
+	std::copy(slice.begin(), slice.end(), data.begin() + offset);
+
+	value.replace(freeze(data));
+
+	return NTScalarArrayRecord::sliceWritten;
+}
+
+void NTScalarArrayRecord::applySlice()
+{
+	int32 offset = pvSliceOffset->get();
+
+	if (offset < 0) {
+		raiseAlarm("slice offset is negative");
+		return;
+	}
+
+	PVScalarArray &value = *pvValue;
+	PVScalarArray const &slice = *pvSliceValue;
+	SliceWrite written(sliceUnchanged);
+
+	switch (scalarType) {
+	case pvBoolean:
+		written = writeSlice<boolean>(value, slice, offset, appliedSlice);
+		break;
+	case pvByte:
+		written = writeSlice<int8>(value, slice, offset, appliedSlice);
+		break;
+	case pvShort:
+		written = writeSlice<int16>(value, slice, offset, appliedSlice);
+		break;
+	case pvInt:
+		written = writeSlice<int32>(value, slice, offset, appliedSlice);
+		break;
+	case pvLong:
+		written = writeSlice<int64>(value, slice, offset, appliedSlice);
+		break;
+	case pvUByte:
+		written = writeSlice<uint8>(value, slice, offset, appliedSlice);
+		break;
+	case pvUShort:
+		written = writeSlice<uint16>(value, slice, offset, appliedSlice);
+		break;
+	case pvUInt:
+		written = writeSlice<uint32>(value, slice, offset, appliedSlice);
+		break;
+	case pvULong:
+		written = writeSlice<uint64>(value, slice, offset, appliedSlice);
+		break;
+	case pvFloat:
+		written = writeSlice<float>(value, slice, offset, appliedSlice);
+		break;
+	case pvDouble:
+		written = writeSlice<double>(value, slice, offset, appliedSlice);
+		break;
+	case pvString:
+		written = writeSlice<string>(value, slice, offset, appliedSlice);
+		break;
+	}
+
+	if (written == sliceWritten) {
+		// The slice may have been written into the array the chunk was
+		// copied from, without replacing it.
+		chunk.invalidate();
+		clearAlarm();
+	} else if (written == sliceOutOfRange) {
+		raiseAlarm("slice offset is past the end of value");
+	}
+}
+
+/*
+ * Decodes a put of dictionary into value, or encodes value into dictionary
+ * if value changed. Puts replace arrays, so a change is told apart by the
+ * arrays no longer being those last published.
+ */
+void NTScalarArrayRecord::applyDictionary()
+{
+	shared_vector<const string> values = pvDictionaryValues->view();
+	shared_vector<const int32> codes = pvDictionaryCodes->view();
+
+	if (values.data() != dictionary.getValues().data() || codes.data() != dictionary.getCodes().data()) {
+
+		if (dictionary.assign(values, codes)) {
+			encodedValue = dictionary.decode();
+			static_pointer_cast<PVStringArray>(pvValue)->replace(encodedValue);
+			clearAlarm();
+			return;
+		}
+
+		// Republish the encoding of value in place of the rejected one.
+		raiseAlarm("dictionary codes must index distinct sorted values");
+		encodedValue.clear();
+	}
+
+	shared_vector<const string> value = static_pointer_cast<PVStringArray>(pvValue)->view();
+
+	if (value.data() == encodedValue.data() && value.size() == encodedValue.size() &&
+	    pvDictionaryCodes->view().data() == dictionary.getCodes().data())
+		return;
+
+	dictionary.encode(value);
+	encodedValue = value;
+
+	pvDictionaryValues->replace(dictionary.getValues());
+	pvDictionaryCodes->replace(dictionary.getCodes());
+}
@@ -12,6 +12,37 @@
  */
 
 #include "ntScalarDemo.h"
+#include "ntArrayStream.h"
+
+#include <epicsTime.h>
+#include <pv/ntTrace.h>
+
+using epics::ntDatabase::NTTrace;
+
+// putGet(), traced when tracing is on: the round trip, and the time until
+// the put's monitor update arrives, as another client would see it.
+static void tracedPutGet(PvaClientChannelPtr const &channel, PvaClientPutGetPtr const &putGet)
+{
+	if (!NTTrace::isEnabled()) {
+		putGet->putGet();
+		return;
+	}
+
+	PvaClientMonitorPtr monitor = channel->monitor("field(value)");
+
+	// Drop the update carrying the current value.
+	if (monitor->waitEvent(1.0)) monitor->releaseEvent();
+
+	epicsUInt64 start = epicsMonotonicGet();
+	putGet->putGet();
+	NTTrace::record("client.putGet", channel->getChannelName(), start, epicsMonotonicGet());
+
+	// An unchanged value sends no update.
+	if (monitor->waitEvent(1.0)) {
+		NTTrace::record("client.monitor", channel->getChannelName(), start, epicsMonotonicGet());
+		monitor->releaseEvent();
+	}
+}
 
 // Crappy method of generating a random integer.
 long genInt(long high) {
@@ -49,7 +80,7 @@ bool demoString(
 	PvaClientPutDataPtr putData = putGet->getPutData();
 	
 	putData->putString(write_str);
-	putGet->putGet();
+	tracedPutGet(channel, putGet);
 
 	// Read the data stored in the record.
 	string read_str;
@@ -93,7 +124,7 @@ bool demoStringArray(
 	// write_str is now empty.
 	
 	putData->putStringArray(data);
-	putGet->putGet();
+	tracedPutGet(channel, putGet);
 
 	PvaClientGetDataPtr getData = putGet->getGetData();
 
@@ -130,7 +161,7 @@ bool demoShort(
 	short write = genInt(32767);
 	
 	putData->getPVStructure()->getSubField<PVShort>("value")->put(write);
-	putGet->putGet();
+	tracedPutGet(channel, putGet);
 
 	short read = getData->getPVStructure()->getSubField<PVShort>("value")->get();
 
@@ -169,7 +200,7 @@ bool demoShortArray(
 	// the data vector is now empty.
 	
 	putData->getPVStructure()->getSubField<PVShortArray>("value")->replace(write);
-	putGet->putGet();
+	tracedPutGet(channel, putGet);
 
 	// Read the data stored in the record.
 	shared_vector<const short> read;
@@ -203,7 +234,7 @@ bool demoInt(
 	int write = genInt(INT_MAX);
 
 	putData->getPVStructure()->getSubField<PVInt>("value")->put(write);
-	putGet->putGet();
+	tracedPutGet(channel, putGet);
 
 	int read = getData->getPVStructure()->getSubField<PVInt>("value")->get();
 
@@ -241,7 +272,7 @@ bool demoIntArray(
 	// the data vector is now empty.
 	
 	putData->getPVStructure()->getSubField<PVIntArray>("value")->replace(write);
-	putGet->putGet();
+	tracedPutGet(channel, putGet);
 
 	// Read the data stored in the record.
 	shared_vector<const int> read;
@@ -276,7 +307,7 @@ bool demoLong(
 	long write = genInt(INT_MAX);
 
 	putData->getPVStructure()->getSubField<PVLong>("value")->put(write);
-	putGet->putGet();
+	tracedPutGet(channel, putGet);
 	
 	putGet->getGetData();
 	
@@ -315,7 +346,7 @@ bool demoLongArray(
 	// the data vector is now empty.
 	
 	putData->getPVStructure()->getSubField<PVLongArray>("value")->replace(write);
-	putGet->putGet();
+	tracedPutGet(channel, putGet);
 
 	putGet->getGetData();
 	
@@ -338,6 +369,35 @@ bool demoLongArray(
 	return result;
 }
 
+// Compares each chunk of a streamed array with the expected contents.
+class CompareChunks : public ArrayChunkConsumer {
+	public:
+		CompareChunks(shared_vector<const double> const &expected)
+			: expected(expected), equal(true) {}
+
+		virtual bool consume(
+			size_t offset,
+			size_t size,
+			PVScalarArrayPtr const &chunk)
+		{
+			shared_vector<const double> data;
+			chunk->getAs<double>(data);
+
+			if (size != expected.size())
+				equal = false;
+
+			for (size_t i = 0; equal && i < data.size(); ++i) {
+				if (offset + i >= expected.size() || data[i] != expected[offset + i])
+					equal = false;
+			}
+
+			return equal;
+		}
+
+		shared_vector<const double> expected;
+		bool equal;
+};
+
 double genDouble() 
 {
 	double f = (double)rand() / INT_MAX;
@@ -357,7 +417,7 @@ bool demoDouble(
 	PvaClientPutDataPtr putData = putGet->getPutData();
 	
 	putData->putDouble(write);
-	putGet->putGet();
+	tracedPutGet(channel, putGet);
 
 	// Read the data stored in the record.
 	double read;
@@ -400,7 +460,7 @@ bool demoDoubleArray(
 	// data is now empty
 
 	putData->putDoubleArray(write);
-	putGet->putGet();
+	tracedPutGet(channel, putGet);
 
 	PvaClientGetDataPtr getData = putGet->getGetData();
 
@@ -420,6 +480,56 @@ bool demoDoubleArray(
 		if (write[i] != read[i])
 			result = false;
 	}
+
+	// Change a few elements in place through the record's slice field.
+	// Only the slice is sent, however long the array is.
+	PvaClientPutGetPtr slicePutGet =
+		channel->createPutGet("record[process=true]putField(slice)getField(value)");
+	PvaClientPutDataPtr slicePutData = slicePutGet->getPutData();
+
+	int slice_offset = 5;
+	int slice_num = 3;
+
+	shared_vector<double> slice_data(slice_num);
+	
+	for (int i = 0; i < slice_num; ++i)
+		slice_data[i] = genDouble();
+
+	shared_vector<const double> slice(freeze(slice_data));
+
+	slicePutData->getPVStructure()->getSubField<PVInt>("slice.offset")->put(slice_offset);
+	slicePutData->getPVStructure()->getSubField<PVDoubleArray>("slice.value")->replace(slice);
+	slicePutGet->putGet();
+
+	read = slicePutGet->getGetData()->getPVStructure()->getSubField<PVDoubleArray>("value")->view();
+
+	if (read.size() != (size_t) num)
+		return false;
+
+	for (int i = 0; i < num; ++i)
+	{
+		bool in_slice = (i >= slice_offset && i < slice_offset + slice_num);
+		double expected = in_slice ? slice[i - slice_offset] : write[i];
+
+		if (verbosity && in_slice)
+		{
+			cout << setw(20) << "Slice write: " << expected << "\n";
+			cout << setw(20) << "Slice read: " << read[i] << "\n\n";
+		}
+
+		if (expected != read[i])
+			result = false;
+	}
+
+	// Read the array back a few elements at a time.
+	CompareChunks compare(read);
+	size_t streamed = readArrayChunked(channel, 8, compare);
+
+	if (verbosity)
+		cout << setw(20) << "Streamed: " << streamed << " elements in chunks of 8\n\n";
+
+	if (!compare.equal || streamed != read.size())
+		result = false;
 			
 	return result;
 }
@@ -0,0 +1,104 @@
+/*
+ * =============================================================
+ *
+ * 	ntScalarRecord.cpp
+ *
+ *	Source file that implements the NTScalar records of the
+ *	normative type database.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntScalarRecord.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::ntDatabase;
+
+NTScalarRecordPtr NTScalarRecord::create(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+{
+	NTScalarRecordPtr pvRecord(new NTScalarRecord(recordName, pvStructure));
+
+	if (!pvRecord->init()) pvRecord.reset();
+
+	return pvRecord;
+}
+
+NTScalarRecord::NTScalarRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+	: NTRecord(recordName, pvStructure),
+	  archiveStream(-1)
+{
+}
+
+bool NTScalarRecord::init()
+{
+	if (!NTRecord::init()) return false;
+
+	pvValue = getPVStructure()->getSubField<PVScalar>("value");
+
+	return pvValue.get() != 0;
+}
+
+bool NTScalarRecord::enableHistory(size_t capacity)
+{
+	if (!ScalarTypeFunc::isNumeric(pvValue->getScalar()->getScalarType()))
+		return false;
+
+	history.reset(new NTHistoryBuffer(capacity));
+	return true;
+}
+
+bool NTScalarRecord::enableArchive(NTArchiverPtr const &archiver)
+{
+	if (!ScalarTypeFunc::isNumeric(pvValue->getScalar()->getScalarType()))
+		return false;
+
+	archiveStream = archiver->addStream(getRecordName());
+	if (archiveStream < 0) return false;
+
+	this->archiver = archiver;
+	return true;
+}
+
+void NTScalarRecord::disableArchive()
+{
+	if (!archiver) return;
+
+	archiver->removeStream(archiveStream);
+	archiver.reset();
+	archiveStream = -1;
+}
+
+void NTScalarRecord::processAt(TimeStamp const &processTime)
+{
+	NTRecord::processAt(processTime);
+
+	if (!history && !archiver) return;
+
+	if (hasAlarm) pvAlarm.get(alarm);
+
+	double value = pvValue->getAs<double>();
+
+	if (history) {
+		history->append(
+			value,
+			timeStamp.getSecondsPastEpoch(),
+			timeStamp.getNanoseconds(),
+			alarm.getSeverity(),
+			alarm.getStatus());
+	}
+
+	if (archiver) {
+		NTArchiveSample sample;
+		sample.time = timeStamp.getSecondsPastEpoch() * 1000000000 + timeStamp.getNanoseconds();
+		sample.value = value;
+		sample.severity = alarm.getSeverity();
+		sample.status = alarm.getStatus();
+
+		archiver->append(archiveStream, sample);
+	}
+}
@@ -0,0 +1,66 @@
+/*
+ * =============================================================
+ *
+ * 	ntServiceRecord.cpp
+ *
+ *	Source file that implements the base class of the records
+ *	that act as a remote procedure.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntServiceRecord.h>
+
+#include <stdexcept>
+
+#include <pv/standardField.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::ntDatabase;
+
+PVStructurePtr NTServiceRecord::createPVStructure(
+	StructureConstPtr const &argument,
+	StructureConstPtr const &result)
+{
+	StandardFieldPtr standardField = getStandardField();
+
+	StructureConstPtr structure = getFieldCreate()->createFieldBuilder()->
+		add("argument", argument)->
+		add("result", result)->
+		add("alarm", standardField->alarm())->
+		add("timeStamp", standardField->timeStamp())->
+		createStructure();
+
+	return getPVDataCreate()->createPVStructure(structure);
+}
+
+NTServiceRecord::NTServiceRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+	: NTRecord(recordName, pvStructure)
+{
+}
+
+bool NTServiceRecord::init()
+{
+	if (!NTRecord::init()) return false;
+
+	pvArgument = getPVStructure()->getSubField<PVStructure>("argument");
+	pvResult = getPVStructure()->getSubField<PVStructure>("result");
+
+	return pvArgument && pvResult;
+}
+
+void NTServiceRecord::processRecord()
+{
+	try {
+
+		execute(pvArgument, pvResult);
+		clearAlarm();
+
+	} catch (std::exception &e) {
+		raiseAlarm(e.what());
+		clearResult(pvResult);
+	}
+}
@@ -0,0 +1,75 @@
+/*
+ * =============================================================
+ *
+ * 	ntShardMap.cpp
+ *
+ *	Source file that implements the partition of the record
+ *	names among server processes.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntShardMap.h>
+
+#include <algorithm>
+#include <sstream>
+
+using namespace std;
+using namespace epics::ntDatabase;
+
+epicsUInt64 NTShardMap::hash(string const &key)
+{
+	// FNV-1a, whose high bits barely differ between names differing
+	// in their last characters, such as sensor1 and sensor2, so they
+	// are mixed with the finalizer of MurmurHash3.
+	epicsUInt64 hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < key.size(); ++i) {
+		hash ^= (unsigned char) key[i];
+		hash *= 1099511628211ULL;
+	}
+
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+	hash ^= hash >> 33;
+
+	return hash;
+}
+
+NTShardMapPtr NTShardMap::create(size_t shards, unsigned short basePort, size_t points)
+{
+	return NTShardMapPtr(new NTShardMap(shards, basePort, points));
+}
+
+NTShardMap::NTShardMap(size_t shards, unsigned short basePort, size_t points)
+	: shards(shards ? shards : 1),
+	  basePort(basePort)
+{
+	if (points == 0) points = 1;
+
+	ring.reserve(this->shards * points);
+
+	for (size_t shard = 0; shard < this->shards; ++shard) {
+		for (size_t point = 0; point < points; ++point) {
+			stringstream key;
+			key << "shard" << shard << "#" << point;
+			ring.push_back(make_pair(hash(key.str()), shard));
+		}
+	}
+
+	sort(ring.begin(), ring.end());
+}
+
+size_t NTShardMap::shardOf(string const &recordName) const
+{
+	if (shards == 1) return 0;
+
+	vector<pair<epicsUInt64, size_t> >::const_iterator it =
+		lower_bound(ring.begin(), ring.end(), make_pair(hash(recordName), (size_t) 0));
+
+	// Past the last point the ring wraps around to the first.
+	if (it == ring.end()) it = ring.begin();
+
+	return it->second;
+}
@@ -0,0 +1,234 @@
+/*
+ * ==========================================================
+ *
+ *	ntShardRouter.cpp
+ *
+ *	Source file for routing channels to sharded servers.
+ *
+ * ==========================================================
+ */
+
+#include "ntShardRouter.h"
+
+#include <iostream>
+#include <sstream>
+
+#include <pv/clientFactory.h>
+#include <pv/createRequest.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::pvAccess;
+using namespace epics::ntDatabase;
+
+ShardRouter::ShardRouter(NTShardMapPtr const &shards, string const &host)
+	: shards(shards),
+	  host(host)
+{
+	ClientFactory::start();
+	provider = getChannelProviderRegistry()->getProvider("pva");
+}
+
+string ShardRouter::getAddress(string const &recordName) const
+{
+	return getShardAddress(shards->shardOf(recordName));
+}
+
+string ShardRouter::getShardAddress(size_t shard) const
+{
+	stringstream address;
+	address << host << ":" << shards->portOf(shard);
+	return address.str();
+}
+
+Channel::shared_pointer ShardRouter::createChannel(
+	string const &recordName,
+	ChannelRequester::shared_pointer const &requester) const
+{
+	return createChannel(recordName, requester, shards->shardOf(recordName));
+}
+
+Channel::shared_pointer ShardRouter::createChannel(
+	string const &recordName,
+	ChannelRequester::shared_pointer const &requester,
+	size_t shard) const
+{
+	// With an address the client connects to that server without searching.
+	return provider->createChannel(recordName, requester,
+		ChannelProvider::PRIORITY_DEFAULT, getShardAddress(shard));
+}
+
+void ShardBatch::expect(size_t count)
+{
+	Lock lock(mutex);
+	pending += count;
+}
+
+void ShardBatch::done(bool success)
+{
+	Lock lock(mutex);
+	if (!success) ++failed;
+	if (pending > 0 && --pending == 0) event.signal();
+}
+
+bool ShardBatch::wait(double timeout)
+{
+	while (true) {
+		{
+			Lock lock(mutex);
+			if (pending == 0) return true;
+		}
+
+		if (!event.wait(timeout)) return false;
+	}
+}
+
+size_t ShardBatch::getFailed() const
+{
+	Lock lock(mutex);
+	return failed;
+}
+
+ShardPutGet::shared_pointer ShardPutGet::create(ShardRouter const &router, string const &recordName)
+{
+	shared_pointer putGet(new ShardPutGet(recordName));
+	putGet->channel = router.createChannel(recordName, putGet);
+	return putGet;
+}
+
+ShardPutGet::ShardPutGet(string const &recordName)
+	: recordName(recordName),
+	  value(0.0)
+{
+}
+
+void ShardPutGet::destroy()
+{
+	ChannelPutGet::shared_pointer putGet;
+	{
+		Lock lock(mutex);
+		putGet.swap(channelPutGet);
+		pvPut.reset();
+	}
+
+	if (putGet) putGet->destroy();
+	if (channel) channel->destroy();
+	channel.reset();
+}
+
+bool ShardPutGet::waitConnect(double timeout)
+{
+	{
+		Lock lock(mutex);
+		if (pvPut) return true;
+	}
+
+	connected.wait(timeout);
+
+	Lock lock(mutex);
+	return pvPut.get() != 0;
+}
+
+void ShardPutGet::issue(double value, ShardBatch::shared_pointer const &batch)
+{
+	ChannelPutGet::shared_pointer putGet;
+	PVStructurePtr pvPut;
+	{
+		Lock lock(mutex);
+		putGet = channelPutGet;
+		pvPut = this->pvPut;
+		this->batch = batch;
+	}
+
+	if (!putGet || !pvPut) {
+		batch->done(false);
+		return;
+	}
+
+	// Only the caller of issue() writes pvPut, one operation at a time.
+	pvPutValue->putFrom<double>(value);
+	putGet->putGet(pvPut, putBitSet);
+}
+
+double ShardPutGet::getValue() const
+{
+	Lock lock(mutex);
+	return value;
+}
+
+void ShardPutGet::message(string const &message, MessageType)
+{
+	cerr << recordName << ": " << message << "\n";
+}
+
+void ShardPutGet::channelCreated(Status const &status, Channel::shared_pointer const &)
+{
+	if (!status.isSuccess())
+		cerr << "Failed to create channel " << recordName << ": " << status.getMessage() << "\n";
+}
+
+void ShardPutGet::channelStateChange(Channel::shared_pointer const &channel, Channel::ConnectionState connectionState)
+{
+	if (connectionState != Channel::CONNECTED) return;
+
+	{
+		Lock lock(mutex);
+		if (channelPutGet) return;
+	}
+
+	PVStructurePtr pvRequest = CreateRequest::create()->createRequest(
+		"record[process=true]putField(value)getField(value)");
+
+	channel->createChannelPutGet(shared_from_this(), pvRequest);
+}
+
+void ShardPutGet::channelPutGetConnect(
+	Status const &status,
+	ChannelPutGet::shared_pointer const &channelPutGet,
+	StructureConstPtr const &putStructure,
+	StructureConstPtr const &)
+{
+	if (!status.isSuccess()) {
+		cerr << "Failed to connect to " << recordName << ": " << status.getMessage() << "\n";
+		return;
+	}
+
+	PVStructurePtr pvPut = getPVDataCreate()->createPVStructure(putStructure);
+	PVScalarPtr pvPutValue = pvPut->getSubField<PVScalar>("value");
+
+	if (!pvPutValue) {
+		cerr << "Record " << recordName << " has no scalar value\n";
+		return;
+	}
+
+	BitSetPtr putBitSet(new BitSet(pvPut->getNumberFields()));
+	putBitSet->set(pvPutValue->getFieldOffset());
+
+	{
+		Lock lock(mutex);
+		this->channelPutGet = channelPutGet;
+		this->pvPut = pvPut;
+		this->pvPutValue = pvPutValue;
+		this->putBitSet = putBitSet;
+	}
+
+	connected.signal();
+}
+
+void ShardPutGet::putGetDone(
+	Status const &status,
+	ChannelPutGet::shared_pointer const &,
+	PVStructurePtr const &pvGetStructure,
+	BitSetPtr const &)
+{
+	ShardBatch::shared_pointer batch;
+	{
+		Lock lock(mutex);
+		batch.swap(this->batch);
+
+		PVScalarPtr pvValue = pvGetStructure ? pvGetStructure->getSubField<PVScalar>("value") : PVScalarPtr();
+		if (status.isSuccess() && pvValue) value = pvValue->getAs<double>();
+	}
+
+	if (batch) batch->done(status.isSuccess());
+}
@@ -0,0 +1,168 @@
+#ifndef NTSHARDROUTER_H
+#define NTSHARDROUTER_H
+
+/*
+ * ==========================================================
+ *	ntShardRouter.h
+ *
+ *	Header file for routing channels to sharded servers.
+ *
+ *	When the record set is partitioned among several server
+ *	processes (ntDatabaseMain -S index/count), the shard of
+ *	a record follows from its name (see pv/ntShardMap.h).
+ *	A ShardRouter creates each channel directly on the port
+ *	of its shard's server, so no search is broadcast and no
+ *	server sees requests for records it does not host.
+ *
+ * ==========================================================
+ */
+
+#include <string>
+
+#include <epicsEvent.h>
+
+#include <pv/pvData.h>
+#include <pv/bitSet.h>
+#include <pv/lock.h>
+#include <pv/pvAccess.h>
+
+#include <pv/ntShardMap.h>
+
+class ShardRouter {
+	public:
+		// Routes to the servers of shards, all running on host.
+		explicit ShardRouter(
+			epics::ntDatabase::NTShardMapPtr const &shards,
+			std::string const &host = "127.0.0.1");
+
+		// host:port of the server of the named record's shard.
+		std::string getAddress(std::string const &recordName) const;
+		std::string getShardAddress(size_t shard) const;
+
+		// Creates a channel to the named record on the server of its shard.
+		epics::pvAccess::Channel::shared_pointer createChannel(
+			std::string const &recordName,
+			epics::pvAccess::ChannelRequester::shared_pointer const &requester) const;
+
+		// Creates a channel on the server of the given shard, for the
+		// service records, such as rpc and history, hosted by every shard.
+		epics::pvAccess::Channel::shared_pointer createChannel(
+			std::string const &recordName,
+			epics::pvAccess::ChannelRequester::shared_pointer const &requester,
+			size_t shard) const;
+
+		epics::ntDatabase::NTShardMapPtr getShardMap() const { return shards; }
+
+	private:
+		epics::ntDatabase::NTShardMapPtr shards;
+		std::string host;
+		epics::pvAccess::ChannelProvider::shared_pointer provider;
+};
+
+/*
+ * Operations issued together, possibly to many shards, and waited for
+ * together.
+ */
+class ShardBatch {
+	public:
+		POINTER_DEFINITIONS(ShardBatch);
+
+		ShardBatch() : pending(0), failed(0) {}
+
+		// Adds count operations to wait for.
+		void expect(size_t count);
+		void done(bool success);
+
+		// Waits until every operation expected is done. Returns false if
+		// timeout seconds pass first.
+		bool wait(double timeout);
+
+		size_t getFailed() const;
+
+	private:
+		mutable epics::pvData::Mutex mutex;
+		epicsEvent event;
+		size_t pending;
+		size_t failed;
+};
+
+/*
+ * Put followed by a get of the value of a scalar record, processing the
+ * record, over a channel routed to the record's shard. Operations are
+ * issued without waiting, so that one thread keeps many records of many
+ * shards busy at once. At most one operation may be outstanding.
+ */
+class ShardPutGet :
+	public epics::pvAccess::ChannelRequester,
+	public epics::pvAccess::ChannelPutGetRequester,
+	public std::tr1::enable_shared_from_this<ShardPutGet>
+{
+	public:
+		POINTER_DEFINITIONS(ShardPutGet);
+
+		static shared_pointer create(ShardRouter const &router, std::string const &recordName);
+
+		virtual ~ShardPutGet() {}
+
+		// Closes the channel, which holds on to its requester until then.
+		void destroy();
+
+		// Waits until the record can be written. Returns false if timeout
+		// seconds pass first.
+		bool waitConnect(double timeout);
+
+		// Writes value and reads the record's value back, then tells batch.
+		void issue(double value, ShardBatch::shared_pointer const &batch);
+
+		// Value read back by the last operation.
+		double getValue() const;
+
+		virtual std::string getRequesterName() { return recordName; }
+		virtual void message(std::string const &message, epics::pvData::MessageType messageType);
+
+		virtual void channelCreated(
+			epics::pvData::Status const &status,
+			epics::pvAccess::Channel::shared_pointer const &channel);
+		virtual void channelStateChange(
+			epics::pvAccess::Channel::shared_pointer const &channel,
+			epics::pvAccess::Channel::ConnectionState connectionState);
+
+		virtual void channelPutGetConnect(
+			epics::pvData::Status const &status,
+			epics::pvAccess::ChannelPutGet::shared_pointer const &channelPutGet,
+			epics::pvData::StructureConstPtr const &putStructure,
+			epics::pvData::StructureConstPtr const &getStructure);
+		virtual void putGetDone(
+			epics::pvData::Status const &status,
+			epics::pvAccess::ChannelPutGet::shared_pointer const &channelPutGet,
+			epics::pvData::PVStructurePtr const &pvGetStructure,
+			epics::pvData::BitSetPtr const &getBitSet);
+		virtual void getPutDone(
+			epics::pvData::Status const &,
+			epics::pvAccess::ChannelPutGet::shared_pointer const &,
+			epics::pvData::PVStructurePtr const &,
+			epics::pvData::BitSetPtr const &) {}
+		virtual void getGetDone(
+			epics::pvData::Status const &,
+			epics::pvAccess::ChannelPutGet::shared_pointer const &,
+			epics::pvData::PVStructurePtr const &,
+			epics::pvData::BitSetPtr const &) {}
+
+	private:
+		explicit ShardPutGet(std::string const &recordName);
+
+		std::string recordName;
+		epics::pvAccess::Channel::shared_pointer channel;
+
+		mutable epics::pvData::Mutex mutex;
+		epicsEvent connected;
+		epics::pvAccess::ChannelPutGet::shared_pointer channelPutGet;
+		epics::pvData::PVStructurePtr pvPut;
+		epics::pvData::PVScalarPtr pvPutValue;
+		epics::pvData::BitSetPtr putBitSet;
+
+		ShardBatch::shared_pointer batch;
+		double value;
+};
+
+#endif /* NTSHARDROUTER_H */
@@ -0,0 +1,144 @@
+/*
+ * =============================================================
+ *
+ * 	ntStringDictionary.cpp
+ *
+ *	Source file that implements the dictionary encoding of
+ *	arrays of strings.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntStringDictionary.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <pv/ntStringIndex.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::ntDatabase;
+
+// Orders the distinct values, given as the first cell holding each.
+struct FirstCellLess {
+	FirstCellLess(string const *cells, vector<uint32> const &firstCells)
+		: cells(cells), firstCells(firstCells) {}
+
+	bool operator()(uint32 a, uint32 b) const { return cells[firstCells[a]] < cells[firstCells[b]]; }
+
+	string const *cells;
+	vector<uint32> const &firstCells;
+};
+
+void NTStringDictionary::encode(shared_vector<const string> const &cells)
+{
+	size_t count = cells.size();
+	string const *data = cells.data();
+
+	// Number each distinct value in order of first appearance.
+	NTStringIndex index;
+	vector<uint32> firstCells;
+	shared_vector<int32> found(count);
+
+	for (size_t i = 0; i < count; ++i) {
+
+		found[i] = index.find(data[i]);
+		if (found[i] >= 0) continue;
+
+		found[i] = firstCells.size();
+		index.insert(data[i], firstCells.size());
+		firstCells.push_back(i);
+	}
+
+	// Sort the distinct values and renumber the cells by their rank.
+	vector<uint32> order(firstCells.size());
+	for (size_t j = 0; j < order.size(); ++j) order[j] = j;
+	sort(order.begin(), order.end(), FirstCellLess(data, firstCells));
+
+	vector<int32> rank(order.size());
+	shared_vector<string> sorted(order.size());
+
+	for (size_t k = 0; k < order.size(); ++k) {
+		rank[order[k]] = k;
+		sorted[k] = data[firstCells[order[k]]];
+	}
+
+	for (size_t i = 0; i < count; ++i) found[i] = rank[found[i]];
+
+	values = freeze(sorted);
+	codes = freeze(found);
+}
+
+bool NTStringDictionary::assign(
+	shared_vector<const string> const &values,
+	shared_vector<const int32> const &codes)
+{
+	for (size_t k = 1; k < values.size(); ++k) {
+		if (!(values[k - 1] < values[k])) return false;
+	}
+
+	int32 valueCount = values.size();
+	for (size_t i = 0; i < codes.size(); ++i) {
+		if (codes[i] < 0 || codes[i] >= valueCount) return false;
+	}
+
+	this->values = values;
+	this->codes = codes;
+	return true;
+}
+
+shared_vector<const string> NTStringDictionary::decode() const
+{
+	shared_vector<string> cells(codes.size());
+
+	for (size_t i = 0; i < codes.size(); ++i)
+		cells[i] = values[codes[i]];
+
+	return freeze(cells);
+}
+
+int32 NTStringDictionary::find(string const &value) const
+{
+	int32 code = lowerBound(value);
+	if (code < (int32) values.size() && values[code] == value) return code;
+	return -1;
+}
+
+int32 NTStringDictionary::lowerBound(string const &value) const
+{
+	return lower_bound(values.begin(), values.end(), value) - values.begin();
+}
+
+int32 NTStringDictionary::upperBound(string const &value) const
+{
+	return upper_bound(values.begin(), values.end(), value) - values.begin();
+}
+
+int32 NTStringDictionary::prefixEnd(string const &prefix) const
+{
+	size_t code = lowerBound(prefix);
+
+	while (code < values.size() && values[code].compare(0, prefix.size(), prefix) == 0)
+		++code;
+
+	return code;
+}
+
+size_t NTStringDictionary::memoryUsed() const
+{
+	return memoryUsed(values) + codes.size() * sizeof(int32);
+}
+
+size_t NTStringDictionary::memoryUsed(shared_vector<const string> const &cells)
+{
+	// Strings short enough for the storage inside std::string allocate nothing.
+	size_t inlineCapacity = string().capacity();
+	size_t bytes = cells.size() * sizeof(string);
+
+	for (size_t i = 0; i < cells.size(); ++i) {
+		if (cells[i].capacity() > inlineCapacity) bytes += cells[i].capacity() + 1;
+	}
+
+	return bytes;
+}
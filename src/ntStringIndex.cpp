@@ -0,0 +1,108 @@
+/*
+ * =============================================================
+ *
+ * 	ntStringIndex.cpp
+ *
+ *	Source file that implements the hash index from strings
+ *	to positions.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntStringIndex.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::ntDatabase;
+
+// Marks an empty slot.
+static const uint32 noEntry = 0xffffffff;
+
+// Slots of an empty index.
+static const size_t initialSlots = 64;
+
+NTStringIndex::NTStringIndex()
+	: slots(initialSlots, noEntry)
+{
+}
+
+size_t NTStringIndex::hash(string const &key)
+{
+	// FNV-1a
+	epicsUInt64 hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < key.size(); ++i) {
+		hash ^= (unsigned char) key[i];
+		hash *= 1099511628211ULL;
+	}
+	return (size_t) hash;
+}
+
+void NTStringIndex::build(shared_vector<const string> const &keys)
+{
+	clear();
+
+	// Size the table once for every key.
+	size_t slotCount = initialSlots;
+	while (slotCount < 2 * keys.size()) slotCount <<= 1;
+	slots.assign(slotCount, noEntry);
+
+	for (size_t i = 0; i < keys.size(); ++i)
+		insert(keys[i], i);
+}
+
+void NTStringIndex::clear()
+{
+	keys.clear();
+	hashes.clear();
+	positions.clear();
+	slots.assign(initialSlots, noEntry);
+}
+
+size_t NTStringIndex::findSlot(string const &key, size_t hash) const
+{
+	size_t mask = slots.size() - 1;
+	size_t slot = hash & mask;
+
+	while (slots[slot] != noEntry) {
+		uint32 entry = slots[slot];
+		if (hashes[entry] == hash && keys[entry] == key) break;
+		slot = (slot + 1) & mask;
+	}
+
+	return slot;
+}
+
+int32 NTStringIndex::find(string const &key) const
+{
+	uint32 entry = slots[findSlot(key, hash(key))];
+	return entry == noEntry ? -1 : positions[entry];
+}
+
+bool NTStringIndex::insert(string const &key, int32 position)
+{
+	size_t keyHash = hash(key);
+	size_t slot = findSlot(key, keyHash);
+
+	if (slots[slot] != noEntry) return false;
+
+	slots[slot] = keys.size();
+	keys.push_back(key);
+	hashes.push_back(keyHash);
+	positions.push_back(position);
+
+	if (2 * keys.size() > slots.size()) grow();
+
+	return true;
+}
+
+void NTStringIndex::grow()
+{
+	slots.assign(2 * slots.size(), noEntry);
+	size_t mask = slots.size() - 1;
+
+	for (size_t entry = 0; entry < keys.size(); ++entry) {
+		size_t slot = hashes[entry] & mask;
+		while (slots[slot] != noEntry) slot = (slot + 1) & mask;
+		slots[slot] = entry;
+	}
+}
@@ -0,0 +1,276 @@
+/*
+ * =============================================================
+ *
+ * 	ntTableColumn.cpp
+ *
+ *	Source file that implements the columns of the table
+ *	records, their indexes and the scans that answer queries.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntTableColumn.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <pv/typeCast.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::ntDatabase;
+
+// Marks the end of a hash chain.
+static const uint32 noRow = 0xffffffff;
+
+static bool precedes(int32 a, int32 b) { return a < b; }
+
+// Orders NaN after every number, so that sorting stays well defined.
+static bool precedes(double a, double b) { return a < b || (a == a && b != b); }
+
+static size_t hashOf(double key)
+{
+	// 0.0 and -0.0 are equal, so they must share a bucket.
+	if (key == 0.0) key = 0.0;
+
+	epicsUInt64 bits;
+	memcpy(&bits, &key, sizeof(bits));
+
+	bits ^= bits >> 33;
+	bits *= 0xff51afd7ed558ccdULL;
+	bits ^= bits >> 33;
+	return (size_t) bits;
+}
+
+// Orders rows by their key, and compares rows with a key for the binary searches.
+template<typename T>
+struct KeyLess {
+	explicit KeyLess(T const *keys) : keys(keys) {}
+
+	bool operator()(uint32 a, uint32 b) const { return precedes(keys[a], keys[b]); }
+	bool operator()(uint32 row, T const &key) const { return precedes(keys[row], key); }
+	bool operator()(T const &key, uint32 row) const { return precedes(key, keys[row]); }
+
+	T const *keys;
+};
+
+bool NTTableColumn::set(PVScalarArrayPtr const &array)
+{
+	shared_vector<const void> data;
+	array->getAs<void>(data);
+
+	ScalarType type = array->getScalarArray()->getElementType();
+
+	// A put replaces the array, so the same array means the same cells.
+	if (built && type == scalarType && data.data() == source.data() && data.size() == source.size())
+		return false;
+
+	scalarType = type;
+	source = data;
+	numbers.clear();
+
+	if (scalarType == pvString) dictionary.encode(static_shared_vector_cast<const string>(data));
+	else if (scalarType == pvDouble) numbers = static_shared_vector_cast<const double>(data);
+	else array->getAs<double>(numbers);
+
+	if (scalarType != pvString) dictionary = NTStringDictionary();
+
+	build();
+	return true;
+}
+
+void NTTableColumn::setIndex(Index index)
+{
+	this->index = index;
+	build();
+}
+
+size_t NTTableColumn::size() const
+{
+	return scalarType == pvString ? dictionary.size() : numbers.size();
+}
+
+void NTTableColumn::build()
+{
+	built = true;
+
+	if (scalarType == pvString) buildIndex(dictionary.getCodes());
+	else buildIndex(numbers);
+}
+
+template<typename T>
+void NTTableColumn::buildIndex(shared_vector<const T> const &keys)
+{
+	order.clear();
+	buckets.clear();
+	next.clear();
+
+	size_t length = keys.size();
+
+	if (index == sorted) {
+
+		order.resize(length);
+		for (size_t i = 0; i < length; ++i) order[i] = i;
+
+		stable_sort(order.begin(), order.end(), KeyLess<T>(keys.data()));
+
+	} else if (index == hash) {
+
+		// Twice as many buckets as rows keeps the chains short.
+		size_t bucketCount = 1;
+		while (bucketCount < 2 * length) bucketCount <<= 1;
+
+		buckets.assign(bucketCount, noRow);
+		next.assign(length, noRow);
+
+		// Rows are pushed from the last, so that each chain is in row order.
+		for (size_t i = length; i-- > 0;) {
+			size_t bucket = hashOf(keys[i]) & (bucketCount - 1);
+			next[i] = buckets[bucket];
+			buckets[bucket] = i;
+		}
+	}
+}
+
+void NTTableColumn::select(
+	NTTablePredicate const &predicate,
+	size_t length,
+	size_t limit,
+	vector<uint32> &rows)
+{
+	if (limit == 0) limit = length;
+
+	if (predicate.op == NTTablePredicate::all) {
+
+		for (size_t i = 0; i < length && i < limit; ++i)
+			rows.push_back(i);
+		return;
+	}
+
+	bool equal = predicate.op == NTTablePredicate::equal;
+	bool hasLow = equal || predicate.op == NTTablePredicate::prefix || !predicate.low.empty();
+	bool hasHigh = equal || predicate.op == NTTablePredicate::prefix || !predicate.high.empty();
+
+	if (scalarType != pvString) {
+
+		if (predicate.op == NTTablePredicate::prefix)
+			throw runtime_error("prefix applies to string columns only");
+
+		double low = 0.0, high = 0.0;
+
+		if (equal) {
+			low = high = castUnsafe<double>(predicate.value);
+		} else {
+			if (hasLow) low = castUnsafe<double>(predicate.low);
+			if (hasHigh) high = castUnsafe<double>(predicate.high);
+		}
+
+		selectKeys(numbers, low, high, hasLow, hasHigh, equal, limit, rows);
+		return;
+	}
+
+	// The dictionary is sorted, so each condition on the strings is a range of codes.
+	int32 low = 0, high = 0;
+
+	if (equal) {
+		low = high = dictionary.find(predicate.value);
+		if (low < 0) return;
+	} else if (predicate.op == NTTablePredicate::range) {
+		if (hasLow) low = dictionary.lowerBound(predicate.low);
+		if (hasHigh) high = dictionary.upperBound(predicate.high) - 1;
+	} else {
+		low = dictionary.lowerBound(predicate.value);
+		high = dictionary.prefixEnd(predicate.value) - 1;
+	}
+
+	if (hasLow && hasHigh && high < low) return;
+
+	selectKeys(dictionary.getCodes(), low, high, hasLow, hasHigh, equal, limit, rows);
+}
+
+template<typename T>
+void NTTableColumn::selectKeys(
+	shared_vector<const T> const &keys,
+	T low,
+	T high,
+	bool hasLow,
+	bool hasHigh,
+	bool equal,
+	size_t limit,
+	vector<uint32> &rows) const
+{
+	size_t first = rows.size();
+	size_t count = keys.size();
+	T const *data = keys.data();
+
+	if (index == hash && equal) {
+
+		// Rows come out of the chain in order, so the limit applies as they do.
+		size_t bucket = hashOf(low) & (buckets.size() - 1);
+
+		for (uint32 row = buckets[bucket]; row != noRow && rows.size() - first < limit; row = next[row]) {
+			if (!precedes(data[row], low) && !precedes(low, data[row])) rows.push_back(row);
+		}
+		return;
+	}
+
+	if (index == sorted) {
+
+		KeyLess<T> keyLess(data);
+		vector<uint32>::const_iterator begin = order.begin();
+		vector<uint32>::const_iterator end = order.end();
+
+		if (hasLow) begin = lower_bound(order.begin(), order.end(), low, keyLess);
+		if (hasHigh) end = upper_bound(begin, order.end(), high, keyLess);
+		if (end < begin) end = begin;
+
+		rows.insert(rows.end(), begin, end);
+
+		// Back to row order, keeping only the first limit rows.
+		vector<uint32>::iterator from = rows.begin() + first;
+		if ((size_t) (rows.end() - from) > limit) {
+			nth_element(from, from + limit, rows.end());
+			rows.resize(first + limit);
+		}
+		sort(rows.begin() + first, rows.end());
+		return;
+	}
+
+	// No index applies, so scan the column.
+	for (size_t i = 0; i < count && rows.size() - first < limit; ++i) {
+		if ((!hasLow || !precedes(data[i], low)) && (!hasHigh || !precedes(high, data[i])))
+			rows.push_back(i);
+	}
+}
+
+shared_vector<const void> NTTableColumn::gather(vector<uint32> const &rows) const
+{
+	size_t length = size();
+
+	if (scalarType == pvString) {
+		shared_vector<const string> const &values = dictionary.getValues();
+		shared_vector<const int32> const &codes = dictionary.getCodes();
+
+		// Copies of the dictionary's values share storage where std::string does.
+		shared_vector<string> out(rows.size());
+		for (size_t i = 0; i < rows.size(); ++i) {
+			if (rows[i] < length) out[i] = values[codes[rows[i]]];
+		}
+		return static_shared_vector_cast<const void>(freeze(out));
+	}
+
+	// Numeric cells are copied in the column's own type.
+	size_t elementSize = ScalarTypeFunc::elementSize(scalarType);
+	shared_vector<void> out(ScalarTypeFunc::allocArray(scalarType, rows.size()));
+
+	char const *from = static_cast<char const *>(source.data());
+	char *to = static_cast<char *>(out.data());
+
+	for (size_t i = 0; i < rows.size(); ++i, to += elementSize) {
+		if (rows[i] < length) memcpy(to, from + rows[i] * elementSize, elementSize);
+		else memset(to, 0, elementSize);
+	}
+
+	return freeze(out);
+}
@@ -0,0 +1,226 @@
+/*
+ * =============================================================
+ *
+ * 	ntTableRecord.cpp
+ *
+ *	Source file that implements the table record and the
+ *	queries it answers.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntTableRecord.h>
+
+#include <stdexcept>
+
+using namespace std;
+using std::tr1::static_pointer_cast;
+using namespace epics::pvData;
+using namespace epics::ntDatabase;
+
+bool NTTableRecord::Query::operator==(Query const &other) const
+{
+	// Puts replace arrays, so the same array means the same columns.
+	return columns.data() == other.columns.data() && columns.size() == other.columns.size() &&
+		column == other.column && op == other.op && value == other.value &&
+		low == other.low && high == other.high && limit == other.limit;
+}
+
+PVStructurePtr NTTableRecord::createPVStructure(StructureConstPtr const &table)
+{
+	FieldCreatePtr fieldCreate = getFieldCreate();
+
+	StructureConstPtr valueStructure = table->getField<Structure>("value");
+
+	StructureConstPtr where = fieldCreate->createFieldBuilder()->
+		add("column", pvString)->
+		add("op", pvString)->
+		add("value", pvString)->
+		add("low", pvString)->
+		add("high", pvString)->
+		createStructure();
+
+	// The result has the table's columns, so it is a NTTable of the same shape.
+	StructureConstPtr result = fieldCreate->createFieldBuilder()->
+		setId(table->getID())->
+		addArray("labels", pvString)->
+		add("value", valueStructure)->
+		createStructure();
+
+	StructureConstPtr query = fieldCreate->createFieldBuilder()->
+		addArray("columns", pvString)->
+		add("where", where)->
+		add("limit", pvInt)->
+		add("result", result)->
+		createStructure();
+
+	PVStructurePtr pvStructure = getPVDataCreate()->createPVStructure(
+		fieldCreate->appendField(table, "query", query));
+
+	// Label the columns by their names, as the NTTable builder does.
+	StringArray const &fieldNames = valueStructure->getFieldNames();
+	shared_vector<string> labels(fieldNames.begin(), fieldNames.end());
+	pvStructure->getSubField<PVStringArray>("labels")->replace(freeze(labels));
+
+	return pvStructure;
+}
+
+NTTableRecordPtr NTTableRecord::create(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+{
+	NTTableRecordPtr pvRecord(new NTTableRecord(recordName, pvStructure));
+
+	if (!pvRecord->init()) pvRecord.reset();
+
+	return pvRecord;
+}
+
+NTTableRecord::NTTableRecord(
+	string const &recordName,
+	PVStructurePtr const &pvStructure)
+	: NTRecord(recordName, pvStructure),
+	  stale(true)
+{
+}
+
+bool NTTableRecord::init()
+{
+	if (!NTRecord::init()) return false;
+
+	PVStructurePtr pvStructure = getPVStructure();
+
+	pvValue = pvStructure->getSubField<PVStructure>("value");
+	pvQuery = pvStructure->getSubField<PVStructure>("query");
+	pvResultLabels = pvStructure->getSubField<PVStringArray>("query.result.labels");
+	pvResultValue = pvStructure->getSubField<PVStructure>("query.result.value");
+
+	if (!pvValue || !pvQuery || !pvResultLabels || !pvResultValue) return false;
+
+	PVFieldPtrArray const &pvFields = pvValue->getPVFields();
+
+	for (size_t i = 0; i < pvFields.size(); ++i) {
+		if (pvFields[i]->getField()->getType() != scalarArray) return false;
+		names.push_back(pvFields[i]->getFieldName());
+	}
+
+	columns.resize(names.size());
+
+	// One label per value field, whichever columns a query returns.
+	shared_vector<string> labels(names.begin(), names.end());
+	pvResultLabels->replace(freeze(labels));
+
+	return true;
+}
+
+bool NTTableRecord::addIndex(string const &column, string const &kind)
+{
+	NTTableColumn::Index index;
+	if (kind == "sorted") index = NTTableColumn::sorted;
+	else if (kind == "hash") index = NTTableColumn::hash;
+	else return false;
+
+	for (size_t i = 0; i < names.size(); ++i) {
+		if (names[i] == column) {
+			lock();
+			columns[i].setIndex(index);
+			unlock();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+size_t NTTableRecord::findColumn(string const &name) const
+{
+	for (size_t i = 0; i < names.size(); ++i) {
+		if (names[i] == name) return i;
+	}
+
+	throw runtime_error("unknown column " + name);
+}
+
+void NTTableRecord::processRecord()
+{
+	// Bring the columns and their indexes up to date with the last put.
+	PVFieldPtrArray const &pvFields = pvValue->getPVFields();
+
+	for (size_t i = 0; i < columns.size(); ++i) {
+		if (columns[i].set(static_pointer_cast<PVScalarArray>(pvFields[i])))
+			stale = true;
+	}
+
+	Query query;
+	query.columns = pvQuery->getSubField<PVStringArray>("columns")->view();
+	query.column = pvQuery->getSubField<PVString>("where.column")->get();
+	query.op = pvQuery->getSubField<PVString>("where.op")->get();
+	query.value = pvQuery->getSubField<PVString>("where.value")->get();
+	query.low = pvQuery->getSubField<PVString>("where.low")->get();
+	query.high = pvQuery->getSubField<PVString>("where.high")->get();
+	query.limit = pvQuery->getSubField<PVInt>("limit")->get();
+
+	if (!stale && query == computed) return;
+
+	try {
+		execute(query);
+		clearAlarm();
+	} catch (std::exception &e) {
+		PVFieldPtrArray const &pvResultFields = pvResultValue->getPVFields();
+		for (size_t i = 0; i < pvResultFields.size(); ++i)
+			static_pointer_cast<PVScalarArray>(pvResultFields[i])->setLength(0);
+
+		raiseAlarm(e.what());
+	}
+
+	stale = false;
+	computed = query;
+}
+
+void NTTableRecord::execute(Query const &query)
+{
+	if (query.limit < 0)
+		throw runtime_error("limit is negative");
+
+	// Columns to return.
+	vector<bool> projected(names.size(), query.columns.empty());
+	for (size_t i = 0; i < query.columns.size(); ++i)
+		projected[findColumn(query.columns[i])] = true;
+
+	// Columns may differ in length, so the table is as long as the longest.
+	size_t length = 0;
+	for (size_t i = 0; i < columns.size(); ++i)
+		length = max(length, columns[i].size());
+
+	NTTablePredicate predicate;
+	size_t column = 0;
+
+	if (!query.column.empty()) {
+
+		column = findColumn(query.column);
+
+		if (query.op == "eq") predicate.op = NTTablePredicate::equal;
+		else if (query.op == "range") predicate.op = NTTablePredicate::range;
+		else if (query.op == "prefix") predicate.op = NTTablePredicate::prefix;
+		else throw runtime_error("unknown op " + query.op);
+
+		predicate.value = query.value;
+		predicate.low = query.low;
+		predicate.high = query.high;
+	}
+
+	vector<uint32> rows;
+	if (!columns.empty()) columns[column].select(predicate, length, query.limit, rows);
+
+	PVFieldPtrArray const &pvResultFields = pvResultValue->getPVFields();
+
+	// Every value field keeps its label, as NTTable has it, and a column
+	// that was not asked for is only emptied.
+	for (size_t i = 0; i < names.size(); ++i) {
+
+		PVScalarArrayPtr pvColumn = static_pointer_cast<PVScalarArray>(pvResultFields[i]);
+
+		if (projected[i]) pvColumn->putFrom(columns[i].gather(rows));
+		else pvColumn->setLength(0);
+	}
+}
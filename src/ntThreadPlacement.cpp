@@ -0,0 +1,260 @@
+/*
+ * =============================================================
+ *
+ * 	ntThreadPlacement.cpp
+ *
+ *	Source file that implements the placement of the server's
+ *	threads on cpus.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntThreadPlacement.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include <pv/lock.h>
+
+#if defined(__linux__)
+#	include <dirent.h>
+#	include <pthread.h>
+#	include <sched.h>
+#	include <sys/syscall.h>
+#	include <unistd.h>
+#	define NT_THREAD_PLACEMENT
+#endif
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::ntDatabase;
+
+static Mutex placementsMutex;
+static map<string, NTThreadPlacement> placements;
+
+// Parses a list of cpus and ranges such as 0-3,8.
+static bool parseCpus(string const &text, vector<int> &cpus)
+{
+	stringstream in(text);
+	string item;
+
+	while (getline(in, item, ',')) {
+		char *end;
+		long first = strtol(item.c_str(), &end, 10);
+		long last = first;
+
+		if (end == item.c_str() || first < 0) return false;
+		if (*end == '-') {
+			char *start = end + 1;
+			last = strtol(start, &end, 10);
+			if (end == start || last < first) return false;
+		}
+		if (*end != '\0') return false;
+
+		for (long cpu = first; cpu <= last; ++cpu)
+			cpus.push_back((int) cpu);
+	}
+
+	sort(cpus.begin(), cpus.end());
+	cpus.erase(unique(cpus.begin(), cpus.end()), cpus.end());
+
+	return !cpus.empty();
+}
+
+bool NTThreadPlacement::parse(string const &text, NTThreadPlacement &placement)
+{
+	NTThreadPlacement parsed;
+	stringstream in(text);
+	string item;
+
+	while (getline(in, item, ':')) {
+		size_t equals = item.find('=');
+		if (equals == string::npos) return false;
+
+		string key = item.substr(0, equals);
+		string value = item.substr(equals + 1);
+		char *end;
+
+		if (key == "cpus") {
+			if (!parseCpus(value, parsed.cpus)) return false;
+		} else if (key == "threads") {
+			parsed.threads = strtoul(value.c_str(), &end, 10);
+			if (*end != '\0' || parsed.threads == 0) return false;
+		} else if (key == "priority") {
+			parsed.priority = strtol(value.c_str(), &end, 10);
+			if (*end != '\0' || parsed.priority < 0 || parsed.priority > 99) return false;
+		} else {
+			return false;
+		}
+	}
+
+	placement = parsed;
+	return true;
+}
+
+bool NTThreadPlacement::apply() const
+{
+	bool result = true;
+
+#ifdef NT_THREAD_PLACEMENT
+	if (!cpus.empty()) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (size_t i = 0; i < cpus.size(); ++i)
+			if (cpus[i] < CPU_SETSIZE) CPU_SET(cpus[i], &set);
+
+		int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+		if (error) {
+			cerr << "Failed to pin thread to its cpus: " << strerror(error) << "\n";
+			result = false;
+		}
+	}
+
+	if (priority > 0) {
+		struct sched_param param;
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = priority;
+
+		int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		if (error) {
+			cerr << "Failed to set real time priority " << priority << ": " << strerror(error) << "\n";
+			result = false;
+		}
+	}
+#endif
+
+	return result;
+}
+
+void NTThreadPlacement::set(string const &role, NTThreadPlacement const &placement)
+{
+	Lock lock(placementsMutex);
+	placements[role] = placement;
+}
+
+NTThreadPlacement NTThreadPlacement::get(string const &role)
+{
+	Lock lock(placementsMutex);
+
+	map<string, NTThreadPlacement>::const_iterator it = placements.find(role);
+	return it == placements.end() ? NTThreadPlacement() : it->second;
+}
+
+void NTThreadPlacement::applyRole(string const &role)
+{
+	get(role).apply();
+}
+
+int NTThreadPlacement::currentCpu()
+{
+#ifdef NT_THREAD_PLACEMENT
+	return sched_getcpu();
+#else
+	return -1;
+#endif
+}
+
+long NTThreadPlacement::currentThread()
+{
+#ifdef NT_THREAD_PLACEMENT
+	// A system call, so it is made once per thread.
+	static __thread long thread = 0;
+	if (!thread) thread = syscall(SYS_gettid);
+	return thread;
+#else
+	return -1;
+#endif
+}
+
+#ifdef NT_THREAD_PLACEMENT
+
+// Formats a cpu set as a list of cpus and ranges such as 0-3,8.
+static string formatCpus(cpu_set_t const &set)
+{
+	stringstream out;
+	bool first = true;
+
+	for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+		if (!CPU_ISSET(cpu, &set)) continue;
+
+		int last = cpu;
+		while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &set)) ++last;
+
+		out << (first ? "" : ",") << cpu;
+		if (last > cpu) out << "-" << last;
+
+		first = false;
+		cpu = last;
+	}
+
+	return out.str();
+}
+
+// Cpu the thread last ran on, field 39 of its stat file.
+static int lastCpu(string const &directory)
+{
+	ifstream stat((directory + "/stat").c_str());
+	string line;
+	getline(stat, line);
+
+	// The name, in parentheses, may hold blanks, so count from after it.
+	size_t close = line.rfind(')');
+	if (close == string::npos) return -1;
+
+	stringstream fields(line.substr(close + 1));
+	string field;
+	for (int i = 3; i <= 39 && fields >> field; ++i)
+		if (i == 39) return atoi(field.c_str());
+
+	return -1;
+}
+
+#endif
+
+void NTThreadPlacement::writeThreads(ostream &out)
+{
+#ifdef NT_THREAD_PLACEMENT
+	DIR *tasks = opendir("/proc/self/task");
+	if (!tasks) return;
+
+	vector<long> threads;
+	struct dirent *entry;
+	while ((entry = readdir(tasks)) != NULL) {
+		long thread = atol(entry->d_name);
+		if (thread > 0) threads.push_back(thread);
+	}
+	closedir(tasks);
+
+	sort(threads.begin(), threads.end());
+
+	for (size_t i = 0; i < threads.size(); ++i) {
+		stringstream directory;
+		directory << "/proc/self/task/" << threads[i];
+
+		string name;
+		ifstream comm((directory.str() + "/comm").c_str());
+		getline(comm, name);
+
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		sched_getaffinity(threads[i], sizeof(set), &set);
+
+		struct sched_param param;
+		memset(&param, 0, sizeof(param));
+		int policy = sched_getscheduler(threads[i]);
+		sched_getparam(threads[i], &param);
+
+		out << "thread " << threads[i] << " " << name
+		    << " cpu " << lastCpu(directory.str())
+		    << " cpus " << formatCpus(set)
+		    << " priority ";
+		if (policy == SCHED_FIFO || policy == SCHED_RR) out << param.sched_priority << "\n";
+		else out << "0\n";
+	}
+#endif
+}
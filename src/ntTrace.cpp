@@ -0,0 +1,183 @@
+/*
+ * =============================================================
+ *
+ * 	ntTrace.cpp
+ *
+ *	Source file that implements the latency tracing of the
+ *	stages of a request.
+ *
+ * =============================================================
+ */
+
+#include <pv/ntTrace.h>
+
+#include <cstring>
+#include <iomanip>
+#include <vector>
+
+#include <unistd.h>
+
+#include <epicsAtomic.h>
+#include <epicsThread.h>
+#include <pv/lock.h>
+
+#include <pv/ntThreadPlacement.h>
+
+using namespace std;
+using namespace epics::pvData;
+using namespace epics::ntDatabase;
+
+struct TraceEvent {
+	const char *name;
+	char label[40];
+	epicsUInt64 start;
+	epicsUInt64 end;
+};
+
+/*
+ * Stages recorded by one thread. Only the thread writes events and head,
+ * which counts the events ever added. A reader copies an event and then
+ * checks that head has not since moved a whole ring past it.
+ */
+struct TraceRing {
+	TraceRing(long thread, string const &threadName)
+		: thread(thread), threadName(threadName), head(0), first(0),
+		  events(NTTrace::ringSize) {}
+
+	long thread;
+	string threadName;
+	size_t head;
+	// Events before first were cleared. Written only by readers.
+	size_t first;
+	vector<TraceEvent> events;
+};
+
+static volatile int enabled = 0;
+
+// Every ring ever made, so that those of threads gone are still written.
+static Mutex ringsMutex;
+static vector<TraceRing *> rings;
+
+static epicsThreadPrivate<TraceRing> threadRing;
+
+static TraceRing *getRing()
+{
+	TraceRing *ring = threadRing.get();
+	if (ring) return ring;
+
+	Lock lock(ringsMutex);
+
+	long thread = NTThreadPlacement::currentThread();
+	if (thread < 0) thread = (long) rings.size() + 1;
+
+	ring = new TraceRing(thread, epicsThreadGetNameSelf());
+	rings.push_back(ring);
+	threadRing.set(ring);
+
+	return ring;
+}
+
+void NTTrace::enable(bool on)
+{
+	enabled = on;
+}
+
+bool NTTrace::isEnabled()
+{
+	return enabled;
+}
+
+void NTTrace::record(
+	const char *name,
+	string const &label,
+	epicsUInt64 start,
+	epicsUInt64 end)
+{
+	if (!enabled) return;
+
+	TraceRing *ring = getRing();
+	size_t head = ring->head;
+	TraceEvent &event = ring->events[head % ringSize];
+
+	event.name = name;
+	size_t length = label.size() < sizeof(event.label) - 1 ? label.size() : sizeof(event.label) - 1;
+	memcpy(event.label, label.data(), length);
+	event.label[length] = '\0';
+	event.start = start;
+	event.end = end;
+
+	// Publishes the event to readers.
+	epicsAtomicSetSizeT(&ring->head, head + 1);
+}
+
+void NTTrace::clear()
+{
+	Lock lock(ringsMutex);
+
+	for (size_t i = 0; i < rings.size(); ++i)
+		rings[i]->first = epicsAtomicGetSizeT(&rings[i]->head);
+}
+
+// Writes text as a JSON string.
+static void writeString(ostream &out, const char *text)
+{
+	out << '"';
+	for (; *text; ++text) {
+		if (*text == '"' || *text == '\\') out << '\\' << *text;
+		else if ((unsigned char) *text < 0x20) out << ' ';
+		else out << *text;
+	}
+	out << '"';
+}
+
+void NTTrace::writeChrome(ostream &out)
+{
+	long pid = getpid();
+	bool firstEvent = true;
+
+	out << "{\"traceEvents\": [";
+
+	Lock lock(ringsMutex);
+
+	for (size_t i = 0; i < rings.size(); ++i) {
+		TraceRing &ring = *rings[i];
+
+		size_t head = epicsAtomicGetSizeT(&ring.head);
+		size_t begin = head > ringSize ? head - ringSize : 0;
+		if (begin < ring.first) begin = ring.first;
+
+		vector<TraceEvent> copy;
+		copy.reserve(head - begin);
+		for (size_t j = begin; j < head; ++j)
+			copy.push_back(ring.events[j % ringSize]);
+
+		// The events the thread may have written over during the copy.
+		size_t after = epicsAtomicGetSizeT(&ring.head);
+		size_t skip = (after > ringSize && after - ringSize + 1 > begin) ? after - ringSize + 1 - begin : 0;
+		if (skip > copy.size()) skip = copy.size();
+
+		out << (firstEvent ? "\n" : ",\n")
+		    << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << pid
+		    << ", \"tid\": " << ring.thread << ", \"args\": {\"name\": ";
+		writeString(out, ring.threadName.c_str());
+		out << "}}";
+		firstEvent = false;
+
+		for (size_t j = skip; j < copy.size(); ++j) {
+			TraceEvent const &event = copy[j];
+
+			out << ",\n{\"name\": ";
+			writeString(out, event.name);
+			out << ", \"cat\": \"ntDatabase\", \"ph\": \"X\""
+			    << fixed << setprecision(3)
+			    << ", \"ts\": " << event.start / 1e3
+			    << ", \"dur\": " << (event.end - event.start) / 1e3
+			    << ", \"pid\": " << pid << ", \"tid\": " << ring.thread
+			    << ", \"args\": {\"label\": ";
+			writeString(out, event.label);
+			out << "}}";
+		}
+	}
+
+	out << "\n], \"displayTimeUnit\": \"ns\"}\n";
+}
@@ -0,0 +1,183 @@
+#ifndef NTADMISSION_H
+#define NTADMISSION_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntAdmissionEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <epicsEvent.h>
+#include <epicsThread.h>
+#include <epicsTypes.h>
+#include <pv/lock.h>
+#include <pv/sharedPtr.h>
+
+#ifdef ntAdmissionEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntAdmissionEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTAdmission;
+	typedef std::tr1::shared_ptr<NTAdmission> NTAdmissionPtr;
+
+	class NTAdmissionTask;
+	typedef std::tr1::shared_ptr<NTAdmissionTask> NTAdmissionTaskPtr;
+
+	// Limits applied by a NTAdmission to each client connection.
+	struct epicsShareClass NTAdmissionOptions {
+		NTAdmissionOptions() : workers(0), rate(0.0), burst(0.0), queueDepth(64) {}
+
+		// Threads running the admitted requests, 0 to serve the requests
+		// in the server's threads without admission control.
+		size_t workers;
+		// Requests per second a connection may make, 0 for no limit, and
+		// the most it may make at once, at least 1. A burst of 0 is one
+		// second of requests.
+		double rate;
+		double burst;
+		// Requests of a connection waiting or running before further ones
+		// are refused.
+		size_t queueDepth;
+		// Share of the workers' time given to the connections from a host,
+		// relative to the 1 of the hosts not listed.
+		std::map<std::string, double> weights;
+
+		// Parses keys separated by colons, for example
+		//
+		//	workers=4:rate=1000:burst=100:depth=64
+		//
+		// into options, keeping the weights. Returns false if text is
+		// malformed.
+		static bool parse(std::string const &text, NTAdmissionOptions &options);
+	};
+
+	// A request of a client, run by a worker once admitted.
+	class epicsShareClass NTAdmissionTask {
+		public:
+			POINTER_DEFINITIONS(NTAdmissionTask);
+
+			virtual ~NTAdmissionTask() {}
+
+			// Does the request. Returns false if it is still outstanding
+			// when run() returns, in which case NTAdmission::finish() is
+			// called when it ends.
+			virtual bool run() = 0;
+
+			// Answers the request with an error instead of running it.
+			virtual void refuse(std::string const &reason) = 0;
+	};
+
+	/*
+	 * Admission control and fair scheduling of the requests of client
+	 * connections.
+	 *
+	 * Each connection has a token bucket, refilled at rate up to burst
+	 * tokens, and a request finding it empty is refused at once, as is a
+	 * request of a connection with queueDepth requests already waiting or
+	 * running. Requests admitted wait in a queue per connection and the
+	 * workers take the connections in deficit round robin: a connection
+	 * gets its weight in requests per round, so a client flooding the
+	 * server only lengthens its own queue. A connection's requests run one
+	 * at a time, in the order they arrived.
+	 *
+	 * The workers take the io placement (see pv/ntThreadPlacement.h), as
+	 * they process the records written by clients.
+	 */
+	class epicsShareClass NTAdmission {
+		public:
+			POINTER_DEFINITIONS(NTAdmission);
+
+			class Client;
+			typedef std::tr1::shared_ptr<Client> ClientPtr;
+
+			// Admission counters of a connection.
+			struct Counters {
+				std::string client;
+				double weight;
+				size_t admitted;
+				// Refused by the rate limit and by the queue depth limit.
+				size_t throttled;
+				size_t rejected;
+				// Requests waiting or running now.
+				size_t queued;
+				// Seconds from arrival until a worker took the request.
+				double meanWait;
+				double maxWait;
+			};
+
+			// Starts the workers.
+			static NTAdmissionPtr create(NTAdmissionOptions const &options);
+
+			virtual ~NTAdmission();
+
+			// Returns the connection named client, such as the host:port of
+			// a pvAccess client, counting one more user of it. Its
+			// counters are kept until every user has called disconnect().
+			ClientPtr connect(std::string const &client);
+			void disconnect(ClientPtr const &client);
+
+			// Queues task for a worker or refuses it at once, in the
+			// caller's thread. Returns false if it was refused.
+			bool submit(ClientPtr const &client, NTAdmissionTaskPtr const &task);
+
+			// Ends a request whose run() returned false.
+			void finish(ClientPtr const &client);
+
+			// Counters of each connection, in order of name, then of the
+			// connections gone, summed as client "closed".
+			std::vector<Counters> getCounters();
+
+			// Requests refused by every connection so far, by the rate and
+			// queue depth limits.
+			size_t getThrottled();
+			size_t getRejected();
+
+			// Refuses the requests still waiting and stops the workers.
+			void stop();
+
+		private:
+			NTAdmission(NTAdmissionOptions const &options);
+
+			class Worker : public epicsThreadRunable {
+				public:
+					Worker(NTAdmission &admission, std::string const &name);
+					virtual void run();
+
+					NTAdmission &admission;
+					epicsThread thread;
+			};
+
+			// Runs admitted requests until stopped. Body of the workers.
+			void work();
+			// Takes the next request in deficit round robin order. Called
+			// with mutex held.
+			bool next(ClientPtr &client, NTAdmissionTaskPtr &task);
+
+			NTAdmissionOptions options;
+
+			epics::pvData::Mutex mutex;
+			std::map<std::string, ClientPtr> clients;
+			// Connections with requests waiting and none running.
+			std::deque<ClientPtr> ready;
+			// Sum of the connections gone.
+			ClientPtr closed;
+			size_t throttled;
+			size_t rejected;
+			bool stopping;
+			epicsEvent wakeUp;
+
+			std::vector<Worker *> workers;
+	};
+
+}}
+
+#endif /* NTADMISSION_H */
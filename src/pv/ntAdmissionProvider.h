@@ -0,0 +1,96 @@
+#ifndef NTADMISSIONPROVIDER_H
+#define NTADMISSIONPROVIDER_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntAdmissionProviderEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+
+#include <pv/pvData.h>
+#include <pv/pvAccess.h>
+
+#ifdef ntAdmissionProviderEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntAdmissionProviderEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntAdmission.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTAdmissionProvider;
+	typedef std::tr1::shared_ptr<NTAdmissionProvider> NTAdmissionProviderPtr;
+
+	/*
+	 * Channel provider serving the channels of another provider, usually
+	 * the local provider of the database, through a NTAdmission.
+	 *
+	 * Every request that changes or processes a record is submitted to
+	 * the admission as a request of the client connection, named by the
+	 * requester the server gives the channel, which for pvAccess is the
+	 * client's host:port: the put of a channelPut, the putGet of a
+	 * channelPutGet, the request of a channelRPC, the process of a
+	 * channelProcess and the putArray and setLength of a channelArray.
+	 * Refused requests are answered at once with an error status. The
+	 * requests that only read, getField, get, monitor and the getArray and
+	 * getLength of a channelArray, go straight to the wrapped provider.
+	 *
+	 * create() registers the provider under providerName, the name to
+	 * give startPVAServer(), and destroy() removes it.
+	 */
+	class epicsShareClass NTAdmissionProvider :
+		public epics::pvAccess::ChannelProvider,
+		public std::tr1::enable_shared_from_this<NTAdmissionProvider>
+	{
+		public:
+			POINTER_DEFINITIONS(NTAdmissionProvider);
+
+			static const std::string providerName;
+
+			static NTAdmissionProviderPtr create(
+				epics::pvAccess::ChannelProvider::shared_pointer const &provider,
+				NTAdmissionPtr const &admission);
+
+			virtual ~NTAdmissionProvider() {}
+
+			virtual std::string getProviderName() { return providerName; }
+
+			virtual void destroy();
+
+			virtual epics::pvAccess::ChannelFind::shared_pointer channelFind(
+				std::string const &channelName,
+				epics::pvAccess::ChannelFindRequester::shared_pointer const &requester);
+
+			virtual epics::pvAccess::ChannelFind::shared_pointer channelList(
+				epics::pvAccess::ChannelListRequester::shared_pointer const &requester);
+
+			virtual epics::pvAccess::Channel::shared_pointer createChannel(
+				std::string const &channelName,
+				epics::pvAccess::ChannelRequester::shared_pointer const &requester,
+				short priority);
+
+			virtual epics::pvAccess::Channel::shared_pointer createChannel(
+				std::string const &channelName,
+				epics::pvAccess::ChannelRequester::shared_pointer const &requester,
+				short priority,
+				std::string const &address);
+
+			NTAdmissionPtr getAdmission() const { return admission; }
+
+		private:
+			NTAdmissionProvider(
+				epics::pvAccess::ChannelProvider::shared_pointer const &provider,
+				NTAdmissionPtr const &admission);
+
+			epics::pvAccess::ChannelProvider::shared_pointer provider;
+			NTAdmissionPtr admission;
+			epics::pvAccess::ChannelProviderFactory::shared_pointer factory;
+	};
+
+}}
+
+#endif /* NTADMISSIONPROVIDER_H */
@@ -0,0 +1,71 @@
+#ifndef NTADMISSIONRECORD_H
+#define NTADMISSIONRECORD_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntAdmissionRecordEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+
+#include <pv/pvData.h>
+
+#ifdef ntAdmissionRecordEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntAdmissionRecordEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntRecord.h>
+#include <pv/ntAdmission.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTAdmissionRecord;
+	typedef std::tr1::shared_ptr<NTAdmissionRecord> NTAdmissionRecordPtr;
+
+	/*
+	 * NTTable record publishing the counters of a NTAdmission, a row per
+	 * client connection, with the columns
+	 *
+	 *	client      host:port of the connection, or closed for the
+	 *	            connections gone
+	 *	weight      its share of the workers
+	 *	admitted    requests admitted
+	 *	throttled   requests refused by the rate limit
+	 *	rejected    requests refused by the queue depth limit
+	 *	queued      requests waiting or running
+	 *	meanWait, maxWait
+	 *	            seconds from arrival until a worker took a request
+	 *
+	 * The record is processed by the NTProcessQueue every period seconds.
+	 */
+	class epicsShareClass NTAdmissionRecord : public NTRecord {
+		public:
+			POINTER_DEFINITIONS(NTAdmissionRecord);
+
+			static NTAdmissionRecordPtr create(
+				std::string const &recordName,
+				NTAdmissionPtr const &admission,
+				double period);
+
+			virtual ~NTAdmissionRecord() {}
+
+			virtual bool init();
+
+		protected:
+			NTAdmissionRecord(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure,
+				NTAdmissionPtr const &admission);
+
+			virtual void processRecord();
+
+		private:
+			NTAdmissionPtr admission;
+	};
+
+}}
+
+#endif /* NTADMISSIONRECORD_H */
@@ -0,0 +1,125 @@
+#ifndef NTAGGREGATERECORD_H
+#define NTAGGREGATERECORD_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntAggregateRecordEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+
+#include <pv/pvData.h>
+#include <pv/lock.h>
+#include <pv/pvTimeStamp.h>
+#include <pv/timeStamp.h>
+
+#ifdef ntAggregateRecordEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntAggregateRecordEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntRecord.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTAggregateRecord;
+	typedef std::tr1::shared_ptr<NTAggregateRecord> NTAggregateRecordPtr;
+
+	/*
+	 * NTAggregate record holding live statistics of another record.
+	 *
+	 * Once bound to a source record, every process() of the source adds
+	 * its value to the statistics: one sample for a scalar record, one per
+	 * element for an array record. The running mean and sum of squared
+	 * deviations are updated with Welford's method, merging a whole array
+	 * at once (Chan et al.), so no samples are kept. Every period the record
+	 * is processed by the NTProcessQueue and publishes the statistics of
+	 * the samples since the last publication:
+	 *
+	 *	value            mean
+	 *	N                number of samples
+	 *	dispersion       standard deviation
+	 *	first, last      first and last sample
+	 *	firstTimeStamp, lastTimeStamp
+	 *	                 time stamps of the source's first and last process()
+	 *	min, max         smallest and largest sample
+	 *
+	 * A period without samples publishes N = 0 and leaves the rest as it was.
+	 * The record also has a string field source naming the source record.
+	 */
+	class epicsShareClass NTAggregateRecord : public NTRecord {
+		public:
+			POINTER_DEFINITIONS(NTAggregateRecord);
+
+			// Builds the pvStructure of an aggregate record.
+			static epics::pvData::PVStructurePtr createPVStructure();
+
+			static NTAggregateRecordPtr create(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			virtual ~NTAggregateRecord() {}
+
+			virtual bool init();
+
+			// Starts collecting the statistics of the named record, which must
+			// be a NTRecord with a numeric scalar or array value, and
+			// publishing them every period seconds. Returns false, after
+			// printing why and raising the record's alarm, if the record can
+			// not be used.
+			bool bind(std::string const &sourceName, double period);
+
+			// Adds count samples taken by a process() of the source at timeStamp.
+			void accumulate(
+				double const *values,
+				size_t count,
+				epics::pvData::TimeStamp const &timeStamp);
+
+		protected:
+			NTAggregateRecord(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			virtual void processRecord();
+
+		private:
+			// Raises the alarm of a record that could not be bound.
+			void refuse(std::string const &message);
+
+			// Statistics of the samples since the last publication.
+			struct Statistics {
+				Statistics() : count(0), mean(0.0), m2(0.0), first(0.0), last(0.0), min(0.0), max(0.0) {}
+
+				epics::pvData::int64 count;
+				double mean;
+				// Sum of the squared deviations from the mean.
+				double m2;
+				double first;
+				double last;
+				double min;
+				double max;
+				epics::pvData::TimeStamp firstTimeStamp;
+				epics::pvData::TimeStamp lastTimeStamp;
+			};
+
+			// Guards statistics, which the source's listener updates while
+			// the source is locked and this record may not be.
+			epics::pvData::Mutex statisticsMutex;
+			Statistics statistics;
+
+			epics::pvData::PVDoublePtr pvValue;
+			epics::pvData::PVLongPtr pvN;
+			epics::pvData::PVDoublePtr pvDispersion;
+			epics::pvData::PVDoublePtr pvFirst;
+			epics::pvData::PVDoublePtr pvLast;
+			epics::pvData::PVDoublePtr pvMin;
+			epics::pvData::PVDoublePtr pvMax;
+			epics::pvData::PVTimeStamp pvFirstTimeStamp;
+			epics::pvData::PVTimeStamp pvLastTimeStamp;
+	};
+
+}}
+
+#endif /* NTAGGREGATERECORD_H */
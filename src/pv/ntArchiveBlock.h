@@ -0,0 +1,69 @@
+#ifndef NTARCHIVEBLOCK_H
+#define NTARCHIVEBLOCK_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntArchiveBlockEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <vector>
+
+#include <pv/pvData.h>
+
+#ifdef ntArchiveBlockEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntArchiveBlockEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	// A sample of an archived record.
+	struct NTArchiveSample {
+		epics::pvData::int64 time;      // nanoseconds past the epoch
+		double value;
+		epics::pvData::int32 severity;
+		epics::pvData::int32 status;
+	};
+
+	/*
+	 * Encoding of a block of samples in an archive segment file.
+	 *
+	 * A block holds consecutive samples of one record stored column by
+	 * column behind a header of five little endian 32 bit words:
+	 *
+	 *	magic, sample count, time bytes, value bytes, alarm bytes
+	 *
+	 * The time column holds the first time, the first delta and then the
+	 * delta of each delta as zigzag varints, so samples taken at a steady
+	 * rate cost about one byte of time each. The value column is the XOR
+	 * encoding of Gorilla (Pelkonen et al., VLDB 2015): a repeated value
+	 * costs one bit and a slowly changing one only its changed mantissa
+	 * bits. The alarm column is run length encoded since the alarm seldom
+	 * changes between samples.
+	 */
+	class epicsShareClass NTArchiveBlock {
+		public:
+			// Appends the encoded block of count samples to out.
+			static void encode(
+				NTArchiveSample const *samples,
+				size_t count,
+				std::vector<epics::pvData::uint8> &out);
+
+			// Appends the samples of the block held in data to out.
+			// Returns false if the block is malformed, including a count of
+			// more than blockSamples or than its columns can hold.
+			static bool decode(
+				epics::pvData::uint8 const *data,
+				size_t length,
+				std::vector<NTArchiveSample> &out);
+
+			static const size_t headerSize = 20;
+			// Most samples in a block. The writer splits larger batches.
+			static const size_t blockSamples = 4096;
+	};
+
+}}
+
+#endif /* NTARCHIVEBLOCK_H */
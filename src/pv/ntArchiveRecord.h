@@ -0,0 +1,61 @@
+#ifndef NTARCHIVERECORD_H
+#define NTARCHIVERECORD_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntArchiveRecordEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+
+#include <pv/pvData.h>
+
+#ifdef ntArchiveRecordEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntArchiveRecordEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntArchiver.h>
+#include <pv/ntHistoryRecord.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTArchiveRecord;
+	typedef std::tr1::shared_ptr<NTArchiveRecord> NTArchiveRecordPtr;
+
+	/*
+	 * Service record that queries the on disk archive. It takes the same
+	 * argument and returns the same result as the history record.
+	 */
+	class epicsShareClass NTArchiveRecord : public NTHistoryRecord {
+		public:
+			POINTER_DEFINITIONS(NTArchiveRecord);
+
+			static NTArchiveRecordPtr create(
+				std::string const &recordName,
+				NTArchiverPtr const &archiver);
+
+			virtual ~NTArchiveRecord() {}
+
+		protected:
+			NTArchiveRecord(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure,
+				NTArchiverPtr const &archiver);
+
+			virtual void query(
+				std::string const &recordName,
+				double start,
+				double end,
+				size_t maxPoints,
+				epics::pvData::PVStructurePtr const &result);
+
+		private:
+			NTArchiverPtr archiver;
+	};
+
+}}
+
+#endif /* NTARCHIVERECORD_H */
@@ -0,0 +1,173 @@
+#ifndef NTARCHIVER_H
+#define NTARCHIVER_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntArchiverEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <epicsEvent.h>
+#include <epicsThread.h>
+
+#include <pv/pvData.h>
+#include <pv/lock.h>
+
+#ifdef ntArchiverEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntArchiverEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntArchiveBlock.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTArchiver;
+	typedef std::tr1::shared_ptr<NTArchiver> NTArchiverPtr;
+
+	/*
+	 * Archive of the samples of records in local append only files.
+	 *
+	 * Each archived record has a directory below the archive directory
+	 * holding its segment files. A segment is a sequence of blocks
+	 * (see NTArchiveBlock) and is accompanied by an index file with one
+	 * entry per block:
+	 *
+	 *	int64 first time, int64 last time, int64 offset, uint32 length,
+	 *	uint32 sample count
+	 *
+	 * stored little endian. Segments are named by the time of their first
+	 * sample and a new one is started once a segment reaches the segment
+	 * size. Files are only ever appended to, so a query can read them
+	 * while they are written.
+	 *
+	 * append() only queues a sample. A background thread writes the queued
+	 * samples of each record as one block every flush period, or sooner
+	 * when many samples are queued, so record processing never waits on
+	 * the disk. A query sees a sample once it has been written. At most
+	 * pendingLimit samples wait for the writer; while the disk is too slow
+	 * to keep up, further samples are dropped and counted.
+	 *
+	 * Only the records given to addStream() are archived and queried, so a
+	 * record name never leads outside the archive directory.
+	 */
+	class epicsShareClass NTArchiver : public epicsThreadRunable {
+		public:
+			POINTER_DEFINITIONS(NTArchiver);
+
+			// Samples queued for the writer before further ones are dropped.
+			static const size_t pendingLimit = 1024 * 1024;
+			// Most samples a query returns.
+			static const size_t queryLimit = 100000;
+
+			// Creates the archive directory if needed and starts the writer
+			// thread. Returns a null pointer if the directory is unusable.
+			static NTArchiverPtr create(
+				std::string const &directory,
+				double flushPeriod = 1.0,
+				size_t segmentSize = 64 * 1024 * 1024);
+
+			virtual ~NTArchiver();
+
+			// Prepares the archive of a record. Returns the stream to pass to
+			// append(), the same one for a record already archived, or -1 if
+			// the name is not a single path component or the record's
+			// directory can not be created.
+			int addStream(std::string const &recordName);
+
+			// Undoes an addStream(). Once every addStream() of the record is
+			// undone, its queued samples are written and its files closed.
+			// The samples already archived stay on disk, but the record is
+			// no longer queried.
+			void removeStream(int stream);
+
+			// Returns true if addStream() was called for the record.
+			bool isArchived(std::string const &recordName);
+
+			// Queues a sample of a stream, or drops it if pendingLimit
+			// samples are already queued.
+			void append(int stream, NTArchiveSample const &sample);
+
+			// Samples dropped so far because the queue was full.
+			size_t getDropped();
+
+			// Writes every queued sample.
+			void flush();
+
+			// Writes the queued samples and stops the writer thread.
+			void stop();
+
+			/*
+			 * Copies the archived samples of a record with start <= time <= end
+			 * into result, which must have the layout of
+			 * NTHistoryBuffer::createResultField(), and decimates them to
+			 * maxPoints as NTHistoryBuffer::query() does. Times are seconds
+			 * past the epoch. Returns the number of samples copied, 0 if the
+			 * record is not archived.
+			 *
+			 * The samples are picked while the blocks are read, so a query
+			 * never holds more than its result. At most queryLimit samples
+			 * are returned: a larger maxPoints is lowered to it, and a
+			 * query without maxPoints matching more samples throws.
+			 */
+			size_t query(
+				std::string const &recordName,
+				double start,
+				double end,
+				size_t maxPoints,
+				epics::pvData::PVStructurePtr const &result);
+
+			std::string const &getDirectory() const { return directory; }
+
+			virtual void run();
+
+		private:
+			NTArchiver(std::string const &directory, double flushPeriod, size_t segmentSize);
+
+			struct Stream {
+				std::string name;
+				std::string path;
+				// Calls of addStream() not yet undone.
+				size_t users;
+				std::vector<NTArchiveSample> pending;
+				std::FILE *segment;
+				std::FILE *index;
+				size_t segmentBytes;
+			};
+			typedef std::tr1::shared_ptr<Stream> StreamPtr;
+
+			void write(Stream &stream, std::vector<NTArchiveSample> const &samples);
+			bool openSegment(Stream &stream, epics::pvData::int64 time);
+			void closeSegment(Stream &stream);
+
+			std::string directory;
+			double flushPeriod;
+			size_t segmentSize;
+
+			// Guards the streams, their pending samples and the counters.
+			epics::pvData::Mutex mutex;
+			// Serializes writes to the files.
+			epics::pvData::Mutex writeMutex;
+			// Indexed by stream, null for the streams removed.
+			std::vector<StreamPtr> streams;
+			// Stream of each archived record.
+			std::map<std::string, int> streamOf;
+			size_t pendingCount;
+			size_t dropped;
+			// Samples dropped since the writer last caught up.
+			size_t droppedSinceFlush;
+			bool stopping;
+
+			epicsEvent wakeUp;
+			epicsThread thread;
+	};
+
+}}
+
+#endif /* NTARCHIVER_H */
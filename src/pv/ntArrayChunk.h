@@ -0,0 +1,95 @@
+#ifndef NTARRAYCHUNK_H
+#define NTARRAYCHUNK_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntArrayChunkEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <pv/pvData.h>
+
+#ifdef ntArrayChunkEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntArrayChunkEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	/*
+	 * Chunked reads of a record's array.
+	 *
+	 * A record that supports them has a chunk structure:
+	 *
+	 *	chunk
+	 *		int offset
+	 *		int length
+	 *		int size
+	 *		<array or union of arrays> value
+	 *
+	 * A processing put of chunk.offset and chunk.length copies that range
+	 * of the record's array into chunk.value and sets chunk.size to the
+	 * length of the whole array. A client reads a large array by getting
+	 * one chunk after another, so neither end holds more than a chunk at a
+	 * time for the transfer. A put of length 0 releases the chunk.
+	 *
+	 * The chunk served last is kept while neither the requested range nor
+	 * the record's array change, so processing the record again, or
+	 * putting the same range, does not copy it again. A record that writes
+	 * into its array in place calls invalidate().
+	 */
+	class epicsShareClass NTArrayChunk {
+		public:
+			// Builds the chunk structure. valueField is the introspection
+			// interface of chunk.value: a scalar array or a union of them.
+			static epics::pvData::StructureConstPtr createField(
+				epics::pvData::FieldConstPtr const &valueField);
+
+			// The chunk last copied into chunk.value and where it came from.
+			struct Served {
+				Served() : valid(false), sourceData(0), sourceSize(0), offset(0), length(0) {}
+
+				bool valid;
+				std::tr1::weak_ptr<const void> source;
+				const void *sourceData;
+				size_t sourceSize;
+				size_t offset;
+				size_t length;
+				std::tr1::weak_ptr<const void> chunk;
+			};
+
+			NTArrayChunk() {}
+
+			// Attaches to a record's chunk structure. Returns false if it does not have the above layout.
+			bool attach(epics::pvData::PVStructurePtr const &pvChunk);
+
+			// Serves the requested chunk of an array.
+			void serve(epics::pvData::PVScalarArrayPtr const &pvArray);
+			// Serves the requested chunk of the array selected in a union.
+			void serve(epics::pvData::PVUnionPtr const &pvArray);
+
+			// Copies the chunk again at the next serve(), after the array
+			// was written in place.
+			void invalidate();
+
+		private:
+			// Copies the requested range of pvArray into pvChunkValue, or empties
+			// pvChunkValue if no range is requested. Returns false if
+			// pvChunkValue was left as it was.
+			bool copyRange(
+				epics::pvData::PVScalarArrayPtr const &pvArray,
+				epics::pvData::PVScalarArrayPtr const &pvChunkValue);
+
+			epics::pvData::PVIntPtr pvOffset;
+			epics::pvData::PVIntPtr pvLength;
+			epics::pvData::PVIntPtr pvSize;
+			epics::pvData::PVScalarArrayPtr pvValue;
+			epics::pvData::PVUnionPtr pvUnionValue;
+
+			Served served;
+	};
+
+}}
+
+#endif /* NTARRAYCHUNK_H */
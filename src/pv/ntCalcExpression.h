@@ -0,0 +1,96 @@
+#ifndef NTCALCEXPRESSION_H
+#define NTCALCEXPRESSION_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntCalcExpressionEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+#include <vector>
+
+#include <pv/pvData.h>
+
+#ifdef ntCalcExpressionEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntCalcExpressionEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTCalcExpression;
+	typedef std::tr1::shared_ptr<NTCalcExpression> NTCalcExpressionPtr;
+
+	/*
+	 * Arithmetic expression over the values of records, compiled once into
+	 * bytecode for a small stack machine.
+	 *
+	 *	expression := term { ('+' | '-') term }
+	 *	term       := unary { ('*' | '/' | '%') unary }
+	 *	unary      := '-' unary | power
+	 *	power      := primary [ '^' unary ]
+	 *	primary    := number | record | function '(' arguments ')'
+	 *	            | reduction '(' record ')' | '(' expression ')'
+	 *
+	 * A record stands for the value of a scalar record. The reductions
+	 * sum, mean and size stand for a value computed from the array of an
+	 * array record. The functions are abs, sqrt, exp, log, log10, sin, cos,
+	 * tan, floor and ceil of one argument and min, max, pow and atan2 of two.
+	 *
+	 * Each distinct use of a record, plain or reduced, is an input of the
+	 * expression. The caller keeps the current value of every input and
+	 * passes them to evaluate(), so only an input whose record changed has
+	 * to be computed again.
+	 */
+	class epicsShareClass NTCalcExpression {
+		public:
+			POINTER_DEFINITIONS(NTCalcExpression);
+
+			enum Reduction { value, sum, mean, size };
+
+			struct Input {
+				std::string recordName;
+				Reduction reduction;
+			};
+
+			// Compiles an expression. Throws std::runtime_error naming the
+			// position of the first error, also for an expression nested
+			// more than maxStackDepth unary and primary levels deep.
+			static NTCalcExpressionPtr compile(std::string const &expression);
+
+			std::string const &getExpression() const { return expression; }
+			std::vector<Input> const &getInputs() const { return inputs; }
+
+			// Evaluates the expression with inputs[i] the value of getInputs()[i].
+			double evaluate(double const *inputs) const;
+
+			// Deepest stack evaluate() may use.
+			static const size_t maxStackDepth = 64;
+
+		private:
+			friend class NTCalcCompiler;
+
+			enum Opcode {
+				pushConstant, pushInput,
+				add, subtract, multiply, divide, modulo, power, negate,
+				call1, call2
+			};
+
+			struct Instruction {
+				Opcode opcode;
+				size_t operand;
+			};
+
+			NTCalcExpression() {}
+
+			std::string expression;
+			std::vector<Input> inputs;
+			std::vector<Instruction> code;
+			std::vector<double> constants;
+	};
+
+}}
+
+#endif /* NTCALCEXPRESSION_H */
@@ -0,0 +1,89 @@
+#ifndef NTCALCRECORD_H
+#define NTCALCRECORD_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntCalcRecordEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+#include <vector>
+
+#include <pv/pvData.h>
+#include <pv/lock.h>
+
+#ifdef ntCalcRecordEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntCalcRecordEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntCalcExpression.h>
+#include <pv/ntRecord.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTCalcRecord;
+	typedef std::tr1::shared_ptr<NTCalcRecord> NTCalcRecordPtr;
+
+	/*
+	 * NTScalar double record whose value is an expression over the values
+	 * of other records, see NTCalcExpression. The record also has a string
+	 * field expression holding the expression's text.
+	 *
+	 * The expression is compiled once. The record listens to the process()
+	 * of each record it uses and keeps the value of each input, so a change
+	 * costs computing the one input that changed, reducing its array if it
+	 * has one, and running the bytecode. The record is processed by the
+	 * NTProcessQueue, not by the changing record, and only when an input's
+	 * value actually changed.
+	 *
+	 * The records used must exist when the calc record is created, and must
+	 * be NTRecords. If the result is not finite the alarm is raised.
+	 */
+	class epicsShareClass NTCalcRecord : public NTRecord {
+		public:
+			POINTER_DEFINITIONS(NTCalcRecord);
+
+			// Builds the pvStructure of a calc record.
+			static epics::pvData::PVStructurePtr createPVStructure();
+
+			// Compiles expression and binds its inputs. Returns a null pointer,
+			// after printing why, if either fails.
+			static NTCalcRecordPtr create(
+				std::string const &recordName,
+				std::string const &expression);
+
+			virtual ~NTCalcRecord() {}
+
+			virtual bool init();
+
+			// Sets an input to value and, if it changed, requests a process().
+			void setInput(size_t input, double value);
+
+		protected:
+			NTCalcRecord(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure,
+				NTCalcExpressionPtr const &expression);
+
+			virtual void processRecord();
+
+		private:
+			bool bindInputs();
+
+			NTCalcExpressionPtr expression;
+			epics::pvData::PVDoublePtr pvValue;
+
+			// Guards inputValues, which the listeners set while the input
+			// records are locked and this record may not be.
+			epics::pvData::Mutex inputMutex;
+			std::vector<double> inputValues;
+			// Copy of the inputs used by processRecord().
+			std::vector<double> evaluatedValues;
+	};
+
+}}
+
+#endif /* NTCALCRECORD_H */
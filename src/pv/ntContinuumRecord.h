@@ -0,0 +1,99 @@
+#ifndef NTCONTINUUMRECORD_H
+#define NTCONTINUUMRECORD_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntContinuumRecordEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+
+#include <pv/pvData.h>
+
+#ifdef ntContinuumRecordEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntContinuumRecordEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntRecord.h>
+#include <pv/ntResampler.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTContinuumRecord;
+	typedef std::tr1::shared_ptr<NTContinuumRecord> NTContinuumRecordPtr;
+
+	/*
+	 * NTContinuum record holding a waveform sampled at non-uniform points,
+	 * value[i] at base[i], that resamples it onto a uniform grid on request.
+	 *
+	 * Besides the normative type fields the record has a resample structure:
+	 *
+	 *	resample
+	 *		double start
+	 *		double step
+	 *		int count         number of grid points, 0 for none, at most
+	 *		                  maxResampleCount
+	 *		string method     "linear" (the default) or "cubic"
+	 *		double[] value    the waveform at start + j * step
+	 *
+	 * A client reads the waveform on its grid with
+	 *
+	 *	record[process=true]putField(resample.start,resample.step,resample.count,
+	 *		resample.method)getField(resample.value)
+	 *
+	 * The result is kept until the waveform or the grid changes, so clients
+	 * reading on the same grid share one computation. A count above
+	 * maxResampleCount raises the alarm and leaves resample.value alone.
+	 * See NTResampler.
+	 */
+	class epicsShareClass NTContinuumRecord : public NTRecord {
+		public:
+			POINTER_DEFINITIONS(NTContinuumRecord);
+
+			// Most grid points a client may ask for, 8 MB of doubles.
+			static const epics::pvData::int32 maxResampleCount = 1024 * 1024;
+
+			// Builds the pvStructure of a continuum record.
+			static epics::pvData::PVStructurePtr createPVStructure();
+
+			static NTContinuumRecordPtr create(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			virtual ~NTContinuumRecord() {}
+
+			virtual bool init();
+
+		protected:
+			NTContinuumRecord(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			virtual void processRecord();
+
+		private:
+			epics::pvData::PVDoubleArrayPtr pvBase;
+			epics::pvData::PVDoubleArrayPtr pvValue;
+			epics::pvData::PVDoublePtr pvStart;
+			epics::pvData::PVDoublePtr pvStep;
+			epics::pvData::PVIntPtr pvCount;
+			epics::pvData::PVStringPtr pvMethod;
+			epics::pvData::PVDoubleArrayPtr pvResampled;
+
+			NTResampler resampler;
+			// Set when the waveform changed since resample.value was computed.
+			bool stale;
+
+			// Grid of resample.value.
+			double cachedStart;
+			double cachedStep;
+			epics::pvData::int32 cachedCount;
+			NTResampler::Method cachedMethod;
+	};
+
+}}
+
+#endif /* NTCONTINUUMRECORD_H */
@@ -0,0 +1,135 @@
+#ifndef NTCONTROLLOOP_H
+#define NTCONTROLLOOP_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntControlLoopEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <pv/sharedPtr.h>
+
+#ifdef ntControlLoopEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols
+#	undef  ntControlLoopEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTControlCommand;
+	typedef std::tr1::shared_ptr<NTControlCommand> NTControlCommandPtr;
+
+	class NTControlLoop;
+	typedef std::tr1::shared_ptr<NTControlLoop> NTControlLoopPtr;
+
+	// A command of a NTControlLoop.
+	class epicsShareClass NTControlCommand {
+		public:
+			POINTER_DEFINITIONS(NTControlCommand);
+
+			virtual ~NTControlCommand() {}
+
+			// Runs the command with the rest of its line and returns the reply.
+			// Throws to reply with an error.
+			virtual std::string execute(std::string const &argument) = 0;
+	};
+
+	/*
+	 * Main loop of the database server.
+	 *
+	 * The loop sleeps in poll() until something needs it: SIGINT or
+	 * SIGTERM, which end it, a connection or command on the control socket,
+	 * or a line of the console. It never reads the console if standard
+	 * input is not a terminal, so the server runs unattended under a
+	 * service manager and is controlled through the socket instead.
+	 *
+	 * The control socket is a UNIX domain stream socket. A client writes
+	 * one command per line, the command's name followed by its argument,
+	 * and each reply is followed by an empty line:
+	 *
+	 *	> echo stats | socat - UNIX-CONNECT:/run/ntDatabase.sock
+	 *
+	 * The commands help and shutdown are built in. The socket is created
+	 * with mode 0600, so only the server's user may connect, and a reply
+	 * is written as far as the client takes it without ever blocking the
+	 * loop; the client's further commands wait until it has read the rest.
+	 */
+	class epicsShareClass NTControlLoop {
+		public:
+			POINTER_DEFINITIONS(NTControlLoop);
+
+			// Listens on a socket at socketPath unless it is empty. A socket
+			// left there by a server that did not stop cleanly is replaced,
+			// but not a file that is not a socket nor a socket a server still
+			// listens on. Returns a null pointer, after printing why, if the
+			// socket can not be created.
+			static NTControlLoopPtr create(std::string const &socketPath);
+
+			// Closes the socket and restores the signal handlers.
+			~NTControlLoop();
+
+			// Adds a command, replacing one of the same name.
+			void addCommand(
+				std::string const &name,
+				NTControlCommandPtr const &command,
+				std::string const &help);
+
+			// Serves the socket, and the console if console is true and
+			// standard input is a terminal, until a shutdown is asked for.
+			// "exit" on the console also ends the loop.
+			void run(bool console);
+
+			// Ends run(). May be called from any thread.
+			void shutdown();
+
+			// Runs one command line and returns its reply.
+			std::string execute(std::string const &line);
+
+		private:
+			NTControlLoop();
+
+			struct Client {
+				int fd;
+				// Text sent without a new line yet.
+				std::string input;
+				// Replies not yet taken by the client.
+				std::string output;
+			};
+
+			bool listen(std::string const &path);
+			void accept();
+			// Reads from a client and answers it. Returns false once the
+			// client is gone.
+			bool serve(Client &client);
+			// Runs the client's complete commands while their replies are
+			// taken. Returns false once the client is gone.
+			bool answer(Client &client);
+			// Writes as much of the client's pending replies as it takes.
+			// Returns false once the client is gone.
+			bool send(Client &client);
+
+			struct Command {
+				NTControlCommandPtr command;
+				std::string help;
+			};
+
+			std::map<std::string, Command> commands;
+
+			std::string socketPath;
+			int listenFd;
+			// A byte written to wake[1] wakes poll(). Signal handlers use it too.
+			int wake[2];
+			bool stopping;
+
+			// Connected clients.
+			std::vector<Client> clients;
+	};
+
+}}
+
+#endif /* NTCONTROLLOOP_H */
@@ -6,6 +6,12 @@
 #	undef   epicsExportSharedSymbols
 #endif
 
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <pv/pvData.h>
 #include <pv/pvDatabase.h>
 
 #ifdef ntDatabaseEpicsExportSharedSymbols
@@ -13,13 +19,122 @@
 #	undef  ntDatabaseEpicsExportSharedSymbols
 #endif
 
+#include <pv/ntAdmission.h>
+#include <pv/ntRPCDispatcher.h>
+#include <pv/ntShardMap.h>
+
 #include <shareLib.h>
 
 namespace epics { namespace ntDatabase {
 
+	// Settings applied to the records created by NTDatabase::create().
+	struct epicsShareClass NTDatabaseOptions {
+		NTDatabaseOptions()
+			: historyLength(0), aggregateSource("double"), aggregatePeriod(1.0),
+			  gatherPeriod(1.0), rpcWorkers(4), rpcQueueDepth(256),
+			  shardCount(1), shardIndex(0), shardBasePort(NTShardMap::defaultBasePort),
+			  admissionPeriod(1.0)
+		{
+			gatherMembers.push_back("long");
+			gatherMembers.push_back("double");
+		}
+
+		// Samples of history kept by each numeric scalar record, 0 for none.
+		size_t historyLength;
+
+		// Directory of the on disk archive, empty for no archive.
+		std::string archiveDirectory;
+		// Records to archive. Every numeric scalar record if empty.
+		std::vector<std::string> archiveRecords;
+
+		// Record definition files, read after the built in records are
+		// created. See pv/ntRecordDefinition.h for their format.
+		std::vector<std::string> definitionFiles;
+
+		// Calc records to create, as pairs of record name and expression.
+		// An expression may use the records created before it.
+		std::vector<std::pair<std::string, std::string> > calcRecords;
+
+		// Record summarized by the aggregate record, empty to leave it
+		// unbound, and the seconds between publications of the statistics.
+		std::string aggregateSource;
+		double aggregatePeriod;
+
+		// Records whose values the gather record publishes together, empty
+		// to leave it unbound, and the seconds between publications.
+		std::vector<std::string> gatherMembers;
+		double gatherPeriod;
+
+		// Indexes kept by the table records, as pairs of record.column and
+		// kind of index, sorted or hash.
+		std::vector<std::pair<std::string, std::string> > tableIndexes;
+
+		// Worker threads of the rpc record and the most requests that may
+		// wait for one before further requests are refused.
+		size_t rpcWorkers;
+		size_t rpcQueueDepth;
+
+		// Number of servers the records are partitioned among, the shard
+		// hosted by this one and the port of shard 0 (see pv/ntShardMap.h).
+		// Only the records belonging to the shard are created. The service
+		// records are created by every shard and serve its own records. A
+		// record follows only records of its own shard: a calc record with
+		// an input elsewhere is refused, and the aggregate and gather
+		// records raise their alarm for a source elsewhere.
+		size_t shardCount;
+		size_t shardIndex;
+		unsigned short shardBasePort;
+
+		// Admission control of the clients' writes, processes and RPCs,
+		// off unless it has workers (see pv/ntAdmission.h). When on, the
+		// admission record publishes its counters every admissionPeriod
+		// seconds.
+		NTAdmissionOptions admission;
+		double admissionPeriod;
+	};
+
 	class epicsShareClass NTDatabase {
 		public:
-			static void create();
+			// Creates every record and adds it to the master database.
+			static void create(NTDatabaseOptions const &options = NTDatabaseOptions());
+			// Stops the background work started by create(). Archived
+			// samples still queued are written out first.
+			static void shutdown();
+			// Serves method through the rpc record. Returns false if the
+			// database was not created.
+			static bool registerRPCHandler(
+				std::string const &method,
+				NTRPCHandlerPtr const &handler);
+			// Adds records described as in a record definition file, lines
+			// separated by new lines or semicolons, to the live database,
+			// replacing records of the same name. Returns the names added.
+			// Throws if the definitions have errors or there is no database.
+			static std::vector<std::string> addRecords(std::string const &definitions);
+			// Removes the named records, separated by blanks or commas and
+			// with name[first-last] for a range. Returns the names removed.
+			static std::vector<std::string> removeRecords(std::string const &names);
+			// Admission control of the clients' requests, null if it is off.
+			// The server serves the database through a NTAdmissionProvider
+			// wrapping the local provider with it.
+			static NTAdmissionPtr getAdmission();
+			// Writes the number of records, the rpc record's metrics and the
+			// requests refused by admission control to out, one "name value"
+			// line each.
+			static void writeStats(std::ostream &out);
+			// Writes the value of every record of the master database to out,
+			// each copied under the record's lock, in order of name.
+			static void writeSnapshot(std::ostream &out);
+			// Writes where the work is done: a line per thread of the process
+			// (see pv/ntThreadPlacement.h), then a line per record giving the
+			// cpu and thread of its last process(), in order of name.
+			static void writePlacement(std::ostream &out);
+			// Names of the normative type records created by create(), in
+			// creation order. The service records are not included.
+			static std::vector<std::string> getRecordNames();
+			// Builds the pvStructure held by the named record without creating
+			// the record. Returns a null pointer if the name is unknown.
+			static epics::pvData::PVStructurePtr createPVStructure(
+				std::string const &recordName);
 	};
 	
 }}
@@ -0,0 +1,76 @@
+#ifndef NTENUMRECORD_H
+#define NTENUMRECORD_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntEnumRecordEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+
+#include <pv/pvData.h>
+
+#ifdef ntEnumRecordEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntEnumRecordEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntRecord.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTEnumRecord;
+	typedef std::tr1::shared_ptr<NTEnumRecord> NTEnumRecordPtr;
+
+	/*
+	 * NTEnum record that versions its list of choices.
+	 *
+	 * Besides the normative type fields the record has
+	 *
+	 *	int choicesVersion
+	 *
+	 * which starts at 1 and is incremented whenever a processing put changes
+	 * value.choices. A client that follows the index monitors
+	 *
+	 *	field(value.index,choicesVersion,timeStamp)
+	 *
+	 * and gets field(value.choices,choicesVersion) only when it does not
+	 * hold the choices of the version received, so an update of the index
+	 * carries two ints rather than the whole list.
+	 */
+	class epicsShareClass NTEnumRecord : public NTRecord {
+		public:
+			POINTER_DEFINITIONS(NTEnumRecord);
+
+			// Builds the pvStructure of an enum record with no choices.
+			static epics::pvData::PVStructurePtr createPVStructure();
+
+			static NTEnumRecordPtr create(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			virtual ~NTEnumRecord() {}
+
+			virtual bool init();
+
+		protected:
+			NTEnumRecord(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			virtual void processRecord();
+
+		private:
+			epics::pvData::PVStringArrayPtr pvChoices;
+			epics::pvData::PVIntPtr pvChoicesVersion;
+
+			// The choices of the current version. A put replaces the array,
+			// so new choices are told apart by it.
+			epics::pvData::shared_vector<const std::string> versionedChoices;
+	};
+
+}}
+
+#endif /* NTENUMRECORD_H */
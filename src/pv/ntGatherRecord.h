@@ -0,0 +1,112 @@
+#ifndef NTGATHERRECORD_H
+#define NTGATHERRECORD_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntGatherRecordEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+#include <vector>
+
+#include <pv/pvData.h>
+#include <pv/lock.h>
+
+#ifdef ntGatherRecordEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntGatherRecordEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntRecord.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTGatherRecord;
+	typedef std::tr1::shared_ptr<NTGatherRecord> NTGatherRecordPtr;
+
+	/*
+	 * NTMultiChannel record that gathers the values of other records.
+	 *
+	 * Once bound to its member records, every process() of a member copies
+	 * the member's value, alarm severity and time stamp. Every period the
+	 * record is processed by the NTProcessQueue and publishes the copies of
+	 * all members at once, so a single monitor on the record receives a
+	 * consistent snapshot of every member in one update:
+	 *
+	 *	channelName       names of the members
+	 *	value             value of each member
+	 *	severity          alarm severity of each member, 0 if it has no alarm
+	 *	secondsPastEpoch  time stamp of each member's last process()
+	 *	nanoseconds
+	 *	isConnected       false for a member that is not in the database
+	 *
+	 * The record's alarm is raised while a member is not connected. The
+	 * arrays are only replaced in a period in which a member changed.
+	 */
+	class epicsShareClass NTGatherRecord : public NTRecord {
+		public:
+			POINTER_DEFINITIONS(NTGatherRecord);
+
+			// Builds the pvStructure of a gather record.
+			static epics::pvData::PVStructurePtr createPVStructure();
+
+			static NTGatherRecordPtr create(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			virtual ~NTGatherRecord() {}
+
+			virtual bool init();
+
+			// Starts gathering the values of the named records, which should be
+			// NTRecords with a value field, and publishing them every period
+			// seconds. A member that can not be found is published as not
+			// connected. Returns false, after printing why, if the record is
+			// already bound.
+			bool bind(std::vector<std::string> const &memberNames, double period);
+
+			// Copies the state of member, which is record, after its process().
+			// Called with record locked.
+			void update(size_t member, NTRecord &record);
+
+		protected:
+			NTGatherRecord(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			virtual void processRecord();
+
+		private:
+			// Latest state of a member record.
+			struct Member {
+				Member() : severity(0), secondsPastEpoch(0), nanoseconds(0) {}
+
+				std::string name;
+				std::tr1::weak_ptr<NTRecord> record;
+				// Copy of the member's value field, null until the first update.
+				epics::pvData::PVFieldPtr value;
+				epics::pvData::int32 severity;
+				epics::pvData::int64 secondsPastEpoch;
+				epics::pvData::int32 nanoseconds;
+			};
+
+			// Guards members and changed, which the members' listeners update
+			// while a member is locked and this record may not be.
+			epics::pvData::Mutex membersMutex;
+			std::vector<Member> members;
+			bool changed;
+			bool bound;
+
+			epics::pvData::PVStringArrayPtr pvChannelName;
+			epics::pvData::PVUnionArrayPtr pvValue;
+			epics::pvData::PVIntArrayPtr pvSeverity;
+			epics::pvData::PVLongArrayPtr pvSecondsPastEpoch;
+			epics::pvData::PVIntArrayPtr pvNanoseconds;
+			epics::pvData::PVBooleanArrayPtr pvIsConnected;
+	};
+
+}}
+
+#endif /* NTGATHERRECORD_H */
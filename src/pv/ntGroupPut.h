@@ -0,0 +1,96 @@
+#ifndef NTGROUPPUT_H
+#define NTGROUPPUT_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntGroupPutEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+#include <vector>
+
+#include <pv/pvData.h>
+
+#ifdef ntGroupPutEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntGroupPutEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntRecord.h>
+#include <pv/ntRPCDispatcher.h>
+#include <pv/ntShardMap.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTGroupPut;
+	typedef std::tr1::shared_ptr<NTGroupPut> NTGroupPutPtr;
+
+	/*
+	 * RPC method writing several records as one unit.
+	 *
+	 * Each field of the query names a record and holds its new value, a
+	 * scalar for a record with a scalar value or for the index of an enum
+	 * record, an array for a record with an array value. Values are
+	 * converted to the record's type, e.g.
+	 *
+	 *	query { long 5, double 1.5, enum 1 }
+	 *
+	 * Every value is converted before any record is touched, so a bad
+	 * value fails the request without writing anything. The records are
+	 * then locked in order of name, which keeps two group puts from
+	 * deadlocking, written and processed with one shared time stamp, and
+	 * released together, so their monitors post in one sweep and nobody
+	 * sees some records written and others not. If processing a record
+	 * throws, the request fails, the records written so far keep their
+	 * values and every record is released.
+	 *
+	 * The result holds the names of the records written and their time stamp.
+	 *
+	 * On a sharded server every record of the group must belong to its
+	 * shard. A group naming a record of another shard fails, saying which
+	 * shard hosts it, without writing anything; the client sends a group
+	 * put to each shard instead.
+	 */
+	class epicsShareClass NTGroupPut : public NTRPCHandler {
+		public:
+			POINTER_DEFINITIONS(NTGroupPut);
+
+			// Given shards, only records belonging to shard may be written.
+			static NTGroupPutPtr create(
+				NTShardMapPtr const &shards = NTShardMapPtr(),
+				size_t shard = 0);
+
+			virtual ~NTGroupPut() {}
+
+			virtual epics::pvData::PVStructurePtr handle(
+				epics::pvData::PVStructurePtr const &query);
+
+		private:
+			NTGroupPut(NTShardMapPtr const &shards, size_t shard);
+
+			// A record of the group and its new value.
+			struct Target {
+				std::string name;
+				NTRecordPtr record;
+				// Field of the record written and the value converted to its type.
+				epics::pvData::PVFieldPtr pvField;
+				epics::pvData::PVFieldPtr pvValue;
+
+				bool operator<(Target const &other) const { return name < other.name; }
+			};
+
+			// Finds the record named by pvValue and converts the value. Throws
+			// if there is no such record, it belongs to another shard or the
+			// value does not fit it.
+			Target resolve(epics::pvData::PVFieldPtr const &pvValue);
+
+			NTShardMapPtr shards;
+			size_t shard;
+			epics::pvData::StructureConstPtr resultType;
+	};
+
+}}
+
+#endif /* NTGROUPPUT_H */
@@ -0,0 +1,93 @@
+#ifndef NTHISTORYBUFFER_H
+#define NTHISTORYBUFFER_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntHistoryBufferEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <vector>
+
+#include <pv/pvData.h>
+#include <pv/lock.h>
+
+#ifdef ntHistoryBufferEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntHistoryBufferEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTHistoryBuffer;
+	typedef std::tr1::shared_ptr<NTHistoryBuffer> NTHistoryBufferPtr;
+
+	/*
+	 * Ring buffer of the last samples of a record.
+	 *
+	 * Each sample is a value, its time stamp and its alarm. The samples
+	 * are kept in columns, one array per component, so that a query scans
+	 * only the time stamps while looking for its range. Values are held
+	 * as doubles. Samples are expected to arrive in time order, as they
+	 * do when they are taken by the record's process().
+	 */
+	class epicsShareClass NTHistoryBuffer {
+		public:
+			POINTER_DEFINITIONS(NTHistoryBuffer);
+
+			explicit NTHistoryBuffer(size_t capacity);
+
+			// Adds a sample, replacing the oldest one if the buffer is full.
+			void append(
+				double value,
+				epics::pvData::int64 secondsPastEpoch,
+				epics::pvData::int32 nanoseconds,
+				epics::pvData::int32 severity,
+				epics::pvData::int32 status);
+
+			size_t getCapacity() const { return capacity; }
+			size_t getSize() const;
+
+			// Introspection interface of a query result: a NTTable with the
+			// columns secondsPastEpoch, nanoseconds, value, severity and status.
+			static epics::pvData::StructureConstPtr createResultField();
+
+			/*
+			 * Copies the samples with start <= time <= end into result, which
+			 * must have the layout of createResultField(). Times are seconds
+			 * past the epoch. If more than maxPoints samples match and
+			 * maxPoints is not 0, maxPoints evenly spaced samples are returned.
+			 * Returns the number of samples copied.
+			 */
+			size_t query(
+				double start,
+				double end,
+				size_t maxPoints,
+				epics::pvData::PVStructurePtr const &result) const;
+
+		private:
+			// Time of the sample at position index, counted from the oldest.
+			double timeAt(size_t index) const;
+			// Position in the columns of the sample at index.
+			size_t slot(size_t index) const { return (first + index) % capacity; }
+			// Index of the first sample at or after time.
+			size_t lowerBound(double time) const;
+			// Index of the first sample after time.
+			size_t upperBound(double time) const;
+
+			mutable epics::pvData::Mutex mutex;
+			size_t capacity;
+			size_t first;
+			size_t count;
+
+			std::vector<epics::pvData::int64> secondsPastEpoch;
+			std::vector<epics::pvData::int32> nanoseconds;
+			std::vector<double> values;
+			std::vector<epics::pvData::int32> severities;
+			std::vector<epics::pvData::int32> statuses;
+	};
+
+}}
+
+#endif /* NTHISTORYBUFFER_H */
@@ -0,0 +1,82 @@
+#ifndef NTHISTORYRECORD_H
+#define NTHISTORYRECORD_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntHistoryRecordEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+
+#include <pv/pvData.h>
+
+#ifdef ntHistoryRecordEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntHistoryRecordEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntServiceRecord.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTHistoryRecord;
+	typedef std::tr1::shared_ptr<NTHistoryRecord> NTHistoryRecordPtr;
+
+	/*
+	 * Service record that queries the history kept by the scalar records.
+	 *
+	 *	argument
+	 *		string record     name of the record to query
+	 *		double start      seconds past the epoch, 0 for the oldest sample
+	 *		double end        seconds past the epoch, 0 for the newest sample
+	 *		int maxPoints     0 for every sample in the range, otherwise the
+	 *		                  range is decimated to at most maxPoints samples
+	 *	result
+	 *		NTTable with columns secondsPastEpoch, nanoseconds, value,
+	 *		severity and status
+	 *
+	 * A query that fails raises the alarm and returns no rows.
+	 *
+	 * A derived record answers the same queries from another source of
+	 * samples by overriding query().
+	 */
+	class epicsShareClass NTHistoryRecord : public NTServiceRecord {
+		public:
+			POINTER_DEFINITIONS(NTHistoryRecord);
+
+			static NTHistoryRecordPtr create(std::string const &recordName);
+
+			virtual ~NTHistoryRecord() {}
+
+			virtual bool init();
+
+		protected:
+			NTHistoryRecord(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			// Builds the pvStructure shared by the history query records.
+			static epics::pvData::PVStructurePtr createPVStructure();
+
+			virtual void execute(
+				epics::pvData::PVStructurePtr const &argument,
+				epics::pvData::PVStructurePtr const &result);
+
+			// Empties the columns of result, keeping their labels.
+			virtual void clearResult(epics::pvData::PVStructurePtr const &result);
+
+			// Fills result with the samples of the named record in the range.
+			// Throws if the record has no samples to query.
+			virtual void query(
+				std::string const &recordName,
+				double start,
+				double end,
+				size_t maxPoints,
+				epics::pvData::PVStructurePtr const &result);
+	};
+
+}}
+
+#endif /* NTHISTORYRECORD_H */
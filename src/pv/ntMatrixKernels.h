@@ -0,0 +1,57 @@
+#ifndef NTMATRIXKERNELS_H
+#define NTMATRIXKERNELS_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntMatrixKernelsEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <cstddef>
+
+#ifdef ntMatrixKernelsEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntMatrixKernelsEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	/*
+	 * Kernels over a rows x columns matrix of doubles stored row by row,
+	 * as the value field of a NTMatrix holds it.
+	 *
+	 * The transpose works on square tiles small enough that a tile of the
+	 * source and of the destination stay in the L1 cache together, so each
+	 * cache line is loaded once rather than once per element. The product
+	 * keeps several independent sums per row so that the additions are not
+	 * serialized on one accumulator and the compiler can vectorize them.
+	 */
+	class epicsShareClass NTMatrixKernels {
+		public:
+			// Copies the block of rows x columns elements whose first element
+			// is at (row, column) into out, row by row.
+			static void copyBlock(
+				double const *matrix, size_t matrixColumns,
+				size_t row, size_t column,
+				size_t rows, size_t columns,
+				double *out);
+
+			// Writes the columns x rows transpose of matrix into out.
+			static void transpose(
+				double const *matrix, size_t rows, size_t columns,
+				double *out);
+
+			// Writes the product of matrix and vector, rows elements, into out.
+			static void multiply(
+				double const *matrix, size_t rows, size_t columns,
+				double const *vector,
+				double *out);
+
+			// Side of the tiles of the transpose.
+			static const size_t tileSize = 32;
+	};
+
+}}
+
+#endif /* NTMATRIXKERNELS_H */
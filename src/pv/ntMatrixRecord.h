@@ -0,0 +1,112 @@
+#ifndef NTMATRIXRECORD_H
+#define NTMATRIXRECORD_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntMatrixRecordEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+
+#include <pv/pvData.h>
+
+#ifdef ntMatrixRecordEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntMatrixRecordEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntRecord.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTMatrixRecord;
+	typedef std::tr1::shared_ptr<NTMatrixRecord> NTMatrixRecordPtr;
+
+	/*
+	 * NTMatrix record that computes slices and products of its matrix on
+	 * request, so that a client does not have to read the whole matrix.
+	 *
+	 * The matrix is value, stored row by row, with dim holding the number
+	 * of rows and columns, both positive. Besides the normative type fields
+	 * the record has an operation structure:
+	 *
+	 *	operation
+	 *		string name       row, column, block, transpose or multiply
+	 *		int row           first row of a row or block
+	 *		int column        first column of a column or block
+	 *		int rows          size of a block
+	 *		int columns
+	 *		double[] vector   operand of multiply, one element per column
+	 *		double[] value    result, stored row by row
+	 *		int[] dim         rows and columns of the result
+	 *
+	 * A client runs an operation with
+	 *
+	 *	record[process=true]putField(operation.name,operation.row,...)
+	 *		getField(operation.value,operation.dim,alarm)
+	 *
+	 * The result is kept until the matrix or the operation changes. A
+	 * malformed operation raises the alarm and empties the result. See
+	 * NTMatrixKernels.
+	 */
+	class epicsShareClass NTMatrixRecord : public NTRecord {
+		public:
+			POINTER_DEFINITIONS(NTMatrixRecord);
+
+			// Builds the pvStructure of a matrix record.
+			static epics::pvData::PVStructurePtr createPVStructure();
+
+			static NTMatrixRecordPtr create(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			virtual ~NTMatrixRecord() {}
+
+			virtual bool init();
+
+		protected:
+			NTMatrixRecord(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			virtual void processRecord();
+
+		private:
+			// Operands of an operation, compared to tell whether its result
+			// is still current.
+			struct Operation {
+				Operation() : row(0), column(0), rows(0), columns(0) {}
+
+				bool operator==(Operation const &other) const;
+
+				std::string name;
+				epics::pvData::int32 row;
+				epics::pvData::int32 column;
+				epics::pvData::int32 rows;
+				epics::pvData::int32 columns;
+				epics::pvData::shared_vector<const double> matrix;
+				epics::pvData::shared_vector<const epics::pvData::int32> dim;
+				epics::pvData::shared_vector<const double> vector;
+			};
+
+			// Computes the result of operation into value, setting resultDim.
+			void execute(
+				Operation const &operation,
+				epics::pvData::shared_vector<double> &value,
+				epics::pvData::shared_vector<epics::pvData::int32> &resultDim);
+
+			epics::pvData::PVDoubleArrayPtr pvValue;
+			epics::pvData::PVIntArrayPtr pvDim;
+			epics::pvData::PVStructurePtr pvOperation;
+			epics::pvData::PVDoubleArrayPtr pvResult;
+			epics::pvData::PVIntArrayPtr pvResultDim;
+
+			// The operation whose result operation.value holds.
+			Operation computed;
+	};
+
+}}
+
+#endif /* NTMATRIXRECORD_H */
@@ -0,0 +1,63 @@
+#ifndef NTNDARRAYRECORD_H
+#define NTNDARRAYRECORD_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntNDArrayRecordEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+
+#include <pv/pvData.h>
+
+#ifdef ntNDArrayRecordEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntNDArrayRecordEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntArrayChunk.h>
+#include <pv/ntRecord.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTNDArrayRecord;
+	typedef std::tr1::shared_ptr<NTNDArrayRecord> NTNDArrayRecordPtr;
+
+	/*
+	 * NTNDArray record whose value can be read a chunk at a time.
+	 *
+	 * The record has a chunk structure, see NTArrayChunk, whose value is
+	 * the same union of arrays as the NTNDArray value field.
+	 */
+	class epicsShareClass NTNDArrayRecord : public NTRecord {
+		public:
+			POINTER_DEFINITIONS(NTNDArrayRecord);
+
+			// Builds the pvStructure of the record.
+			static epics::pvData::PVStructurePtr createPVStructure();
+
+			static NTNDArrayRecordPtr create(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			virtual ~NTNDArrayRecord() {}
+
+			virtual bool init();
+
+		protected:
+			NTNDArrayRecord(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			virtual void processRecord();
+
+		private:
+			epics::pvData::PVUnionPtr pvValue;
+			NTArrayChunk chunk;
+	};
+
+}}
+
+#endif /* NTNDARRAYRECORD_H */
@@ -0,0 +1,105 @@
+#ifndef NTNAMEVALUERECORD_H
+#define NTNAMEVALUERECORD_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntNameValueRecordEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+
+#include <pv/pvData.h>
+
+#ifdef ntNameValueRecordEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntNameValueRecordEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntRecord.h>
+#include <pv/ntStringIndex.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTNameValueRecord;
+	typedef std::tr1::shared_ptr<NTNameValueRecord> NTNameValueRecordPtr;
+
+	/*
+	 * NTNameValue record of doubles that gets and sets values by name.
+	 *
+	 * Besides the normative type fields the record has a keyed structure:
+	 *
+	 *	keyed
+	 *		int request       number of the request, see below
+	 *		string[] names    names to get or set
+	 *		double[] values   values to set, one per name, or empty to get
+	 *		double[] result   value of each name once the set is done
+	 *
+	 * A processing put of keyed.names sets the named values in place,
+	 * adding the names that are not yet in name, and fills keyed.result.
+	 * The positions of the names are kept in a hash index, rebuilt after a
+	 * put replaces name, so the cost follows the number of names asked for
+	 * rather than the size of the record:
+	 *
+	 *	record[process=true]putField(keyed.request,keyed.names,keyed.values)
+	 *		getField(keyed.result)
+	 *
+	 * A set is applied when a put brings new keyed.names or keyed.values,
+	 * or a keyed.request different from the last one, and not when the
+	 * record is processed for another reason. A client that repeats a set
+	 * without sending its arrays again, such as one sending only modified
+	 * fields, changes keyed.request. keyed.result is refreshed on every
+	 * process, so a get always returns the current values.
+	 *
+	 * Getting a name that is not in name raises the alarm and gives NaN.
+	 */
+	class epicsShareClass NTNameValueRecord : public NTRecord {
+		public:
+			POINTER_DEFINITIONS(NTNameValueRecord);
+
+			// Builds the pvStructure of a name value record.
+			static epics::pvData::PVStructurePtr createPVStructure();
+
+			static NTNameValueRecordPtr create(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			virtual ~NTNameValueRecord() {}
+
+			virtual bool init();
+
+		protected:
+			NTNameValueRecord(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			virtual void processRecord();
+
+		private:
+			// Sets the value of each of names, adding the missing names.
+			void set(
+				epics::pvData::shared_vector<const std::string> const &names,
+				epics::pvData::shared_vector<const double> const &values);
+
+			epics::pvData::PVStringArrayPtr pvName;
+			epics::pvData::PVDoubleArrayPtr pvValue;
+			epics::pvData::PVIntPtr pvKeyedRequest;
+			epics::pvData::PVStringArrayPtr pvKeyedNames;
+			epics::pvData::PVDoubleArrayPtr pvKeyedValues;
+			epics::pvData::PVDoubleArrayPtr pvKeyedResult;
+
+			NTStringIndex index;
+			// The name array the index was built from.
+			epics::pvData::shared_vector<const std::string> indexedNames;
+
+			// The keyed request last applied. Holding the buffers keeps their
+			// addresses from being reused, so a new put is told apart by them.
+			epics::pvData::shared_vector<const std::string> appliedNames;
+			epics::pvData::shared_vector<const double> appliedValues;
+			epics::pvData::int32 appliedRequest;
+	};
+
+}}
+
+#endif /* NTNAMEVALUERECORD_H */
@@ -0,0 +1,92 @@
+#ifndef NTPROCESSQUEUE_H
+#define NTPROCESSQUEUE_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntProcessQueueEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <deque>
+#include <set>
+#include <vector>
+
+#include <epicsEvent.h>
+#include <epicsThread.h>
+
+#include <pv/pvData.h>
+#include <pv/lock.h>
+
+#ifdef ntProcessQueueEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntProcessQueueEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntRecord.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTProcessQueue;
+	typedef std::tr1::shared_ptr<NTProcessQueue> NTProcessQueuePtr;
+
+	/*
+	 * Thread that processes records on request and periodically.
+	 *
+	 * A record that depends on others is told of their changes by a
+	 * NTProcessListener while they are locked, when it may not lock itself.
+	 * It requests to be processed instead, and this thread later processes
+	 * it holding only its own lock. Requests made while a record is queued
+	 * are merged, so a burst of input changes costs a single process().
+	 *
+	 * A record may also be scheduled to be processed at a fixed period,
+	 * until it is no longer referenced elsewhere.
+	 */
+	class epicsShareClass NTProcessQueue : public epicsThreadRunable {
+		public:
+			POINTER_DEFINITIONS(NTProcessQueue);
+
+			// The queue shared by the records of the database.
+			static NTProcessQueuePtr get();
+
+			virtual ~NTProcessQueue();
+
+			// Queues a process() of the record unless it is already queued.
+			void request(NTRecordPtr const &record);
+
+			// Requests a process() of the record every period seconds.
+			void schedule(NTRecordPtr const &record, double period);
+
+			// Processes the queued records and stops the thread.
+			void stop();
+
+			virtual void run();
+
+		private:
+			NTProcessQueue();
+
+			struct Scheduled {
+				std::tr1::weak_ptr<NTRecord> record;
+				epicsUInt64 period;    // nanoseconds
+				epicsUInt64 due;       // epicsMonotonicGet() time
+			};
+
+			// Queues the scheduled records that are due. Returns the seconds
+			// until the next one is due, or a negative value if none is
+			// scheduled. Called with mutex held.
+			double queueScheduled();
+			void enqueue(NTRecordPtr const &record);
+
+			epics::pvData::Mutex mutex;
+			std::deque<NTRecordPtr> queue;
+			std::set<NTRecord *> queued;
+			std::vector<Scheduled> scheduled;
+			bool stopping;
+
+			epicsEvent wakeUp;
+			epicsThread thread;
+	};
+
+}}
+
+#endif /* NTPROCESSQUEUE_H */
@@ -0,0 +1,141 @@
+#ifndef NTRPCDISPATCHER_H
+#define NTRPCDISPATCHER_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntRPCDispatcherEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <epicsEvent.h>
+#include <epicsThread.h>
+#include <pv/pvData.h>
+#include <pv/lock.h>
+#include <pv/rpcService.h>
+
+#ifdef ntRPCDispatcherEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntRPCDispatcherEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTRPCHandler;
+	typedef std::tr1::shared_ptr<NTRPCHandler> NTRPCHandlerPtr;
+
+	class NTRPCDispatcher;
+	typedef std::tr1::shared_ptr<NTRPCDispatcher> NTRPCDispatcherPtr;
+
+	// A method served by a NTRPCDispatcher.
+	class epicsShareClass NTRPCHandler {
+		public:
+			POINTER_DEFINITIONS(NTRPCHandler);
+
+			virtual ~NTRPCHandler() {}
+
+			// Runs the method with the query of the request, which is null if
+			// the request has none, and returns the result. Throws to fail the
+			// request. Called from several worker threads at once.
+			virtual epics::pvData::PVStructurePtr handle(
+				epics::pvData::PVStructurePtr const &query) = 0;
+	};
+
+	/*
+	 * Asynchronous RPC service dispatching NTURI requests to handlers.
+	 *
+	 * The path of a request names the method and its query holds the
+	 * arguments. request() only queues the request, so the server thread
+	 * that received it is free at once, and a pool of worker threads runs
+	 * the handlers and sends the responses. When queueDepth requests are
+	 * waiting, further ones are refused until the workers catch up.
+	 *
+	 * The latency of each method, from arrival to response, is kept and is
+	 * returned as a NTTable by the built in method "metrics".
+	 */
+	class epicsShareClass NTRPCDispatcher : public epics::pvAccess::RPCServiceAsync {
+		public:
+			POINTER_DEFINITIONS(NTRPCDispatcher);
+
+			// Starts workers threads. Requests are refused when queueDepth are waiting.
+			static NTRPCDispatcherPtr create(size_t workers, size_t queueDepth);
+
+			virtual ~NTRPCDispatcher();
+
+			// Serves method with handler, replacing the previous handler.
+			void registerHandler(std::string const &method, NTRPCHandlerPtr const &handler);
+
+			// Names of the methods served, sorted.
+			std::vector<std::string> getMethods();
+
+			virtual void request(
+				epics::pvData::PVStructurePtr const &args,
+				epics::pvAccess::RPCResponseCallback::shared_pointer const &callback);
+
+			// Latency of each method, as a NTTable with columns method, count,
+			// errors, meanLatency, maxLatency and meanWait, times in seconds.
+			epics::pvData::PVStructurePtr getMetrics();
+
+			// Number of requests refused because the queue was full.
+			size_t getRejected();
+
+			// Fails the requests still queued and stops the workers.
+			void stop();
+
+		private:
+			NTRPCDispatcher(size_t queueDepth);
+
+			struct Request {
+				std::string method;
+				NTRPCHandlerPtr handler;
+				epics::pvData::PVStructurePtr query;
+				epics::pvAccess::RPCResponseCallback::shared_pointer callback;
+				epicsUInt64 arrival;   // epicsMonotonicGet() time
+			};
+
+			struct Metrics {
+				Metrics() : count(0), errors(0), totalLatency(0), maxLatency(0), totalWait(0) {}
+
+				size_t count;
+				size_t errors;
+				epicsUInt64 totalLatency;   // nanoseconds
+				epicsUInt64 maxLatency;
+				epicsUInt64 totalWait;
+			};
+
+			class Worker : public epicsThreadRunable {
+				public:
+					Worker(NTRPCDispatcher &dispatcher, std::string const &name);
+					virtual void run();
+
+					NTRPCDispatcher &dispatcher;
+					epicsThread thread;
+			};
+
+			// Runs queued requests until stopped. Body of the worker threads.
+			void work();
+			void record(Request const &request, epicsUInt64 start, bool failed);
+
+			size_t queueDepth;
+
+			epics::pvData::Mutex mutex;
+			std::map<std::string, NTRPCHandlerPtr> handlers;
+			std::deque<Request> queue;
+			size_t rejected;
+			bool stopping;
+			epicsEvent wakeUp;
+
+			std::vector<Worker *> workers;
+
+			epics::pvData::Mutex metricsMutex;
+			std::map<std::string, Metrics> metrics;
+	};
+
+}}
+
+#endif /* NTRPCDISPATCHER_H */
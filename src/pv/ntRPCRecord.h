@@ -0,0 +1,71 @@
+#ifndef NTRPCRECORD_H
+#define NTRPCRECORD_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntRPCRecordEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+
+#include <pv/pvData.h>
+
+#ifdef ntRPCRecordEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntRPCRecordEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntRecord.h>
+#include <pv/ntRPCDispatcher.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTRPCRecord;
+	typedef std::tr1::shared_ptr<NTRPCRecord> NTRPCRecordPtr;
+
+	/*
+	 * Record through which a NTRPCDispatcher is reached by channelRPC.
+	 *
+	 * Its value is the list of methods served, for clients to discover
+	 * them. An RPC on the record's channel with a NTURI argument, such as
+	 *
+	 *	scheme pva, path echo, query { ... }
+	 *
+	 * is handed to the dispatcher without processing or locking the record,
+	 * so slow methods hold neither the record nor a server thread.
+	 */
+	class epicsShareClass NTRPCRecord : public NTRecord {
+		public:
+			POINTER_DEFINITIONS(NTRPCRecord);
+
+			static NTRPCRecordPtr create(
+				std::string const &recordName,
+				NTRPCDispatcherPtr const &dispatcher);
+
+			virtual ~NTRPCRecord() {}
+
+			virtual bool init();
+
+			// Called by the local channel provider of pvDatabase 4.4.0 and
+			// later for each channelRPC on the record.
+			virtual epics::pvAccess::Service::shared_pointer getService(
+				epics::pvData::PVStructurePtr const &pvRequest);
+
+			// Publishes the methods currently registered with the dispatcher.
+			void updateMethods();
+
+		protected:
+			NTRPCRecord(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure,
+				NTRPCDispatcherPtr const &dispatcher);
+
+		private:
+			NTRPCDispatcherPtr dispatcher;
+	};
+
+}}
+
+#endif /* NTRPCRECORD_H */
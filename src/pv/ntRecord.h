@@ -0,0 +1,124 @@
+#ifndef NTRECORD_H
+#define NTRECORD_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntRecordEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+#include <vector>
+
+#include <pv/pvData.h>
+#include <pv/pvTimeStamp.h>
+#include <pv/timeStamp.h>
+#include <pv/pvAlarm.h>
+#include <pv/alarm.h>
+#include <pv/pvDatabase.h>
+
+#ifdef ntRecordEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntRecordEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTRecord;
+	typedef std::tr1::shared_ptr<NTRecord> NTRecordPtr;
+
+	class NTProcessListener;
+	typedef std::tr1::shared_ptr<NTProcessListener> NTProcessListenerPtr;
+
+	/*
+	 * Told about every process() of the records it was added to, which is
+	 * how records that depend on other records learn of new input values.
+	 */
+	class epicsShareClass NTProcessListener {
+		public:
+			POINTER_DEFINITIONS(NTProcessListener);
+
+			virtual ~NTProcessListener() {}
+
+			// Called at the end of the record's process(), with the record
+			// locked. It must not lock another record, since the caller may
+			// be holding records locked in any order.
+			virtual void processed(NTRecord &record) = 0;
+	};
+
+	/*
+	 * Base class of the records hosted by the normative type database.
+	 *
+	 * process() lets the derived record do its work in processRecord()
+	 * and then sets the record's timeStamp field, if it has one.
+	 * process() is called with the record locked and inside a group put.
+	 * Once the time stamp is set, the record's process listeners are told.
+	 * A derived record reports failures through its alarm field, if it
+	 * has one, with raiseAlarm() and clearAlarm().
+	 */
+	class epicsShareClass NTRecord : public epics::pvDatabase::PVRecord {
+		public:
+			POINTER_DEFINITIONS(NTRecord);
+
+			// Creates a record that only time stamps its puts.
+			static NTRecordPtr create(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			virtual ~NTRecord() {}
+
+			virtual bool init();
+			virtual void process();
+
+			// process() with the time stamp set to processTime rather than
+			// the current time, so that records written together share one.
+			// process() calls it, so records extend this rather than process().
+			virtual void processAt(epics::pvData::TimeStamp const &processTime);
+
+			// Time stamp set by the last process(). Read with the record locked.
+			epics::pvData::TimeStamp const &getTimeStamp() const { return timeStamp; }
+
+			// Where the last process() ran, the cpu (-1 if unknown) and the
+			// kernel id of the thread (see pv/ntThreadPlacement.h), and the
+			// number of process() calls. Read with the record locked.
+			int getProcessCpu() const { return processCpu; }
+			long getProcessThread() const { return processThread; }
+			size_t getProcessCount() const { return processCount; }
+
+			// Adds or removes a listener told about each process() of the record.
+			void addProcessListener(NTProcessListenerPtr const &listener);
+			void removeProcessListener(NTProcessListenerPtr const &listener);
+
+		protected:
+			NTRecord(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			// Record specific processing, done before the time stamp is set.
+			virtual void processRecord() {}
+
+			// Sets the alarm field to a major record alarm with message.
+			void raiseAlarm(std::string const &message);
+			// Returns the alarm field to no alarm.
+			void clearAlarm();
+
+			epics::pvData::PVTimeStamp pvTimeStamp;
+			epics::pvData::TimeStamp timeStamp;
+			bool hasTimeStamp;
+
+			epics::pvData::PVAlarm pvAlarm;
+			epics::pvData::Alarm alarm;
+			bool hasAlarm;
+
+		private:
+			// Guarded by the record's lock.
+			std::vector<NTProcessListenerPtr> processListeners;
+			int processCpu;
+			long processThread;
+			size_t processCount;
+	};
+
+}}
+
+#endif /* NTRECORD_H */
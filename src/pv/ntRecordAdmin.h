@@ -0,0 +1,119 @@
+#ifndef NTRECORDADMIN_H
+#define NTRECORDADMIN_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntRecordAdminEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <pv/pvData.h>
+#include <pv/lock.h>
+
+#ifdef ntRecordAdminEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntRecordAdminEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntArchiver.h>
+#include <pv/ntRPCDispatcher.h>
+#include <pv/ntShardMap.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTRecordAdmin;
+	typedef std::tr1::shared_ptr<NTRecordAdmin> NTRecordAdminPtr;
+
+	/*
+	 * RPC method adding and removing records of the live database.
+	 *
+	 * The query may hold two strings:
+	 *
+	 *	remove    names of records to remove, separated by blanks or
+	 *	          commas, where name[first-last] stands for a range
+	 *	add       record definitions in the format of ntRecordDefinition.h,
+	 *	          separated by new lines or semicolons
+	 *
+	 * Removals are done first. An added record whose name is taken replaces
+	 * the record of that name, which is how a record is given a new shape.
+	 * The result lists the records removed and added.
+	 *
+	 * New records are built in bulk before the database is touched, then
+	 * added one at a time, so the database is only held for the moment
+	 * each addition or removal takes. Only the channels of the records
+	 * removed or replaced are disconnected. Records following another
+	 * record, such as calc and gather records, keep following the record
+	 * they were bound to and not its replacement.
+	 *
+	 * The admin of a shard adds only the records belonging to its shard,
+	 * so the same definitions may be sent to every shard.
+	 *
+	 * A request through the RPC names or defines at most maxBatch records,
+	 * and the service records, such as rpc itself, can be neither removed
+	 * nor replaced. A record removed or replaced stops being archived; what
+	 * it archived stays on disk.
+	 */
+	class epicsShareClass NTRecordAdmin : public NTRPCHandler {
+		public:
+			POINTER_DEFINITIONS(NTRecordAdmin);
+
+			// Most records an admin RPC may add or remove.
+			static const size_t maxBatch = 10000;
+
+			// Added records asking to be archived are archived by archiver.
+			// Given shards, only records belonging to shard are added.
+			static NTRecordAdminPtr create(
+				NTArchiverPtr const &archiver = NTArchiverPtr(),
+				NTShardMapPtr const &shards = NTShardMapPtr(),
+				size_t shard = 0);
+
+			virtual ~NTRecordAdmin() {}
+
+			// Creates the records of definitions and adds them to the master
+			// database. Returns the names of the records added. Throws,
+			// before anything is changed, if the definitions can not be
+			// parsed, stand for more than limit records and limit is not 0,
+			// or name a service record.
+			std::vector<std::string> add(
+				std::string const &definitions,
+				std::string const &source = "admin",
+				size_t limit = 0);
+
+			// Removes the named records from the master database. Returns the
+			// names of the records removed. Throws, before anything is
+			// changed, if names is malformed, names more than limit records
+			// and limit is not 0, or names a service record.
+			std::vector<std::string> remove(std::string const &names, size_t limit = 0);
+
+			// Keeps the record from being removed or replaced.
+			void addServiceRecord(std::string const &recordName);
+
+			virtual epics::pvData::PVStructurePtr handle(
+				epics::pvData::PVStructurePtr const &query);
+
+		private:
+			NTRecordAdmin(
+				NTArchiverPtr const &archiver,
+				NTShardMapPtr const &shards,
+				size_t shard);
+
+			NTArchiverPtr archiver;
+			NTShardMapPtr shards;
+			size_t shard;
+			epics::pvData::StructureConstPtr resultType;
+			std::set<std::string> serviceRecords;
+
+			// One change of the database at a time, so that the records of
+			// a batch are not interleaved with another batch's. Also guards
+			// serviceRecords.
+			epics::pvData::Mutex mutex;
+	};
+
+}}
+
+#endif /* NTRECORDADMIN_H */
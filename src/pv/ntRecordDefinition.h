@@ -0,0 +1,138 @@
+#ifndef NTRECORDDEFINITION_H
+#define NTRECORDDEFINITION_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntRecordDefinitionEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <istream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <pv/pvData.h>
+#include <pv/pvDatabase.h>
+
+#ifdef ntRecordDefinitionEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntRecordDefinitionEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntArchiver.h>
+#include <pv/ntShardMap.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	/*
+	 * Record described by a line of a record definition file.
+	 *
+	 * A line holds the name of the record, its type and any number of
+	 * options, separated by blanks. Text from # to the end of a line is
+	 * ignored. A name ending in [first-last] stands for the records name
+	 * followed by each number of the range, at most maxRange of them:
+	 *
+	 *	temperature[0-99999] scalar:double alarm timeStamp value=20.5 history=100
+	 *	setpoints scalarArray:double value=1,2.5,4
+	 *	mode enum choices=off,on,auto value=1
+	 *	log table:string columns=time:double,message alarm timeStamp
+	 *	parameters name_value
+	 *	gains matrix
+	 *
+	 * The types are those of the built in records: scalar, scalarArray,
+	 * enum, table, name_value and matrix, a scalar type following a colon
+	 * where the record has one (double by default). The options are
+	 *
+	 *	alarm, timeStamp, display, control, descriptor
+	 *	            optional fields of a scalar or table record
+	 *	columns=name[:type],...
+	 *	            columns of a table record, of the record's scalar type
+	 *	            unless given
+	 *	choices=a,b,...
+	 *	            choices of an enum record
+	 *	value=v or value=v,v,...
+	 *	            initial value of a scalar, array or enum (index) record
+	 *	history=samples, archive
+	 *	            update policies of a scalar record, as -H and -a
+	 *
+	 * Values may not contain blanks or commas.
+	 */
+	struct epicsShareClass NTRecordDefinition {
+		// Most records a range of names may stand for.
+		static const size_t maxRange = 1000000;
+
+		NTRecordDefinition()
+			: scalarType(epics::pvData::pvDouble), first(0), last(-1),
+			  history(0), archive(false), line(0) {}
+
+		std::string name;
+		std::string type;
+		epics::pvData::ScalarType scalarType;
+		// Numbers appended to name, none if last < first.
+		long first;
+		long last;
+
+		// Optional fields, sorted.
+		std::vector<std::string> fields;
+		std::vector<std::pair<std::string, epics::pvData::ScalarType> > columns;
+		std::vector<std::string> choices;
+		std::vector<std::string> value;
+
+		size_t history;
+		bool archive;
+
+		// Line of the file, for messages.
+		size_t line;
+
+		// Number of records the definition stands for.
+		size_t count() const { return last < first ? 1 : (size_t) (last - first + 1); }
+		// Name of the index-th of them.
+		std::string recordName(size_t index) const;
+		// Text equal for definitions whose records have the same structure.
+		std::string shape() const;
+	};
+
+	/*
+	 * Reads record definition files and creates their records.
+	 *
+	 * The structure of every distinct shape is built once and shared by
+	 * all the records of that shape, and the records are created by
+	 * several threads at once, so that large test databases are quick
+	 * to make.
+	 */
+	class epicsShareClass NTRecordLoader {
+		public:
+			// Appends the definitions read from in to definitions. Errors
+			// are printed with source and line and make it return false.
+			static bool parse(
+				std::istream &in,
+				std::string const &source,
+				std::vector<NTRecordDefinition> &definitions);
+
+			// Appends to names the record names in text, separated by blanks
+			// or commas, expanding name[first-last]. Returns false, leaving
+			// names as they were, if one is malformed or if there are more
+			// than limit of them and limit is not 0.
+			static bool expandNames(
+				std::string const &text,
+				std::vector<std::string> &names,
+				size_t limit = 0);
+
+			// Creates the records of definitions with the given number of
+			// threads, in order, without adding them to a database. A record
+			// that can not be created is printed and left out. Records asking
+			// to be archived are archived by archiver, if there is one. Given
+			// shards, only the records belonging to shard are created.
+			static std::vector<epics::pvDatabase::PVRecordPtr> instantiate(
+				std::vector<NTRecordDefinition> const &definitions,
+				size_t threads,
+				NTArchiverPtr const &archiver = NTArchiverPtr(),
+				NTShardMapPtr const &shards = NTShardMapPtr(),
+				size_t shard = 0);
+	};
+
+}}
+
+#endif /* NTRECORDDEFINITION_H */
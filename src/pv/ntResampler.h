@@ -0,0 +1,86 @@
+#ifndef NTRESAMPLER_H
+#define NTRESAMPLER_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntResamplerEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <vector>
+
+#include <pv/pvData.h>
+
+#ifdef ntResamplerEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntResamplerEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	/*
+	 * Resamples a waveform given at non-uniform points onto a uniform grid.
+	 *
+	 * The waveform is value[i] at base[i], with base strictly increasing.
+	 * Points of the grid before the first base or after the last one take
+	 * the first or last value. Cubic interpolation uses a natural cubic
+	 * spline, whose coefficients are computed once per waveform.
+	 *
+	 * Resampling is done in two passes: a scalar pass walks the grid and
+	 * the base together to find each point's interval, then a pass with
+	 * no branches computes every point from its interval, which the
+	 * compiler can vectorize.
+	 */
+	class epicsShareClass NTResampler {
+		public:
+			enum Method { linear, cubic };
+
+			NTResampler() : splineReady(false) {}
+
+			// Sets the waveform. Returns false, keeping the previous waveform,
+			// if base is not strictly increasing or not as long as value.
+			bool setSamples(
+				epics::pvData::shared_vector<const double> const &base,
+				epics::pvData::shared_vector<const double> const &value);
+
+			size_t getSize() const { return value.size(); }
+
+			// Whether base and value are the arrays of the current waveform.
+			// Holding them keeps their storage from being reused by others.
+			bool holds(
+				epics::pvData::shared_vector<const double> const &base,
+				epics::pvData::shared_vector<const double> const &value) const
+			{
+				return base.data() == this->base.data() && base.size() == this->base.size() &&
+					value.data() == this->value.data() && value.size() == this->value.size();
+			}
+
+			// Writes the waveform at start + j * step for j < count into out.
+			// step must be positive unless count is 1.
+			void resample(
+				double start,
+				double step,
+				size_t count,
+				Method method,
+				double *out);
+
+		private:
+			void locate(double start, double step, size_t count);
+			void computeSpline();
+
+			epics::pvData::shared_vector<const double> base;
+			epics::pvData::shared_vector<const double> value;
+
+			// Second derivatives of the spline at each base.
+			std::vector<double> secondDerivatives;
+			bool splineReady;
+
+			// Interval of each grid point and its position within it, 0 to 1.
+			std::vector<size_t> intervals;
+			std::vector<double> fractions;
+	};
+
+}}
+
+#endif /* NTRESAMPLER_H */
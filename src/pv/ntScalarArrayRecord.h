@@ -0,0 +1,122 @@
+#ifndef NTSCALARARRAYRECORD_H
+#define NTSCALARARRAYRECORD_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntScalarArrayRecordEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+
+#include <pv/pvData.h>
+
+#ifdef ntScalarArrayRecordEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntScalarArrayRecordEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntArrayChunk.h>
+#include <pv/ntRecord.h>
+#include <pv/ntStringDictionary.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTScalarArrayRecord;
+	typedef std::tr1::shared_ptr<NTScalarArrayRecord> NTScalarArrayRecordPtr;
+
+	/*
+	 * NTScalarArray record that accepts partial updates of its value.
+	 *
+	 * Besides the normative type fields the record has a slice structure:
+	 *
+	 *	slice
+	 *		int offset
+	 *		<scalarType>[] value
+	 *
+	 * A processing put of slice writes slice.value into value starting at
+	 * slice.offset, growing value if the slice runs past its end. An offset
+	 * past the end of value is refused with an alarm, so value only grows
+	 * by what a slice appends. The rest of value is untouched, and value's
+	 * storage is reused in place unless another reader still holds it.
+	 * Writing the same slice.value at a new offset writes it again. A
+	 * monitor that requests
+	 * field(slice,timeStamp) receives only the changed range.
+	 *
+	 * The record also has a chunk structure for reading value a piece
+	 * at a time, see NTArrayChunk.
+	 *
+	 * A string array record also carries value dictionary encoded:
+	 *
+	 *	dictionary
+	 *		string[] values   distinct values of value, sorted
+	 *		int[] codes       index in values of each element of value
+	 *
+	 * which processing refreshes after value changes. A client that gets
+	 * dictionary instead of value transfers each repeated string once.
+	 * A processing put of dictionary is decoded into value. See
+	 * NTStringDictionary.
+	 */
+	class epicsShareClass NTScalarArrayRecord : public NTRecord {
+		public:
+			POINTER_DEFINITIONS(NTScalarArrayRecord);
+
+			// Builds the pvStructure of the record for arrays of scalarType.
+			static epics::pvData::PVStructurePtr createPVStructure(
+				epics::pvData::ScalarType scalarType);
+
+			static NTScalarArrayRecordPtr create(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			virtual ~NTScalarArrayRecord() {}
+
+			virtual bool init();
+
+			// Outcome of writing slice into value.
+			enum SliceWrite { sliceUnchanged, sliceWritten, sliceOutOfRange };
+
+			// The slice last written into value, or refused. Holding its
+			// buffer keeps the address from being reused, so a new slice is
+			// told apart by it and by its offset.
+			struct AppliedSlice {
+				AppliedSlice() : data(0), size(0), offset(0) {}
+
+				std::tr1::shared_ptr<const void> buffer;
+				const void *data;
+				size_t size;
+				size_t offset;
+			};
+
+		protected:
+			NTScalarArrayRecord(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			virtual void processRecord();
+
+			epics::pvData::PVScalarArrayPtr pvValue;
+			epics::pvData::ScalarType scalarType;
+
+		private:
+			void applySlice();
+			void applyDictionary();
+
+			epics::pvData::PVIntPtr pvSliceOffset;
+			epics::pvData::PVScalarArrayPtr pvSliceValue;
+			AppliedSlice appliedSlice;
+
+			NTArrayChunk chunk;
+
+			// Null unless the record holds strings.
+			epics::pvData::PVStringArrayPtr pvDictionaryValues;
+			epics::pvData::PVIntArrayPtr pvDictionaryCodes;
+			// Encoding of encodedValue, as published in dictionary.
+			NTStringDictionary dictionary;
+			epics::pvData::shared_vector<const std::string> encodedValue;
+	};
+
+}}
+
+#endif /* NTSCALARARRAYRECORD_H */
@@ -0,0 +1,81 @@
+#ifndef NTSCALARRECORD_H
+#define NTSCALARRECORD_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntScalarRecordEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+
+#include <pv/pvData.h>
+
+#ifdef ntScalarRecordEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntScalarRecordEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntArchiver.h>
+#include <pv/ntHistoryBuffer.h>
+#include <pv/ntRecord.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTScalarRecord;
+	typedef std::tr1::shared_ptr<NTScalarRecord> NTScalarRecordPtr;
+
+	/*
+	 * NTScalar record that can keep a history of its value.
+	 *
+	 * With history enabled every process() appends the value, time stamp
+	 * and alarm to a NTHistoryBuffer, which the history record queries.
+	 * With archiving enabled the same sample is queued to a NTArchiver.
+	 */
+	class epicsShareClass NTScalarRecord : public NTRecord {
+		public:
+			POINTER_DEFINITIONS(NTScalarRecord);
+
+			static NTScalarRecordPtr create(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			virtual ~NTScalarRecord() {}
+
+			virtual bool init();
+			virtual void processAt(epics::pvData::TimeStamp const &processTime);
+
+			// Keeps the last capacity samples in memory. Must be called before
+			// the record is added to a database. Only records with a numeric
+			// value keep a history; returns false for the others.
+			bool enableHistory(size_t capacity);
+
+			// The record's history, or a null pointer if it keeps none.
+			NTHistoryBufferPtr getHistory() const { return history; }
+
+			// Archives every processed value. Must be called before the
+			// record is added to a database. Only records with a numeric
+			// value are archived; returns false for the others.
+			bool enableArchive(NTArchiverPtr const &archiver);
+
+			// Stops archiving, releasing the record's archive stream. Called
+			// with the record locked once it is removed from the database.
+			void disableArchive();
+
+		protected:
+			NTScalarRecord(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			epics::pvData::PVScalarPtr pvValue;
+
+		private:
+			NTHistoryBufferPtr history;
+			NTArchiverPtr archiver;
+			int archiveStream;
+	};
+
+}}
+
+#endif /* NTSCALARRECORD_H */
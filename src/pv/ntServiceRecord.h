@@ -0,0 +1,81 @@
+#ifndef NTSERVICERECORD_H
+#define NTSERVICERECORD_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntServiceRecordEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+
+#include <pv/pvData.h>
+
+#ifdef ntServiceRecordEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntServiceRecordEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntRecord.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTServiceRecord;
+	typedef std::tr1::shared_ptr<NTServiceRecord> NTServiceRecordPtr;
+
+	/*
+	 * Base class of records that act as a remote procedure.
+	 *
+	 * The record's structure is
+	 *
+	 *	argument    (defined by the derived record)
+	 *	result      (defined by the derived record)
+	 *	alarm
+	 *	timeStamp
+	 *
+	 * A client calls the procedure with a single putGet:
+	 *
+	 *	record[process=true]putField(argument)getField(result,alarm)
+	 *
+	 * process() passes argument and result to execute(). If execute()
+	 * throws, the exception's message is raised in the alarm field and
+	 * clearResult() is called, so that a failed call does not return the
+	 * result of an earlier one.
+	 */
+	class epicsShareClass NTServiceRecord : public NTRecord {
+		public:
+			POINTER_DEFINITIONS(NTServiceRecord);
+
+			// Builds the pvStructure of a service record.
+			static epics::pvData::PVStructurePtr createPVStructure(
+				epics::pvData::StructureConstPtr const &argument,
+				epics::pvData::StructureConstPtr const &result);
+
+			virtual ~NTServiceRecord() {}
+
+			virtual bool init();
+
+		protected:
+			NTServiceRecord(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			virtual void processRecord();
+
+			// Computes the result of a call from its argument.
+			virtual void execute(
+				epics::pvData::PVStructurePtr const &argument,
+				epics::pvData::PVStructurePtr const &result) = 0;
+
+			// Empties the result after execute() failed. Does nothing unless
+			// the derived record overrides it.
+			virtual void clearResult(epics::pvData::PVStructurePtr const &result) {}
+
+			epics::pvData::PVStructurePtr pvArgument;
+			epics::pvData::PVStructurePtr pvResult;
+	};
+
+}}
+
+#endif /* NTSERVICERECORD_H */
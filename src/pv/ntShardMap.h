@@ -0,0 +1,77 @@
+#ifndef NTSHARDMAP_H
+#define NTSHARDMAP_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntShardMapEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <epicsTypes.h>
+#include <pv/sharedPtr.h>
+
+#ifdef ntShardMapEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntShardMapEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTShardMap;
+	typedef std::tr1::shared_ptr<NTShardMap> NTShardMapPtr;
+
+	/*
+	 * Partition of the record names among server processes.
+	 *
+	 * Each shard is given a number of points on a ring of hash values and
+	 * a record belongs to the shard of the first point at or after the
+	 * hash of its name. Growing from K to K + 1 shards moves only about
+	 * 1 / (K + 1) of the records, all of them to the new shard.
+	 *
+	 * Shard i serves on TCP port basePort + i, so that servers and clients
+	 * agree on where a record lives from the shard count and base port
+	 * alone, without a search.
+	 */
+	class epicsShareClass NTShardMap {
+		public:
+			POINTER_DEFINITIONS(NTShardMap);
+
+			static NTShardMapPtr create(
+				size_t shards,
+				unsigned short basePort = defaultBasePort,
+				size_t points = defaultPoints);
+
+			// Shard owning the named record.
+			size_t shardOf(std::string const &recordName) const;
+
+			// TCP port of the server of shard.
+			unsigned short portOf(size_t shard) const { return basePort + shard; }
+
+			size_t getShards() const { return shards; }
+			unsigned short getBasePort() const { return basePort; }
+
+			static const unsigned short defaultBasePort = 5080;
+			// Enough points per shard to keep most shards within about ten
+			// percent of an even share.
+			static const size_t defaultPoints = 128;
+
+		private:
+			NTShardMap(size_t shards, unsigned short basePort, size_t points);
+
+			// Position of key on the ring.
+			static epicsUInt64 hash(std::string const &key);
+
+			size_t shards;
+			unsigned short basePort;
+			// Points of the ring, sorted by hash, and the shard of each.
+			std::vector<std::pair<epicsUInt64, size_t> > ring;
+	};
+
+}}
+
+#endif /* NTSHARDMAP_H */
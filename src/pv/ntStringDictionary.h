@@ -0,0 +1,79 @@
+#ifndef NTSTRINGDICTIONARY_H
+#define NTSTRINGDICTIONARY_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntStringDictionaryEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+
+#include <pv/pvData.h>
+
+#ifdef ntStringDictionaryEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntStringDictionaryEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	/*
+	 * Dictionary encoding of an array of strings.
+	 *
+	 * The array is held as its distinct values, in sorted order, and one
+	 * code per cell giving the position of the cell's value. Arrays that
+	 * repeat a few hundred values across many cells take four bytes per
+	 * cell plus the values once, rather than a string per cell.
+	 *
+	 * As the values are sorted, codes compare as the strings they stand
+	 * for, so a condition on the strings is answered by comparing codes.
+	 */
+	class epicsShareClass NTStringDictionary {
+		public:
+			NTStringDictionary() {}
+
+			// Encodes cells, replacing the previous contents.
+			void encode(epics::pvData::shared_vector<const std::string> const &cells);
+
+			// Sets the dictionary from its encoded form. Returns false, leaving
+			// the dictionary alone, if values are not distinct and sorted or a
+			// code is out of range.
+			bool assign(
+				epics::pvData::shared_vector<const std::string> const &values,
+				epics::pvData::shared_vector<const epics::pvData::int32> const &codes);
+
+			// Decodes the cells. Cells with the same value are copies of one
+			// string, which share storage where std::string does.
+			epics::pvData::shared_vector<const std::string> decode() const;
+
+			epics::pvData::shared_vector<const std::string> const &getValues() const { return values; }
+			epics::pvData::shared_vector<const epics::pvData::int32> const &getCodes() const { return codes; }
+
+			// Number of cells.
+			size_t size() const { return codes.size(); }
+
+			// Code of value, or -1 if no cell holds it.
+			epics::pvData::int32 find(std::string const &value) const;
+			// Lowest code whose value is not less than value, or the number of
+			// values if there is none.
+			epics::pvData::int32 lowerBound(std::string const &value) const;
+			// Lowest code whose value is greater than value.
+			epics::pvData::int32 upperBound(std::string const &value) const;
+			// Lowest code past the values starting with prefix.
+			epics::pvData::int32 prefixEnd(std::string const &prefix) const;
+
+			// Bytes held by the encoded form.
+			size_t memoryUsed() const;
+			// Bytes held by cells as an array of strings.
+			static size_t memoryUsed(epics::pvData::shared_vector<const std::string> const &cells);
+
+		private:
+			epics::pvData::shared_vector<const std::string> values;
+			epics::pvData::shared_vector<const epics::pvData::int32> codes;
+	};
+
+}}
+
+#endif /* NTSTRINGDICTIONARY_H */
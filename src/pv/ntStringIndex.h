@@ -0,0 +1,66 @@
+#ifndef NTSTRINGINDEX_H
+#define NTSTRINGINDEX_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntStringIndexEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+#include <vector>
+
+#include <pv/pvData.h>
+
+#ifdef ntStringIndexEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntStringIndexEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	/*
+	 * Hash index from strings to positions.
+	 *
+	 * An open addressing table, kept at most half full, so that a lookup
+	 * usually compares one string. The index holds its own copy of the
+	 * keys.
+	 */
+	class epicsShareClass NTStringIndex {
+		public:
+			NTStringIndex();
+
+			// Indexes each element of keys by its position. An element equal to
+			// an earlier one is left out.
+			void build(epics::pvData::shared_vector<const std::string> const &keys);
+
+			// Empties the index.
+			void clear();
+
+			// Position of key, or -1 if it is not indexed.
+			epics::pvData::int32 find(std::string const &key) const;
+
+			// Indexes key at position. Returns false if key is already indexed.
+			bool insert(std::string const &key, epics::pvData::int32 position);
+
+			// Number of keys indexed.
+			size_t size() const { return keys.size(); }
+
+			static size_t hash(std::string const &key);
+
+		private:
+			// Slot holding key, or the empty slot where it would go.
+			size_t findSlot(std::string const &key, size_t hash) const;
+			void grow();
+
+			std::vector<std::string> keys;
+			std::vector<size_t> hashes;
+			std::vector<epics::pvData::int32> positions;
+			// Entry in keys of each slot, or none.
+			std::vector<epics::pvData::uint32> slots;
+	};
+
+}}
+
+#endif /* NTSTRINGINDEX_H */
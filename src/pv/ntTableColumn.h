@@ -0,0 +1,123 @@
+#ifndef NTTABLECOLUMN_H
+#define NTTABLECOLUMN_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntTableColumnEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+#include <vector>
+
+#include <pv/pvData.h>
+
+#ifdef ntTableColumnEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntTableColumnEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntStringDictionary.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	// Condition on the cells of one column of a table. Operands are given as
+	// strings and read as numbers when the column is numeric.
+	struct epicsShareClass NTTablePredicate {
+		enum Op { all, equal, range, prefix };
+
+		NTTablePredicate() : op(all) {}
+
+		Op op;
+		// Operand of equal and prefix. Prefix applies to string columns only.
+		std::string value;
+		// Inclusive bounds of range, empty for no bound.
+		std::string low;
+		std::string high;
+	};
+
+	/*
+	 * One column of a NTTable record, with an optional index over it.
+	 *
+	 * Numeric columns are held as doubles and string columns by their
+	 * dictionary codes, so that a predicate is evaluated by comparing
+	 * numbers down a single array. As codes are ordered as the strings,
+	 * every predicate on a string column becomes a range of codes. A sorted
+	 * index keeps the rows ordered by their cell and answers every predicate
+	 * by binary search. A hash index answers equal by following the chain of
+	 * rows in the bucket of the operand. Other predicates, and every
+	 * predicate on a column without an index, scan the column.
+	 *
+	 * The column is refreshed from its array by set(), which rebuilds the
+	 * index only when a put replaced the array.
+	 */
+	class epicsShareClass NTTableColumn {
+		public:
+			enum Index { none, sorted, hash };
+
+			NTTableColumn() : scalarType(epics::pvData::pvString), index(none), built(false) {}
+
+			// Refreshes the column from array. Returns true if the array
+			// changed since the last call.
+			bool set(epics::pvData::PVScalarArrayPtr const &array);
+
+			// Selects the index kept over the column.
+			void setIndex(Index index);
+			Index getIndex() const { return index; }
+
+			// Number of cells in the column.
+			size_t size() const;
+
+			// Appends to rows, in increasing order, the first limit rows below
+			// length matching predicate, or all of them if limit is 0. Throws if
+			// the predicate does not apply to the column.
+			void select(
+				NTTablePredicate const &predicate,
+				size_t length,
+				size_t limit,
+				std::vector<epics::pvData::uint32> &rows);
+
+			// Returns the cells at rows, in the column's type. Rows past the end
+			// of the column give empty strings or zeros.
+			epics::pvData::shared_vector<const void> gather(
+				std::vector<epics::pvData::uint32> const &rows) const;
+
+		private:
+			void build();
+
+			template<typename T>
+			void buildIndex(epics::pvData::shared_vector<const T> const &keys);
+
+			// Appends the rows whose key is within the bounds.
+			template<typename T>
+			void selectKeys(
+				epics::pvData::shared_vector<const T> const &keys,
+				T low,
+				T high,
+				bool hasLow,
+				bool hasHigh,
+				bool equal,
+				size_t limit,
+				std::vector<epics::pvData::uint32> &rows) const;
+
+			epics::pvData::ScalarType scalarType;
+			// The array last given to set(), to tell when it is replaced.
+			epics::pvData::shared_vector<const void> source;
+			// String cells, dictionary encoded, or numeric cells.
+			NTStringDictionary dictionary;
+			epics::pvData::shared_vector<const double> numbers;
+
+			Index index;
+			bool built;
+			// Rows in the order of their cells, for a sorted index.
+			std::vector<epics::pvData::uint32> order;
+			// First row of each bucket and the next row in the same bucket,
+			// for a hash index.
+			std::vector<epics::pvData::uint32> buckets;
+			std::vector<epics::pvData::uint32> next;
+	};
+
+}}
+
+#endif /* NTTABLECOLUMN_H */
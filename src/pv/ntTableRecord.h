@@ -0,0 +1,125 @@
+#ifndef NTTABLERECORD_H
+#define NTTABLERECORD_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntTableRecordEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <string>
+#include <vector>
+
+#include <pv/pvData.h>
+
+#ifdef ntTableRecordEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntTableRecordEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntRecord.h>
+#include <pv/ntTableColumn.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	class NTTableRecord;
+	typedef std::tr1::shared_ptr<NTTableRecord> NTTableRecordPtr;
+
+	/*
+	 * NTTable record that answers queries for some of its rows and columns,
+	 * so that a client does not have to read the whole table.
+	 *
+	 * Besides the normative type fields the record has a query structure:
+	 *
+	 *	query
+	 *		string[] columns  columns to return, empty for every column
+	 *		where
+	 *			string column   column tested, empty for every row
+	 *			string op       eq, range or prefix
+	 *			string value    operand of eq and prefix
+	 *			string low      inclusive bounds of range, empty for none
+	 *			string high
+	 *		int limit         most rows to return, 0 for no limit
+	 *		result            NTTable of the matching rows, in table order.
+	 *		                  Its labels name every column, as the table's
+	 *		                  do; columns that were not asked for are empty.
+	 *
+	 * A client runs a query with
+	 *
+	 *	record[process=true]putField(query.columns,query.where,query.limit)
+	 *		getField(query.result)
+	 *
+	 * Columns may be given a sorted or hash index with addIndex(). Indexes
+	 * are brought up to date when the record is processed after a put. The
+	 * result is kept until the table or the query changes. A malformed
+	 * query raises the alarm and empties the result. See NTTableColumn.
+	 */
+	class epicsShareClass NTTableRecord : public NTRecord {
+		public:
+			POINTER_DEFINITIONS(NTTableRecord);
+
+			// Builds the pvStructure of a table record from its NTTable structure.
+			static epics::pvData::PVStructurePtr createPVStructure(
+				epics::pvData::StructureConstPtr const &table);
+
+			static NTTableRecordPtr create(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			virtual ~NTTableRecord() {}
+
+			virtual bool init();
+
+			// Keeps an index, "sorted" or "hash", over the named column.
+			// Returns false if there is no such column or kind of index.
+			bool addIndex(std::string const &column, std::string const &kind);
+
+		protected:
+			NTTableRecord(
+				std::string const &recordName,
+				epics::pvData::PVStructurePtr const &pvStructure);
+
+			virtual void processRecord();
+
+		private:
+			// Arguments of a query, compared to tell whether its result is
+			// still current.
+			struct Query {
+				Query() : limit(0) {}
+
+				bool operator==(Query const &other) const;
+
+				epics::pvData::shared_vector<const std::string> columns;
+				std::string column;
+				std::string op;
+				std::string value;
+				std::string low;
+				std::string high;
+				epics::pvData::int32 limit;
+			};
+
+			// Fills query.result with the rows and columns selected by query.
+			void execute(Query const &query);
+
+			// Index in names of the named column. Throws if there is none.
+			size_t findColumn(std::string const &name) const;
+
+			epics::pvData::PVStructurePtr pvValue;
+			epics::pvData::PVStructurePtr pvQuery;
+			epics::pvData::PVStringArrayPtr pvResultLabels;
+			epics::pvData::PVStructurePtr pvResultValue;
+
+			// Column names and columns, in the order of the value structure.
+			std::vector<std::string> names;
+			std::vector<NTTableColumn> columns;
+
+			// Set when the table changed since query.result was computed.
+			bool stale;
+			// The query whose result query.result holds.
+			Query computed;
+	};
+
+}}
+
+#endif /* NTTABLERECORD_H */
@@ -0,0 +1,90 @@
+#ifndef NTTHREADPLACEMENT_H
+#define NTTHREADPLACEMENT_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntThreadPlacementEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef ntThreadPlacementEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntThreadPlacementEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	/*
+	 * Cpus, number and scheduling priority of the threads of one role.
+	 *
+	 * The roles are
+	 *
+	 *	io        the pvAccess server, whose threads serve the channels and
+	 *	          process the records written by clients, and the
+	 *	          admission workers doing so under admission control
+	 *	scan      the thread of NTProcessQueue, processing calc, aggregate
+	 *	          and gather records and the periodic scans
+	 *	rpc       the workers of the rpc record
+	 *	archive   the thread writing the archive
+	 *
+	 * A placement is written as keys separated by colons, for example
+	 *
+	 *	cpus=2-3,6:threads=4:priority=50
+	 *
+	 * where cpus lists the cpus the threads may run on, threads is the
+	 * size of a pool (only the rpc workers have one) and priority is a
+	 * SCHED_FIFO priority from 1 to 99, which needs the privilege to use
+	 * real time scheduling. A role without a placement keeps the cpus and
+	 * scheduling of the thread that created it.
+	 *
+	 * Threads inherit the cpus of the thread creating them, and memory is
+	 * placed on the NUMA node of the cpu that first writes it. ntDatabaseMain
+	 * applies the io placement to its main thread before it creates the
+	 * records and starts the server, so the records are allocated on the
+	 * node of the threads serving them.
+	 *
+	 * The placement functions do nothing outside Linux.
+	 */
+	struct epicsShareClass NTThreadPlacement {
+		NTThreadPlacement() : threads(0), priority(0) {}
+
+		// Cpus the threads may run on, any if empty.
+		std::vector<int> cpus;
+		// Threads of the role's pool, 0 for its default.
+		size_t threads;
+		// SCHED_FIFO priority, 0 to keep the default scheduling.
+		int priority;
+
+		// Parses text as described above. Returns false if it is malformed.
+		static bool parse(std::string const &text, NTThreadPlacement &placement);
+
+		// Pins the calling thread to cpus and sets its priority. Failures
+		// are printed and make it return false.
+		bool apply() const;
+
+		// Placement of the threads of role, the default one if none was set.
+		static void set(std::string const &role, NTThreadPlacement const &placement);
+		static NTThreadPlacement get(std::string const &role);
+
+		// Applies the placement of role to the calling thread. Called by
+		// each thread of a role as it starts.
+		static void applyRole(std::string const &role);
+
+		// Cpu the calling thread is running on and its kernel thread id,
+		// or -1 if unknown.
+		static int currentCpu();
+		static long currentThread();
+
+		// Writes a line per thread of the process: its id and name, the cpu
+		// it last ran on, the cpus it may run on and its priority.
+		static void writeThreads(std::ostream &out);
+	};
+
+}}
+
+#endif /* NTTHREADPLACEMENT_H */
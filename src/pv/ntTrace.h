@@ -0,0 +1,76 @@
+#ifndef NTTRACE_H
+#define NTTRACE_H
+
+#ifdef epicsExportSharedSymbols
+#	define  ntTraceEpicsExportSharedSymbols
+#	undef   epicsExportSharedSymbols
+#endif
+
+#include <ostream>
+#include <string>
+
+#include <epicsTypes.h>
+
+#ifdef ntTraceEpicsExportSharedSymbols
+#	define epicsExportSharedSymbols  
+#	undef  ntTraceEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace ntDatabase {
+
+	/*
+	 * Latency tracing of the stages of a request.
+	 *
+	 * A stage is recorded with its start and end, epicsMonotonicGet()
+	 * times, which every process of a host shares, and a label such as the
+	 * record's name. The stages are
+	 *
+	 *	client.putGet    a client's putGet(), from send to reply
+	 *	client.monitor   from a client's put to the monitor update it caused
+	 *	admission.wait   a client's put or RPC waiting to be admitted
+	 *	rpc.wait         an RPC waiting in the queue for a worker
+	 *	rpc.run          an RPC method running
+	 *	record.lock      waiting for a record's lock
+	 *	record.process   the record's process(), with its lock held
+	 *	record.post      endGroupPut(), queueing the record's monitor updates
+	 *
+	 * Puts from the network reach process() inside pvDatabase, so for them
+	 * record.lock and record.post are not seen, and the time between
+	 * record.process and client.monitor is spent queueing and sending the
+	 * update.
+	 *
+	 * Each thread records into a ring of its own without locking, keeping
+	 * its last ringSize stages. The rings are read by writeChrome(), which
+	 * skips stages overwritten while it reads. Tracing is off until
+	 * enabled, when recording costs a check of a flag.
+	 */
+	class epicsShareClass NTTrace {
+		public:
+			static void enable(bool enabled);
+			static bool isEnabled();
+
+			// Records a stage. name must be a string literal. label is cut
+			// to 39 characters.
+			static void record(
+				const char *name,
+				std::string const &label,
+				epicsUInt64 start,
+				epicsUInt64 end);
+
+			// Forgets the stages recorded so far.
+			static void clear();
+
+			// Writes the recorded stages in the Chrome trace event format,
+			// read by chrome://tracing and Perfetto, as complete events of
+			// this process with the threads named.
+			static void writeChrome(std::ostream &out);
+
+			// Stages kept per thread.
+			static const size_t ringSize = 16384;
+	};
+
+}}
+
+#endif /* NTTRACE_H */